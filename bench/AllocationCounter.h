@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Heap allocations made by the process so far, counted by replacing the global
+ * operator new in AllocationCounter.cpp. Every thread's allocations count, so
+ * the pool's workers are included.
+ */
+struct AllocationCounter {
+    static uint64_t count();
+    static uint64_t bytes();
+};
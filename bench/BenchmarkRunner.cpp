@@ -0,0 +1,304 @@
+#include "BenchmarkRunner.h"
+#include "AllocationCounter.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/**
+ * Cycle and instruction counters of the calling thread through perf_event_open.
+ * Containers and locked-down kernels usually refuse them; available() is then
+ * false and the results leave the fields out.
+ */
+class HardwareCounters {
+public:
+    HardwareCounters() {
+#if defined(__linux__)
+        cycles_ = open(PERF_COUNT_HW_CPU_CYCLES);
+        instructions_ = open(PERF_COUNT_HW_INSTRUCTIONS);
+        if (cycles_ < 0 || instructions_ < 0) {
+            close();
+        }
+#endif
+    }
+    ~HardwareCounters() { close(); }
+
+    HardwareCounters(const HardwareCounters&) = delete;
+    HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+    bool available() const { return cycles_ >= 0; }
+
+    void start() {
+#if defined(__linux__)
+        if (available()) {
+            ioctl(cycles_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(instructions_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(cycles_, PERF_EVENT_IOC_ENABLE, 0);
+            ioctl(instructions_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Counts since start()
+    void stop(uint64_t& cycles, uint64_t& instructions) {
+        cycles = 0;
+        instructions = 0;
+#if defined(__linux__)
+        if (available()) {
+            ioctl(cycles_, PERF_EVENT_IOC_DISABLE, 0);
+            ioctl(instructions_, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(cycles_, &cycles, sizeof(cycles)) != sizeof(cycles) ||
+                read(instructions_, &instructions, sizeof(instructions)) != sizeof(instructions)) {
+                cycles = instructions = 0;
+            }
+        }
+#endif
+    }
+
+private:
+#if defined(__linux__)
+    static int open(uint64_t config) {
+        perf_event_attr attr = {};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+    void close() {
+#if defined(__linux__)
+        if (cycles_ >= 0) ::close(cycles_);
+        if (instructions_ >= 0) ::close(instructions_);
+#endif
+        cycles_ = instructions_ = -1;
+    }
+
+    int cycles_ = -1;
+    int instructions_ = -1;
+};
+
+struct Repetition {
+    uint64_t iterations = 0;
+    double nsPerIteration = 0.0;
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+};
+
+std::string escape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+// Six digits are plenty for timings; JSON has no infinities
+std::string number(double value) {
+    if (!std::isfinite(value)) {
+        return "0";
+    }
+    std::ostringstream out;
+    out << std::setprecision(6) << value;
+    return out.str();
+}
+
+// Value of "key": in one line of writeJson() output
+bool findField(const std::string& line, const std::string& key, std::string& value) {
+    const std::string token = "\"" + key + "\": ";
+    const size_t at = line.find(token);
+    if (at == std::string::npos) {
+        return false;
+    }
+    size_t begin = at + token.size();
+    size_t end;
+    if (begin < line.size() && line[begin] == '"') {
+        ++begin;
+        end = line.find('"', begin);
+    } else {
+        end = line.find_first_of(",}", begin);
+    }
+    if (end == std::string::npos) {
+        return false;
+    }
+    value = line.substr(begin, end - begin);
+    return true;
+}
+
+} // namespace
+
+bool BenchmarkRunner::selected(const Case& benchmark) const {
+    return benchmark.bodies <= options_.maxBodies &&
+           (options_.filter.empty() || benchmark.name.find(options_.filter) != std::string::npos);
+}
+
+std::vector<std::string> BenchmarkRunner::list() const {
+    std::vector<std::string> names;
+    for (const Case& benchmark : cases_) {
+        if (selected(benchmark)) {
+            names.push_back(benchmark.name);
+        }
+    }
+    return names;
+}
+
+std::vector<BenchmarkRunner::Result> BenchmarkRunner::run(std::ostream& log) {
+    using Clock = std::chrono::steady_clock;
+    HardwareCounters counters;
+    std::vector<Result> results;
+
+    log << std::left << std::setw(40) << "benchmark" << std::right << std::setw(8) << "iters"
+        << std::setw(14) << "ns/iter" << std::setw(12) << "ns/item" << std::setw(14) << "inter/s"
+        << std::setw(12) << "allocs/iter" << std::setw(10) << "cyc/item" << "\n";
+
+    for (const Case& benchmark : cases_) {
+        if (!selected(benchmark)) {
+            continue;
+        }
+        Iteration iteration = benchmark.prepare();
+        if (!iteration) {
+            log << std::left << std::setw(40) << benchmark.name << "  skipped\n" << std::flush;
+            continue;
+        }
+
+        // The warm-up fills caches, pools and scratch buffers so they are not charged to the first repetition
+        iteration();
+
+        std::vector<Repetition> repetitions;
+        for (size_t r = 0; r < std::max<size_t>(1, options_.repetitions); ++r) {
+            Repetition rep;
+            const uint64_t allocationsBefore = AllocationCounter::count();
+            const uint64_t bytesBefore = AllocationCounter::bytes();
+            counters.start();
+            const Clock::time_point start = Clock::now();
+            double elapsed = 0.0;
+            do {
+                iteration();
+                ++rep.iterations;
+                elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            } while (elapsed < options_.minTime);
+            counters.stop(rep.cycles, rep.instructions);
+            rep.allocations = AllocationCounter::count() - allocationsBefore;
+            rep.bytes = AllocationCounter::bytes() - bytesBefore;
+            rep.nsPerIteration = elapsed * 1e9 / static_cast<double>(rep.iterations);
+            repetitions.push_back(rep);
+        }
+        std::sort(repetitions.begin(), repetitions.end(),
+                  [](const Repetition& a, const Repetition& b) { return a.nsPerIteration < b.nsPerIteration; });
+        const Repetition& median = repetitions[repetitions.size() / 2];
+
+        Result result;
+        result.name = benchmark.name;
+        result.bodies = benchmark.bodies;
+        result.items = benchmark.items > 0 ? benchmark.items : benchmark.bodies;
+        result.iterations = median.iterations;
+        result.nsPerIteration = median.nsPerIteration;
+        const double items = static_cast<double>(std::max<size_t>(1, result.items));
+        const double iterations = static_cast<double>(median.iterations);
+        result.nsPerItem = median.nsPerIteration / items;
+        result.interactionsPerSecond = benchmark.interactions * 1e9 / median.nsPerIteration;
+        result.allocationsPerIteration = static_cast<double>(median.allocations) / iterations;
+        result.bytesPerIteration = static_cast<double>(median.bytes) / iterations;
+        if (counters.available() && median.cycles > 0) {
+            result.cyclesPerItem = static_cast<double>(median.cycles) / (iterations * items);
+            result.instructionsPerCycle = static_cast<double>(median.instructions) / static_cast<double>(median.cycles);
+        }
+        results.push_back(result);
+
+        // The iteration and everything it owns are released before the next case is built
+        iteration = Iteration();
+
+        log << std::left << std::setw(40) << result.name << std::right << std::setw(8) << result.iterations
+            << std::setw(14) << number(result.nsPerIteration) << std::setw(12) << number(result.nsPerItem)
+            << std::setw(14) << (benchmark.interactions > 0.0 ? number(result.interactionsPerSecond) : "-")
+            << std::setw(12) << number(result.allocationsPerIteration)
+            << std::setw(10) << (result.cyclesPerItem >= 0.0 ? number(result.cyclesPerItem) : "-")
+            << "\n" << std::flush;
+    }
+    return results;
+}
+
+void BenchmarkRunner::writeJson(std::ostream& out, const Context& context, const std::vector<Result>& results) {
+    out << "{\n  \"context\": {";
+    for (size_t i = 0; i < context.size(); ++i) {
+        out << (i ? ", " : "") << "\"" << escape(context[i].first) << "\": \"" << escape(context[i].second) << "\"";
+    }
+    out << "},\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "    {\"name\": \"" << escape(r.name) << "\", \"bodies\": " << r.bodies
+            << ", \"items\": " << r.items << ", \"iterations\": " << r.iterations
+            << ", \"ns_per_iteration\": " << number(r.nsPerIteration)
+            << ", \"ns_per_item\": " << number(r.nsPerItem)
+            << ", \"interactions_per_second\": " << number(r.interactionsPerSecond)
+            << ", \"allocations_per_iteration\": " << number(r.allocationsPerIteration)
+            << ", \"bytes_per_iteration\": " << number(r.bytesPerIteration);
+        if (r.cyclesPerItem >= 0.0) {
+            out << ", \"cycles_per_item\": " << number(r.cyclesPerItem)
+                << ", \"instructions_per_cycle\": " << number(r.instructionsPerCycle);
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int BenchmarkRunner::compare(const std::vector<Result>& results, const std::string& baselinePath,
+                             double tolerance, std::ostream& out, std::string& error) {
+    std::ifstream file(baselinePath);
+    if (!file) {
+        error = "Cannot open " + baselinePath;
+        return -1;
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string name, value;
+        if (findField(line, "name", name) && findField(line, "ns_per_iteration", value)) {
+            baseline[name] = std::strtod(value.c_str(), nullptr);
+        }
+    }
+    if (baseline.empty()) {
+        error = baselinePath + ": no benchmark results";
+        return -1;
+    }
+
+    int regressions = 0;
+    out << std::left << std::setw(40) << "benchmark" << std::right << std::setw(14) << "baseline ns"
+        << std::setw(14) << "ns" << std::setw(10) << "ratio" << "\n";
+    for (const Result& r : results) {
+        const auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0.0) {
+            out << std::left << std::setw(40) << r.name << "  new\n";
+            continue;
+        }
+        const double ratio = r.nsPerIteration / it->second;
+        const bool slower = ratio > 1.0 + tolerance;
+        regressions += slower ? 1 : 0;
+        out << std::left << std::setw(40) << r.name << std::right << std::setw(14) << number(it->second)
+            << std::setw(14) << number(r.nsPerIteration) << std::setw(10) << std::fixed << std::setprecision(3)
+            << ratio << std::defaultfloat << (slower ? "  REGRESSION" : "") << "\n";
+    }
+    return regressions;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Timing harness behind GravityBench.
+ *
+ * A case builds its inputs once, untimed, and hands back one iteration of the
+ * work. Each case runs a warm-up iteration, then several repetitions of as
+ * many iterations as fit in the minimum time; the median repetition is
+ * reported along with allocations per iteration (see AllocationCounter.h) and,
+ * where the kernel allows it, hardware cycle and instruction counts. Results
+ * are written as JSON with one case per line so two runs diff cleanly and
+ * compare() can check one against another.
+ */
+class BenchmarkRunner {
+public:
+    // One iteration of the work being measured
+    using Iteration = std::function<void()>;
+
+    struct Case {
+        std::string name;             // group/variant/N; results are matched by it
+        size_t bodies = 0;            // Size of the scenario, which Options::maxBodies limits
+        size_t items = 0;             // Units of work per iteration for ns_per_item; bodies if 0
+        double interactions = 0.0;    // Pairwise interactions per iteration; 0 where there is no such count
+        // Build the inputs and return the iteration, which owns them through its captures;
+        // an empty iteration skips the case (no GL context, instruction set missing)
+        std::function<Iteration()> prepare;
+    };
+
+    struct Options {
+        std::string filter;           // Only run cases whose name contains this
+        size_t maxBodies = 1000000;   // Skip larger cases
+        double minTime = 0.2;         // Seconds per repetition
+        size_t repetitions = 3;
+    };
+
+    struct Result {
+        std::string name;
+        size_t bodies = 0;
+        size_t items = 0;
+        uint64_t iterations = 0;           // Per repetition
+        double nsPerIteration = 0.0;       // Median repetition
+        double nsPerItem = 0.0;            // ns per body-step for the stepping cases
+        double interactionsPerSecond = 0.0;
+        double allocationsPerIteration = 0.0;
+        double bytesPerIteration = 0.0;
+        // Hardware counters of the calling thread; negative when the system offers none
+        double cyclesPerItem = -1.0;
+        double instructionsPerCycle = -1.0;
+    };
+
+    // Name and value pairs describing the machine and build, written at the top of the JSON
+    using Context = std::vector<std::pair<std::string, std::string>>;
+
+    explicit BenchmarkRunner(const Options& options) : options_(options) {}
+
+    void add(Case benchmark) { cases_.push_back(std::move(benchmark)); }
+
+    // Names of the cases the options select
+    std::vector<std::string> list() const;
+
+    // Run the selected cases, printing a table row to log as each finishes
+    std::vector<Result> run(std::ostream& log);
+
+    static void writeJson(std::ostream& out, const Context& context, const std::vector<Result>& results);
+
+    /**
+     * Compare results with a JSON file from an earlier run and print the ratios.
+     * @return Cases slower than the baseline by more than tolerance (0.1 = 10%);
+     *         -1 with error set if the baseline cannot be read
+     */
+    static int compare(const std::vector<Result>& results, const std::string& baselinePath,
+                       double tolerance, std::ostream& out, std::string& error);
+
+private:
+    bool selected(const Case& benchmark) const;
+
+    Options options_;
+    std::vector<Case> cases_;
+};
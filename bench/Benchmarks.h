@@ -0,0 +1,14 @@
+#pragma once
+#include "BenchmarkRunner.h"
+#include "Scenario.h"
+#include <cstddef>
+
+// The first bodies of the built-in solar system, then a seeded main belt up to bodies in total.
+// One seed throughout, so a given count is the same scenario on every run and every machine.
+Scenario seededScenario(size_t bodies, bool threeD = false);
+
+// Kernels, force solvers, integrators, test particles and the spacetime field
+void addCoreBenchmarks(BenchmarkRunner& runner, size_t threads);
+
+// Trail updates and the GPU backend; they need a GL context and skip without one
+void addGraphicsBenchmarks(BenchmarkRunner& runner, size_t threads);
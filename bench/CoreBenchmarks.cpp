@@ -0,0 +1,260 @@
+#include "Benchmarks.h"
+#include "Physics.h"
+#include "SolarSystem.h"
+#include "GravityKernel.h"
+#include "GravityField.h"
+#include "DirectSolver.h"
+#include "BarnesHutSolver.h"
+#include "FmmSolver.h"
+#include "SymplecticIntegrators.h"
+#include "DormandPrinceIntegrator.h"
+#include "BlockTimestepIntegrator.h"
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t SEED = 20240601;
+
+// Scenario sizes from a handful of bodies to the largest belts the scenarios ship with
+const size_t SOLVER_SIZES[] = {10, 100, 1000, 10000, 100000, 1000000};
+// Direct summation at a million bodies is minutes per iteration
+constexpr size_t DIRECT_LIMIT = 100000;
+
+std::string caseName(const std::string& group, const std::string& variant, size_t n) {
+    return group + "/" + variant + "/" + std::to_string(n);
+}
+
+std::shared_ptr<SolarSystem> loadSystem(const Scenario& scenario, size_t threads) {
+    auto system = std::make_shared<SolarSystem>();
+    system->setThreadCount(threads);
+    system->load(scenario);
+    BodyStore& store = system->getStore();
+    store.recenterOrigin();
+    // Every axis, so the kernel cases can read z whatever mode the scenario is in
+    store.updateSinglePositions(0, store.size(), true);
+    return system;
+}
+
+// Packed single-precision copy of a scenario for the kernels
+struct KernelInput {
+    std::vector<float> x, y, z, gm;
+    std::vector<float> ax, ay, az;
+
+    explicit KernelInput(const BodyStore& store)
+        : x(store.px), y(store.py), z(store.pz), gm(store.gm),
+          ax(store.size()), ay(store.size()), az(store.size()) {}
+
+    GravityKernel::Sources sources() const { return {x.data(), y.data(), z.data(), gm.data(), gm.size()}; }
+
+    void clear() {
+        std::fill(ax.begin(), ax.end(), 0.0f);
+        std::fill(ay.begin(), ay.end(), 0.0f);
+        std::fill(az.begin(), az.end(), 0.0f);
+    }
+};
+
+void addKernelBenchmarks(BenchmarkRunner& runner) {
+    using Isa = GravityKernel::Isa;
+    const Isa isas[] = {Isa::Scalar, Isa::AVX2, Isa::AVX512, Isa::NEON};
+    const char* variants[] = {"scalar", "avx2", "avx512", "neon"};
+    const size_t sizes[] = {1000, 10000};
+
+    for (size_t k = 0; k < 4; ++k) {
+        const Isa isa = isas[k];
+        for (size_t n : sizes) {
+            // The instruction set is process-wide, so each iteration selects its own and puts the
+            // detected one back for the cases that follow
+            runner.add({caseName("kernel/pairs", variants[k], n), n, 0, n * (n - 1) / 2.0,
+                        [isa, n]() -> BenchmarkRunner::Iteration {
+                GravityKernel::setIsa(isa);
+                const bool supported = GravityKernel::getIsa() == isa;
+                GravityKernel::setIsa(GravityKernel::detectIsa());
+                if (!supported) {
+                    return nullptr;
+                }
+                auto input = std::make_shared<KernelInput>(loadSystem(seededScenario(n), 1)->getStore());
+                return [isa, input]() {
+                    GravityKernel::setIsa(isa);
+                    input->clear();
+                    GravityKernel::accumulatePairs(input->sources(), 0, input->gm.size(), SolarSystem::getSoftening2(),
+                                                   input->ax.data(), input->ay.data(), input->az.data(), false);
+                    GravityKernel::setIsa(GravityKernel::detectIsa());
+                };
+            }});
+
+            runner.add({caseName("kernel/field", variants[k], n), n, 0, static_cast<double>(n) * n,
+                        [isa, n]() -> BenchmarkRunner::Iteration {
+                GravityKernel::setIsa(isa);
+                const bool supported = GravityKernel::getIsa() == isa;
+                GravityKernel::setIsa(GravityKernel::detectIsa());
+                if (!supported) {
+                    return nullptr;
+                }
+                auto input = std::make_shared<KernelInput>(loadSystem(seededScenario(n), 1)->getStore());
+                return [isa, input]() {
+                    const GravityKernel::Targets targets{input->x.data(), input->y.data(), input->z.data(),
+                                                         input->x.size()};
+                    GravityKernel::setIsa(isa);
+                    input->clear();
+                    GravityKernel::accumulateField(input->sources(), targets, SolarSystem::getSoftening2(),
+                                                   input->ax.data(), input->ay.data(), input->az.data(), false);
+                    GravityKernel::setIsa(GravityKernel::detectIsa());
+                };
+            }});
+        }
+    }
+}
+
+using SolverFactory = std::function<std::unique_ptr<ForceSolver>()>;
+
+void addSolverBenchmarks(BenchmarkRunner& runner, size_t threads) {
+    const std::pair<const char*, SolverFactory> solvers[] = {
+        {"direct", []() { return std::make_unique<DirectSolver>(); }},
+        {"barnes-hut", []() { return std::make_unique<BarnesHutSolver>(); }},
+        {"fmm", []() { return std::make_unique<FmmSolver>(); }},
+    };
+
+    for (const auto& solver : solvers) {
+        const bool direct = solver.first == std::string("direct");
+        for (size_t n : SOLVER_SIZES) {
+            if (direct && n > DIRECT_LIMIT) {
+                continue;
+            }
+            // Tree solvers do fewer interactions; the count is the direct one they stand in for
+            const SolverFactory factory = solver.second;
+            runner.add({caseName("solver", solver.first, n), n, 0, n * (n - 1) / 2.0,
+                        [factory, n, threads]() -> BenchmarkRunner::Iteration {
+                std::shared_ptr<SolarSystem> system = loadSystem(seededScenario(n), threads);
+                std::shared_ptr<ForceSolver> forceSolver = factory();
+                auto pool = std::make_shared<ThreadPool>(threads);
+                return [system, forceSolver, pool]() {
+                    BodyStore& store = system->getStore();
+                    store.resetForces();
+                    forceSolver->computeAccelerations(store, *pool, SolarSystem::getSoftening2(), false);
+                };
+            }});
+        }
+    }
+}
+
+using IntegratorFactory = std::function<std::unique_ptr<Integrator>()>;
+
+void addIntegratorBenchmarks(BenchmarkRunner& runner, size_t threads) {
+    const std::pair<const char*, IntegratorFactory> integrators[] = {
+        {"euler", []() { return std::make_unique<EulerIntegrator>(); }},
+        {"leapfrog", []() { return std::make_unique<LeapfrogIntegrator>(); }},
+        {"yoshida", []() { return std::make_unique<YoshidaIntegrator>(); }},
+        {"rk45", []() { return std::make_unique<DormandPrinceIntegrator>(); }},
+        {"block", []() { return std::make_unique<BlockTimestepIntegrator>(); }},
+    };
+    const size_t sizes[] = {1000, 10000};
+
+    // Whole steps with the default direct solver, so ns per body is the cost of a body-step
+    for (const auto& integrator : integrators) {
+        for (size_t n : sizes) {
+            const IntegratorFactory factory = integrator.second;
+            runner.add({caseName("integrator", integrator.first, n), n, 0, 0.0,
+                        [factory, n, threads]() -> BenchmarkRunner::Iteration {
+                std::shared_ptr<SolarSystem> system = loadSystem(seededScenario(n), threads);
+                system->setIntegrator(factory());
+                return [system]() { system->advance(3600.0); };
+            }});
+        }
+    }
+}
+
+void addParticleBenchmarks(BenchmarkRunner& runner, size_t threads) {
+    const size_t sizes[] = {10000, 100000, 1000000};
+
+    // The planets plus a massless belt: each step is bodies x particles, not particles squared
+    for (size_t n : sizes) {
+        runner.add({caseName("particles", "leapfrog", n), n, 0, 0.0,
+                    [n, threads]() -> BenchmarkRunner::Iteration {
+            Scenario scenario = seededScenario(9);
+            Scenario::Belt belt;
+            belt.parent = 0;
+            belt.count = n;
+            belt.seed = SEED;
+            belt.innerRadius = 2.1 * Physics::AU;
+            belt.outerRadius = 3.3 * Physics::AU;
+            scenario.belts.push_back(belt);
+            std::shared_ptr<SolarSystem> system = loadSystem(scenario, threads);
+            return [system]() { system->advance(86400.0); };
+        }});
+    }
+}
+
+void addFieldBenchmarks(BenchmarkRunner& runner) {
+    constexpr size_t GRID = 64;
+    const double extent = 4.0 * Physics::AU * Physics::DISTANCE_SCALE;
+
+    for (size_t n : SOLVER_SIZES) {
+        runner.add({caseName("field", "build", n), n, 0, 0.0, [n]() -> BenchmarkRunner::Iteration {
+            std::shared_ptr<SolarSystem> system = loadSystem(seededScenario(n), 1);
+            auto state = std::make_shared<StateSnapshot>();
+            system->captureSnapshot(*state);
+            auto field = std::make_shared<GravityField>();
+            return [system, state, field]() { field->build(*system, *state); };
+        }});
+
+        // A spacetime grid's worth of points over the inner system; ns per item is per point
+        runner.add({caseName("field", "evaluate", n), n, GRID * GRID, 0.0, [n, extent]() -> BenchmarkRunner::Iteration {
+            std::shared_ptr<SolarSystem> system = loadSystem(seededScenario(n), 1);
+            StateSnapshot state;
+            system->captureSnapshot(state);
+            auto field = std::make_shared<GravityField>();
+            field->build(*system, state);
+            return [field, extent]() {
+                float sum = 0.0f;
+                for (size_t j = 0; j < GRID; ++j) {
+                    for (size_t i = 0; i < GRID; ++i) {
+                        const sf::Vector2f point(static_cast<float>(extent * (2.0 * i / (GRID - 1) - 1.0)),
+                                                 static_cast<float>(extent * (2.0 * j / (GRID - 1) - 1.0)));
+                        sum += field->evaluate(point);
+                    }
+                }
+                // Keep the evaluations from being optimised away
+                volatile float sink = sum;
+                (void)sink;
+            };
+        }});
+    }
+}
+
+} // namespace
+
+Scenario seededScenario(size_t bodies, bool threeD) {
+    Scenario scenario = Scenario::solarSystem();
+    scenario.threeD = threeD;
+    scenario.belts.clear();
+    if (scenario.bodies.size() > bodies) {
+        // Moons follow their planets, so a prefix never loses a parent
+        scenario.bodies.resize(bodies);
+        return scenario;
+    }
+
+    Scenario::Belt belt;
+    belt.parent = 0;
+    belt.count = bodies - scenario.bodies.size();
+    belt.seed = SEED;
+    belt.innerRadius = 2.1 * Physics::AU;
+    belt.outerRadius = 3.3 * Physics::AU;
+    belt.thickness = 0.1 * Physics::AU;
+    belt.minMass = 1e15;
+    belt.maxMass = 1e20;
+    belt.color = Color(139, 131, 120);
+    scenario.belts.push_back(belt);
+    return scenario;
+}
+
+void addCoreBenchmarks(BenchmarkRunner& runner, size_t threads) {
+    addKernelBenchmarks(runner);
+    addSolverBenchmarks(runner, threads);
+    addIntegratorBenchmarks(runner, threads);
+    addParticleBenchmarks(runner, threads);
+    addFieldBenchmarks(runner);
+}
@@ -0,0 +1,89 @@
+#include "Benchmarks.h"
+#include "SolarSystem.h"
+#include "TrailRenderer.h"
+#include "GpuBackend.h"
+#include <SFML/OpenGL.hpp>
+#include <SFML/Window.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Pre-integrated states the trail cases cycle through
+constexpr size_t TRAIL_FRAMES = 8;
+
+// One hidden context for every graphics case, created on first use; the GPU backend wants 4.3
+bool ensureContext() {
+    static std::unique_ptr<sf::Context> context;
+    if (!context) {
+        sf::ContextSettings settings;
+        settings.majorVersion = 4;
+        settings.minorVersion = 3;
+        context = std::make_unique<sf::Context>(settings, 1, 1);
+    }
+    context->setActive(true);
+    return sf::Context::getActiveContext() != nullptr;
+}
+
+void addTrailBenchmarks(BenchmarkRunner& runner, size_t threads) {
+    const size_t sizes[] = {1000, 10000, 100000};
+
+    // A sample of every body per iteration; the states are integrated beforehand so only the
+    // trail update and its upload are timed
+    for (size_t n : sizes) {
+        runner.add({"trails/update/" + std::to_string(n), n, 0, 0.0, [n, threads]() -> BenchmarkRunner::Iteration {
+            if (!ensureContext()) {
+                return nullptr;
+            }
+            auto system = std::make_shared<SolarSystem>();
+            system->setThreadCount(threads);
+            system->load(seededScenario(n));
+            auto frames = std::make_shared<std::vector<StateSnapshot>>(TRAIL_FRAMES);
+            for (StateSnapshot& frame : *frames) {
+                system->advance(86400.0);
+                system->captureSnapshot(frame);
+            }
+            auto trails = std::make_shared<TrailRenderer>();
+            trails->setSampleInterval(1);
+            auto step = std::make_shared<uint64_t>(0);
+            return [system, frames, trails, step]() {
+                StateSnapshot& frame = (*frames)[*step % frames->size()];
+                frame.step = ++*step;
+                trails->update(*system, frame);
+            };
+        }});
+    }
+}
+
+void addGpuBenchmarks(BenchmarkRunner& runner) {
+    const size_t sizes[] = {1000, 10000, 100000};
+
+    // One frame of the compute backend, waited for so the time covers the dispatches themselves
+    for (size_t n : sizes) {
+        runner.add({"gpu/step/" + std::to_string(n), n, 0, static_cast<double>(n) * n,
+                    [n]() -> BenchmarkRunner::Iteration {
+            if (!ensureContext()) {
+                return nullptr;
+            }
+            auto backend = std::make_shared<GpuBackend>();
+            if (!backend->initialize()) {
+                return nullptr;
+            }
+            auto system = std::make_shared<SolarSystem>();
+            system->load(seededScenario(n));
+            backend->upload(*system);
+            return [system, backend]() {
+                backend->step(*system, 1.0 / 60.0);
+                glFinish();
+            };
+        }});
+    }
+}
+
+} // namespace
+
+void addGraphicsBenchmarks(BenchmarkRunner& runner, size_t threads) {
+    addTrailBenchmarks(runner, threads);
+    addGpuBenchmarks(runner);
+}
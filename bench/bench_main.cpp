@@ -0,0 +1,177 @@
+#include "BenchmarkRunner.h"
+#include "Benchmarks.h"
+#include "GravityKernel.h"
+#include "ThreadPool.h"
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+struct Arguments {
+    BenchmarkRunner::Options options;
+    size_t threads = 1;
+    std::string json;
+    std::string compare;
+    double tolerance = 0.1;
+    bool list = false;
+};
+
+std::string usage(const char* program) {
+    return std::string("Usage: ") + program + " [options]\n"
+        "  --filter TEXT       Only run benchmarks whose name contains TEXT\n"
+        "  --max-bodies N      Skip scenarios larger than N bodies (1000000)\n"
+        "  --min-time SECONDS  Time per repetition (0.2)\n"
+        "  --repetitions N     Repetitions per benchmark; the median is reported (3)\n"
+        "  --threads N         Force worker threads, 0 = all cores (1)\n"
+        "  --json FILE         Write results as JSON, - for stdout\n"
+        "  --compare FILE      Compare with an earlier --json file; exit 1 on regressions\n"
+        "  --tolerance RATIO   Slowdown counted as a regression by --compare (0.1)\n"
+        "  --list              Print the selected benchmark names and exit\n";
+}
+
+bool parseCount(const char* text, size_t& value) {
+    char* end = nullptr;
+    const unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || text[0] == '-') return false;
+    value = static_cast<size_t>(parsed);
+    return true;
+}
+
+bool parseFraction(const char* text, double& value) {
+    char* end = nullptr;
+    const double parsed = std::strtod(text, &end);
+    if (end == text || *end != '\0' || !(parsed >= 0.0) || !std::isfinite(parsed)) return false;
+    value = parsed;
+    return true;
+}
+
+bool parseArguments(int argc, char** argv, Arguments& arguments, std::string& message) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool usedValue = true;
+
+        if (arg == "--help" || arg == "-h") {
+            message = usage(argv[0]);
+            return false;
+        } else if (arg == "--list") {
+            arguments.list = true;
+            usedValue = false;
+        } else if (arg.rfind("--", 0) == 0 && !value) {
+            message = "Missing value for " + arg;
+            return false;
+        } else if (arg == "--filter") {
+            arguments.options.filter = value;
+        } else if (arg == "--max-bodies") {
+            if (!parseCount(value, arguments.options.maxBodies)) { message = "Bad body count: " + std::string(value); return false; }
+        } else if (arg == "--min-time") {
+            if (!parseFraction(value, arguments.options.minTime)) { message = "Bad time: " + std::string(value); return false; }
+        } else if (arg == "--repetitions") {
+            if (!parseCount(value, arguments.options.repetitions) || arguments.options.repetitions == 0) {
+                message = "Bad repetition count: " + std::string(value);
+                return false;
+            }
+        } else if (arg == "--threads") {
+            if (!parseCount(value, arguments.threads)) { message = "Bad thread count: " + std::string(value); return false; }
+        } else if (arg == "--json") {
+            arguments.json = value;
+        } else if (arg == "--compare") {
+            arguments.compare = value;
+        } else if (arg == "--tolerance") {
+            if (!parseFraction(value, arguments.tolerance)) { message = "Bad tolerance: " + std::string(value); return false; }
+        } else {
+            message = "Unknown option " + arg + "\n" + usage(argv[0]);
+            return false;
+        }
+        if (usedValue) {
+            ++i;
+        }
+    }
+    return true;
+}
+
+std::string compilerName() {
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc " + std::to_string(_MSC_VER);
+#else
+    return "unknown";
+#endif
+}
+
+std::string currentDate() {
+    const std::time_t now = std::time(nullptr);
+    char text[32] = {};
+    std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Arguments arguments;
+    std::string message;
+    if (!parseArguments(argc, argv, arguments, message)) {
+        const bool help = message.rfind("Usage:", 0) == 0;
+        (help ? std::cout : std::cerr) << message << std::endl;
+        return help ? 0 : 2;
+    }
+    const size_t threads = arguments.threads > 0 ? arguments.threads : ThreadPool::defaultThreadCount();
+
+    BenchmarkRunner runner(arguments.options);
+    addCoreBenchmarks(runner, threads);
+#if defined(GRAVITY_BENCH_GRAPHICS)
+    addGraphicsBenchmarks(runner, threads);
+#endif
+
+    if (arguments.list) {
+        for (const std::string& name : runner.list()) {
+            std::cout << name << "\n";
+        }
+        return 0;
+    }
+
+    // The table goes to stderr when the JSON takes stdout
+    const bool jsonToStdout = arguments.json == "-";
+    const std::vector<BenchmarkRunner::Result> results = runner.run(jsonToStdout ? std::cerr : std::cout);
+
+    const BenchmarkRunner::Context context = {
+        {"isa", GravityKernel::getIsaName(GravityKernel::detectIsa())},
+        {"threads", std::to_string(threads)},
+        {"compiler", compilerName()},
+        {"date", currentDate()},
+    };
+    if (jsonToStdout) {
+        BenchmarkRunner::writeJson(std::cout, context, results);
+    } else if (!arguments.json.empty()) {
+        std::ofstream file(arguments.json);
+        BenchmarkRunner::writeJson(file, context, results);
+        if (!file) {
+            std::cerr << "Cannot write " << arguments.json << std::endl;
+            return 2;
+        }
+    }
+
+    if (!arguments.compare.empty()) {
+        std::string error;
+        std::ostream& out = jsonToStdout ? std::cerr : std::cout;
+        const int regressions = BenchmarkRunner::compare(results, arguments.compare, arguments.tolerance, out, error);
+        if (regressions < 0) {
+            std::cerr << error << std::endl;
+            return 2;
+        }
+        if (regressions > 0) {
+            std::cerr << regressions << " benchmark(s) slower than the baseline by more than "
+                      << arguments.tolerance * 100.0 << "%" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
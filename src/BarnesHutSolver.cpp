@@ -0,0 +1,200 @@
+#include "BarnesHutSolver.h"
+#include "GravityKernel.h"
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+
+BarnesHutSolver::BarnesHutSolver(float theta, size_t leafSize)
+    : theta_(std::clamp(theta, 0.0f, MAX_THETA)), leafSize_(leafSize > 0 ? leafSize : 1) {
+}
+
+void BarnesHutSolver::computeAccelerations(BodyStore& store, ThreadPool& pool,
+                                           float softening2, bool threeD) {
+    tree_.build(store, threeD, leafSize_);
+    evaluateLeaves(store, pool, tree_.getLeaves(), softening2, nullptr);
+}
+
+void BarnesHutSolver::computeShare(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& targets,
+                                   float softening2, bool threeD, bool reuse) {
+    if (!reuse || tree_.getOrder().size() != store.size() || tree_.isThreeD() != threeD) {
+        tree_.build(store, threeD, leafSize_);
+    }
+    shareMask_.assign(store.size(), 0);
+    for (uint32_t target : targets) {
+        shareMask_[target] = 1;
+    }
+
+    // Each body gets the same interaction list it would in a full evaluation, so a
+    // target's acceleration does not depend on which process computed it
+    const std::vector<SpatialTree::Node>& nodes = tree_.getNodes();
+    const std::vector<uint32_t>& order = tree_.getOrder();
+    shareLeaves_.clear();
+    for (uint32_t leafIndex : tree_.getLeaves()) {
+        const SpatialTree::Node& leaf = nodes[leafIndex];
+        for (uint32_t k = leaf.begin; k < leaf.begin + leaf.count; ++k) {
+            if (shareMask_[order[k]]) {
+                shareLeaves_.push_back(leafIndex);
+                break;
+            }
+        }
+    }
+    evaluateLeaves(store, pool, shareLeaves_, softening2, &shareMask_);
+}
+
+void BarnesHutSolver::evaluateLeaves(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& leaves,
+                                     float softening2, const std::vector<uint8_t>* mask) {
+    if (leaves.empty()) {
+        return;
+    }
+
+    scratch_.resize(pool.size());
+
+    // Leaves differ a lot in cost, so hand them out in small batches
+    const size_t batch = 4;
+    std::atomic<size_t> next(0);
+    pool.run([&](size_t worker) {
+        Scratch& scratch = scratch_[worker];
+        while (true) {
+            size_t first = next.fetch_add(batch);
+            if (first >= leaves.size()) {
+                break;
+            }
+            size_t last = std::min(leaves.size(), first + batch);
+            for (size_t k = first; k < last; ++k) {
+                evaluateLeaf(store, leaves[k], scratch, softening2, mask);
+            }
+        }
+    });
+}
+
+void BarnesHutSolver::evaluateLeaf(BodyStore& store, uint32_t leafIndex, Scratch& scratch,
+                                   float softening2, const std::vector<uint8_t>* mask) const {
+    const std::vector<SpatialTree::Node>& nodes = tree_.getNodes();
+    const std::vector<uint32_t>& order = tree_.getOrder();
+    const float* sortedX = tree_.getSortedX().data();
+    const float* sortedY = tree_.getSortedY().data();
+    const float* sortedZ = tree_.getSortedZ().data();
+    const float* sortedGm = tree_.getSortedGm().data();
+    const bool threeD = tree_.isThreeD();
+
+    const SpatialTree::Node& leaf = nodes[leafIndex];
+    const uint32_t begin = leaf.begin;
+    const uint32_t end = leaf.begin + leaf.count;
+
+    // Tight bounds of the bodies in this leaf; the acceptance test is against
+    // the nearest point of this box so it holds for every body inside
+    float minX = sortedX[begin], maxX = minX;
+    float minY = sortedY[begin], maxY = minY;
+    float minZ = sortedZ[begin], maxZ = minZ;
+    for (uint32_t k = begin + 1; k < end; ++k) {
+        minX = std::min(minX, sortedX[k]);
+        maxX = std::max(maxX, sortedX[k]);
+        minY = std::min(minY, sortedY[k]);
+        maxY = std::max(maxY, sortedY[k]);
+        minZ = std::min(minZ, sortedZ[k]);
+        maxZ = std::max(maxZ, sortedZ[k]);
+    }
+
+    scratch.cellX.clear();
+    scratch.cellY.clear();
+    scratch.cellZ.clear();
+    scratch.cellGm.clear();
+    scratch.leafList.clear();
+    scratch.stack.clear();
+    scratch.stack.push_back(0);
+
+    const float theta2 = theta_ * theta_;
+    const unsigned int childCount = tree_.getChildCount();
+
+    while (!scratch.stack.empty()) {
+        uint32_t index = scratch.stack.back();
+        scratch.stack.pop_back();
+        const SpatialTree::Node& node = nodes[index];
+        if (node.count == 0 || node.gm <= 0.0f) {
+            continue;
+        }
+        if (index == leafIndex) {
+            scratch.leafList.push_back(index);
+            continue;
+        }
+
+        float dx = std::max(0.0f, std::max(minX - node.comX, node.comX - maxX));
+        float dy = std::max(0.0f, std::max(minY - node.comY, node.comY - maxY));
+        float dz = std::max(0.0f, std::max(minZ - node.comZ, node.comZ - maxZ));
+        float distance2 = dx * dx + dy * dy + dz * dz;
+        // Reach of the cell from its center of mass: its farthest corner
+        float rx = node.halfSize + std::fabs(node.comX - node.centerX);
+        float ry = node.halfSize + std::fabs(node.comY - node.centerY);
+        float rz = threeD ? node.halfSize + std::fabs(node.comZ - node.centerZ) : 0.0f;
+        float size2 = rx * rx + ry * ry + rz * rz;
+
+        // A cell reaching into the leaf's box may hold the leaf's own bodies, which a
+        // wide opening angle would otherwise fold into the point mass they feel. Faces
+        // count as inside, since bodies on them are filed into either neighbour
+        const bool overlaps = minX <= node.centerX + node.halfSize && maxX >= node.centerX - node.halfSize &&
+                              minY <= node.centerY + node.halfSize && maxY >= node.centerY - node.halfSize &&
+                              minZ <= node.centerZ + node.halfSize && maxZ >= node.centerZ - node.halfSize;
+
+        if (!overlaps && size2 < theta2 * distance2) {
+            // Far enough away to act as a point mass
+            scratch.cellX.push_back(node.comX);
+            scratch.cellY.push_back(node.comY);
+            scratch.cellZ.push_back(node.comZ);
+            scratch.cellGm.push_back(node.gm);
+        } else if (node.firstChild == 0) {
+            scratch.leafList.push_back(index);
+        } else {
+            for (unsigned int c = 0; c < childCount; ++c) {
+                scratch.stack.push_back(node.firstChild + c);
+            }
+        }
+    }
+
+    const size_t count = leaf.count;
+    scratch.ax.assign(count, 0.0f);
+    scratch.ay.assign(count, 0.0f);
+    scratch.az.assign(count, 0.0f);
+    const bool withPotential = !store.potential.empty();
+    float* potential = nullptr;
+    if (withPotential) {
+        scratch.potential.assign(count, 0.0f);
+        potential = scratch.potential.data();
+    }
+
+    const GravityKernel::Targets targets = {
+        sortedX + begin, sortedY + begin, sortedZ + begin, count
+    };
+
+    const GravityKernel::Sources cells = {
+        scratch.cellX.data(), scratch.cellY.data(), scratch.cellZ.data(), scratch.cellGm.data(),
+        scratch.cellGm.size()
+    };
+    GravityKernel::accumulateField(cells, targets, softening2,
+                                   scratch.ax.data(), scratch.ay.data(), scratch.az.data(), threeD, potential);
+
+    for (uint32_t sourceIndex : scratch.leafList) {
+        const SpatialTree::Node& source = nodes[sourceIndex];
+        const GravityKernel::Sources bodies = {
+            sortedX + source.begin, sortedY + source.begin,
+            sortedZ + source.begin, sortedGm + source.begin, source.count
+        };
+        GravityKernel::accumulateField(bodies, targets, softening2,
+                                       scratch.ax.data(), scratch.ay.data(), scratch.az.data(), threeD, potential);
+    }
+
+    // Leaves partition the bodies, so these writes never overlap between workers
+    for (size_t k = 0; k < count; ++k) {
+        uint32_t b = order[begin + k];
+        if (mask && !(*mask)[b]) {
+            continue;
+        }
+        store.ax[b] += scratch.ax[k];
+        store.ay[b] += scratch.ay[k];
+        if (threeD) {
+            store.az[b] += scratch.az[k];
+        }
+        if (withPotential) {
+            store.potential[b] += scratch.potential[k];
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "ForceSolver.h"
+#include "SpatialTree.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Barnes-Hut tree solver: a quadtree in 2D mode and an octree in 3D mode.
+ *
+ * The SpatialTree is rebuilt every step. Forces are evaluated per leaf: one
+ * walk builds the interaction list shared by all bodies in that leaf (cell monopoles plus neighbouring leaves evaluated
+ * exactly), which is then fed to GravityKernel::accumulateField.
+ */
+class BarnesHutSolver : public ForceSolver {
+public:
+    /**
+     * @param theta Opening angle, clamped to [0, MAX_THETA]; a cell is used as a point mass
+     *              when its reach from its center of mass is under theta * distance and it
+     *              does not reach into the target leaf
+     * @param leafSize Maximum number of bodies in a leaf before it is split
+     */
+    explicit BarnesHutSolver(float theta = 0.5f, size_t leafSize = 16);
+
+    const char* getName() const override { return "Barnes-Hut"; }
+
+    void computeAccelerations(BodyStore& store, ThreadPool& pool,
+                              float softening2, bool threeD) override;
+
+    // Walks only the leaves holding a target; with reuse the previous call's tree is kept
+    void computeShare(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& targets,
+                      float softening2, bool threeD, bool reuse) override;
+
+    // Past 1 a cell's point mass stands in for it closer than its own reach; a heavy body
+    // sharing a cell with light ones is then placed visibly off
+    static constexpr float MAX_THETA = 1.0f;
+
+    void setTheta(float theta) { theta_ = std::clamp(theta, 0.0f, MAX_THETA); }
+    float getTheta() const { return theta_; }
+
+    void setLeafSize(size_t leafSize) { leafSize_ = leafSize > 0 ? leafSize : 1; }
+    size_t getLeafSize() const { return leafSize_; }
+
+    // Tree statistics from the most recent step
+    size_t getNodeCount() const { return tree_.getNodes().size(); }
+    size_t getLeafCount() const { return tree_.getLeaves().size(); }
+
+    // Tree from the most recent step, for reuse by picking and visualization
+    const SpatialTree& getTree() const { return tree_; }
+
+private:
+    // Per-worker scratch reused between leaves and steps
+    struct Scratch {
+        std::vector<float> cellX, cellY, cellZ, cellGm;
+        std::vector<uint32_t> leafList;
+        std::vector<uint32_t> stack;
+        std::vector<float> ax, ay, az, potential;
+    };
+
+    // Evaluate a list of leaves on the pool; only bodies set in mask are written back, if given
+    void evaluateLeaves(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& leaves,
+                        float softening2, const std::vector<uint8_t>* mask);
+    void evaluateLeaf(BodyStore& store, uint32_t leafIndex, Scratch& scratch,
+                      float softening2, const std::vector<uint8_t>* mask) const;
+
+    float theta_;
+    size_t leafSize_;
+
+    SpatialTree tree_;
+    std::vector<Scratch> scratch_;
+
+    // computeShare(): targets flagged per body, and the leaves that hold one
+    std::vector<uint8_t> shareMask_;
+    std::vector<uint32_t> shareLeaves_;
+};
@@ -0,0 +1,608 @@
+#include "BatchRunner.h"
+#include "Physics.h"
+#include "DirectSolver.h"
+#include "BarnesHutSolver.h"
+#include "FmmSolver.h"
+#include "SymplecticIntegrators.h"
+#include "DormandPrinceIntegrator.h"
+#include "BlockTimestepIntegrator.h"
+#include "Checkpoint.h"
+#include "CheckpointWriter.h"
+#include "TrajectoryWriter.h"
+#include "TrajectoryReader.h"
+#include "Profiler.h"
+#include "Communicator.h"
+#include "DistributedSolver.h"
+#include "ParticleDomain.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+std::unique_ptr<ForceSolver> makeSolver(const BatchRunner::Options& options) {
+    const std::string& name = options.solver;
+    if (name == "direct") return std::make_unique<DirectSolver>();
+    if (name == "barnes-hut" || name == "bh") {
+        auto solver = std::make_unique<BarnesHutSolver>();
+        if (options.theta > 0.0) solver->setTheta(static_cast<float>(options.theta));
+        if (options.leafSize > 0) solver->setLeafSize(options.leafSize);
+        return solver;
+    }
+    if (name == "fmm") {
+        auto solver = std::make_unique<FmmSolver>();
+        if (options.fmmOrder > 0) solver->setOrder(options.fmmOrder);
+        if (options.theta > 0.0) solver->setTheta(static_cast<float>(options.theta));
+        if (options.leafSize > 0) solver->setLeafSize(options.leafSize);
+        return solver;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<Integrator> makeIntegrator(const std::string& name) {
+    if (name == "euler") return std::make_unique<EulerIntegrator>();
+    if (name == "leapfrog") return std::make_unique<LeapfrogIntegrator>();
+    if (name == "yoshida") return std::make_unique<YoshidaIntegrator>();
+    if (name == "rk45") return std::make_unique<DormandPrinceIntegrator>();
+    if (name == "block") return std::make_unique<BlockTimestepIntegrator>();
+    return nullptr;
+}
+
+// FNV-1a over the bits of every body's state, to check that the replicas agree
+uint64_t stateHash(const BodyStore& store) {
+    uint64_t hash = 1469598103934665603ULL;
+    const auto mix = [&hash](double value) {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        hash = (hash ^ bits) * 1099511628211ULL;
+    };
+    for (size_t i = 0; i < store.size(); ++i) {
+        mix(store.x[i]);
+        mix(store.y[i]);
+        mix(store.z[i]);
+        mix(store.vx[i]);
+        mix(store.vy[i]);
+        mix(store.vz[i]);
+    }
+    return hash;
+}
+
+bool parseCount(const char* text, size_t& value) {
+    char* end = nullptr;
+    const unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || text[0] == '-') return false;
+    value = static_cast<size_t>(parsed);
+    return true;
+}
+
+bool parseSeconds(const char* text, double& value) {
+    char* end = nullptr;
+    const double parsed = std::strtod(text, &end);
+    if (end == text || *end != '\0' || !(parsed > 0.0) || !std::isfinite(parsed)) return false;
+    value = parsed;
+    return true;
+}
+
+} // namespace
+
+std::string BatchRunner::usage(const char* program) {
+    std::string text = std::string("Usage: ") + program + " [options]\n"
+        "  --scenario NAME     solar, or a scenario file (text or binary) (solar)\n"
+        "  --save-scenario FILE  Write the scenario in compact binary form\n"
+        "  --steps N           Number of steps (1000)\n"
+        "  --dt SECONDS        Simulated seconds per step (3600)\n"
+        "  --solver NAME       direct | barnes-hut | fmm (direct)\n"
+        "  --theta T           Barnes-Hut opening angle, at most 1 (0.5); FMM separation (0.4)\n"
+        "  --leaf-size N       Bodies per tree leaf: Barnes-Hut (16), FMM (64)\n"
+        "  --fmm-order P       FMM expansion order, 1 to 8 (6)\n"
+        "  --integrator NAME   euler | leapfrog | yoshida | rk45 | block (leapfrog)\n"
+        "  --3d                Integrate in three dimensions\n"
+        "  --collisions        Merge bodies whose spheres touch during a step\n"
+        "  --threads N         Force worker threads, 0 = all cores (1)\n"
+        "  --output FILE       CSV destination, - for stdout (-)\n"
+        "  --every K           Write states every K steps, 0 = final only (0)\n"
+        "  --quiet             No summary on stderr\n"
+        "  --resume FILE       Start from a checkpoint instead of the scenario\n"
+        "  --checkpoint FILE   Write checkpoints to FILE (in the background)\n"
+        "  --checkpoint-every K  Steps between checkpoints, 0 = at the end only (0)\n"
+        "  --trajectory FILE   Stream compressed positions to FILE (from an I/O thread)\n"
+        "  --trajectory-every K  Steps between trajectory frames (1)\n"
+        "  --trajectory-quantum M  Trajectory position resolution in metres (1000)\n"
+        "  --trajectory-drop   Drop trajectory frames instead of stalling when I/O falls behind\n"
+        "  --diagnostics FILE  Write energy, momentum and their drift as CSV to FILE\n"
+        "  --diagnostics-every K  Steps between diagnostics rows (100)\n"
+        "  --profile FILE      Write a Chrome trace of the timed scopes of the last steps to FILE\n"
+        "  --decode FILE       Write a trajectory file as CSV and exit\n";
+    if (Communicator::hasMpi()) {
+        text +=
+            "\nUnder mpirun the force work and the test particles are split between processes,\n"
+            "but every process holds a full copy of the massive bodies: their count is bounded\n"
+            "by one node's memory. Diagnostics steps, which also sum the potential, are\n"
+            "evaluated by the root alone and broadcast.\n";
+    }
+    return text;
+}
+
+bool BatchRunner::parseArguments(int argc, char** argv, Options& options, std::string& message) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool usedValue = true;
+
+        if (arg == "--help" || arg == "-h") {
+            message = usage(argv[0]);
+            return false;
+        } else if (arg == "--3d") {
+            options.threeD = true;
+            usedValue = false;
+        } else if (arg == "--collisions") {
+            options.collisions = true;
+            usedValue = false;
+        } else if (arg == "--quiet") {
+            options.quiet = true;
+            usedValue = false;
+        } else if (arg == "--trajectory-drop") {
+            options.trajectoryDrop = true;
+            usedValue = false;
+        } else if (arg.rfind("--", 0) == 0 && !value) {
+            message = "Missing value for " + arg;
+            return false;
+        } else if (arg == "--scenario") {
+            options.scenario = value;
+        } else if (arg == "--save-scenario") {
+            options.saveScenario = value;
+        } else if (arg == "--steps") {
+            if (!parseCount(value, options.steps)) { message = "Bad step count: " + std::string(value); return false; }
+        } else if (arg == "--dt") {
+            if (!parseSeconds(value, options.dt)) { message = "Bad step size: " + std::string(value); return false; }
+        } else if (arg == "--solver") {
+            options.solver = value;
+        } else if (arg == "--theta") {
+            if (!parseSeconds(value, options.theta)) { message = "Bad opening angle: " + std::string(value); return false; }
+        } else if (arg == "--leaf-size") {
+            if (!parseCount(value, options.leafSize) || options.leafSize == 0) {
+                message = "Bad leaf size: " + std::string(value);
+                return false;
+            }
+        } else if (arg == "--fmm-order") {
+            size_t order = 0;
+            if (!parseCount(value, order) || order == 0 || order > FmmSolver::MAX_ORDER) {
+                message = "Bad FMM order: " + std::string(value);
+                return false;
+            }
+            options.fmmOrder = static_cast<unsigned int>(order);
+        } else if (arg == "--integrator") {
+            options.integrator = value;
+        } else if (arg == "--threads") {
+            if (!parseCount(value, options.threads)) { message = "Bad thread count: " + std::string(value); return false; }
+        } else if (arg == "--output") {
+            options.output = value;
+        } else if (arg == "--resume") {
+            options.resume = value;
+        } else if (arg == "--checkpoint") {
+            options.checkpoint = value;
+        } else if (arg == "--checkpoint-every") {
+            if (!parseCount(value, options.checkpointEvery)) { message = "Bad checkpoint interval: " + std::string(value); return false; }
+        } else if (arg == "--trajectory") {
+            options.trajectory = value;
+        } else if (arg == "--trajectory-every") {
+            if (!parseCount(value, options.trajectoryEvery) || options.trajectoryEvery == 0) {
+                message = "Bad trajectory interval: " + std::string(value);
+                return false;
+            }
+        } else if (arg == "--trajectory-quantum") {
+            if (!parseSeconds(value, options.trajectoryQuantum)) { message = "Bad trajectory quantum: " + std::string(value); return false; }
+        } else if (arg == "--diagnostics") {
+            options.diagnostics = value;
+        } else if (arg == "--profile") {
+            options.profile = value;
+        } else if (arg == "--diagnostics-every") {
+            if (!parseCount(value, options.diagnosticsEvery) || options.diagnosticsEvery == 0) {
+                message = "Bad diagnostics interval: " + std::string(value);
+                return false;
+            }
+        } else if (arg == "--decode") {
+            options.decode = value;
+        } else if (arg == "--every") {
+            if (!parseCount(value, options.every)) { message = "Bad output interval: " + std::string(value); return false; }
+        } else {
+            message = "Unknown option " + arg + "\n" + usage(argv[0]);
+            return false;
+        }
+
+        if (usedValue) {
+            ++i;
+        }
+    }
+    return true;
+}
+
+BatchRunner::BatchRunner(const Options& options) : options_(options) {
+    system_.setVerbose(false);
+}
+
+BatchRunner::~BatchRunner() = default;
+
+bool BatchRunner::isDistributed() const {
+    return communicator_ && communicator_->getSize() > 1;
+}
+
+bool BatchRunner::isRoot() const {
+    return !communicator_ || communicator_->isRoot();
+}
+
+bool BatchRunner::allSucceeded(bool ok) const {
+    return isDistributed() ? communicator_->all(ok) : ok;
+}
+
+bool BatchRunner::setUp(std::string& error) {
+    // Checkpoints and trajectories hold the whole state, which no one process has
+    if (isDistributed() && (!options_.resume.empty() || !options_.checkpoint.empty() || !options_.trajectory.empty())) {
+        error = "--resume, --checkpoint and --trajectory need a single process";
+        return false;
+    }
+
+    if (options_.resume.empty()) {
+        Scenario scenario;
+        if (options_.scenario == "solar") {
+            scenario = Scenario::solarSystem();
+        } else if (!Scenario::load(options_.scenario, scenario, error)) {
+            return false;
+        }
+        if (!options_.saveScenario.empty() && isRoot() && !scenario.saveBinary(options_.saveScenario, error)) {
+            return false;
+        }
+        if (isDistributed()) {
+            particleDomain_ = std::make_unique<ParticleDomain>(*communicator_, scenario.getParticleCount());
+            system_.load(scenario, particleDomain_->getFirst(), particleDomain_->getLast());
+        } else {
+            system_.load(scenario);
+        }
+    } else if (!options_.saveScenario.empty()) {
+        error = "--save-scenario needs a scenario, not --resume";
+        return false;
+    }
+
+    auto solver = makeSolver(options_);
+    if (!solver) {
+        error = "Unknown solver: " + options_.solver;
+        return false;
+    }
+    auto integrator = makeIntegrator(options_.integrator);
+    if (!integrator) {
+        error = "Unknown integrator: " + options_.integrator;
+        return false;
+    }
+
+    fmmSolver_ = dynamic_cast<const FmmSolver*>(solver.get());
+    if (isDistributed()) {
+        auto distributed = std::make_unique<DistributedSolver>(*communicator_, std::move(solver));
+        distributedSolver_ = distributed.get();
+        solver = std::move(distributed);
+    }
+
+    system_.setForceSolver(std::move(solver));
+    system_.setIntegrator(std::move(integrator));
+    system_.setThreadCount(options_.threads);
+    system_.setCollisions(options_.collisions);
+
+    // The integrator is chosen first so a checkpoint from the same one brings its state back
+    if (!options_.resume.empty() && !Checkpoint::load(system_, options_.resume, error)) {
+        return false;
+    }
+    // --3d lifts a planar start into 3D; a state that is already 3D keeps its z
+    if (options_.threeD && !system_.is3DMode()) {
+        system_.set3DMode(true);
+    }
+    return true;
+}
+
+int BatchRunner::run() {
+    if (!options_.decode.empty() && !isRoot()) {
+        return 0;
+    }
+
+    std::string error;
+    const bool ready = !options_.decode.empty() || setUp(error);
+    if (!ready) {
+        std::cerr << error << std::endl;
+    }
+    if (!allSucceeded(ready)) {
+        return 2;
+    }
+
+    // Only the root writes; the other processes format into a stream without a buffer
+    std::ofstream file;
+    std::ostream discard(nullptr);
+    bool opened = true;
+    if (isRoot() && options_.output != "-") {
+        file.open(options_.output);
+        if (!file) {
+            std::cerr << "Cannot open " << options_.output << " for writing" << std::endl;
+            opened = false;
+        }
+    }
+    if (!allSucceeded(opened)) {
+        return 1;
+    }
+    std::ostream& out = !isRoot() ? discard : options_.output == "-" ? std::cout : file;
+    out.precision(std::numeric_limits<double>::max_digits10);
+
+    if (!options_.decode.empty()) {
+        return decodeTrajectory(out);
+    }
+
+    writeHeader(out);
+    if (options_.every > 0) {
+        writeStates(out, system_.getStepCount());
+    }
+
+    std::unique_ptr<CheckpointWriter> checkpoints;
+    if (!options_.checkpoint.empty()) {
+        checkpoints = std::make_unique<CheckpointWriter>(options_.checkpoint);
+    }
+
+    std::unique_ptr<TrajectoryWriter> trajectory;
+    if (!options_.trajectory.empty()) {
+        TrajectoryWriter::Options trajectoryOptions;
+        trajectoryOptions.quantum = options_.trajectoryQuantum * Physics::DISTANCE_SCALE;
+        trajectoryOptions.backpressure = options_.trajectoryDrop ? TrajectoryWriter::Backpressure::DropFrames
+                                                                 : TrajectoryWriter::Backpressure::Block;
+        trajectory = std::make_unique<TrajectoryWriter>(options_.trajectory, trajectoryOptions);
+        if (!trajectory->isOpen()) {
+            std::cerr << trajectory->getError() << std::endl;
+            return 1;
+        }
+        trajectory->record(system_, system_.getStepCount());
+    }
+
+    std::ofstream diagnostics;
+    if (!options_.diagnostics.empty()) {
+        if (isRoot()) {
+            diagnostics.open(options_.diagnostics);
+            if (!diagnostics) {
+                std::cerr << "Cannot open " << options_.diagnostics << " for writing" << std::endl;
+            }
+        }
+        if (!allSucceeded(!isRoot() || diagnostics.is_open())) {
+            return 1;
+        }
+        diagnostics.precision(std::numeric_limits<double>::max_digits10);
+        diagnostics << "step,time_s,kinetic_J,potential_J,total_J,energy_drift,px_kg_m_s,py_kg_m_s,pz_kg_m_s,"
+                       "lx_kg_m2_s,ly_kg_m2_s,lz_kg_m2_s,angular_momentum_drift,com_x_m,com_y_m,com_z_m,"
+                       "fmm_rms_error,fmm_max_error\n";
+        system_.setDiagnosticsInterval(options_.diagnosticsEvery);
+    }
+    // The baseline the drift is measured from; the potential comes from one force
+    // evaluation rather than a separate O(N^2) sum
+    if (!options_.diagnostics.empty() || !options_.quiet) {
+        system_.sampleDiagnostics();
+    }
+    if (diagnostics.is_open()) {
+        writeDiagnostics(diagnostics);
+    }
+
+    if (!options_.profile.empty()) {
+        Profiler::setThreadName("main");
+        Profiler::setEnabled(true);
+    }
+
+    double fmmWorst = 0.0;   // Largest sampled FMM error of any step
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t step = 1; step <= options_.steps; ++step) {
+        const auto stepStart = std::chrono::steady_clock::now();
+        system_.advance(options_.dt);
+        if (fmmSolver_) {
+            fmmWorst = std::max(fmmWorst, fmmSolver_->getErrorEstimate().maxRelative);
+        }
+        if (particleDomain_) {
+            // Waiting in the solver's exchanges is the other processes' imbalance, not ours
+            const double stepSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stepStart).count();
+            particleDomain_->recordStep(stepSeconds - distributedSolver_->takeSeconds());
+            if (step % ParticleDomain::REBALANCE_STEPS == 0) {
+                particleDomain_->rebalance(system_);
+            }
+        }
+        // Output counts steps from the start of the run, including any before a resumed checkpoint
+        const uint64_t stepCount = system_.getStepCount();
+        if (diagnostics.is_open() && system_.getDiagnostics().step == stepCount) {
+            writeDiagnostics(diagnostics);
+        }
+        if (options_.every > 0 ? stepCount % options_.every == 0 : step == options_.steps) {
+            GRAVITY_PROFILE_SCOPE("writeStates");
+            writeStates(out, stepCount);
+        }
+        if (checkpoints && (options_.checkpointEvery > 0 ? stepCount % options_.checkpointEvery == 0 : step == options_.steps)) {
+            checkpoints->submit(system_);
+        }
+        if (trajectory && stepCount % options_.trajectoryEvery == 0) {
+            trajectory->record(system_, stepCount);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // The summary's closing sample is a force evaluation, which in a distributed job
+    // every process takes part in, as it does in checking that their bodies agree
+    if (!options_.quiet && system_.getDiagnostics().step != system_.getStepCount()) {
+        system_.sampleDiagnostics();
+    }
+    if (isDistributed() && !communicator_->agree(stateHash(system_.getStore()))) {
+        if (isRoot()) {
+            std::cerr << "The processes' copies of the bodies diverged" << std::endl;
+        }
+        return 1;
+    }
+
+    if (checkpoints) {
+        checkpoints->flush();
+        if (!checkpoints->getLastError().empty()) {
+            std::cerr << checkpoints->getLastError() << std::endl;
+            return 1;
+        }
+    }
+
+    TrajectoryWriter::Stats trajectoryStats;
+    if (trajectory) {
+        trajectory->close();
+        trajectoryStats = trajectory->getStats();
+        if (!trajectory->getError().empty()) {
+            std::cerr << trajectory->getError() << std::endl;
+            return 1;
+        }
+    }
+
+    // After the writer threads have finished, so their last work is in the trace; each
+    // process of a distributed job writes its own, the root's under the given name
+    if (!options_.profile.empty()) {
+        Profiler::setEnabled(false);
+        std::string error;
+        const std::string profile = isRoot() ? options_.profile
+                                             : options_.profile + "." + std::to_string(communicator_->getRank());
+        if (!Profiler::writeChromeTrace(profile, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+
+    if (!isRoot()) {
+        return 0;
+    }
+
+    out.flush();
+    if (!out) {
+        std::cerr << "Failed writing " << options_.output << std::endl;
+        return 1;
+    }
+    if (diagnostics.is_open()) {
+        diagnostics.flush();
+        if (!diagnostics) {
+            std::cerr << "Failed writing " << options_.diagnostics << std::endl;
+            return 1;
+        }
+    }
+
+    if (!options_.quiet) {
+        const SolarSystem::Diagnostics& sample = system_.getDiagnostics();
+        std::cerr << options_.steps << " steps of " << options_.dt << " s ("
+                  << options_.steps * options_.dt / Physics::SECONDS_PER_DAY << " days) with "
+                  << system_.getForceSolver().getName() << " / " << system_.getIntegrator().getName()
+                  << " in " << seconds << " s"
+                  << (isDistributed() ? " on " + std::to_string(communicator_->getSize()) + " processes" : std::string())
+                  << "; " << system_.getForceEvaluationCount()
+                  << " body evaluations, relative energy change " << sample.energyDrift
+                  << ", angular momentum change " << sample.angularMomentumDrift << std::endl;
+        const uint64_t particles = particleDomain_ ? particleDomain_->getTotal() : system_.getTestParticleCount();
+        if (particles > 0) {
+            std::cerr << "Test particles: " << particles << std::endl;
+        }
+        if (system_.getShortStepCount() > 0) {
+            std::cerr << system_.getIntegrator().getName() << " hit its substep limit on "
+                      << system_.getShortStepCount() << " steps; the run covered "
+                      << system_.getTimeShortfall() << " s less than requested" << std::endl;
+        }
+        if (fmmSolver_ && fmmSolver_->getErrorEstimate().samples > 0) {
+            const FmmSolver::ErrorEstimate& estimate = fmmSolver_->getErrorEstimate();
+            std::cerr << "FMM error against direct summation: rms " << estimate.rmsRelative << ", max "
+                      << estimate.maxRelative << " over " << estimate.samples << " bodies of the last check; max "
+                      << fmmWorst << " over the run" << std::endl;
+        }
+        if (options_.collisions) {
+            std::cerr << "Collisions: " << system_.getMergeCount() << " bodies merged, "
+                      << system_.getBodyCount() << " left" << std::endl;
+        }
+        if (trajectory) {
+            std::cerr << "Trajectory: " << trajectoryStats.framesWritten << " frames ("
+                      << trajectoryStats.framesDropped << " dropped), " << trajectoryStats.fileBytes
+                      << " bytes, " << double(trajectoryStats.rawBytes) / std::max<uint64_t>(1, trajectoryStats.fileBytes)
+                      << "x smaller than raw doubles" << (TrajectoryWriter::hasCompression() ? "" : " (no zstd)")
+                      << std::endl;
+        }
+    }
+    return 0;
+}
+
+int BatchRunner::decodeTrajectory(std::ostream& out) const {
+    TrajectoryReader reader;
+    std::string error;
+    if (!reader.open(options_.decode, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    // Trajectories hold positions only, and bodies by index since names are not stored
+    const double toMeters = 1.0 / Physics::DISTANCE_SCALE;
+    out << "step,time_s,body,x_m,y_m,z_m\n";
+    TrajectoryReader::Frame frame;
+    while (reader.readFrame(frame, error)) {
+        for (size_t i = 0; i < frame.x.size(); ++i) {
+            out << frame.step << ',' << frame.time << ',' << i << ',' << frame.x[i] * toMeters << ','
+                << frame.y[i] * toMeters << ',' << frame.z[i] * toMeters << '\n';
+        }
+    }
+    if (!error.empty()) {
+        std::cerr << options_.decode << ": " << error << std::endl;
+        return 1;
+    }
+    out.flush();
+    return out ? 0 : 1;
+}
+
+void BatchRunner::writeHeader(std::ostream& out) const {
+    out << "step,time_s,body,x_m,y_m,z_m,vx_m_s,vy_m_s,vz_m_s\n";
+}
+
+void BatchRunner::writeDiagnostics(std::ostream& out) const {
+    const SolarSystem::Diagnostics& d = system_.getDiagnostics();
+    out << d.step << ',' << d.simulationTime << ',' << d.kineticEnergy << ',' << d.potentialEnergy << ','
+        << d.totalEnergy() << ',' << d.energyDrift << ','
+        << d.momentum.x << ',' << d.momentum.y << ',' << d.momentum.z << ','
+        << d.angularMomentum.x << ',' << d.angularMomentum.y << ',' << d.angularMomentum.z << ','
+        << d.angularMomentumDrift << ','
+        << d.centerOfMass.x << ',' << d.centerOfMass.y << ',' << d.centerOfMass.z << ',';
+    // The sample evaluation also checked the FMM against direct summation; blank for other solvers
+    if (fmmSolver_ && fmmSolver_->getErrorEstimate().samples > 0) {
+        out << fmmSolver_->getErrorEstimate().rmsRelative << ',' << fmmSolver_->getErrorEstimate().maxRelative;
+    } else {
+        out << ',';
+    }
+    out << '\n';
+}
+
+void BatchRunner::writeStates(std::ostream& out, uint64_t step) const {
+    const double toMeters = 1.0 / Physics::DISTANCE_SCALE;
+    const double time = system_.getSimulationTime();
+    if (isRoot()) {
+        const BodyStore& s = system_.getStore();
+        const auto& bodies = system_.getBodies();
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            out << step << ',' << time << ',' << bodies[i]->getName() << ','
+                << s.x[i] * toMeters << ',' << s.y[i] * toMeters << ',' << s.z[i] * toMeters << ','
+                << s.vx[i] * toMeters << ',' << s.vy[i] * toMeters << ',' << s.vz[i] * toMeters << '\n';
+        }
+    }
+
+    // Test particles follow as unnamed rows, like belt bodies
+    if (particleDomain_) {
+        // Each process's range passes through the root in turn, which keeps the scenario order
+        particleDomain_->gather(system_, [&](const double* states, size_t count) {
+            for (size_t k = 0; k < count; ++k) {
+                const double* v = states + 6 * k;
+                out << step << ',' << time << ",,"
+                    << v[0] * toMeters << ',' << v[1] * toMeters << ',' << v[2] * toMeters << ','
+                    << v[3] * toMeters << ',' << v[4] * toMeters << ',' << v[5] * toMeters << '\n';
+            }
+        });
+        return;
+    }
+    const TestParticles& p = system_.getTestParticles();
+    for (size_t i = 0; i < p.size(); ++i) {
+        out << step << ',' << time << ",,"
+            << p.x[i] * toMeters << ',' << p.y[i] * toMeters << ',' << p.z[i] * toMeters << ','
+            << p.vx[i] * toMeters << ',' << p.vy[i] * toMeters << ',' << p.vz[i] * toMeters << '\n';
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "SolarSystem.h"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+class Communicator;
+class DistributedSolver;
+class FmmSolver;
+class ParticleDomain;
+
+/**
+ * Headless driver for the simulation core: builds a scenario, advances it a
+ * fixed number of steps with the chosen solver and integrator, and writes
+ * body states as CSV. Needs neither a window nor a GL context, so many runs
+ * can go side by side on render-less machines.
+ */
+class BatchRunner {
+public:
+    struct Options {
+        std::string scenario = "solar";   // Built-in solar system, or a scenario file
+        size_t steps = 1000;
+        double dt = 3600.0;               // Simulated seconds per step
+        std::string solver = "direct";
+        double theta = 0.0;               // Tree solver opening angle; 0 keeps the solver's default
+        size_t leafSize = 0;              // Bodies per tree leaf; 0 keeps the solver's default
+        unsigned int fmmOrder = 0;        // FMM expansion order; 0 keeps the solver's default
+        std::string integrator = "leapfrog";
+        bool threeD = false;
+        bool collisions = false;          // Merge bodies that touch
+        size_t threads = 1;               // One per run suits parallel sweeps; 0 = all cores
+        std::string output = "-";         // "-" writes to stdout
+        size_t every = 0;                 // Write states every this many steps; 0 = final state only
+        bool quiet = false;               // No summary on stderr
+        std::string resume;               // Checkpoint to start from instead of the scenario
+        std::string checkpoint;           // Periodic checkpoint file; empty for none
+        size_t checkpointEvery = 0;       // Steps between checkpoints; 0 = only at the end
+        std::string trajectory;           // Compressed position stream; empty for none
+        size_t trajectoryEvery = 1;       // Steps between trajectory frames
+        double trajectoryQuantum = 1e3;   // Trajectory position resolution in metres
+        bool trajectoryDrop = false;      // Drop frames rather than wait when the writer falls behind
+        std::string diagnostics;          // Energy and momentum CSV; empty for none
+        size_t diagnosticsEvery = 100;    // Steps between diagnostics rows
+        std::string profile;              // Chrome trace of the last steps' timings; empty for none
+        std::string saveScenario;         // Write the scenario in binary form before running
+        std::string decode;               // Convert this trajectory to CSV instead of running
+    };
+
+    // Fill options from the command line; false with message set on bad input or --help
+    static bool parseArguments(int argc, char** argv, Options& options, std::string& message);
+    static std::string usage(const char* program);
+
+    explicit BatchRunner(const Options& options);
+    ~BatchRunner();
+
+    // Run as one process of a distributed job. The bodies are replicated on every
+    // process and their force work split; test particles are split between them.
+    // The root writes all output.
+    void setCommunicator(Communicator* communicator) { communicator_ = communicator; }
+
+    // Run to completion; returns a process exit code
+    int run();
+
+private:
+    bool setUp(std::string& error);
+    bool isDistributed() const;
+    bool isRoot() const;
+    // Whether ok held on every process; collective in a distributed job
+    bool allSucceeded(bool ok) const;
+    int decodeTrajectory(std::ostream& out) const;
+    void writeHeader(std::ostream& out) const;
+    void writeStates(std::ostream& out, uint64_t step) const;
+    void writeDiagnostics(std::ostream& out) const;
+
+    Options options_;
+    SolarSystem system_;
+
+    Communicator* communicator_ = nullptr;
+    DistributedSolver* distributedSolver_ = nullptr;   // Owned by system_
+    const FmmSolver* fmmSolver_ = nullptr;             // Owned by system_, when the solver is FMM
+    std::unique_ptr<ParticleDomain> particleDomain_;
+};
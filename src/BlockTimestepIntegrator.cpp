@@ -0,0 +1,183 @@
+#include "BlockTimestepIntegrator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+BlockTimestepIntegrator::BlockTimestepIntegrator(double accuracy, unsigned int maxLevel)
+    : accuracy_(accuracy > 0.0 ? accuracy : 0.02), maxLevel_(std::min(maxLevel, MAX_LEVEL)) {
+}
+
+double BlockTimestepIntegrator::step(Context& context, double dt) {
+    BodyStore& s = context.store;
+    const size_t n = s.size();
+    substeps_ = 0;
+    bodyEvaluations_ = 0;
+    deepestLevel_ = 0;
+    if (n == 0 || dt <= 0.0) {
+        return dt;
+    }
+
+    ensureAccelerations(context);
+    if (level_.size() != n) {
+        level_.assign(n, 0);
+        stepEnd_.assign(n, 0);
+        timescale_.assign(n, 0.0);
+        startAx_.resize(n);
+        startAy_.resize(n);
+        startAz_.resize(n);
+    }
+
+    const bool threeD = context.threeD;
+    const uint64_t frameTicks = uint64_t(1) << maxLevel_;
+    const double tickSeconds = dt / static_cast<double>(frameTicks);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (timescale_[i] <= 0.0) {
+            timescale_[i] = initialTimescale(s, i, threeD);
+        }
+        openStep(s, i, dt, 0, threeD);
+    }
+
+    uint64_t tick = 0;
+    while (tick < frameTicks) {
+        const uint64_t next = *std::min_element(stepEnd_.begin(), stepEnd_.end());
+        drift(context, static_cast<double>(next - tick) * tickSeconds);
+        tick = next;
+
+        active_.clear();
+        for (size_t i = 0; i < n; ++i) {
+            if (stepEnd_[i] == tick) {
+                active_.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        // Everyone is due at the frame end; the full path lets the solver share work
+        if (active_.size() == n) {
+            context.evaluate();
+        } else {
+            context.evaluateSubset(active_);
+        }
+        ++substeps_;
+        bodyEvaluations_ += active_.size();
+
+        for (uint32_t i : active_) {
+            const double h = static_cast<double>(frameTicks >> level_[i]) * tickSeconds;
+            kickBody(s, i, 0.5 * h, threeD);
+
+            // Jerk as the change in acceleration over the step just completed
+            const double jx = (s.ax[i] - startAx_[i]) / h;
+            const double jy = (s.ay[i] - startAy_[i]) / h;
+            const double jz = threeD ? (s.az[i] - startAz_[i]) / h : 0.0;
+            const double jerk = std::sqrt(jx * jx + jy * jy + jz * jz);
+            const double az = threeD ? s.az[i] : 0.0;
+            const double acceleration = std::sqrt(static_cast<double>(s.ax[i]) * s.ax[i] +
+                                                  static_cast<double>(s.ay[i]) * s.ay[i] + az * az);
+            timescale_[i] = jerk > 0.0 ? acceleration / jerk : std::numeric_limits<double>::infinity();
+
+            if (tick < frameTicks) {
+                openStep(s, i, dt, tick, threeD);
+            }
+        }
+    }
+
+    // The last substep evaluated every body at the final positions
+    markAccelerationsValid(context);
+    return dt;
+}
+
+void BlockTimestepIntegrator::saveState(std::vector<uint8_t>& out) const {
+    out.resize(timescale_.size() * sizeof(double));
+    if (!timescale_.empty()) {
+        std::memcpy(out.data(), timescale_.data(), out.size());
+    }
+}
+
+bool BlockTimestepIntegrator::loadState(const uint8_t* data, size_t size, size_t bodyCount) {
+    // A system that has not been stepped yet saves no timescales
+    if (size == 0) {
+        timescale_.clear();
+        level_.clear();
+        return true;
+    }
+    if (size != bodyCount * sizeof(double)) {
+        return false;
+    }
+    timescale_.resize(bodyCount);
+    std::memcpy(timescale_.data(), data, size);
+    level_.assign(bodyCount, 0);
+    stepEnd_.assign(bodyCount, 0);
+    startAx_.resize(bodyCount);
+    startAy_.resize(bodyCount);
+    startAz_.resize(bodyCount);
+    return true;
+}
+
+void BlockTimestepIntegrator::openStep(BodyStore& store, size_t i, double dt, uint64_t tick, bool threeD) {
+    const unsigned int level = chooseLevel(i, dt, tick);
+    level_[i] = static_cast<uint8_t>(level);
+    stepEnd_[i] = tick + ((uint64_t(1) << maxLevel_) >> level);
+    deepestLevel_ = std::max(deepestLevel_, level);
+
+    startAx_[i] = store.ax[i];
+    startAy_[i] = store.ay[i];
+    startAz_[i] = store.az[i];
+    kickBody(store, i, 0.5 * dt / static_cast<double>(uint64_t(1) << level), threeD);
+}
+
+unsigned int BlockTimestepIntegrator::chooseLevel(size_t i, double dt, uint64_t tick) const {
+    unsigned int level = 0;
+    const double wanted = accuracy_ * timescale_[i];
+    if (wanted < dt) {
+        // Smallest level whose step dt / 2^level fits inside the wanted step
+        const double ratio = wanted > 0.0 ? dt / wanted : std::numeric_limits<double>::infinity();
+        const double exact = std::ceil(std::log2(ratio));
+        level = exact >= maxLevel_ ? maxLevel_ : static_cast<unsigned int>(exact);
+    }
+
+    // Lengthen by at most one level per step so a noisy jerk estimate cannot swing the step
+    if (tick != 0 && level + 1 < level_[i]) {
+        level = level_[i] - 1u;
+    }
+
+    // Longer levels are only reachable where their grid lines up with tick
+    while (level < maxLevel_ && tick % ((uint64_t(1) << maxLevel_) >> level) != 0) {
+        ++level;
+    }
+    return level;
+}
+
+double BlockTimestepIntegrator::initialTimescale(const BodyStore& store, size_t i, bool threeD) const {
+    const uint32_t p = store.parent[i];
+    const bool hasParent = p != BodyStore::NO_PARENT && p < store.size();
+    const double dx = store.x[i] - (hasParent ? store.x[p] : store.originX);
+    const double dy = store.y[i] - (hasParent ? store.y[p] : store.originY);
+    const double dz = threeD ? store.z[i] - (hasParent ? store.z[p] : store.originZ) : 0.0;
+    const double vx = store.vx[i] - (hasParent ? store.vx[p] : 0.0);
+    const double vy = store.vy[i] - (hasParent ? store.vy[p] : 0.0);
+    const double vz = threeD ? store.vz[i] - (hasParent ? store.vz[p] : 0.0) : 0.0;
+    const double az = threeD ? store.az[i] : 0.0;
+
+    const double r = std::sqrt(dx * dx + dy * dy + dz * dz);
+    const double v = std::sqrt(vx * vx + vy * vy + vz * vz);
+    const double a = std::sqrt(static_cast<double>(store.ax[i]) * store.ax[i] +
+                               static_cast<double>(store.ay[i]) * store.ay[i] + az * az);
+
+    // Orbital timescale 1/omega: r / v for the motion, sqrt(r / a) for the pull
+    double timescale = std::numeric_limits<double>::infinity();
+    if (r > 0.0 && v > 0.0) {
+        timescale = std::min(timescale, r / v);
+    }
+    if (r > 0.0 && a > 0.0) {
+        timescale = std::min(timescale, std::sqrt(r / a));
+    }
+    return timescale;
+}
+
+void BlockTimestepIntegrator::kickBody(BodyStore& store, size_t i, double h, bool threeD) const {
+    store.vx[i] += store.ax[i] * h;
+    store.vy[i] += store.ay[i] * h;
+    if (threeD) {
+        store.vz[i] += store.az[i] * h;
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "Integrator.h"
+#include <vector>
+
+/**
+ * Kick-drift-kick leapfrog with individual power-of-two (block) timesteps.
+ *
+ * Each body sits in a level k and advances by dt / 2^k, where dt is the frame
+ * step. Its level is picked from the Aarseth-style timescale |a| / |da/dt|,
+ * with the jerk taken as the change in acceleration over the body's last step.
+ * At every substep all bodies drift (O(N)), but only those whose step ends
+ * there get new accelerations (through Context::evaluateSubset) and are
+ * kicked, so a fast moon costs force evaluations for itself alone instead of
+ * forcing the whole system onto its step.
+ *
+ * A body may move to a shorter level whenever its step ends, and to a longer
+ * one only where that level's grid lines up. Every body ends the frame
+ * synchronised, so the state between frames is the same as for the global
+ * integrators.
+ */
+class BlockTimestepIntegrator : public Integrator {
+public:
+    /**
+     * @param accuracy Fraction of the acceleration timescale |a| / |da/dt| taken per step
+     * @param maxLevel Deepest level; the shortest step is dt / 2^maxLevel
+     */
+    explicit BlockTimestepIntegrator(double accuracy = 0.02, unsigned int maxLevel = 16);
+
+    const char* getName() const override { return "Block leapfrog"; }
+
+    double step(Context& context, double dt) override;
+
+    // Per-body timescales, so levels resume where they were
+    void saveState(std::vector<uint8_t>& out) const override;
+    bool loadState(const uint8_t* data, size_t size, size_t bodyCount) override;
+
+    void setAccuracy(double accuracy) { accuracy_ = accuracy > 0.0 ? accuracy : accuracy_; }
+    double getAccuracy() const { return accuracy_; }
+
+    // Statistics from the most recent step()
+    unsigned int getDeepestLevel() const { return deepestLevel_; }
+    size_t getSubstepCount() const { return substeps_; }
+    size_t getBodyEvaluations() const { return bodyEvaluations_; }
+
+    static constexpr unsigned int MAX_LEVEL = 30;
+
+private:
+    // Level whose step best fits the body's timescale and lines up with tick
+    unsigned int chooseLevel(size_t i, double dt, uint64_t tick) const;
+    // Estimated |a| / |da/dt| for a body without step history, from its motion about its parent
+    double initialTimescale(const BodyStore& store, size_t i, bool threeD) const;
+    void kickBody(BodyStore& store, size_t i, double h, bool threeD) const;
+    // Start body i's next step at tick
+    void openStep(BodyStore& store, size_t i, double dt, uint64_t tick, bool threeD);
+
+    double accuracy_;
+    unsigned int maxLevel_;
+    unsigned int deepestLevel_ = 0;
+    size_t substeps_ = 0;
+    size_t bodyEvaluations_ = 0;
+
+    // Per-body state, indexed like the store
+    std::vector<uint8_t> level_;
+    std::vector<uint64_t> stepEnd_;       // Tick at which the current step ends
+    std::vector<double> timescale_;       // |a| / |da/dt| from the last completed step; 0 = unknown
+    std::vector<float> startAx_, startAy_, startAz_;   // Accelerations when the step opened
+
+    std::vector<uint32_t> active_;
+};
@@ -0,0 +1,54 @@
+#include "BodyGrid.h"
+#include <algorithm>
+#include <cmath>
+
+void BodyGrid::build(const std::vector<Vector3d>& positions, size_t count) {
+    count = std::min(count, positions.size());
+    cellStart_.clear();
+    indices_.clear();
+    if (count == 0) {
+        return;
+    }
+
+    double minX = positions[0].x, maxX = minX;
+    double minY = positions[0].y, maxY = minY;
+    for (size_t i = 1; i < count; ++i) {
+        minX = std::min(minX, positions[i].x);
+        maxX = std::max(maxX, positions[i].x);
+        minY = std::min(minY, positions[i].y);
+        maxY = std::max(maxY, positions[i].y);
+    }
+
+    // Square cells sized for the target occupancy, capped so the offsets stay small
+    const double width = std::max(maxX - minX, 1e-9);
+    const double height = std::max(maxY - minY, 1e-9);
+    const double cells = std::max(1.0, static_cast<double>(count) / BODIES_PER_CELL);
+    cellSize_ = std::sqrt(width * height / cells);
+    cellSize_ = std::max({cellSize_, width / MAX_CELLS_PER_SIDE, height / MAX_CELLS_PER_SIDE});
+    inverseCellSize_ = 1.0 / cellSize_;
+    originX_ = minX;
+    originY_ = minY;
+    columns_ = std::max<uint32_t>(1, std::min<uint32_t>(MAX_CELLS_PER_SIDE, static_cast<uint32_t>(width / cellSize_) + 1));
+    rows_ = std::max<uint32_t>(1, std::min<uint32_t>(MAX_CELLS_PER_SIDE, static_cast<uint32_t>(height / cellSize_) + 1));
+
+    // Counting sort by cell
+    cellStart_.assign(static_cast<size_t>(columns_) * rows_ + 1, 0);
+    bodyCell_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t cell = row(positions[i].y) * columns_ + column(positions[i].x);
+        bodyCell_[i] = cell;
+        ++cellStart_[cell + 1];
+    }
+    for (size_t c = 1; c < cellStart_.size(); ++c) {
+        cellStart_[c] += cellStart_[c - 1];
+    }
+    indices_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        indices_[cellStart_[bodyCell_[i]]++] = static_cast<uint32_t>(i);
+    }
+    // The scatter advanced every start to the next cell's; shift back
+    for (size_t c = cellStart_.size() - 1; c > 0; --c) {
+        cellStart_[c] = cellStart_[c - 1];
+    }
+    cellStart_[0] = 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "CelestialBody.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Uniform grid over the x-y positions of a set of bodies, for finding the
+ * ones inside a rectangle without visiting the rest.
+ *
+ * The grid spans the bounding box of the positions it was built from, with
+ * about BODIES_PER_CELL bodies per cell on average, and stores body indices
+ * sorted by cell (a counting sort, so a build is two linear passes). Queries
+ * return whole cells; callers test the exact positions themselves, which
+ * also lets a grid built a little while ago stay usable as long as queries
+ * are widened by how far any body can have moved since.
+ */
+class BodyGrid {
+public:
+    void build(const std::vector<Vector3d>& positions, size_t count);
+
+    bool empty() const { return cellStart_.empty(); }
+    size_t size() const { return indices_.size(); }
+    double getCellSize() const { return cellSize_; }
+
+    // Call visit(index) for every body in a cell overlapping [minX, maxX] x [minY, maxY]
+    template <typename Visit>
+    void query(double minX, double minY, double maxX, double maxY, Visit&& visit) const;
+
+    static constexpr double BODIES_PER_CELL = 4.0;
+    static constexpr uint32_t MAX_CELLS_PER_SIDE = 2048;
+
+private:
+    uint32_t column(double x) const;
+    uint32_t row(double y) const;
+
+    double originX_ = 0.0, originY_ = 0.0;
+    double cellSize_ = 1.0;
+    double inverseCellSize_ = 1.0;
+    uint32_t columns_ = 0, rows_ = 0;
+    std::vector<uint32_t> cellStart_;    // columns_ * rows_ + 1 offsets into indices_
+    std::vector<uint32_t> indices_;      // Body indices, grouped by cell
+    std::vector<uint32_t> bodyCell_;     // Scratch: cell of each body during a build
+};
+
+inline uint32_t BodyGrid::column(double x) const {
+    const double c = (x - originX_) * inverseCellSize_;
+    return c <= 0.0 ? 0 : c >= columns_ ? columns_ - 1 : static_cast<uint32_t>(c);
+}
+
+inline uint32_t BodyGrid::row(double y) const {
+    const double r = (y - originY_) * inverseCellSize_;
+    return r <= 0.0 ? 0 : r >= rows_ ? rows_ - 1 : static_cast<uint32_t>(r);
+}
+
+template <typename Visit>
+void BodyGrid::query(double minX, double minY, double maxX, double maxY, Visit&& visit) const {
+    if (empty() || maxX < minX || maxY < minY) {
+        return;
+    }
+    // The edge cells also hold everything clamped into them, so a rectangle past the grid still finds it
+    const uint32_t c0 = column(minX), c1 = column(maxX);
+    const uint32_t r0 = row(minY), r1 = row(maxY);
+    for (uint32_t r = r0; r <= r1; ++r) {
+        const uint32_t begin = cellStart_[r * columns_ + c0];
+        const uint32_t end = cellStart_[r * columns_ + c1 + 1];
+        // Cells of a row are contiguous, so each row is one run
+        for (uint32_t k = begin; k < end; ++k) {
+            visit(indices_[k]);
+        }
+    }
+}
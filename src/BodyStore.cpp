@@ -0,0 +1,153 @@
+#include "BodyStore.h"
+#include "Physics.h"
+#include <algorithm>
+
+void BodyStore::reserve(size_t n) {
+    x.reserve(n);
+    y.reserve(n);
+    z.reserve(n);
+    vx.reserve(n);
+    vy.reserve(n);
+    vz.reserve(n);
+    px.reserve(n);
+    py.reserve(n);
+    pz.reserve(n);
+    ax.reserve(n);
+    ay.reserve(n);
+    az.reserve(n);
+    mass.reserve(n);
+    gm.reserve(n);
+    parent.reserve(n);
+    radius.reserve(n);
+}
+
+size_t BodyStore::add(double posX, double posY, double posZ, double velX, double velY, double velZ,
+                      double m, uint32_t parentIndex) {
+    x.push_back(posX);
+    y.push_back(posY);
+    z.push_back(posZ);
+    vx.push_back(velX);
+    vy.push_back(velY);
+    vz.push_back(velZ);
+    px.push_back(static_cast<float>(posX - originX));
+    py.push_back(static_cast<float>(posY - originY));
+    pz.push_back(static_cast<float>(posZ - originZ));
+    ax.push_back(0.0f);
+    ay.push_back(0.0f);
+    az.push_back(0.0f);
+    mass.push_back(m);
+    gm.push_back(gravitationalParameter(m));
+    parent.push_back(parentIndex);
+    radius.push_back(0.0);
+    return mass.size() - 1;
+}
+
+void BodyStore::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    vx.clear();
+    vy.clear();
+    vz.clear();
+    px.clear();
+    py.clear();
+    pz.clear();
+    ax.clear();
+    ay.clear();
+    az.clear();
+    mass.clear();
+    gm.clear();
+    parent.clear();
+    radius.clear();
+    potential.clear();
+}
+
+void BodyStore::compact(const std::vector<uint8_t>& keep, std::vector<uint32_t>& newIndex) {
+    const size_t n = size();
+    newIndex.assign(n, NO_PARENT);
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!keep[i]) {
+            continue;
+        }
+        newIndex[i] = static_cast<uint32_t>(kept);
+        x[kept] = x[i];
+        y[kept] = y[i];
+        z[kept] = z[i];
+        vx[kept] = vx[i];
+        vy[kept] = vy[i];
+        vz[kept] = vz[i];
+        px[kept] = px[i];
+        py[kept] = py[i];
+        pz[kept] = pz[i];
+        ax[kept] = ax[i];
+        ay[kept] = ay[i];
+        az[kept] = az[i];
+        mass[kept] = mass[i];
+        gm[kept] = gm[i];
+        parent[kept] = parent[i];
+        radius[kept] = radius[i];
+        ++kept;
+    }
+    for (std::vector<double>* v : {&x, &y, &z, &vx, &vy, &vz, &mass, &radius}) {
+        v->resize(kept);
+    }
+    for (std::vector<float>* v : {&px, &py, &pz, &ax, &ay, &az, &gm}) {
+        v->resize(kept);
+    }
+    parent.resize(kept);
+    potential.clear();
+
+    // Parent indices still refer to the old layout
+    for (size_t i = 0; i < kept; ++i) {
+        if (parent[i] != NO_PARENT) {
+            parent[i] = newIndex[parent[i]];
+        }
+    }
+}
+
+void BodyStore::recenterOrigin() {
+    double mx = 0.0, my = 0.0, mz = 0.0, total = 0.0;
+    for (size_t i = 0; i < size(); ++i) {
+        mx += mass[i] * x[i];
+        my += mass[i] * y[i];
+        mz += mass[i] * z[i];
+        total += mass[i];
+    }
+    if (total > 0.0) {
+        originX = mx / total;
+        originY = my / total;
+        originZ = mz / total;
+    }
+}
+
+void BodyStore::updateSinglePositions(size_t begin, size_t end, bool threeD) {
+    for (size_t i = begin; i < end; ++i) {
+        px[i] = static_cast<float>(x[i] - originX);
+        py[i] = static_cast<float>(y[i] - originY);
+    }
+    if (threeD) {
+        for (size_t i = begin; i < end; ++i) {
+            pz[i] = static_cast<float>(z[i] - originZ);
+        }
+    }
+}
+
+void BodyStore::resetForces() {
+    std::fill(ax.begin(), ax.end(), 0.0f);
+    std::fill(ay.begin(), ay.end(), 0.0f);
+    std::fill(az.begin(), az.end(), 0.0f);
+    std::fill(potential.begin(), potential.end(), 0.0f);
+}
+
+void BodyStore::setMass(size_t i, double m) {
+    mass[i] = m;
+    gm[i] = gravitationalParameter(m);
+}
+
+float BodyStore::gravitationalParameter(double m) {
+    // a = G m / r^2 with r in meters; with r = d / S for a simulation distance d,
+    // the acceleration in simulation units is S * G m S^2 / d^2 = (G m S^3) / d^2
+    const double scale = Physics::DISTANCE_SCALE;
+    return static_cast<float>(Physics::G * m * scale * scale * scale);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Packed structure-of-arrays storage for the hot simulation state of every body.
+ * The force and integration loops in SolarSystem walk these contiguous arrays
+ * directly; CelestialBody objects only refer into them by index.
+ *
+ * Positions and velocities are integrated in double precision. The force
+ * kernels read a single-precision copy (px/py/pz) taken relative to a floating
+ * origin near the bodies, refreshed before every force evaluation.
+ */
+struct BodyStore {
+    // Position (simulation units)
+    std::vector<double> x, y, z;
+    // Velocity (simulation units per second)
+    std::vector<double> vx, vy, vz;
+    // Position relative to (originX, originY, originZ), as read by the force solvers.
+    // pz is only kept current in 3D; 2D evaluations must not read it
+    std::vector<float> px, py, pz;
+    // Accumulated gravitational acceleration for the current physics step
+    std::vector<float> ax, ay, az;
+    // Mass in kg
+    std::vector<double> mass;
+    // Gravitational parameter G * m expressed in simulation units, as read by the force kernel
+    std::vector<float> gm;
+    // Index of the body this one orbits (NO_PARENT for none); its pull is corrected in double
+    std::vector<uint32_t> parent;
+    // Physical radius (simulation units), used for collisions
+    std::vector<double> radius;
+    // Softened gravitational potential per unit mass (simulation units), filled by full force
+    // evaluations while it is sized like the rest; left empty except on diagnostics steps
+    std::vector<float> potential;
+
+    // Floating origin of px/py/pz
+    double originX = 0.0, originY = 0.0, originZ = 0.0;
+
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    size_t size() const { return mass.size(); }
+    bool empty() const { return mass.empty(); }
+
+    // Reserve room for n bodies in every array
+    void reserve(size_t n);
+
+    // Append a body and return its index
+    size_t add(double posX, double posY, double posZ, double velX, double velY, double velZ,
+               double m, uint32_t parentIndex = NO_PARENT);
+
+    // Remove all bodies
+    void clear();
+
+    // Drop every body i with keep[i] == 0, preserving the order of the rest. newIndex[i]
+    // receives body i's new index (NO_PARENT if dropped); parents are remapped, and a
+    // dropped parent becomes NO_PARENT
+    void compact(const std::vector<uint8_t>& keep, std::vector<uint32_t>& newIndex);
+
+    // Change the mass of body i, keeping gm in step
+    void setMass(size_t i, double m);
+
+    // Move the floating origin to the mass-weighted centre of all bodies
+    void recenterOrigin();
+
+    // Refresh px/py/pz of bodies [begin, end) from the double positions; 2D evaluation ignores
+    // pz, so without threeD it is left as it was
+    void updateSinglePositions(size_t begin, size_t end, bool threeD);
+
+    // Zero the acceleration accumulators of all bodies, and the potential if it is in use
+    void resetForces();
+
+    // G * m in simulation units (distance scaled by Physics::DISTANCE_SCALE)
+    static float gravitationalParameter(double m);
+};
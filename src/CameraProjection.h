@@ -0,0 +1,69 @@
+#pragma once
+#include <SFML/System/Vector2.hpp>
+#include "CelestialBody.h"
+#include <cmath>
+#include <cstddef>
+
+/**
+ * The renderer's 3D camera model: translate to the camera, pitch about x, yaw
+ * about y, then divide by depth at PERSPECTIVE_DISTANCE in front of the
+ * screen, leaving world units around the view centre.
+ *
+ * The sines and cosines are only worked out again when an angle changes, so
+ * projecting a point is a handful of multiply-adds. The trail shader and the
+ * GPU backend's draw shader apply the same model to their vertices.
+ */
+class CameraProjection {
+public:
+    static constexpr float PERSPECTIVE_DISTANCE = 1000.0f;
+
+    void setCamera(const sf::Vector2f& center, float cameraZ, float pitch, float yaw) {
+        center_ = center;
+        cameraZ_ = cameraZ;
+        if (pitch != pitch_ || yaw != yaw_) {
+            pitch_ = pitch;
+            yaw_ = yaw;
+            cosPitch_ = std::cos(pitch);
+            sinPitch_ = std::sin(pitch);
+            cosYaw_ = std::cos(yaw);
+            sinYaw_ = std::sin(yaw);
+        }
+    }
+
+    sf::Vector2f project(const Vector3f& position) const {
+        const float x = position.x - center_.x;
+        const float y = position.y - center_.y;
+        const float z = position.z - cameraZ_;
+
+        const float yPitch = y * cosPitch_ - z * sinPitch_;
+        const float zPitch = y * sinPitch_ + z * cosPitch_;
+        const float xYaw = x * cosYaw_ + zPitch * sinYaw_;
+        float zYaw = -x * sinYaw_ + zPitch * cosYaw_;
+
+        // Points behind the eye are pulled in front of it rather than dividing by zero
+        zYaw = zYaw < -PERSPECTIVE_DISTANCE ? -PERSPECTIVE_DISTANCE + 1.0f : zYaw;
+        const float depth = PERSPECTIVE_DISTANCE / (PERSPECTIVE_DISTANCE + zYaw);
+        return sf::Vector2f(xYaw * depth + center_.x, yPitch * depth + center_.y);
+    }
+
+    // Project count points in one pass; the loop has no branches, so it vectorizes
+    void project(const Vector3f* positions, size_t count, sf::Vector2f* out) const {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = project(positions[i]);
+        }
+    }
+
+    const sf::Vector2f& getCenter() const { return center_; }
+    float getCameraZ() const { return cameraZ_; }
+    float getCosPitch() const { return cosPitch_; }
+    float getSinPitch() const { return sinPitch_; }
+    float getCosYaw() const { return cosYaw_; }
+    float getSinYaw() const { return sinYaw_; }
+
+private:
+    sf::Vector2f center_;
+    float cameraZ_ = 0.0f;
+    float pitch_ = 0.0f, yaw_ = 0.0f;
+    float cosPitch_ = 1.0f, sinPitch_ = 0.0f;
+    float cosYaw_ = 1.0f, sinYaw_ = 0.0f;
+};
@@ -4,138 +4,202 @@
 
 CelestialBody::CelestialBody(const std::string& name, double mass, double radius,
                            const sf::Vector2f& position, const sf::Vector2f& velocity,
-                           const sf::Color& color)
-    : name_(name), mass_(mass), radius_(radius), position_(position),
-      velocity_(velocity), force_(0.0f, 0.0f),
-      position3D_(Vector3f(position)), velocity3D_(Vector3f(velocity)), force3D_(Vector3f()),
-      color_(color), visualRadius_(static_cast<float>(radius * Physics::DISTANCE_SCALE)) {
+                           const Color& color)
+    : name_(name), radius_(radius), color_(color),
+      visualRadius_(static_cast<float>(radius * Physics::DISTANCE_SCALE)),
+      store_(nullptr), index_(0), mass_(mass),
+      position_(Vector3d(Vector3f(position))), velocity_(Vector3d(Vector3f(velocity))),
+      acceleration_(Vector3f()) {
 }
 
-void CelestialBody::addForce(const sf::Vector2f& force) {
-    force_ += force;
+CelestialBody::CelestialBody(const std::string& name, double mass, double radius,
+                           const Vector3d& position, const Vector3d& velocity,
+                           const Color& color)
+    : name_(name), radius_(radius), color_(color),
+      visualRadius_(static_cast<float>(radius * Physics::DISTANCE_SCALE)),
+      store_(nullptr), index_(0), mass_(mass),
+      position_(position), velocity_(velocity), acceleration_(Vector3f()) {
 }
 
-void CelestialBody::addForce3D(const Vector3f& force) {
-    force3D_ += force;
-    force_ += force.to2D(); // Keep 2D version in sync
+CelestialBody::CelestialBody(const CelestialBody& other)
+    : name_(other.name_), radius_(other.radius_), color_(other.color_),
+      visualRadius_(other.visualRadius_),
+      store_(nullptr), index_(0), mass_(other.getMass()),
+      position_(other.getPrecisePosition()), velocity_(other.getPreciseVelocity()),
+      acceleration_(Vector3f()) {
+    if (other.store_) {
+        const BodyStore& s = *other.store_;
+        acceleration_ = Vector3f(s.ax[other.index_], s.ay[other.index_], s.az[other.index_]);
+    } else {
+        acceleration_ = other.acceleration_;
+    }
 }
 
-void CelestialBody::update(double deltaTime) {
-    // Apply scaled time factor
-    deltaTime *= Physics::TIME_SCALE;
+CelestialBody& CelestialBody::operator=(const CelestialBody& other) {
+    if (this != &other) {
+        CelestialBody copy(other);
+        name_ = copy.name_;
+        radius_ = copy.radius_;
+        color_ = copy.color_;
+        visualRadius_ = copy.visualRadius_;
+        store_ = nullptr;
+        index_ = 0;
+        mass_ = copy.mass_;
+        position_ = copy.position_;
+        velocity_ = copy.velocity_;
+        acceleration_ = copy.acceleration_;
+    }
+    return *this;
+}
 
-    // Calculate acceleration from force (F = ma, so a = F/m)
-    sf::Vector2f acceleration = force_ / static_cast<float>(mass_);
+void CelestialBody::attach(BodyStore& store, size_t index) {
+    store.x[index] = position_.x;
+    store.y[index] = position_.y;
+    store.z[index] = position_.z;
+    store.vx[index] = velocity_.x;
+    store.vy[index] = velocity_.y;
+    store.vz[index] = velocity_.z;
+    store.px[index] = static_cast<float>(position_.x - store.originX);
+    store.py[index] = static_cast<float>(position_.y - store.originY);
+    store.pz[index] = static_cast<float>(position_.z - store.originZ);
+    store.ax[index] = acceleration_.x;
+    store.ay[index] = acceleration_.y;
+    store.az[index] = acceleration_.z;
+    store.setMass(index, mass_);
+    store.radius[index] = radius_ * Physics::DISTANCE_SCALE;
+    store_ = &store;
+    index_ = index;
+}
+
+void CelestialBody::setMass(double mass) {
+    if (store_) {
+        store_->setMass(index_, mass);
+    } else {
+        mass_ = mass;
+    }
+}
+
+void CelestialBody::setRadius(double radius) {
+    radius_ = radius;
+    if (store_) {
+        store_->radius[index_] = radius * Physics::DISTANCE_SCALE;
+    }
+}
+
+void CelestialBody::setPrecisePosition(const Vector3d& position) {
+    if (store_) {
+        store_->x[index_] = position.x;
+        store_->y[index_] = position.y;
+        store_->z[index_] = position.z;
+    } else {
+        position_ = position;
+    }
+}
+
+void CelestialBody::setPreciseVelocity(const Vector3d& velocity) {
+    if (store_) {
+        store_->vx[index_] = velocity.x;
+        store_->vy[index_] = velocity.y;
+        store_->vz[index_] = velocity.z;
+    } else {
+        velocity_ = velocity;
+    }
+}
+
+void CelestialBody::setPosition(const sf::Vector2f& position) {
+    if (store_) {
+        store_->x[index_] = position.x;
+        store_->y[index_] = position.y;
+    } else {
+        position_.x = position.x;
+        position_.y = position.y;
+    }
+}
+
+void CelestialBody::setVelocity(const sf::Vector2f& velocity) {
+    if (store_) {
+        store_->vx[index_] = velocity.x;
+        store_->vy[index_] = velocity.y;
+    } else {
+        velocity_.x = velocity.x;
+        velocity_.y = velocity.y;
+    }
+}
 
-    // Update velocity using Verlet integration for better stability
-    velocity_ += acceleration * static_cast<float>(deltaTime);
+void CelestialBody::addForce(const sf::Vector2f& force) {
+    addForce3D(Vector3f(force));
+}
 
-    // Update position
-    position_ += velocity_ * static_cast<float>(deltaTime);
+void CelestialBody::addForce3D(const Vector3f& force) {
+    // Accumulated as acceleration (a = F/m), the quantity the integrators consume
+    Vector3f acceleration = force / static_cast<float>(getMass());
+    if (store_) {
+        store_->ax[index_] += acceleration.x;
+        store_->ay[index_] += acceleration.y;
+        store_->az[index_] += acceleration.z;
+    } else {
+        acceleration_ += acceleration;
+    }
 }
 
 void CelestialBody::resetForces() {
-    force_ = sf::Vector2f(0.0f, 0.0f);
-    force3D_ = Vector3f();
+    if (store_) {
+        store_->ax[index_] = 0.0f;
+        store_->ay[index_] = 0.0f;
+        store_->az[index_] = 0.0f;
+    } else {
+        acceleration_ = Vector3f();
+    }
 }
 
 bool CelestialBody::contains(const sf::Vector2f& point) const {
-    float dx = point.x - position_.x;
-    float dy = point.y - position_.y;
+    sf::Vector2f position = getPosition();
+    float dx = point.x - position.x;
+    float dy = point.y - position.y;
     float distanceSquared = dx * dx + dy * dy;
     float radiusSquared = visualRadius_ * visualRadius_;
     return distanceSquared <= radiusSquared;
 }
 
 double CelestialBody::distanceTo(const CelestialBody& other) const {
-    return Physics::distance(position_, other.position_);
+    Vector3d delta = other.getPrecisePosition() - getPrecisePosition();
+    return std::sqrt(delta.x * delta.x + delta.y * delta.y);
 }
 
 sf::Vector2f CelestialBody::calculateGravitationalForce(const CelestialBody& body1,
                                                        const CelestialBody& body2) {
-    // Calculate distance vector
-    sf::Vector2f deltaPos = body2.position_ - body1.position_;
-    float distance = Physics::magnitude(deltaPos);
-
-    // Prevent division by zero and unrealistic forces at very close distances
-    const float minDistance = 1e6f; // Minimum distance in meters
-    if (distance < minDistance) {
-        distance = minDistance;
-    }
-
-    // Convert distance from simulation units to meters for calculation
-    double distanceMeters = distance / Physics::DISTANCE_SCALE;
-
-    // Calculate gravitational force magnitude: F = G * m1 * m2 / r^2
-    double forceMagnitude = G * body1.mass_ * body2.mass_ / (distanceMeters * distanceMeters);
-
-    // Convert force back to simulation units and apply direction
-    float forceSimulation = static_cast<float>(forceMagnitude * Physics::DISTANCE_SCALE);
-    sf::Vector2f direction = Physics::normalize(deltaPos);
-
-    return direction * forceSimulation;
+    Vector3d deltaPos = body2.getPrecisePosition() - body1.getPrecisePosition();
+    deltaPos.z = 0.0;
+    Vector3f force = calculateGravitationalForce3D(body1, body2, deltaPos);
+    return force.to2D();
 }
 
 Vector3f CelestialBody::calculateGravitationalForce3D(const CelestialBody& body1,
                                                      const CelestialBody& body2) {
-    // Calculate distance vector in 3D
-    Vector3f deltaPos = body2.position3D_ - body1.position3D_;
-    float distance = deltaPos.magnitude();
-
-    // Prevent division by zero and unrealistic forces at very close distances
-    const float minDistance = 1e6f; // Minimum distance in meters
-    if (distance < minDistance) {
-        distance = minDistance;
-    }
-
-    // Convert distance from simulation units to meters for calculation
-    double distanceMeters = distance / Physics::DISTANCE_SCALE;
-
-    // Calculate gravitational force magnitude: F = G * m1 * m2 / r^2
-    double forceMagnitude = G * body1.mass_ * body2.mass_ / (distanceMeters * distanceMeters);
-
-    // Convert force back to simulation units and apply direction
-    float forceSimulation = static_cast<float>(forceMagnitude * Physics::DISTANCE_SCALE);
-    Vector3f direction = deltaPos.normalized();
-
-    return direction * forceSimulation;
+    return calculateGravitationalForce3D(body1, body2, body2.getPrecisePosition() - body1.getPrecisePosition());
 }
 
-void CelestialBody::update3D(const std::vector<CelestialBody>& bodies, float deltaTime) {
-    // Only update if not the Sun (index 0 in typical setup)
-    if (this->mass_ < 1.989e30) { // Sun's mass threshold
-        // Calculate net gravitational force from all other bodies
-        Vector3f netForce(0.0f, 0.0f, 0.0f);
-
-        for (const auto& body : bodies) {
-            if (&body != this) { // Don't calculate force from itself
-                Vector3f force = calculateGravitationalForce3D(*this, body);
-                netForce = netForce + force;
-            }
-        }
-
-        // Calculate acceleration: a = F/m
-        Vector3f acceleration = netForce / static_cast<float>(mass_);
-
-        // Store current position before updating
-        Vector3f currentPos = position3D_;
-
-        // Use a more stable integration method - simple Euler with smaller effective timestep
-        float effectiveDt = deltaTime * 0.1f; // Much smaller timestep for stability
-
-        // Update velocity
-        velocity3D_ = velocity3D_ + acceleration * effectiveDt;
-
-        // Update position
-        position3D_ = position3D_ + velocity3D_ * effectiveDt;
-
-        // Update previous position for Verlet (if needed later)
-        previousPosition3D_ = currentPos;
+Vector3f CelestialBody::calculateGravitationalForce3D(const CelestialBody& body1,
+                                                     const CelestialBody& body2,
+                                                     const Vector3d& deltaPos) {
+    // Convert the separation from simulation units to meters
+    double dx = deltaPos.x / Physics::DISTANCE_SCALE;
+    double dy = deltaPos.y / Physics::DISTANCE_SCALE;
+    double dz = deltaPos.z / Physics::DISTANCE_SCALE;
+
+    // Plummer-softened F = G * m1 * m2 * r / (r^2 + eps^2)^(3/2); the softening
+    // keeps close encounters finite without a distance clamp
+    double r2 = dx * dx + dy * dy + dz * dz + Physics::SOFTENING_LENGTH * Physics::SOFTENING_LENGTH;
+    double scale = G * body1.getMass() * body2.getMass() / (r2 * std::sqrt(r2));
+
+    // Convert force back to simulation units
+    scale *= Physics::DISTANCE_SCALE;
+    return Vector3f(static_cast<float>(dx * scale),
+                    static_cast<float>(dy * scale),
+                    static_cast<float>(dz * scale));
+}
 
-        // Project 3D position to 2D for rendering
-        position_ = sf::Vector2f(position3D_.x, position3D_.y);
-    }
-}float CelestialBody::getDistanceFrom3D(const CelestialBody& other) const {
-    Vector3f diff = position3D_ - other.position3D_;
-    return diff.magnitude();
+float CelestialBody::getDistanceFrom3D(const CelestialBody& other) const {
+    Vector3d diff = getPrecisePosition() - other.getPrecisePosition();
+    return static_cast<float>(diff.magnitude());
 }
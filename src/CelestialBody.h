@@ -1,6 +1,9 @@
 #pragma once
-#include <SFML/Graphics.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <cmath>
 #include <string>
+#include "BodyStore.h"
+#include "Color.h"
 
 /**
  * Simple 3D vector structure for 3D simulation mode
@@ -26,54 +29,89 @@ struct Vector3f {
     sf::Vector2f to2D() const { return sf::Vector2f(x, y); }
 };
 
+/**
+ * Double-precision 3D vector for simulation state; Vector3f is the render-side counterpart
+ */
+struct Vector3d {
+    double x, y, z;
+
+    Vector3d() : x(0), y(0), z(0) {}
+    Vector3d(double x_, double y_, double z_) : x(x_), y(y_), z(z_) {}
+    explicit Vector3d(const Vector3f& vec) : x(vec.x), y(vec.y), z(vec.z) {}
+
+    Vector3d operator+(const Vector3d& other) const { return Vector3d(x + other.x, y + other.y, z + other.z); }
+    Vector3d operator-(const Vector3d& other) const { return Vector3d(x - other.x, y - other.y, z - other.z); }
+    Vector3d operator*(double scalar) const { return Vector3d(x * scalar, y * scalar, z * scalar); }
+    Vector3d& operator+=(const Vector3d& other) { x += other.x; y += other.y; z += other.z; return *this; }
+
+    double magnitude() const { return std::sqrt(x*x + y*y + z*z); }
+
+    // Rounded to single precision for rendering
+    Vector3f toFloat() const { return Vector3f(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)); }
+};
+
 /**
  * Represents a celestial body in the solar system with physical properties
- * and visual representation
+ * and visual representation.
+ *
+ * Once added to a SolarSystem the body's position, velocity, force and mass live
+ * in the system's BodyStore and this object acts as a handle onto its slot; the
+ * name, colour and radii stay here since the physics loops never touch them.
+ * A detached body (not yet added, or a copy) keeps its own state.
+ *
+ * The simulation state is double precision: positions in simulation units and
+ * velocities in simulation units per second. The float getters round it for
+ * rendering and UI; physics code uses the getPrecise* accessors.
  */
 class CelestialBody {
 public:
     CelestialBody(const std::string& name, double mass, double radius,
                   const sf::Vector2f& position, const sf::Vector2f& velocity,
-                  const sf::Color& color = sf::Color::White);
+                  const Color& color = Color::White);
+    CelestialBody(const std::string& name, double mass, double radius,
+                  const Vector3d& position, const Vector3d& velocity,
+                  const Color& color = Color::White);
+
+    // Copies are detached snapshots of the current state
+    CelestialBody(const CelestialBody& other);
+    CelestialBody& operator=(const CelestialBody& other);
 
     // Physics properties
-    double getMass() const { return mass_; }
+    double getMass() const { return store_ ? store_->mass[index_] : mass_; }
     double getRadius() const { return radius_; }
-    sf::Vector2f getPosition() const { return position_; }
-    sf::Vector2f getVelocity() const { return velocity_; }
+    void setMass(double mass);
+    void setRadius(double radius);
+    sf::Vector2f getPosition() const { return getPosition3D().to2D(); }
+    sf::Vector2f getVelocity() const { return getVelocity3D().to2D(); }
     std::string getName() const { return name_; }
-    sf::Color getColor() const { return color_; }
+    Color getColor() const { return color_; }
 
     // 3D physics properties
-    Vector3f getPosition3D() const { return position3D_; }
-    Vector3f getVelocity3D() const { return velocity3D_; }
-    void setPosition3D(const Vector3f& position) {
-        position3D_ = position;
-        position_ = position.to2D();
+    Vector3f getPosition3D() const { return getPrecisePosition().toFloat(); }
+    Vector3f getVelocity3D() const { return getPreciseVelocity().toFloat(); }
+    void setPosition3D(const Vector3f& position) { setPrecisePosition(Vector3d(position)); }
+    void setVelocity3D(const Vector3f& velocity) { setPreciseVelocity(Vector3d(velocity)); }
+
+    // Double-precision simulation state
+    Vector3d getPrecisePosition() const {
+        return store_ ? Vector3d(store_->x[index_], store_->y[index_], store_->z[index_]) : position_;
     }
-    void setVelocity3D(const Vector3f& velocity) {
-        velocity3D_ = velocity;
-        velocity_ = velocity.to2D();
+    Vector3d getPreciseVelocity() const {
+        return store_ ? Vector3d(store_->vx[index_], store_->vy[index_], store_->vz[index_]) : velocity_;
     }
+    void setPrecisePosition(const Vector3d& position);
+    void setPreciseVelocity(const Vector3d& velocity);
 
-    void setPosition(const sf::Vector2f& position) { position_ = position; }
-    void setVelocity(const sf::Vector2f& velocity) { velocity_ = velocity; }
+    void setPosition(const sf::Vector2f& position);
+    void setVelocity(const sf::Vector2f& velocity);
 
     // Add force to the body (for gravity calculations)
     void addForce(const sf::Vector2f& force);
     void addForce3D(const Vector3f& force);
 
-    // Update position based on velocity and forces (physics integration)
-    void update(double deltaTime);
-    void update3D(const std::vector<CelestialBody>& bodies, float deltaTime);
-
     // 3D distance calculation
     float getDistanceFrom3D(const CelestialBody& other) const;
 
-    // Previous position for Verlet integration in 3D
-    Vector3f getPreviousPosition3D() const { return previousPosition3D_; }
-    void setPreviousPosition3D(const Vector3f& pos) { previousPosition3D_ = pos; }
-
     // Reset forces (called after each physics update)
     void resetForces();
 
@@ -87,6 +125,12 @@ public:
     // Get distance to another body
     double distanceTo(const CelestialBody& other) const;
 
+    // Bind this body to a slot of a packed store; the current state is copied in
+    void attach(BodyStore& store, size_t index);
+    // Follow the body's slot after the store was compacted; nothing is copied
+    void rebind(size_t index) { index_ = index; }
+    size_t getIndex() const { return index_; }
+
     // Static method to calculate gravitational force between two bodies
     static sf::Vector2f calculateGravitationalForce(const CelestialBody& body1,
                                                    const CelestialBody& body2);
@@ -94,21 +138,24 @@ public:
                                                   const CelestialBody& body2);
 
 private:
+    static Vector3f calculateGravitationalForce3D(const CelestialBody& body1,
+                                                  const CelestialBody& body2,
+                                                  const Vector3d& deltaPos);
+
     std::string name_;
-    double mass_;           // Mass in kg
     double radius_;         // Physical radius in meters
-    sf::Vector2f position_; // Position in meters (simulation space - 2D)
-    sf::Vector2f velocity_; // Velocity in m/s (2D)
-    sf::Vector2f force_;    // Accumulated force for current physics step (2D)
+    Color color_;       // Visual color
+    float visualRadius_;    // Visual radius for rendering (may be scaled)
 
-    // 3D simulation support
-    Vector3f position3D_;           // Position in 3D space
-    Vector3f velocity3D_;           // Velocity in 3D space
-    Vector3f force3D_;              // Accumulated force in 3D space
-    Vector3f previousPosition3D_;   // Previous position for Verlet integration
+    // Slot in the owning system's packed state (null while detached)
+    BodyStore* store_;
+    size_t index_;
 
-    sf::Color color_;       // Visual color
-    float visualRadius_;    // Visual radius for rendering (may be scaled)
+    // Detached state, only authoritative while store_ is null
+    double mass_;           // Mass in kg
+    Vector3d position_;     // Position in simulation units
+    Vector3d velocity_;     // Velocity in simulation units per second
+    Vector3f acceleration_; // Accumulated acceleration (force / mass) for current physics step
 
     // Constants
     static constexpr double G = 6.67430e-11; // Gravitational constant
@@ -0,0 +1,386 @@
+#include "Checkpoint.h"
+#include "MappedFile.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+constexpr char MAGIC[8] = {'G', 'R', 'A', 'V', 'C', 'K', 'P', 'T'};
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr size_t ALIGNMENT = 64;
+
+constexpr uint32_t FLAG_THREE_D = 1u << 0;
+constexpr uint32_t FLAG_PAUSED = 1u << 1;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;        // BYTE_ORDER_MARK as the writer saw it
+    uint64_t fileBytes;
+    uint64_t checksum;         // Over everything after the header
+    uint64_t bodyCount;
+    uint64_t particleCount;
+    uint32_t sectionCount;
+    uint32_t flags;
+    double simulationTime;
+    uint64_t stepCount;        // SolarSystem::getStepCount(), so a resumed run numbers on
+    double timeScale;
+    double origin[3];
+    char integrator[32];       // Integrator::getName() of the saved state
+};
+
+struct Section {
+    uint32_t id;
+    uint32_t elementBytes;     // 0 for sections not sized per body
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+enum SectionId : uint32_t {
+    POSITION_X, POSITION_Y, POSITION_Z,
+    VELOCITY_X, VELOCITY_Y, VELOCITY_Z,
+    MASS, PARENT, RADIUS, VISUAL_RADIUS, COLOR,
+    NAME_OFFSETS,              // bodyCount + 1 offsets into NAME_DATA
+    NAME_DATA,
+    INTEGRATOR_STATE,
+    PARTICLE_X, PARTICLE_Y, PARTICLE_Z,
+    PARTICLE_VX, PARTICLE_VY, PARTICLE_VZ,
+    PARTICLE_PARENT, PARTICLE_COLOR,
+    SECTION_COUNT
+};
+
+static_assert(sizeof(Header) % 8 == 0 && sizeof(Section) % 8 == 0, "checkpoint records must stay 8-byte aligned");
+
+// FNV-1a over 8-byte words, then the tail bytes
+uint64_t checksum(const uint8_t* data, size_t size) {
+    constexpr uint64_t PRIME = 1099511628211ull;
+    uint64_t hash = 14695981039346656037ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * PRIME;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * PRIME;
+    }
+    return hash;
+}
+
+void appendSection(std::vector<uint8_t>& image, std::vector<Section>& sections, uint32_t id,
+                   uint32_t elementBytes, const void* data, size_t bytes) {
+    image.resize((image.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+    sections.push_back({id, elementBytes, image.size(), bytes});
+    if (bytes > 0) {
+        const auto* begin = static_cast<const uint8_t*>(data);
+        image.insert(image.end(), begin, begin + bytes);
+    }
+}
+
+template <typename T>
+void appendArray(std::vector<uint8_t>& image, std::vector<Section>& sections, uint32_t id, const std::vector<T>& values) {
+    appendSection(image, sections, id, sizeof(T), values.data(), values.size() * sizeof(T));
+}
+
+template <typename T>
+T readElement(const uint8_t* base, size_t i) {
+    T value;
+    std::memcpy(&value, base + i * sizeof(T), sizeof(T));
+    return value;
+}
+
+} // namespace
+
+void Checkpoint::capture(const SolarSystem& system, std::vector<uint8_t>& image) {
+    const BodyStore& s = system.getStore();
+    const auto& bodies = system.getBodies();
+    const size_t n = s.size();
+
+    // Per-body metadata lives in CelestialBody, so it is gathered into arrays here
+    std::vector<double> radius(n);
+    std::vector<float> visualRadius(n);
+    std::vector<uint32_t> color(n);
+    std::vector<uint64_t> nameOffsets(n + 1, 0);
+    std::string names;
+    for (size_t i = 0; i < n; ++i) {
+        const CelestialBody& body = *bodies[i];
+        radius[i] = body.getRadius();
+        visualRadius[i] = body.getVisualRadius();
+        const Color c = body.getColor();
+        color[i] = uint32_t(c.r) | uint32_t(c.g) << 8 | uint32_t(c.b) << 16 | uint32_t(c.a) << 24;
+        names += body.getName();
+        nameOffsets[i + 1] = names.size();
+    }
+    std::vector<uint8_t> integratorState;
+    system.getIntegrator().saveState(integratorState);
+
+    const TestParticles& particles = system.getTestParticles();
+    const size_t m = particles.size();
+    std::vector<uint32_t> particleColor(m);
+    for (size_t i = 0; i < m; ++i) {
+        const Color c = system.getTestParticleColors()[i];
+        particleColor[i] = uint32_t(c.r) | uint32_t(c.g) << 8 | uint32_t(c.b) << 16 | uint32_t(c.a) << 24;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.bodyCount = n;
+    header.particleCount = m;
+    header.sectionCount = SECTION_COUNT;
+    header.flags = (system.is3DMode() ? FLAG_THREE_D : 0) | (system.isPaused() ? FLAG_PAUSED : 0);
+    header.simulationTime = system.getSimulationTime();
+    header.stepCount = system.getStepCount();
+    header.timeScale = system.getTimeScale();
+    header.origin[0] = s.originX;
+    header.origin[1] = s.originY;
+    header.origin[2] = s.originZ;
+    std::strncpy(header.integrator, system.getIntegrator().getName(), sizeof(header.integrator) - 1);
+
+    image.clear();
+    image.reserve(sizeof(Header) + SECTION_COUNT * sizeof(Section) + SECTION_COUNT * ALIGNMENT +
+                  n * (7 * sizeof(double) + 3 * sizeof(uint32_t) + sizeof(float) + sizeof(uint64_t)) +
+                  m * (6 * sizeof(double) + 2 * sizeof(uint32_t)) + names.size() + integratorState.size());
+    image.resize(sizeof(Header) + SECTION_COUNT * sizeof(Section));
+
+    std::vector<Section> sections;
+    sections.reserve(SECTION_COUNT);
+    appendArray(image, sections, POSITION_X, s.x);
+    appendArray(image, sections, POSITION_Y, s.y);
+    appendArray(image, sections, POSITION_Z, s.z);
+    appendArray(image, sections, VELOCITY_X, s.vx);
+    appendArray(image, sections, VELOCITY_Y, s.vy);
+    appendArray(image, sections, VELOCITY_Z, s.vz);
+    appendArray(image, sections, MASS, s.mass);
+    appendArray(image, sections, PARENT, s.parent);
+    appendArray(image, sections, RADIUS, radius);
+    appendArray(image, sections, VISUAL_RADIUS, visualRadius);
+    appendArray(image, sections, COLOR, color);
+    appendSection(image, sections, NAME_OFFSETS, 0, nameOffsets.data(), nameOffsets.size() * sizeof(uint64_t));
+    appendSection(image, sections, NAME_DATA, 0, names.data(), names.size());
+    appendSection(image, sections, INTEGRATOR_STATE, 0, integratorState.data(), integratorState.size());
+    appendArray(image, sections, PARTICLE_X, particles.x);
+    appendArray(image, sections, PARTICLE_Y, particles.y);
+    appendArray(image, sections, PARTICLE_Z, particles.z);
+    appendArray(image, sections, PARTICLE_VX, particles.vx);
+    appendArray(image, sections, PARTICLE_VY, particles.vy);
+    appendArray(image, sections, PARTICLE_VZ, particles.vz);
+    appendArray(image, sections, PARTICLE_PARENT, particles.parent);
+    appendArray(image, sections, PARTICLE_COLOR, particleColor);
+
+    header.fileBytes = image.size();
+    std::memcpy(image.data(), &header, sizeof(Header));
+    std::memcpy(image.data() + sizeof(Header), sections.data(), sections.size() * sizeof(Section));
+}
+
+void Checkpoint::seal(std::vector<uint8_t>& image) {
+    if (image.size() < sizeof(Header)) {
+        return;
+    }
+    const uint64_t sum = checksum(image.data() + sizeof(Header), image.size() - sizeof(Header));
+    std::memcpy(image.data() + offsetof(Header, checksum), &sum, sizeof(sum));
+}
+
+bool Checkpoint::write(const std::vector<uint8_t>& image, const std::string& path, std::string& error) {
+    // Readers only ever see a complete file: write beside it, then rename over it
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            error = "cannot create " + temporary;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+        out.close();
+        if (!out) {
+            error = "failed writing " + temporary;
+            return false;
+        }
+    }
+
+    std::error_code code;
+    std::filesystem::rename(temporary, path, code);
+    if (code) {
+        error = "cannot replace " + path + ": " + code.message();
+        return false;
+    }
+    return true;
+}
+
+bool Checkpoint::save(const SolarSystem& system, const std::string& path, std::string& error) {
+    std::vector<uint8_t> image;
+    capture(system, image);
+    seal(image);
+    return write(image, path, error);
+}
+
+bool Checkpoint::load(SolarSystem& system, const std::string& path, std::string& error) {
+    MappedFile file;
+    if (!file.open(path, error)) {
+        return false;
+    }
+    if (!restore(system, file.data(), file.size(), error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool Checkpoint::restore(SolarSystem& system, const uint8_t* data, size_t size, std::string& error) {
+    Header header;
+    if (size < sizeof(Header)) {
+        error = "too short for a checkpoint";
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = "not a checkpoint";
+        return false;
+    }
+    if (header.byteOrder != BYTE_ORDER_MARK) {
+        error = "written on a machine with a different byte order";
+        return false;
+    }
+    if (header.version != VERSION) {
+        error = "unsupported checkpoint version " + std::to_string(header.version);
+        return false;
+    }
+    if (header.fileBytes != size || header.sectionCount != SECTION_COUNT ||
+        sizeof(Header) + SECTION_COUNT * sizeof(Section) > size) {
+        error = "truncated or malformed";
+        return false;
+    }
+    if (checksum(data + sizeof(Header), size - sizeof(Header)) != header.checksum) {
+        error = "checksum mismatch";
+        return false;
+    }
+
+    // Every section must lie inside the file; per-body ones must hold exactly bodyCount elements
+    // and per-particle ones particleCount
+    const size_t n = static_cast<size_t>(header.bodyCount);
+    const size_t m = static_cast<size_t>(header.particleCount);
+    const uint8_t* section[SECTION_COUNT];
+    uint64_t sectionBytes[SECTION_COUNT];
+    for (uint32_t k = 0; k < SECTION_COUNT; ++k) {
+        Section entry;
+        std::memcpy(&entry, data + sizeof(Header) + k * sizeof(Section), sizeof(Section));
+        const uint64_t elements = k >= PARTICLE_X ? m : n;
+        if (entry.id != k || entry.offset % ALIGNMENT != 0 || entry.offset > size || entry.bytes > size - entry.offset ||
+            (entry.elementBytes != 0 && entry.bytes != elements * uint64_t(entry.elementBytes))) {
+            error = "bad section " + std::to_string(k);
+            return false;
+        }
+        section[k] = data + entry.offset;
+        sectionBytes[k] = entry.bytes;
+    }
+    const uint32_t expectedElement[] = {8, 8, 8, 8, 8, 8, 8, 4, 8, 4, 4};
+    for (uint32_t k = POSITION_X; k <= COLOR; ++k) {
+        if (sectionBytes[k] != n * expectedElement[k]) {
+            error = "bad section " + std::to_string(k);
+            return false;
+        }
+    }
+    for (uint32_t k = PARTICLE_X; k <= PARTICLE_COLOR; ++k) {
+        if (sectionBytes[k] != m * (k <= PARTICLE_VZ ? sizeof(double) : sizeof(uint32_t))) {
+            error = "bad section " + std::to_string(k);
+            return false;
+        }
+    }
+    if (sectionBytes[NAME_OFFSETS] != (n + 1) * sizeof(uint64_t) ||
+        readElement<uint64_t>(section[NAME_OFFSETS], n) != sectionBytes[NAME_DATA]) {
+        error = "bad name table";
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        const uint32_t p = readElement<uint32_t>(section[PARENT], i);
+        const double m = readElement<double>(section[MASS], i);
+        if ((p != BodyStore::NO_PARENT && p >= n) || !(m >= 0.0) || !std::isfinite(m) ||
+            readElement<uint64_t>(section[NAME_OFFSETS], i) > readElement<uint64_t>(section[NAME_OFFSETS], i + 1)) {
+            error = "bad body " + std::to_string(i);
+            return false;
+        }
+        for (uint32_t k = POSITION_X; k <= VELOCITY_Z; ++k) {
+            if (!std::isfinite(readElement<double>(section[k], i))) {
+                error = "non-finite state for body " + std::to_string(i);
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < m; ++i) {
+        const uint32_t p = readElement<uint32_t>(section[PARTICLE_PARENT], i);
+        bool finite = true;
+        for (uint32_t k = PARTICLE_X; k <= PARTICLE_VZ; ++k) {
+            finite = finite && std::isfinite(readElement<double>(section[k], i));
+        }
+        if ((p != BodyStore::NO_PARENT && p >= n) || !finite) {
+            error = "bad test particle " + std::to_string(i);
+            return false;
+        }
+    }
+
+    // Another integrator's state means nothing to the current one
+    char savedIntegrator[sizeof(header.integrator) + 1] = {};
+    std::memcpy(savedIntegrator, header.integrator, sizeof(header.integrator));
+    if (std::strcmp(savedIntegrator, system.getIntegrator().getName()) == 0 &&
+        !system.getIntegrator().loadState(section[INTEGRATOR_STATE], sectionBytes[INTEGRATOR_STATE], n)) {
+        error = "integrator state does not fit";
+        return false;
+    }
+
+    // Valid: rebuild the bodies, then copy the state arrays over in bulk
+    system.clear();
+    system.set3DMode((header.flags & FLAG_THREE_D) != 0);
+    system.getStore().reserve(n);
+    const char* names = reinterpret_cast<const char*>(section[NAME_DATA]);
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t begin = readElement<uint64_t>(section[NAME_OFFSETS], i);
+        const uint64_t end = readElement<uint64_t>(section[NAME_OFFSETS], i + 1);
+        const uint32_t c = readElement<uint32_t>(section[COLOR], i);
+        auto body = std::make_unique<CelestialBody>(
+            std::string(names + begin, names + end), readElement<double>(section[MASS], i),
+            readElement<double>(section[RADIUS], i), Vector3d(), Vector3d(),
+            Color(c & 0xff, (c >> 8) & 0xff, (c >> 16) & 0xff, c >> 24));
+        body->setVisualRadius(readElement<float>(section[VISUAL_RADIUS], i));
+        system.addBody(std::move(body), readElement<uint32_t>(section[PARENT], i));
+    }
+
+    BodyStore& s = system.getStore();
+    std::vector<double>* state[] = {&s.x, &s.y, &s.z, &s.vx, &s.vy, &s.vz};
+    for (uint32_t k = POSITION_X; k <= VELOCITY_Z; ++k) {
+        if (n > 0) {
+            std::memcpy(state[k]->data(), section[k], n * sizeof(double));
+        }
+    }
+    s.originX = header.origin[0];
+    s.originY = header.origin[1];
+    s.originZ = header.origin[2];
+    s.updateSinglePositions(0, n, system.is3DMode());
+
+    system.getTestParticles().reserve(m);
+    for (size_t i = 0; i < m; ++i) {
+        const uint32_t c = readElement<uint32_t>(section[PARTICLE_COLOR], i);
+        system.addTestParticle(Vector3d(readElement<double>(section[PARTICLE_X], i), readElement<double>(section[PARTICLE_Y], i),
+                                        readElement<double>(section[PARTICLE_Z], i)),
+                               Vector3d(readElement<double>(section[PARTICLE_VX], i), readElement<double>(section[PARTICLE_VY], i),
+                                        readElement<double>(section[PARTICLE_VZ], i)),
+                               Color(c & 0xff, (c >> 8) & 0xff, (c >> 16) & 0xff, c >> 24),
+                               readElement<uint32_t>(section[PARTICLE_PARENT], i));
+    }
+
+    system.setTimeScale(header.timeScale);
+    system.setSimulationTime(header.simulationTime);
+    system.setStepCount(header.stepCount);
+    if (header.flags & FLAG_PAUSED) {
+        system.pause();
+    } else {
+        system.resume();
+    }
+    system.storeInitialConditions();
+    system.invalidateAccelerations();
+    return true;
+}
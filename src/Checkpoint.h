@@ -0,0 +1,37 @@
+#pragma once
+#include "SolarSystem.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Versioned binary checkpoint of a SolarSystem: the double-precision 3D state,
+ * masses, parents, the bodies' names, radii and colours, the test particles,
+ * the simulation clock and step count and the integrator's own state.
+ *
+ * The file is a fixed header, a section table, and one 64-byte aligned
+ * section per store array in native byte order, so a load is an mmap, one
+ * validation pass (header, bounds, sizes, checksum, parent indices) and a
+ * bulk copy into the store rather than a parse. Accelerations are not saved;
+ * they follow from the positions and are recomputed by the first step.
+ */
+class Checkpoint {
+public:
+    static constexpr uint32_t VERSION = 3;
+
+    // Serialise system into image, leaving the checksum for seal(); only copies arrays
+    static void capture(const SolarSystem& system, std::vector<uint8_t>& image);
+    // Fill in the checksum of a captured image
+    static void seal(std::vector<uint8_t>& image);
+    // Write a sealed image to a temporary file and rename it over path
+    static bool write(const std::vector<uint8_t>& image, const std::string& path, std::string& error);
+
+    // capture(), seal() and write() in one go
+    static bool save(const SolarSystem& system, const std::string& path, std::string& error);
+
+    // Map path, validate it and rebuild system from it. The integrator's state is
+    // restored only if the system currently uses the integrator that saved it.
+    static bool load(SolarSystem& system, const std::string& path, std::string& error);
+    static bool restore(SolarSystem& system, const uint8_t* data, size_t size, std::string& error);
+};
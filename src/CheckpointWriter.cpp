@@ -0,0 +1,82 @@
+#include "CheckpointWriter.h"
+#include "Checkpoint.h"
+#include "Profiler.h"
+#include <utility>
+
+CheckpointWriter::CheckpointWriter(std::string path) : path_(std::move(path)) {
+    thread_ = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void CheckpointWriter::submit(const SolarSystem& system) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (hasPending_) {
+        ++skipped_;
+    }
+    // The writer never touches pending_, so the capture can reuse its capacity
+    Checkpoint::capture(system, pending_);
+    hasPending_ = true;
+    wake_.notify_one();
+}
+
+void CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() { return !hasPending_ && !busy_; });
+}
+
+size_t CheckpointWriter::getWrittenCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return written_;
+}
+
+size_t CheckpointWriter::getSkippedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return skipped_;
+}
+
+std::string CheckpointWriter::getLastError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastError_;
+}
+
+void CheckpointWriter::run() {
+    Profiler::setThreadName("checkpoint");
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this]() { return hasPending_ || stopping_; });
+        // A pending checkpoint is still written on shutdown
+        if (!hasPending_) {
+            return;
+        }
+
+        std::swap(pending_, writing_);
+        hasPending_ = false;
+        busy_ = true;
+        lock.unlock();
+
+        std::string error;
+        bool ok;
+        {
+            GRAVITY_PROFILE_SCOPE("writeCheckpoint");
+            Checkpoint::seal(writing_);
+            ok = Checkpoint::write(writing_, path_, error);
+        }
+
+        lock.lock();
+        busy_ = false;
+        if (ok) {
+            ++written_;
+        } else {
+            lastError_ = error;
+        }
+        idle_.notify_all();
+    }
+}
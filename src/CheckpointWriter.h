@@ -0,0 +1,55 @@
+#pragma once
+#include "SolarSystem.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Writes periodic checkpoints on a background thread.
+ *
+ * submit() only copies the state into a reusable image on the caller's
+ * thread; checksumming and file I/O happen on the writer thread, so the step
+ * loop is held up for a memcpy per array. If a checkpoint is still being
+ * written when the next one arrives, the newer one waits in a single slot
+ * and replaces any older one waiting there.
+ */
+class CheckpointWriter {
+public:
+    explicit CheckpointWriter(std::string path);
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // Capture system now and write it out in the background
+    void submit(const SolarSystem& system);
+
+    // Block until every submitted checkpoint has been written
+    void flush();
+
+    const std::string& getPath() const { return path_; }
+    size_t getWrittenCount() const;
+    size_t getSkippedCount() const;
+    // Message from the most recent failed write; empty if none failed
+    std::string getLastError() const;
+
+private:
+    void run();
+
+    std::string path_;
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::vector<uint8_t> pending_;    // Captured, waiting for the writer
+    std::vector<uint8_t> writing_;    // Owned by the writer thread while busy
+    bool hasPending_ = false;
+    bool busy_ = false;
+    bool stopping_ = false;
+    size_t written_ = 0;
+    size_t skipped_ = 0;
+    std::string lastError_;
+};
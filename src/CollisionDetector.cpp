@@ -0,0 +1,100 @@
+#include "CollisionDetector.h"
+#include <algorithm>
+#include <numeric>
+
+template <bool ThreeD>
+void CollisionDetector::sweep(const BodyStore& store, const std::vector<uint8_t>& live, double dt,
+                              std::vector<Contact>& contacts) {
+    const size_t n = store.size();
+
+    // Whether two bodies' swept extents overlap on one axis
+    auto overlaps = [dt](double pa, double va, double ra, double pb, double vb, double rb) {
+        const double aLow = std::min(pa - va * dt, pa) - ra, aHigh = std::max(pa - va * dt, pa) + ra;
+        const double bLow = std::min(pb - vb * dt, pb) - rb, bHigh = std::max(pb - vb * dt, pb) + rb;
+        return aLow <= bHigh && bLow <= aHigh;
+    };
+
+    for (size_t k = 0; k < n; ++k) {
+        const uint32_t a = order_[k];
+        if (!live[a]) {
+            continue;
+        }
+        for (size_t m = k + 1; m < n && low_[order_[m]] <= high_[a]; ++m) {
+            const uint32_t b = order_[m];
+            const double reach = store.radius[a] + store.radius[b];
+            if (!live[b] || reach <= 0.0) {
+                continue;
+            }
+            if (!overlaps(store.y[a], store.vy[a], store.radius[a], store.y[b], store.vy[b], store.radius[b]) ||
+                (ThreeD &&
+                 !overlaps(store.z[a], store.vz[a], store.radius[a], store.z[b], store.vz[b], store.radius[b]))) {
+                continue;
+            }
+            ++candidates_;
+
+            // Separation d(t) = d0 + w t over the step, with d0 the separation at its start
+            const double wx = store.vx[a] - store.vx[b];
+            const double wy = store.vy[a] - store.vy[b];
+            const double wz = ThreeD ? store.vz[a] - store.vz[b] : 0.0;
+            const double dx = store.x[a] - store.x[b] - wx * dt;
+            const double dy = store.y[a] - store.y[b] - wy * dt;
+            const double dz = ThreeD ? store.z[a] - store.z[b] - wz * dt : 0.0;
+            const double ww = wx * wx + wy * wy + wz * wz;
+            const double t = ww > 0.0 ? std::min(dt, std::max(0.0, -(dx * wx + dy * wy + dz * wz) / ww)) : 0.0;
+            const double cx = dx + wx * t, cy = dy + wy * t, cz = dz + wz * t;
+            if (cx * cx + cy * cy + cz * cz <= reach * reach) {
+                contacts.push_back({a, b});
+            }
+        }
+    }
+}
+
+void CollisionDetector::detect(const BodyStore& store, const std::vector<uint8_t>& live, bool threeD, double dt,
+                               std::vector<Contact>& contacts) {
+    contacts.clear();
+    candidates_ = 0;
+    const size_t n = store.size();
+
+    low_.resize(n);
+    high_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const double start = store.x[i] - store.vx[i] * dt;
+        low_[i] = std::min(start, store.x[i]) - store.radius[i];
+        high_[i] = std::max(start, store.x[i]) + store.radius[i];
+    }
+    sortByLow();
+
+    if (threeD) {
+        sweep<true>(store, live, dt, contacts);
+    } else {
+        sweep<false>(store, live, dt, contacts);
+    }
+}
+
+void CollisionDetector::sortByLow() {
+    const size_t n = low_.size();
+    if (order_.size() != n) {
+        order_.resize(n);
+        std::iota(order_.begin(), order_.end(), 0u);
+        std::sort(order_.begin(), order_.end(), [this](uint32_t a, uint32_t b) { return low_[a] < low_[b]; });
+        return;
+    }
+
+    // Last step's order is nearly right; give up on it if bodies moved past too many others
+    const size_t budget = MAX_SORT_MOVES_PER_BODY * n;
+    size_t moves = 0;
+    for (size_t k = 1; k < n && moves <= budget; ++k) {
+        const uint32_t body = order_[k];
+        const double key = low_[body];
+        size_t m = k;
+        while (m > 0 && low_[order_[m - 1]] > key) {
+            order_[m] = order_[m - 1];
+            --m;
+            ++moves;
+        }
+        order_[m] = body;
+    }
+    if (moves > budget) {
+        std::sort(order_.begin(), order_.end(), [this](uint32_t a, uint32_t b) { return low_[a] < low_[b]; });
+    }
+}
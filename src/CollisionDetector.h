@@ -0,0 +1,47 @@
+#pragma once
+#include "BodyStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Finds pairs of bodies whose spheres touched during the step that just ended.
+ *
+ * Each body is taken to have moved in a straight line from x - v dt to x over
+ * the step. The broad phase is sweep and prune on x: bodies are kept sorted by
+ * the low end of their swept x extent, and since that order barely changes
+ * between steps it is repaired by insertion sort rather than sorted afresh;
+ * only pairs whose extents overlap on every axis reach the narrow phase, which
+ * finds the closest approach of the two straight paths. Bodies of zero
+ * radius are points: they can hit a body with a radius but not each other.
+ */
+class CollisionDetector {
+public:
+    struct Contact {
+        uint32_t a, b;
+    };
+
+    /**
+     * Replace contacts with the pairs that touched
+     * @param live Bodies with live[i] == 0 are ignored
+     * @param dt Length of the step in simulated seconds
+     */
+    void detect(const BodyStore& store, const std::vector<uint8_t>& live, bool threeD, double dt,
+                std::vector<Contact>& contacts);
+
+    // Pairs that passed the broad phase in the last detect()
+    size_t getCandidateCount() const { return candidates_; }
+
+    // Above this many element moves per body, the insertion sort gives way to a full sort
+    static constexpr size_t MAX_SORT_MOVES_PER_BODY = 8;
+
+private:
+    void sortByLow();
+    // Test the pairs of sorted bodies whose x extents overlap
+    template <bool ThreeD>
+    void sweep(const BodyStore& store, const std::vector<uint8_t>& live, double dt, std::vector<Contact>& contacts);
+
+    std::vector<uint32_t> order_;     // Bodies by increasing low_, carried over between steps
+    std::vector<double> low_, high_;  // Swept x extent of each body, radius included
+    size_t candidates_ = 0;
+};
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * RGBA colour of a body, kept free of SFML graphics so the simulation core
+ * builds without a windowing stack; the renderer converts it to sf::Color.
+ */
+struct Color {
+    uint8_t r, g, b, a;
+
+    constexpr Color() : r(255), g(255), b(255), a(255) {}
+    constexpr Color(uint8_t r_, uint8_t g_, uint8_t b_, uint8_t a_ = 255) : r(r_), g(g_), b(b_), a(a_) {}
+
+    static const Color White;
+    static const Color Yellow;
+};
+
+inline constexpr Color Color::White(255, 255, 255);
+inline constexpr Color Color::Yellow(255, 255, 0);
@@ -0,0 +1,158 @@
+#include "Communicator.h"
+#include <algorithm>
+
+#ifdef GRAVITY_HAVE_MPI
+#include <mpi.h>
+
+namespace {
+
+// Messages are split so no count overflows MPI's int
+constexpr size_t MAX_MESSAGE = size_t(1) << 27;
+
+} // namespace
+
+struct Communicator::Requests {
+    std::vector<MPI_Request> pending;
+};
+
+Communicator::Communicator(int& argc, char**& argv) : requests_(std::make_unique<Requests>()) {
+    // Only this thread talks to MPI; the force workers stay out of it
+    int provided = 0;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+    MPI_Comm_size(MPI_COMM_WORLD, &size_);
+}
+
+Communicator::~Communicator() {
+    MPI_Finalize();
+}
+
+bool Communicator::hasMpi() {
+    return true;
+}
+
+Communicator::Request Communicator::startAllGather(float* data, const std::vector<int>& counts,
+                                                   const std::vector<int>& offsets) {
+    std::vector<MPI_Request>& pending = requests_->pending;
+    // Every earlier request has been waited for, so the slots can be reused
+    if (std::all_of(pending.begin(), pending.end(), [](MPI_Request r) { return r == MPI_REQUEST_NULL; })) {
+        pending.clear();
+    }
+    pending.push_back(MPI_REQUEST_NULL);
+    MPI_Iallgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, data, counts.data(), offsets.data(), MPI_FLOAT,
+                    MPI_COMM_WORLD, &pending.back());
+    return pending.size() - 1;
+}
+
+void Communicator::wait(Request request) {
+    MPI_Wait(&requests_->pending[request], MPI_STATUS_IGNORE);
+}
+
+void Communicator::allGather(double value, std::vector<double>& values) {
+    values.resize(size_);
+    MPI_Allgather(&value, 1, MPI_DOUBLE, values.data(), 1, MPI_DOUBLE, MPI_COMM_WORLD);
+}
+
+bool Communicator::all(bool value) {
+    int local = value ? 1 : 0, result = 0;
+    MPI_Allreduce(&local, &result, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    return result != 0;
+}
+
+bool Communicator::agree(uint64_t value) {
+    uint64_t low = 0, high = 0;
+    MPI_Allreduce(&value, &low, 1, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
+    MPI_Allreduce(&value, &high, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+    return low == high;
+}
+
+void Communicator::broadcast(float* data, size_t count) {
+    for (size_t done = 0; done < count; done += MAX_MESSAGE) {
+        const int part = static_cast<int>(std::min(MAX_MESSAGE, count - done));
+        MPI_Bcast(data + done, part, MPI_FLOAT, 0, MPI_COMM_WORLD);
+    }
+}
+
+void Communicator::allToAll(const std::vector<double>& send, const std::vector<int>& sendCounts,
+                            std::vector<double>& received) {
+    receiveCounts_.resize(size_);
+    MPI_Alltoall(sendCounts.data(), 1, MPI_INT, receiveCounts_.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+    sendOffsets_.resize(size_);
+    receiveOffsets_.resize(size_);
+    int sendTotal = 0, receiveTotal = 0;
+    for (int r = 0; r < size_; ++r) {
+        sendOffsets_[r] = sendTotal;
+        receiveOffsets_[r] = receiveTotal;
+        sendTotal += sendCounts[r];
+        receiveTotal += receiveCounts_[r];
+    }
+    received.resize(static_cast<size_t>(receiveTotal));
+    MPI_Alltoallv(send.data(), sendCounts.data(), sendOffsets_.data(), MPI_DOUBLE,
+                  received.data(), receiveCounts_.data(), receiveOffsets_.data(), MPI_DOUBLE, MPI_COMM_WORLD);
+}
+
+void Communicator::send(const std::vector<double>& data, int destination) {
+    uint64_t count = data.size();
+    MPI_Send(&count, 1, MPI_UINT64_T, destination, 0, MPI_COMM_WORLD);
+    for (size_t done = 0; done < data.size(); done += MAX_MESSAGE) {
+        const int part = static_cast<int>(std::min(MAX_MESSAGE, data.size() - done));
+        MPI_Send(data.data() + done, part, MPI_DOUBLE, destination, 0, MPI_COMM_WORLD);
+    }
+}
+
+void Communicator::receive(std::vector<double>& data, int source) {
+    uint64_t count = 0;
+    MPI_Recv(&count, 1, MPI_UINT64_T, source, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    data.resize(count);
+    for (size_t done = 0; done < data.size(); done += MAX_MESSAGE) {
+        const int part = static_cast<int>(std::min(MAX_MESSAGE, data.size() - done));
+        MPI_Recv(data.data() + done, part, MPI_DOUBLE, source, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    }
+}
+
+#else
+
+// A job of one process: the only block is already in place and nothing is ever received
+
+struct Communicator::Requests {};
+
+Communicator::Communicator(int&, char**&) {}
+
+Communicator::~Communicator() = default;
+
+bool Communicator::hasMpi() {
+    return false;
+}
+
+Communicator::Request Communicator::startAllGather(float*, const std::vector<int>&, const std::vector<int>&) {
+    return 0;
+}
+
+void Communicator::wait(Request) {}
+
+void Communicator::allGather(double value, std::vector<double>& values) {
+    values.assign(1, value);
+}
+
+bool Communicator::all(bool value) {
+    return value;
+}
+
+bool Communicator::agree(uint64_t) {
+    return true;
+}
+
+void Communicator::broadcast(float*, size_t) {}
+
+void Communicator::allToAll(const std::vector<double>& send, const std::vector<int>&, std::vector<double>& received) {
+    received = send;
+}
+
+void Communicator::send(const std::vector<double>&, int) {}
+
+void Communicator::receive(std::vector<double>& data, int) {
+    data.clear();
+}
+
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * The processes of a distributed GravityBatch job, and the few collectives it
+ * needs over plain buffers, so nothing else includes mpi.h.
+ *
+ * MPI is set up by the constructor and finalised by the destructor. Only the
+ * thread that made the communicator may call it; force workers never do. In a
+ * build without MPI (or a plain launch) this is a job of one process and every
+ * collective is a copy or a no-op, so callers need no special case.
+ */
+class Communicator {
+public:
+    // Handle of a started non-blocking operation, passed to wait() exactly once
+    using Request = size_t;
+
+    // MPI may take its own arguments out of argc/argv
+    Communicator(int& argc, char**& argv);
+    ~Communicator();
+
+    Communicator(const Communicator&) = delete;
+    Communicator& operator=(const Communicator&) = delete;
+
+    int getRank() const { return rank_; }
+    int getSize() const { return size_; }
+    bool isRoot() const { return rank_ == 0; }
+
+    // Whether GravityBatch was built with MPI
+    static bool hasMpi();
+
+    /**
+     * Start an in-place all-gather: each process has filled its own block of data,
+     * counts[rank] floats at offsets[rank], and gets every other block. The buffer
+     * and both vectors must stay untouched until wait().
+     */
+    Request startAllGather(float* data, const std::vector<int>& counts, const std::vector<int>& offsets);
+    void wait(Request request);
+
+    // Everyone's value, indexed by rank
+    void allGather(double value, std::vector<double>& values);
+
+    // True on every process if value was true on every process
+    bool all(bool value);
+    // True if every process passed the same value
+    bool agree(uint64_t value);
+
+    // The root's data on every process
+    void broadcast(float* data, size_t count);
+
+    /**
+     * Personalised exchange: send holds sendCounts[k] values for rank k, one block
+     * after another, and received gets what every rank sent here, in rank order.
+     */
+    void allToAll(const std::vector<double>& send, const std::vector<int>& sendCounts, std::vector<double>& received);
+
+    // Point-to-point, for streaming to the root; receive() resizes data to what was sent
+    void send(const std::vector<double>& data, int destination);
+    void receive(std::vector<double>& data, int source);
+
+private:
+    struct Requests;
+
+    int rank_ = 0;
+    int size_ = 1;
+    std::unique_ptr<Requests> requests_;
+    std::vector<int> receiveCounts_, sendOffsets_, receiveOffsets_;
+};
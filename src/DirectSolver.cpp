@@ -0,0 +1,77 @@
+#include "DirectSolver.h"
+#include "GravityKernel.h"
+#include <algorithm>
+
+void DirectSolver::computeAccelerations(BodyStore& store, ThreadPool& pool,
+                                        float softening2, bool threeD) {
+    const size_t n = store.size();
+    const size_t workers = pool.size();
+
+    const GravityKernel::Sources sources = {
+        store.px.data(), store.py.data(), store.pz.data(), store.gm.data(), n
+    };
+
+    const bool withPotential = !store.potential.empty();
+    if (workers == 1 || n < PARALLEL_THRESHOLD) {
+        GravityKernel::accumulatePairs(sources, 0, n, softening2,
+                                       store.ax.data(), store.ay.data(), store.az.data(), threeD,
+                                       withPotential ? store.potential.data() : nullptr);
+        return;
+    }
+
+    // Row i of the triangular pair loop has n - 1 - i pairs, so split the rows
+    // where the running pair count crosses each worker's equal share
+    const double totalPairs = 0.5 * static_cast<double>(n) * static_cast<double>(n - 1);
+    rowBounds_.assign(workers + 1, n);
+    rowBounds_[0] = 0;
+    double pairs = 0.0;
+    size_t worker = 1;
+    for (size_t i = 0; i < n && worker < workers; ++i) {
+        while (worker < workers && pairs >= totalPairs * static_cast<double>(worker) / workers) {
+            rowBounds_[worker++] = i;
+        }
+        pairs += static_cast<double>(n - 1 - i);
+    }
+
+    // Each worker owns a private accumulator block, so the j-side reaction
+    // terms of Newton's third law never race; a fourth array holds the potential when asked for
+    const size_t arrays = withPotential ? 4 : 3;
+    workerForces_.resize(workers * arrays * n);
+    pool.run([&](size_t w) {
+        const size_t begin = rowBounds_[w];
+        const size_t end = rowBounds_[w + 1];
+        float* ax = workerForces_.data() + w * arrays * n;
+        float* ay = ax + n;
+        float* az = ay + n;
+        float* potential = withPotential ? az + n : nullptr;
+
+        // Rows [begin, end) only ever touch bodies at or after begin
+        std::fill(ax + begin, ax + n, 0.0f);
+        std::fill(ay + begin, ay + n, 0.0f);
+        std::fill(az + begin, az + n, 0.0f);
+        if (potential) {
+            std::fill(potential + begin, potential + n, 0.0f);
+        }
+        GravityKernel::accumulatePairs(sources, begin, end, softening2, ax, ay, az, threeD, potential);
+    });
+
+    // Reduce the per-worker blocks into the store
+    pool.parallelFor(n, [&](size_t begin, size_t end) {
+        for (size_t w = 0; w < workers; ++w) {
+            const float* ax = workerForces_.data() + w * arrays * n;
+            const float* ay = ax + n;
+            const float* az = ay + n;
+            for (size_t k = std::max(begin, rowBounds_[w]); k < end; ++k) {
+                store.ax[k] += ax[k];
+                store.ay[k] += ay[k];
+                store.az[k] += az[k];
+            }
+            if (withPotential) {
+                const float* potential = az + n;
+                for (size_t k = std::max(begin, rowBounds_[w]); k < end; ++k) {
+                    store.potential[k] += potential[k];
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "ForceSolver.h"
+#include <vector>
+
+/**
+ * Exact O(N^2) pairwise summation through GravityKernel. Kept as the reference
+ * for validating the approximate solvers.
+ */
+class DirectSolver : public ForceSolver {
+public:
+    const char* getName() const override { return "Direct"; }
+
+    void computeAccelerations(BodyStore& store, ThreadPool& pool,
+                              float softening2, bool threeD) override;
+
+private:
+    std::vector<float> workerForces_;  // Per-worker ax/ay/az (and potential) blocks, N floats each
+    std::vector<size_t> rowBounds_;    // Pair-balanced row partition, one range per worker
+
+    // Below this many bodies the pool's wake-up cost outweighs the work
+    static constexpr size_t PARALLEL_THRESHOLD = 256;
+};
@@ -0,0 +1,203 @@
+#include "DistributedSolver.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+} // namespace
+
+DistributedSolver::DistributedSolver(Communicator& communicator, std::unique_ptr<ForceSolver> local)
+    : communicator_(communicator), local_(std::move(local)) {
+}
+
+double DistributedSolver::takeSeconds() {
+    const double seconds = seconds_;
+    seconds_ = 0.0;
+    return seconds;
+}
+
+void DistributedSolver::computeAccelerations(BodyStore& store, ThreadPool& pool,
+                                             float softening2, bool threeD) {
+    const Clock::time_point start = Clock::now();
+    if (communicator_.getSize() == 1 || !local_->canShare() || !store.potential.empty()) {
+        // The others would compute the same numbers, so they only wait for the root's
+        if (communicator_.isRoot()) {
+            local_->computeAccelerations(store, pool, softening2, threeD);
+        }
+        replicateFromRoot(store, threeD);
+    } else {
+        if (order_.size() != store.size() || sinceBalance_ >= REBALANCE_EVALUATIONS) {
+            decompose(store, threeD);
+        }
+        layout(cuts_);
+        evaluateShared(store, pool, order_, softening2, threeD, true);
+        ++sinceBalance_;
+    }
+    seconds_ += secondsSince(start);
+}
+
+void DistributedSolver::computeAccelerationsFor(BodyStore& store, ThreadPool& pool,
+                                                const std::vector<uint32_t>& targets,
+                                                float softening2, bool threeD) {
+    const Clock::time_point start = Clock::now();
+    const size_t size = static_cast<size_t>(communicator_.getSize());
+    if (size == 1) {
+        local_->computeAccelerationsFor(store, pool, targets, softening2, threeD);
+    } else {
+        subsetCuts_.resize(size + 1);
+        for (size_t r = 0; r <= size; ++r) {
+            subsetCuts_[r] = targets.size() * r / size;
+        }
+        layout(subsetCuts_);
+        evaluateShared(store, pool, targets, softening2, threeD, false);
+    }
+    seconds_ += secondsSince(start);
+}
+
+void DistributedSolver::decompose(const BodyStore& store, bool threeD) {
+    GRAVITY_PROFILE_SCOPE("decompose");
+    const size_t size = static_cast<size_t>(communicator_.getSize());
+    const size_t n = store.size();
+
+    // Same cost for every body at the start, or when collisions changed the bodies
+    rankCost_.assign(size, 1.0);
+    owner_.assign(n, 0);
+    if (order_.size() == n && sinceBalance_ > 0) {
+        communicator_.allGather(shareSeconds_, rankSeconds_);
+        double seconds = 0.0;
+        size_t bodies = 0;
+        for (size_t r = 0; r < size; ++r) {
+            seconds += rankSeconds_[r];
+            bodies += cuts_[r + 1] - cuts_[r];
+        }
+        const double mean = bodies > 0 && seconds > 0.0 ? seconds / bodies : 1.0;
+        for (size_t r = 0; r < size; ++r) {
+            const size_t count = cuts_[r + 1] - cuts_[r];
+            rankCost_[r] = count > 0 && rankSeconds_[r] > 0.0 ? rankSeconds_[r] / count : mean;
+            for (size_t k = cuts_[r]; k < cuts_[r + 1]; ++k) {
+                owner_[order_[k]] = static_cast<uint32_t>(r);
+            }
+        }
+    }
+
+    order_ = curve_.sort(store.px.data(), store.py.data(), store.pz.data(), n, threeD);
+
+    double total = 0.0;
+    for (uint32_t i : order_) {
+        total += rankCost_[owner_[i]];
+    }
+    cuts_.assign(size + 1, n);
+    cuts_[0] = 0;
+    size_t r = 1;
+    double running = 0.0;
+    for (size_t k = 0; k < n && r < size; ++k) {
+        while (r < size && running >= total * r / size) {
+            cuts_[r++] = k;
+        }
+        running += rankCost_[owner_[order_[k]]];
+    }
+
+    shareSeconds_ = 0.0;
+    sinceBalance_ = 0;
+}
+
+void DistributedSolver::layout(const std::vector<size_t>& cuts) {
+    const size_t size = static_cast<size_t>(communicator_.getSize());
+    split_.resize(2 * size + 1);
+    for (size_t r = 0; r < size; ++r) {
+        split_[2 * r] = cuts[r];
+        split_[2 * r + 1] = cuts[r] + (cuts[r + 1] - cuts[r]) / 2;
+    }
+    split_[2 * size] = cuts[size];
+
+    for (size_t h = 0; h < 2; ++h) {
+        counts_[h].resize(size);
+        offsets_[h].resize(size);
+        int offset = 0;
+        for (size_t r = 0; r < size; ++r) {
+            counts_[h][r] = static_cast<int>(3 * (split_[2 * r + h + 1] - split_[2 * r + h]));
+            offsets_[h][r] = offset;
+            offset += counts_[h][r];
+        }
+        exchange_[h].resize(static_cast<size_t>(offset));
+    }
+}
+
+void DistributedSolver::evaluateShared(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& list,
+                                       float softening2, bool threeD, bool full) {
+    const size_t size = static_cast<size_t>(communicator_.getSize());
+    const size_t rank = static_cast<size_t>(communicator_.getRank());
+
+    Communicator::Request requests[2];
+    for (size_t h = 0; h < 2; ++h) {
+        std::vector<uint32_t>& share = share_[h];
+        share.assign(list.begin() + split_[2 * rank + h], list.begin() + split_[2 * rank + h + 1]);
+
+        const Clock::time_point start = Clock::now();
+        {
+            GRAVITY_PROFILE_SCOPE("shareForces");
+            if (full) {
+                // The second half's tree is the first half's: nothing moved in between
+                local_->computeShare(store, pool, share, softening2, threeD, h == 1);
+            } else {
+                local_->computeAccelerationsFor(store, pool, share, softening2, threeD);
+            }
+        }
+        shareSeconds_ += secondsSince(start);
+
+        float* block = exchange_[h].data() + offsets_[h][rank];
+        for (size_t k = 0; k < share.size(); ++k) {
+            const uint32_t i = share[k];
+            block[3 * k] = store.ax[i];
+            block[3 * k + 1] = store.ay[i];
+            block[3 * k + 2] = threeD ? store.az[i] : 0.0f;
+        }
+        requests[h] = communicator_.startAllGather(exchange_[h].data(), counts_[h], offsets_[h]);
+    }
+
+    // The first exchange went on behind the second half's forces; the second is
+    // still in flight while the first is unpacked
+    GRAVITY_PROFILE_SCOPE("shareExchange");
+    for (size_t h = 0; h < 2; ++h) {
+        communicator_.wait(requests[h]);
+        const float* values = exchange_[h].data();
+        for (size_t r = 0; r < size; ++r) {
+            if (r == rank) {
+                continue;
+            }
+            const size_t begin = split_[2 * r + h];
+            const size_t count = split_[2 * r + h + 1] - begin;
+            const float* block = values + offsets_[h][r];
+            for (size_t k = 0; k < count; ++k) {
+                const uint32_t i = list[begin + k];
+                store.ax[i] += block[3 * k];
+                store.ay[i] += block[3 * k + 1];
+                if (threeD) {
+                    store.az[i] += block[3 * k + 2];
+                }
+            }
+        }
+    }
+}
+
+void DistributedSolver::replicateFromRoot(BodyStore& store, bool threeD) {
+    if (communicator_.getSize() == 1) {
+        return;
+    }
+    const size_t n = store.size();
+    communicator_.broadcast(store.ax.data(), n);
+    communicator_.broadcast(store.ay.data(), n);
+    if (threeD) {
+        communicator_.broadcast(store.az.data(), n);
+    }
+    if (!store.potential.empty()) {
+        communicator_.broadcast(store.potential.data(), n);
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "Communicator.h"
+#include "ForceSolver.h"
+#include "MortonOrder.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Splits the force evaluations of another solver between the processes of a
+ * distributed job.
+ *
+ * Every process holds all the bodies and integrates them identically, so no
+ * tree essentials or ghost bodies need to be sent: each one already has every
+ * source. The work is what gets divided. Bodies are ordered along a Morton curve
+ * and cut into one contiguous run per process, and each process evaluates its
+ * run with ForceSolver::computeShare() and all-gathers the accelerations. The
+ * run is done in two halves, so the first half's exchange overlaps the second
+ * half's forces. Every REBALANCE_EVALUATIONS evaluations the cuts move: each
+ * process's per-body time over the interval gives its bodies a cost, and the
+ * re-sorted curve is cut at equal total cost.
+ *
+ * Evaluations that also sum the potential (diagnostics steps), and solvers that
+ * cannot split their work, run on the root alone and are broadcast. Subset
+ * evaluations split the target list evenly. Either way every process ends up
+ * with the same accelerations bit for bit, so the replicas never drift apart.
+ */
+class DistributedSolver : public ForceSolver {
+public:
+    static constexpr size_t REBALANCE_EVALUATIONS = 32;
+
+    DistributedSolver(Communicator& communicator, std::unique_ptr<ForceSolver> local);
+
+    const char* getName() const override { return local_->getName(); }
+
+    void computeAccelerations(BodyStore& store, ThreadPool& pool,
+                              float softening2, bool threeD) override;
+
+    void computeAccelerationsFor(BodyStore& store, ThreadPool& pool,
+                                 const std::vector<uint32_t>& targets,
+                                 float softening2, bool threeD) override;
+
+    // Already split between processes; nesting would only add exchanges
+    bool canShare() const override { return false; }
+
+    ForceSolver& getLocalSolver() { return *local_; }
+
+    // Seconds spent in evaluations, waiting for the other processes included, since the last call
+    double takeSeconds();
+
+private:
+    // Re-sort the bodies along the curve and cut it by the measured cost per process
+    void decompose(const BodyStore& store, bool threeD);
+
+    // Halve each process's run of bodies [cuts[r], cuts[r + 1]) of a list and size the exchange
+    void layout(const std::vector<size_t>& cuts);
+
+    // Evaluate this process's runs of list and gather everyone's; full selects computeShare()
+    void evaluateShared(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& list,
+                        float softening2, bool threeD, bool full);
+
+    // Take the root's accelerations (and potential, if summed) of every body
+    void replicateFromRoot(BodyStore& store, bool threeD);
+
+    Communicator& communicator_;
+    std::unique_ptr<ForceSolver> local_;
+
+    MortonOrder curve_;
+    std::vector<uint32_t> order_;      // Bodies along the curve at the last decomposition
+    std::vector<size_t> cuts_;         // Process r evaluates order_[cuts_[r], cuts_[r + 1])
+    std::vector<uint32_t> owner_;      // Process each body was assigned to, for its cost
+    std::vector<double> rankCost_;     // Seconds per body of each process's run
+    std::vector<double> rankSeconds_;
+    double shareSeconds_ = 0.0;        // This process's compute time since the last decomposition
+    size_t sinceBalance_ = 0;          // Split full evaluations since then
+    double seconds_ = 0.0;
+
+    // Half h of process r's run is split_[2r + h] to split_[2r + h + 1] in the list
+    std::vector<size_t> split_;
+    std::vector<size_t> subsetCuts_;
+    std::vector<uint32_t> share_[2];
+    std::vector<float> exchange_[2];   // ax, ay, az per body, in list order
+    std::vector<int> counts_[2], offsets_[2];
+};
@@ -0,0 +1,211 @@
+#include "DormandPrinceIntegrator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Dormand-Prince 5(4) tableau; row 6 holds the 5th order weights, so the last
+// stage is evaluated at the new state and its accelerations carry over
+constexpr double A[7][6] = {
+    {0.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+    {1.0 / 5.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+    {3.0 / 40.0, 9.0 / 40.0, 0.0, 0.0, 0.0, 0.0},
+    {44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0, 0.0, 0.0, 0.0},
+    {19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0, 0.0, 0.0},
+    {9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0, 0.0},
+    {35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0},
+};
+
+// 5th minus 4th order weights
+constexpr double E[7] = {
+    71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0, -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0
+};
+
+// Step size controller limits
+constexpr double SAFETY = 0.9;
+constexpr double MIN_FACTOR = 0.2;
+constexpr double MAX_FACTOR = 5.0;
+
+} // namespace
+
+DormandPrinceIntegrator::DormandPrinceIntegrator(double tolerance) : tolerance_(tolerance) {
+}
+
+double DormandPrinceIntegrator::step(Context& context, double dt) {
+    accepted_ = 0;
+    rejected_ = 0;
+    if (dt <= 0.0 || context.store.empty()) {
+        return dt;
+    }
+
+    ensureAccelerations(context);
+    if (substep_ <= 0.0) {
+        substep_ = dt;
+    }
+
+    double remaining = dt;
+    while (remaining > 0.0 && accepted_ + rejected_ < MAX_SUBSTEPS) {
+        const bool last = substep_ >= remaining;
+        const double h = last ? remaining : substep_;
+
+        saveStart(context);
+        const double error = attempt(context, h);
+        const double factor = error > 0.0
+            ? std::min(MAX_FACTOR, std::max(MIN_FACTOR, SAFETY * std::pow(error, -0.2)))
+            : MAX_FACTOR;
+
+        if (error <= 1.0) {
+            // The last stage was evaluated at the accepted state
+            markAccelerationsValid(context);
+            ++accepted_;
+            remaining = last ? 0.0 : remaining - h;
+            // A final substep clipped to the frame end says little about the right size
+            if (!last || h * factor < substep_) {
+                substep_ = h * factor;
+            }
+        } else {
+            restoreStart(context);
+            ++rejected_;
+            substep_ = h * factor;
+        }
+    }
+    return dt - remaining;
+}
+
+void DormandPrinceIntegrator::saveState(std::vector<uint8_t>& out) const {
+    out.resize(sizeof(substep_));
+    std::memcpy(out.data(), &substep_, sizeof(substep_));
+}
+
+bool DormandPrinceIntegrator::loadState(const uint8_t* data, size_t size, size_t bodyCount) {
+    (void)bodyCount;
+    double substep = 0.0;
+    if (size != sizeof(substep)) {
+        return false;
+    }
+    std::memcpy(&substep, data, sizeof(substep));
+    if (!std::isfinite(substep) || substep < 0.0) {
+        return false;
+    }
+    substep_ = substep;
+    return true;
+}
+
+void DormandPrinceIntegrator::saveStart(const Context& context) {
+    const BodyStore& s = context.store;
+    const size_t n = s.size();
+    startX_.resize(3 * n);
+    startV_.resize(3 * n);
+    for (int k = 0; k < STAGES; ++k) {
+        stageX_[k].resize(3 * n);
+        stageV_[k].resize(3 * n);
+    }
+
+    std::copy(s.x.begin(), s.x.end(), startX_.begin());
+    std::copy(s.y.begin(), s.y.end(), startX_.begin() + n);
+    std::copy(s.z.begin(), s.z.end(), startX_.begin() + 2 * n);
+    std::copy(s.vx.begin(), s.vx.end(), startV_.begin());
+    std::copy(s.vy.begin(), s.vy.end(), startV_.begin() + n);
+    std::copy(s.vz.begin(), s.vz.end(), startV_.begin() + 2 * n);
+    std::copy(s.ax.begin(), s.ax.end(), stageV_[0].begin());
+    std::copy(s.ay.begin(), s.ay.end(), stageV_[0].begin() + n);
+    std::copy(s.az.begin(), s.az.end(), stageV_[0].begin() + 2 * n);
+    stageX_[0] = startV_;
+}
+
+void DormandPrinceIntegrator::restoreStart(Context& context) {
+    BodyStore& s = context.store;
+    const size_t n = s.size();
+    std::copy(startX_.begin(), startX_.begin() + n, s.x.begin());
+    std::copy(startX_.begin() + n, startX_.begin() + 2 * n, s.y.begin());
+    std::copy(startX_.begin() + 2 * n, startX_.end(), s.z.begin());
+    std::copy(startV_.begin(), startV_.begin() + n, s.vx.begin());
+    std::copy(startV_.begin() + n, startV_.begin() + 2 * n, s.vy.begin());
+    std::copy(startV_.begin() + 2 * n, startV_.end(), s.vz.begin());
+    for (size_t i = 0; i < n; ++i) {
+        s.ax[i] = static_cast<float>(stageV_[0][i]);
+        s.ay[i] = static_cast<float>(stageV_[0][n + i]);
+        s.az[i] = static_cast<float>(stageV_[0][2 * n + i]);
+    }
+}
+
+double DormandPrinceIntegrator::attempt(Context& context, double h) {
+    BodyStore& s = context.store;
+    const size_t n = s.size();
+    const int dims = context.threeD ? 3 : 2;
+    double* position[3] = {s.x.data(), s.y.data(), s.z.data()};
+    double* velocity[3] = {s.vx.data(), s.vy.data(), s.vz.data()};
+    const float* acceleration[3] = {s.ax.data(), s.ay.data(), s.az.data()};
+
+    for (int stage = 1; stage < STAGES; ++stage) {
+        context.forEachBody([&](size_t begin, size_t end) {
+            for (int c = 0; c < dims; ++c) {
+                const size_t offset = c * n;
+                for (size_t i = begin; i < end; ++i) {
+                    double dx = 0.0;
+                    double dv = 0.0;
+                    for (int j = 0; j < stage; ++j) {
+                        dx += A[stage][j] * stageX_[j][offset + i];
+                        dv += A[stage][j] * stageV_[j][offset + i];
+                    }
+                    position[c][i] = startX_[offset + i] + h * dx;
+                    stageX_[stage][offset + i] = startV_[offset + i] + h * dv;
+                }
+            }
+        });
+
+        context.evaluate();
+        for (int c = 0; c < dims; ++c) {
+            std::copy(acceleration[c], acceleration[c] + n, stageV_[stage].begin() + c * n);
+        }
+    }
+
+    // The store now holds the 5th order positions; velocities are the last stage's
+    bodyError_.resize(n);
+    context.forEachBody([&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const uint32_t p = s.parent[i];
+            const bool hasParent = p != BodyStore::NO_PARENT && p < n;
+            const double origin[3] = {s.originX, s.originY, s.originZ};
+
+            double positionError2 = 0.0, velocityError2 = 0.0;
+            double distance2 = 0.0, speed2 = 0.0;
+            for (int c = 0; c < dims; ++c) {
+                const size_t offset = c * n;
+                velocity[c][i] = stageX_[STAGES - 1][offset + i];
+
+                double ex = 0.0;
+                double ev = 0.0;
+                for (int j = 0; j < STAGES; ++j) {
+                    ex += E[j] * stageX_[j][offset + i];
+                    ev += E[j] * stageV_[j][offset + i];
+                }
+                positionError2 += h * h * ex * ex;
+                velocityError2 += h * h * ev * ev;
+
+                const double r = startX_[offset + i] - (hasParent ? startX_[offset + p] : origin[c]);
+                const double v = startV_[offset + i] - (hasParent ? startV_[offset + p] : 0.0);
+                distance2 += r * r;
+                speed2 += v * v;
+            }
+
+            // A body exactly at rest or at its reference point has no scale to measure against
+            const double tolerance2 = tolerance_ * tolerance_;
+            double error2 = 0.0;
+            if (distance2 > 0.0) {
+                error2 += positionError2 / (tolerance2 * distance2);
+            }
+            if (speed2 > 0.0) {
+                error2 += velocityError2 / (tolerance2 * speed2);
+            }
+            bodyError_[i] = error2;
+        }
+    });
+
+    double worst = 0.0;
+    for (double error2 : bodyError_) {
+        worst = std::max(worst, error2);
+    }
+    return std::sqrt(worst);
+}
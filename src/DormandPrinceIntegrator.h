@@ -0,0 +1,61 @@
+#pragma once
+#include "Integrator.h"
+#include <vector>
+
+/**
+ * Adaptive embedded Runge-Kutta 5(4) (Dormand-Prince) with step size control.
+ *
+ * Each frame is covered by as many accepted substeps as the tolerance needs;
+ * the substep length carries over between frames. The error of a substep is
+ * the largest over all bodies of the 5th/4th order difference in position and
+ * velocity, relative to the body's distance and speed from its parent (or the
+ * barycentre), so a moon is held to its own orbit rather than the system's.
+ *
+ * Not symplectic: energy drifts slowly, at a rate set by the tolerance.
+ * Six evaluations per accepted substep (the last stage is reused).
+ */
+class DormandPrinceIntegrator : public Integrator {
+public:
+    explicit DormandPrinceIntegrator(double tolerance = 1e-8);
+
+    const char* getName() const override { return "RK45"; }
+
+    double step(Context& context, double dt) override;
+
+    // The substep length the controller settled on
+    void saveState(std::vector<uint8_t>& out) const override;
+    bool loadState(const uint8_t* data, size_t size, size_t bodyCount) override;
+
+    void setTolerance(double tolerance) { tolerance_ = tolerance > 0.0 ? tolerance : tolerance_; }
+    double getTolerance() const { return tolerance_; }
+
+    // Substep length the controller will try next, in simulated seconds
+    double getSubstepSize() const { return substep_; }
+
+    // Statistics from the most recent step()
+    size_t getAcceptedSubsteps() const { return accepted_; }
+    size_t getRejectedSubsteps() const { return rejected_; }
+
+    // Upper bound on substeps per step(); a frame that needs more only partly advances, and
+    // step() returns the part it covered
+    static constexpr size_t MAX_SUBSTEPS = 10000;
+
+private:
+    static constexpr int STAGES = 7;
+
+    // Integrate one substep of length h from the saved start state; returns the error norm
+    double attempt(Context& context, double h);
+    void saveStart(const Context& context);
+    void restoreStart(Context& context);
+
+    double tolerance_;
+    double substep_ = 0.0;      // 0 until the first step picks one
+    size_t accepted_ = 0;
+    size_t rejected_ = 0;
+
+    // Start-of-substep state and per-stage derivatives, 3 * N each as [x | y | z]
+    std::vector<double> startX_, startV_;
+    std::vector<double> stageX_[STAGES];   // dx/dt = v
+    std::vector<double> stageV_[STAGES];   // dv/dt = a
+    std::vector<double> bodyError_;
+};
@@ -0,0 +1,188 @@
+#include "Ephemeris.h"
+#include "Physics.h"
+#include "MappedFile.h"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr double KILOMETRE = 1e3;
+constexpr double SECONDS_PER_DAY = 86400.0;
+
+// Components of a record, filled as they are found
+struct Record {
+    double julianDate = 0.0;
+    double value[6] = {};
+    unsigned found = 0;   // Bit k set once value[k] is known
+
+    bool complete() const { return found == 0x3f; }
+};
+
+std::string lineAt(const char* text, size_t size, size_t& offset) {
+    const char* begin = text + offset;
+    const char* newline = static_cast<const char*>(std::memchr(begin, '\n', size - offset));
+    const size_t length = newline ? static_cast<size_t>(newline - begin) : size - offset;
+    offset += length + (newline ? 1 : 0);
+    std::string line(begin, length);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return line;
+}
+
+// Index of X, Y, Z, VX, VY, VZ; -1 for the other quantities (LT, RG, RR)
+int componentIndex(const std::string& key) {
+    static const char* const names[6] = {"X", "Y", "Z", "VX", "VY", "VZ"};
+    for (int k = 0; k < 6; ++k) {
+        if (key == names[k]) return k;
+    }
+    return -1;
+}
+
+// "X =-1.39E+08 Y = 4.67E+07 Z = 1.02E+04": keys and values, with or without spaces around '='
+void parseKeyValues(const std::string& line, Record& record) {
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && !std::isalpha(static_cast<unsigned char>(line[i]))) ++i;
+        const size_t keyBegin = i;
+        while (i < line.size() && std::isalpha(static_cast<unsigned char>(line[i]))) ++i;
+        const std::string key = line.substr(keyBegin, i - keyBegin);
+        while (i < line.size() && line[i] == ' ') ++i;
+        if (i >= line.size() || line[i] != '=') continue;
+        ++i;
+        char* end = nullptr;
+        const double value = std::strtod(line.c_str() + i, &end);
+        if (end == line.c_str() + i) continue;
+        i = static_cast<size_t>(end - line.c_str());
+        const int k = componentIndex(key);
+        if (k >= 0) {
+            record.value[k] = value;
+            record.found |= 1u << k;
+        }
+    }
+}
+
+// "JD, A.D. 2025-Jan-01 00:00:00.0000, X, Y, Z, VX, VY, VZ[, LT, RG, RR],"
+bool parseCsvRecord(const std::string& line, Record& record) {
+    std::vector<std::string> fields;
+    size_t begin = 0;
+    for (;;) {
+        const size_t comma = line.find(',', begin);
+        fields.push_back(line.substr(begin, comma == std::string::npos ? std::string::npos : comma - begin));
+        if (comma == std::string::npos) break;
+        begin = comma + 1;
+    }
+    if (fields.size() < 8) return false;
+    for (int k = 0; k < 6; ++k) {
+        char* end = nullptr;
+        record.value[k] = std::strtod(fields[2 + k].c_str(), &end);
+        if (end == fields[2 + k].c_str()) return false;
+        record.found |= 1u << k;
+    }
+    return true;
+}
+
+} // namespace
+
+bool Ephemeris::parseHorizons(const char* text, size_t size, std::vector<State>& states, std::string& error) {
+    states.clear();
+    double lengthUnit = KILOMETRE;
+    double timeUnit = 1.0;
+
+    // Header up to $$SOE: only the units matter
+    size_t offset = 0;
+    bool inTable = false;
+    while (offset < size && !inTable) {
+        const std::string line = lineAt(text, size, offset);
+        if (line.compare(0, 5, "$$SOE") == 0) {
+            inTable = true;
+        } else if (line.find("Output units") != std::string::npos) {
+            if (line.find("AU-D") != std::string::npos) {
+                lengthUnit = Physics::AU;
+                timeUnit = SECONDS_PER_DAY;
+            } else if (line.find("KM-D") != std::string::npos) {
+                timeUnit = SECONDS_PER_DAY;
+            }
+        }
+    }
+    if (!inTable) {
+        error = "no $$SOE marker; not a Horizons vector table";
+        return false;
+    }
+
+    auto finish = [&](const Record& record) {
+        if (!record.complete()) {
+            error = "state at JD " + std::to_string(record.julianDate) + " lacks velocities (use VEC_TABLE=2)";
+            return false;
+        }
+        State state;
+        state.julianDate = record.julianDate;
+        state.position = Vector3d(record.value[0], record.value[1], record.value[2]) * lengthUnit;
+        state.velocity = Vector3d(record.value[3], record.value[4], record.value[5]) * (lengthUnit / timeUnit);
+        states.push_back(state);
+        return true;
+    };
+
+    Record record;
+    bool open = false;
+    bool ended = false;
+    while (offset < size) {
+        const std::string line = lineAt(text, size, offset);
+        if (line.compare(0, 5, "$$EOE") == 0) {
+            ended = true;
+            break;
+        }
+
+        // A record starts with its Julian date in the first column
+        char* end = nullptr;
+        const double julianDate = std::strtod(line.c_str(), &end);
+        const bool starts = end != line.c_str() && !line.empty() && line[0] != ' ';
+        if (starts) {
+            if (open && !finish(record)) return false;
+            record = Record();
+            record.julianDate = julianDate;
+            open = true;
+            if (line.find(',') != std::string::npos) {
+                if (!parseCsvRecord(line, record)) {
+                    error = "bad CSV state at JD " + std::to_string(julianDate);
+                    return false;
+                }
+            }
+        } else if (open) {
+            parseKeyValues(line, record);
+        }
+    }
+    if (open && !finish(record)) return false;
+
+    if (!ended) {
+        error = "no $$EOE marker; table is truncated";
+        return false;
+    }
+    if (states.empty()) {
+        error = "table holds no states";
+        return false;
+    }
+    return true;
+}
+
+bool Ephemeris::loadHorizons(const std::string& path, std::vector<State>& states, std::string& error) {
+    MappedFile file;
+    if (!file.open(path, error)) {
+        return false;
+    }
+    if (!parseHorizons(reinterpret_cast<const char*>(file.data()), file.size(), states, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+const Ephemeris::State* Ephemeris::nearest(const std::vector<State>& states, double julianDate, double tolerance) {
+    const State* best = nullptr;
+    for (const State& state : states) {
+        if (!best || std::abs(state.julianDate - julianDate) < std::abs(best->julianDate - julianDate)) {
+            best = &state;
+        }
+    }
+    return best && std::abs(best->julianDate - julianDate) <= tolerance ? best : nullptr;
+}
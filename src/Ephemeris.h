@@ -0,0 +1,34 @@
+#pragma once
+#include "CelestialBody.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Reader for state-vector tables from JPL Horizons (EPHEM_TYPE=VECTORS).
+ *
+ * Both the default layout ("X =... Y =... Z =..." lines under a Julian date)
+ * and CSV_FORMAT=YES are accepted, between the $$SOE and $$EOE markers.
+ * Units come from the "Output units" header line (KM-S, KM-D or AU-D; km/s
+ * when absent) and are converted to metres and m/s. Positions are relative
+ * to whatever centre the table was requested for, usually the solar system
+ * barycentre (@0), so every body of a scenario should share one.
+ */
+class Ephemeris {
+public:
+    struct State {
+        double julianDate = 0.0;     // TDB
+        Vector3d position;           // m
+        Vector3d velocity;           // m/s
+    };
+
+    // Every state in the table, in file order; false with error set if there are none
+    static bool parseHorizons(const char* text, size_t size, std::vector<State>& states, std::string& error);
+    static bool loadHorizons(const std::string& path, std::vector<State>& states, std::string& error);
+
+    // State closest to julianDate, or null if none lies within tolerance days
+    static const State* nearest(const std::vector<State>& states, double julianDate, double tolerance);
+
+    // Dates further apart than this (about 9 s) are different epochs
+    static constexpr double EPOCH_TOLERANCE = 1e-4;
+};
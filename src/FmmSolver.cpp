@@ -0,0 +1,664 @@
+#include "FmmSolver.h"
+#include "GravityKernel.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+constexpr unsigned int MAX_TERMS = (FmmSolver::MAX_ORDER + 1) * (FmmSolver::MAX_ORDER + 2) *
+                                   (FmmSolver::MAX_ORDER + 3) / 6;
+
+using Expansion = std::array<double, MAX_TERMS>;
+
+double binomial(unsigned int n, unsigned int k) {
+    double result = 1.0;
+    for (unsigned int i = 1; i <= k; ++i) {
+        result = result * (n - k + i) / i;
+    }
+    return result;
+}
+
+} // namespace
+
+FmmSolver::FmmSolver(unsigned int order, float theta, size_t leafSize)
+    : order_(0), theta_(theta), leafSize_(leafSize > 0 ? leafSize : 1) {
+    setOrder(order);
+}
+
+void FmmSolver::setOrder(unsigned int order) {
+    order = std::clamp(order, 1u, MAX_ORDER);
+    if (order != order_) {
+        order_ = order;
+        buildTables();
+    }
+}
+
+void FmmSolver::buildTables() {
+    const unsigned int p = order_;
+    const unsigned int side = p + 1;
+
+    // Multi-indices ordered by total degree, with a dense (a, b, c) -> index lookup
+    std::vector<int> lookup(side * side * side, -1);
+    auto indexOf = [&](int a, int b, int c) {
+        if (a < 0 || b < 0 || c < 0 || a + b + c > static_cast<int>(p)) return -1;
+        return lookup[(a * side + b) * side + c];
+    };
+
+    exponents_.clear();
+    degreeBegin_.assign(p + 2, 0);
+    termCount_ = 0;
+    for (unsigned int degree = 0; degree <= p; ++degree) {
+        degreeBegin_[degree] = static_cast<int>(termCount_);
+        for (int a = degree; a >= 0; --a) {
+            for (int b = degree - a; b >= 0; --b) {
+                int c = degree - a - b;
+                lookup[(a * side + b) * side + c] = static_cast<int>(termCount_++);
+                exponents_.push_back(static_cast<uint8_t>(a));
+                exponents_.push_back(static_cast<uint8_t>(b));
+                exponents_.push_back(static_cast<uint8_t>(c));
+            }
+        }
+    }
+    degreeBegin_[p + 1] = static_cast<int>(termCount_);
+
+    lower_.assign(termCount_ * 3, -1);
+    lower2_.assign(termCount_ * 3, -1);
+    for (size_t t = 0; t < termCount_; ++t) {
+        int e[3] = {exponents_[t * 3], exponents_[t * 3 + 1], exponents_[t * 3 + 2]};
+        for (int i = 0; i < 3; ++i) {
+            int d1[3] = {e[0], e[1], e[2]};
+            d1[i] -= 1;
+            lower_[t * 3 + i] = indexOf(d1[0], d1[1], d1[2]);
+            d1[i] -= 1;
+            lower2_[t * 3 + i] = indexOf(d1[0], d1[1], d1[2]);
+        }
+    }
+
+    shiftTerms_.clear();
+    m2lTerms_.clear();
+    for (size_t n = 0; n < termCount_; ++n) {
+        const uint8_t* en = &exponents_[n * 3];
+        for (size_t k = 0; k < termCount_; ++k) {
+            const uint8_t* ek = &exponents_[k * 3];
+
+            if (ek[0] <= en[0] && ek[1] <= en[1] && ek[2] <= en[2]) {
+                Term term;
+                term.out = static_cast<uint16_t>(n);
+                term.in = static_cast<uint16_t>(k);
+                term.power = static_cast<uint16_t>(indexOf(en[0] - ek[0], en[1] - ek[1], en[2] - ek[2]));
+                term.coefficient = binomial(en[0], ek[0]) * binomial(en[1], ek[1]) * binomial(en[2], ek[2]);
+                shiftTerms_.push_back(term);
+            }
+
+            // Here n is the local index and k the multipole index
+            int sum = indexOf(en[0] + ek[0], en[1] + ek[1], en[2] + ek[2]);
+            if (sum >= 0) {
+                Term term;
+                term.out = static_cast<uint16_t>(n);
+                term.in = static_cast<uint16_t>(k);
+                term.power = static_cast<uint16_t>(sum);
+                double sign = ((ek[0] + ek[1] + ek[2]) % 2) ? -1.0 : 1.0;
+                term.coefficient = sign * binomial(en[0] + ek[0], en[0]) *
+                                   binomial(en[1] + ek[1], en[1]) * binomial(en[2] + ek[2], en[2]);
+                m2lTerms_.push_back(term);
+            }
+        }
+    }
+
+    // One M2L costs a few flops per term; a leaf is summed directly against any
+    // cell whose pair count is below that
+    directThreshold_ = m2lTerms_.size() * 4;
+}
+
+void FmmSolver::monomials(double x, double y, double z, double* out) const {
+    const double axis[3] = {x, y, z};
+    out[0] = 1.0;
+    for (size_t t = 1; t < termCount_; ++t) {
+        // Multiply the monomial one degree lower along the first non-zero axis
+        int i = exponents_[t * 3] ? 0 : (exponents_[t * 3 + 1] ? 1 : 2);
+        out[t] = out[lower_[t * 3 + i]] * axis[i];
+    }
+}
+
+void FmmSolver::derivatives(const double* x, const double* y, const double* z, double* out) const {
+    double invR2[M2L_BATCH];
+    for (unsigned int lane = 0; lane < M2L_BATCH; ++lane) {
+        invR2[lane] = 1.0 / (x[lane] * x[lane] + y[lane] * y[lane] + z[lane] * z[lane]);
+        out[lane] = std::sqrt(invR2[lane]);
+    }
+
+    // r^2 T_n = -(2k - 1) / k * sum_i x_i T_{n - e_i} - (k - 1) / k * sum_i T_{n - 2 e_i}, k = |n|
+    const double* axis[3] = {x, y, z};
+    for (unsigned int degree = 1; degree <= order_; ++degree) {
+        const double a = (2.0 * degree - 1.0) / degree;
+        const double b = (degree - 1.0) / degree;
+        for (int t = degreeBegin_[degree]; t < degreeBegin_[degree + 1]; ++t) {
+            double value[M2L_BATCH] = {};
+            for (int i = 0; i < 3; ++i) {
+                const int l1 = lower_[t * 3 + i];
+                if (l1 >= 0) {
+                    for (unsigned int lane = 0; lane < M2L_BATCH; ++lane) {
+                        value[lane] -= a * axis[i][lane] * out[l1 * M2L_BATCH + lane];
+                    }
+                }
+                const int l2 = lower2_[t * 3 + i];
+                if (l2 >= 0) {
+                    for (unsigned int lane = 0; lane < M2L_BATCH; ++lane) {
+                        value[lane] -= b * out[l2 * M2L_BATCH + lane];
+                    }
+                }
+            }
+            for (unsigned int lane = 0; lane < M2L_BATCH; ++lane) {
+                out[t * M2L_BATCH + lane] = value[lane] * invR2[lane];
+            }
+        }
+    }
+}
+
+void FmmSolver::computeAccelerations(BodyStore& store, ThreadPool& pool,
+                                     float softening2, bool threeD) {
+    buildInteractions(store, pool, threeD);
+    if (tree_.empty()) {
+        error_ = ErrorEstimate();
+        return;
+    }
+
+    translateToLocals(pool, nullptr);
+    evaluateLeaves(store, pool, tree_.getLeaves(), softening2, nullptr);
+    estimateError(store, softening2, threeD);
+}
+
+void FmmSolver::computeShare(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& targets,
+                             float softening2, bool threeD, bool reuse) {
+    if (!reuse || tree_.getOrder().size() != store.size() || tree_.isThreeD() != threeD) {
+        buildInteractions(store, pool, threeD);
+        translated_.clear();
+    }
+    if (tree_.empty()) {
+        return;
+    }
+
+    shareMask_.assign(store.size(), 0);
+    for (uint32_t target : targets) {
+        shareMask_[target] = 1;
+    }
+
+    const std::vector<SpatialTree::Node>& nodes = tree_.getNodes();
+    const std::vector<uint32_t>& order = tree_.getOrder();
+    shareLeaves_.clear();
+    shareCells_.assign(nodes.size(), 0);
+    for (uint32_t leafIndex : tree_.getLeaves()) {
+        const SpatialTree::Node& leaf = nodes[leafIndex];
+        for (uint32_t k = leaf.begin; k < leaf.begin + leaf.count; ++k) {
+            if (shareMask_[order[k]]) {
+                shareLeaves_.push_back(leafIndex);
+                shareCells_[leafIndex] = 1;
+                break;
+            }
+        }
+    }
+
+    // Children come after their parents, so a backward sweep marks every ancestor
+    const unsigned int childCount = tree_.getChildCount();
+    for (size_t i = nodes.size(); i-- > 0;) {
+        const SpatialTree::Node& node = nodes[i];
+        if (node.firstChild == 0) {
+            continue;
+        }
+        for (unsigned int c = 0; c < childCount && !shareCells_[i]; ++c) {
+            shareCells_[i] = shareCells_[node.firstChild + c];
+        }
+    }
+    if (translated_.size() == nodes.size()) {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            shareCells_[i] = shareCells_[i] && !translated_[i];
+        }
+    }
+
+    // Each cell gets the same local expansion and each body the same near field it
+    // would in a full evaluation, so the result does not depend on the split
+    translateToLocals(pool, &shareCells_);
+    evaluateLeaves(store, pool, shareLeaves_, softening2, &shareMask_);
+}
+
+void FmmSolver::buildInteractions(BodyStore& store, ThreadPool& pool, bool threeD) {
+    tree_.build(store, threeD, leafSize_);
+    if (tree_.empty()) {
+        return;
+    }
+
+    computeMultipoles(pool);
+
+    m2l_.clear();
+    p2p_.clear();
+    walk(0, 0);
+    groupByTarget(m2l_, m2lOffsets_, m2lSources_);
+    groupByTarget(p2p_, p2pOffsets_, p2pSources_);
+}
+
+void FmmSolver::evaluateLeaves(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& leaves,
+                               float softening2, const std::vector<uint8_t>* mask) {
+    scratch_.resize(pool.size());
+    const size_t batch = 4;
+    std::atomic<size_t> next(0);
+    pool.run([&](size_t worker) {
+        Scratch& scratch = scratch_[worker];
+        while (true) {
+            size_t first = next.fetch_add(batch);
+            if (first >= leaves.size()) {
+                break;
+            }
+            size_t last = std::min(leaves.size(), first + batch);
+            for (size_t k = first; k < last; ++k) {
+                evaluateLeaf(store, leaves[k], scratch, softening2, mask);
+            }
+        }
+    });
+}
+
+void FmmSolver::computeMultipoles(ThreadPool& pool) {
+    const std::vector<SpatialTree::Node>& nodes = tree_.getNodes();
+    const std::vector<uint32_t>& leaves = tree_.getLeaves();
+    const float* sortedX = tree_.getSortedX().data();
+    const float* sortedY = tree_.getSortedY().data();
+    const float* sortedZ = tree_.getSortedZ().data();
+    const float* sortedGm = tree_.getSortedGm().data();
+    const size_t terms = termCount_;
+
+    radius_.assign(nodes.size(), 0.0f);
+    multipoles_.assign(nodes.size() * terms, 0.0);
+
+    // P2M: raw moments of the bodies about each leaf's center of mass
+    pool.parallelFor(leaves.size(), [&](size_t begin, size_t end) {
+        Expansion power;
+        for (size_t l = begin; l < end; ++l) {
+            const SpatialTree::Node& leaf = nodes[leaves[l]];
+            double* m = &multipoles_[leaves[l] * terms];
+            double radius2 = 0.0;
+            for (uint32_t k = leaf.begin; k < leaf.begin + leaf.count; ++k) {
+                double dx = static_cast<double>(sortedX[k]) - leaf.comX;
+                double dy = static_cast<double>(sortedY[k]) - leaf.comY;
+                double dz = static_cast<double>(sortedZ[k]) - leaf.comZ;
+                radius2 = std::max(radius2, dx * dx + dy * dy + dz * dz);
+                monomials(dx, dy, dz, power.data());
+                for (size_t t = 0; t < terms; ++t) {
+                    m[t] += sortedGm[k] * power[t];
+                }
+            }
+            radius_[leaves[l]] = static_cast<float>(std::sqrt(radius2));
+        }
+    });
+
+    // M2M: children always follow their parent, so a reverse sweep is bottom-up
+    const unsigned int childCount = tree_.getChildCount();
+    const double cornerScale = std::sqrt(static_cast<double>(tree_.isThreeD() ? 3 : 2));
+    Expansion power;
+    for (size_t i = nodes.size(); i-- > 0;) {
+        const SpatialTree::Node& node = nodes[i];
+        if (node.firstChild == 0) {
+            continue;
+        }
+
+        double* m = &multipoles_[i * terms];
+        double radius = 0.0;
+        for (unsigned int c = 0; c < childCount; ++c) {
+            const uint32_t childIndex = node.firstChild + c;
+            const SpatialTree::Node& child = nodes[childIndex];
+            if (child.count == 0) {
+                continue;
+            }
+
+            double tx = static_cast<double>(child.comX) - node.comX;
+            double ty = static_cast<double>(child.comY) - node.comY;
+            double tz = static_cast<double>(child.comZ) - node.comZ;
+            radius = std::max(radius, std::sqrt(tx * tx + ty * ty + tz * tz) + radius_[childIndex]);
+
+            monomials(tx, ty, tz, power.data());
+            const double* mc = &multipoles_[childIndex * terms];
+            for (const Term& term : shiftTerms_) {
+                m[term.out] += term.coefficient * power[term.power] * mc[term.in];
+            }
+        }
+
+        // The cell's own extent can be a tighter bound than the children's spheres
+        double gx = static_cast<double>(node.comX) - node.centerX;
+        double gy = static_cast<double>(node.comY) - node.centerY;
+        double gz = static_cast<double>(node.comZ) - node.centerZ;
+        double cellBound = std::sqrt(gx * gx + gy * gy + gz * gz) + cornerScale * node.halfSize;
+        radius_[i] = static_cast<float>(std::min(radius, cellBound));
+    }
+}
+
+bool FmmSolver::separated(uint32_t a, uint32_t b) const {
+    const SpatialTree::Node& na = tree_.getNodes()[a];
+    const SpatialTree::Node& nb = tree_.getNodes()[b];
+    float dx = na.comX - nb.comX;
+    float dy = na.comY - nb.comY;
+    float dz = na.comZ - nb.comZ;
+    float reach = radius_[a] + radius_[b];
+    return reach * reach < theta_ * theta_ * (dx * dx + dy * dy + dz * dz);
+}
+
+void FmmSolver::walk(uint32_t target, uint32_t source) {
+    const std::vector<SpatialTree::Node>& nodes = tree_.getNodes();
+    const SpatialTree::Node& a = nodes[target];
+    const SpatialTree::Node& b = nodes[source];
+    if (a.count == 0 || b.count == 0 || b.gm <= 0.0f) {
+        return;
+    }
+
+    const unsigned int childCount = tree_.getChildCount();
+    const bool leafA = a.firstChild == 0;
+    const bool leafB = b.firstChild == 0;
+
+    if (target == source) {
+        if (leafA) {
+            p2p_.push_back({target, source});
+            return;
+        }
+        for (unsigned int i = 0; i < childCount; ++i) {
+            for (unsigned int j = 0; j < childCount; ++j) {
+                walk(a.firstChild + i, a.firstChild + j);
+            }
+        }
+        return;
+    }
+
+    // Small leaf-cell pairs are cheaper to sum directly than to translate
+    const bool cheapDirect = leafA && static_cast<size_t>(a.count) * b.count <= directThreshold_;
+
+    if (cheapDirect) {
+        p2p_.push_back({target, source});
+    } else if (separated(target, source)) {
+        m2l_.push_back({target, source});
+    } else if (leafA && leafB) {
+        p2p_.push_back({target, source});
+    } else if (leafB || (!leafA && radius_[target] >= radius_[source])) {
+        for (unsigned int i = 0; i < childCount; ++i) {
+            walk(a.firstChild + i, source);
+        }
+    } else {
+        for (unsigned int j = 0; j < childCount; ++j) {
+            walk(target, b.firstChild + j);
+        }
+    }
+}
+
+void FmmSolver::groupByTarget(const std::vector<Interaction>& list, std::vector<uint32_t>& offsets,
+                              std::vector<uint32_t>& sources) {
+    const size_t nodeCount = tree_.getNodes().size();
+    offsets.assign(nodeCount + 1, 0);
+    for (const Interaction& interaction : list) {
+        ++offsets[interaction.target + 1];
+    }
+    for (size_t i = 0; i < nodeCount; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    sources.resize(list.size());
+    cursor_.assign(offsets.begin(), offsets.end() - 1);
+    for (const Interaction& interaction : list) {
+        sources[cursor_[interaction.target]++] = interaction.source;
+    }
+}
+
+void FmmSolver::translateToLocals(ThreadPool& pool, const std::vector<uint8_t>* cells) {
+    const std::vector<SpatialTree::Node>& nodes = tree_.getNodes();
+    const size_t terms = termCount_;
+    if (!cells || translated_.size() != nodes.size()) {
+        locals_.assign(nodes.size() * terms, 0.0);
+        translated_.assign(nodes.size(), 0);
+    }
+
+    // M2L: every target cell only writes its own local expansion. Sources are
+    // processed M2L_BATCH at a time with one accumulator per lane, which keeps
+    // the term loop free of serial dependencies
+    pool.parallelFor(nodes.size(), [&](size_t begin, size_t end) {
+        double dx[M2L_BATCH], dy[M2L_BATCH], dz[M2L_BATCH];
+        double derivative[MAX_TERMS * M2L_BATCH];
+        double moment[MAX_TERMS * M2L_BATCH];
+        double accumulator[MAX_TERMS * M2L_BATCH];
+
+        for (size_t t = begin; t < end; ++t) {
+            const uint32_t first = m2lOffsets_[t];
+            const uint32_t last = m2lOffsets_[t + 1];
+            if (first == last || (cells && !(*cells)[t])) {
+                continue;
+            }
+
+            const SpatialTree::Node& target = nodes[t];
+            std::fill(accumulator, accumulator + terms * M2L_BATCH, 0.0);
+
+            for (uint32_t k = first; k < last; k += M2L_BATCH) {
+                for (unsigned int lane = 0; lane < M2L_BATCH; ++lane) {
+                    if (k + lane < last) {
+                        const uint32_t s = m2lSources_[k + lane];
+                        const SpatialTree::Node& source = nodes[s];
+                        dx[lane] = static_cast<double>(target.comX) - source.comX;
+                        dy[lane] = static_cast<double>(target.comY) - source.comY;
+                        dz[lane] = static_cast<double>(target.comZ) - source.comZ;
+                        const double* m = &multipoles_[s * terms];
+                        for (size_t n = 0; n < terms; ++n) {
+                            moment[n * M2L_BATCH + lane] = m[n];
+                        }
+                    } else {
+                        // Padding lane: any finite separation with zero moments
+                        dx[lane] = 1.0;
+                        dy[lane] = dz[lane] = 0.0;
+                        for (size_t n = 0; n < terms; ++n) {
+                            moment[n * M2L_BATCH + lane] = 0.0;
+                        }
+                    }
+                }
+
+                derivatives(dx, dy, dz, derivative);
+                for (const Term& term : m2lTerms_) {
+                    const double* m = &moment[term.in * M2L_BATCH];
+                    const double* d = &derivative[term.power * M2L_BATCH];
+                    double* acc = &accumulator[term.out * M2L_BATCH];
+                    for (unsigned int lane = 0; lane < M2L_BATCH; ++lane) {
+                        acc[lane] += term.coefficient * m[lane] * d[lane];
+                    }
+                }
+            }
+
+            double* local = &locals_[t * terms];
+            for (size_t n = 0; n < terms; ++n) {
+                double sum = 0.0;
+                for (unsigned int lane = 0; lane < M2L_BATCH; ++lane) {
+                    sum += accumulator[n * M2L_BATCH + lane];
+                }
+                local[n] += sum;
+            }
+        }
+    });
+
+    // L2L: parents come before their children, so a forward sweep is top-down
+    const unsigned int childCount = tree_.getChildCount();
+    Expansion power;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const SpatialTree::Node& node = nodes[i];
+        if (node.firstChild == 0) {
+            continue;
+        }
+
+        const double* parent = &locals_[i * terms];
+        for (unsigned int c = 0; c < childCount; ++c) {
+            const uint32_t childIndex = node.firstChild + c;
+            const SpatialTree::Node& child = nodes[childIndex];
+            if (child.count == 0 || (cells && !(*cells)[childIndex])) {
+                continue;
+            }
+
+            monomials(static_cast<double>(child.comX) - node.comX,
+                      static_cast<double>(child.comY) - node.comY,
+                      static_cast<double>(child.comZ) - node.comZ, power.data());
+            double* local = &locals_[childIndex * terms];
+            for (const Term& term : shiftTerms_) {
+                local[term.in] += term.coefficient * power[term.power] * parent[term.out];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        translated_[i] = translated_[i] || !cells || (*cells)[i];
+    }
+}
+
+void FmmSolver::evaluateLeaf(BodyStore& store, uint32_t leafIndex, Scratch& scratch,
+                             float softening2, const std::vector<uint8_t>* mask) const {
+    const SpatialTree::Node& leaf = tree_.getNodes()[leafIndex];
+    const std::vector<uint32_t>& order = tree_.getOrder();
+    const float* sortedX = tree_.getSortedX().data();
+    const float* sortedY = tree_.getSortedY().data();
+    const float* sortedZ = tree_.getSortedZ().data();
+    const float* sortedGm = tree_.getSortedGm().data();
+    const bool threeD = tree_.isThreeD();
+    const size_t count = leaf.count;
+
+    scratch.ax.assign(count, 0.0f);
+    scratch.ay.assign(count, 0.0f);
+    scratch.az.assign(count, 0.0f);
+    const bool withPotential = !store.potential.empty();
+    float* potential = nullptr;
+    if (withPotential) {
+        scratch.potential.assign(count, 0.0f);
+        potential = scratch.potential.data();
+    }
+
+    // P2P: near-field cells, softened and exact. Sibling cells are usually
+    // adjacent in tree order, so merge their ranges into fewer kernel calls
+    scratch.ranges.clear();
+    for (uint32_t k = p2pOffsets_[leafIndex]; k < p2pOffsets_[leafIndex + 1]; ++k) {
+        const SpatialTree::Node& source = tree_.getNodes()[p2pSources_[k]];
+        scratch.ranges.push_back({source.begin, source.begin + source.count});
+    }
+    std::sort(scratch.ranges.begin(), scratch.ranges.end());
+
+    const GravityKernel::Targets targets = {
+        sortedX + leaf.begin, sortedY + leaf.begin, sortedZ + leaf.begin, count
+    };
+    for (size_t r = 0; r < scratch.ranges.size();) {
+        const uint32_t begin = scratch.ranges[r].first;
+        uint32_t end = scratch.ranges[r].second;
+        for (++r; r < scratch.ranges.size() && scratch.ranges[r].first == end; ++r) {
+            end = scratch.ranges[r].second;
+        }
+
+        const GravityKernel::Sources bodies = {
+            sortedX + begin, sortedY + begin, sortedZ + begin, sortedGm + begin, end - begin
+        };
+        GravityKernel::accumulateField(bodies, targets, softening2,
+                                       scratch.ax.data(), scratch.ay.data(), scratch.az.data(), threeD, potential);
+    }
+
+    // L2P: gradient of the local expansion, a_i = sum_k k_i L_k y^(k - e_i); the
+    // expansion itself is the far-field sum of gm / r, the potential with its sign flipped
+    const double* local = &locals_[leafIndex * termCount_];
+    Expansion power;
+    for (size_t k = 0; k < count; ++k) {
+        const uint32_t body = leaf.begin + static_cast<uint32_t>(k);
+        monomials(static_cast<double>(sortedX[body]) - leaf.comX,
+                  static_cast<double>(sortedY[body]) - leaf.comY,
+                  static_cast<double>(sortedZ[body]) - leaf.comZ, power.data());
+
+        double gradient[3] = {0.0, 0.0, 0.0};
+        for (size_t t = 1; t < termCount_; ++t) {
+            for (int i = 0; i < 3; ++i) {
+                const uint8_t e = exponents_[t * 3 + i];
+                if (e > 0) {
+                    gradient[i] += e * local[t] * power[lower_[t * 3 + i]];
+                }
+            }
+        }
+        scratch.ax[k] += static_cast<float>(gradient[0]);
+        scratch.ay[k] += static_cast<float>(gradient[1]);
+        scratch.az[k] += static_cast<float>(gradient[2]);
+
+        if (withPotential) {
+            double value = 0.0;
+            for (size_t t = 0; t < termCount_; ++t) {
+                value += local[t] * power[t];
+            }
+            potential[k] -= static_cast<float>(value);
+        }
+    }
+
+    for (size_t k = 0; k < count; ++k) {
+        uint32_t b = order[leaf.begin + k];
+        if (mask && !(*mask)[b]) {
+            continue;
+        }
+        store.ax[b] += scratch.ax[k];
+        store.ay[b] += scratch.ay[k];
+        if (threeD) {
+            store.az[b] += scratch.az[k];
+        }
+        if (withPotential) {
+            store.potential[b] += scratch.potential[k];
+        }
+    }
+}
+
+void FmmSolver::estimateError(const BodyStore& store, float softening2, bool threeD) {
+    const size_t n = store.size();
+    if (errorSamples_ == 0 || n == 0) {
+        error_ = ErrorEstimate();
+        return;
+    }
+
+    // Evenly strided sample whose offset advances every step, so over time
+    // every body gets checked
+    const size_t samples = std::min(errorSamples_, n);
+    sampleIndex_.resize(samples);
+    sampleX_.resize(samples);
+    sampleY_.resize(samples);
+    sampleZ_.resize(samples);
+    sampleAx_.assign(samples, 0.0f);
+    sampleAy_.assign(samples, 0.0f);
+    sampleAz_.assign(samples, 0.0f);
+    for (size_t k = 0; k < samples; ++k) {
+        size_t i = (sampleOffset_ + k * n / samples) % n;
+        sampleIndex_[k] = static_cast<uint32_t>(i);
+        sampleX_[k] = store.px[i];
+        sampleY_[k] = store.py[i];
+        sampleZ_[k] = store.pz[i];
+    }
+    sampleOffset_ = (sampleOffset_ + 1) % n;
+
+    const GravityKernel::Sources sources = {
+        store.px.data(), store.py.data(), store.pz.data(), store.gm.data(), n
+    };
+    const GravityKernel::Targets targets = {
+        sampleX_.data(), sampleY_.data(), sampleZ_.data(), samples
+    };
+    GravityKernel::accumulateField(sources, targets, softening2,
+                                   sampleAx_.data(), sampleAy_.data(), sampleAz_.data(), threeD);
+
+    double errorSum = 0.0;
+    double normSum = 0.0;
+    double maxError = 0.0;
+    for (size_t k = 0; k < samples; ++k) {
+        const size_t i = sampleIndex_[k];
+        double ex = static_cast<double>(store.ax[i]) - sampleAx_[k];
+        double ey = static_cast<double>(store.ay[i]) - sampleAy_[k];
+        double ez = threeD ? static_cast<double>(store.az[i]) - sampleAz_[k] : 0.0;
+        double az = threeD ? sampleAz_[k] : 0.0;
+        double e2 = ex * ex + ey * ey + ez * ez;
+        errorSum += e2;
+        normSum += static_cast<double>(sampleAx_[k]) * sampleAx_[k] +
+                   static_cast<double>(sampleAy_[k]) * sampleAy_[k] + az * az;
+        maxError = std::max(maxError, e2);
+    }
+
+    error_.samples = samples;
+    if (normSum > 0.0) {
+        error_.rmsRelative = std::sqrt(errorSum / normSum);
+        error_.maxRelative = std::sqrt(maxError / (normSum / samples));
+    } else {
+        error_.rmsRelative = 0.0;
+        error_.maxRelative = 0.0;
+    }
+}
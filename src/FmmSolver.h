@@ -0,0 +1,155 @@
+#pragma once
+#include "ForceSolver.h"
+#include "SpatialTree.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * Fast multipole solver on the shared SpatialTree, O(N) per step.
+ *
+ * Every cell carries a Cartesian multipole expansion about its center of mass
+ * (raw moments up to the configured order p, built P2M / M2M). A dual tree walk
+ * pairs well-separated cells, r_A + r_B < theta * |z_A - z_B|, and translates the
+ * source multipole into a local Taylor expansion of the target (M2L); nearby
+ * leaves interact directly through GravityKernel::accumulateField. Locals are
+ * pushed down the tree (L2L) and evaluated at the bodies (L2P).
+ *
+ * Each accepted M2L term is off from its source's exact field by at most about
+ * theta^(p+1) of that field. The acceptance test does not weigh mass, so when one
+ * heavy cell (a star) dominates a body's acceleration that is also the bound on the
+ * body's relative error; it only grows where far-field terms cancel. The defaults,
+ * p = 6 and theta = 0.4, bound it by 1.6e-3; on scenarios/main-belt.csv the worst
+ * body is 6e-5 off direct summation. Far field terms are unsoftened, which only
+ * matters for separations near the softening length.
+ */
+class FmmSolver : public ForceSolver {
+public:
+    /**
+     * @param order Expansion order p (1 = monopole forces only), clamped to [1, MAX_ORDER]
+     * @param theta Separation parameter; smaller is more accurate and more expensive
+     * @param leafSize Maximum number of bodies in a leaf before it is split
+     */
+    explicit FmmSolver(unsigned int order = 6, float theta = 0.4f, size_t leafSize = 64);
+
+    const char* getName() const override { return "FMM"; }
+
+    void computeAccelerations(BodyStore& store, ThreadPool& pool,
+                              float softening2, bool threeD) override;
+
+    // Translates and evaluates only the cells above and at the leaves holding a target,
+    // on top of the replicated upward pass and walk; with reuse both are kept. The
+    // error estimate needs every acceleration, so it is not taken here
+    void computeShare(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& targets,
+                      float softening2, bool threeD, bool reuse) override;
+
+    void setOrder(unsigned int order);
+    unsigned int getOrder() const { return order_; }
+
+    void setTheta(float theta) { theta_ = theta; }
+    float getTheta() const { return theta_; }
+
+    void setLeafSize(size_t leafSize) { leafSize_ = leafSize > 0 ? leafSize : 1; }
+    size_t getLeafSize() const { return leafSize_; }
+
+    // Bodies checked against direct summation after each step; 0 disables the check
+    void setErrorSampleCount(size_t samples) { errorSamples_ = samples; }
+    size_t getErrorSampleCount() const { return errorSamples_; }
+
+    struct ErrorEstimate {
+        double rmsRelative = 0.0;  // sqrt(sum |a - a_direct|^2 / sum |a_direct|^2) over the samples
+        double maxRelative = 0.0;  // Largest sample error relative to the RMS direct acceleration
+        size_t samples = 0;        // 0 until a step has been checked
+    };
+
+    // Error of the most recent step, measured on a rotating sample of bodies. The few bodies
+    // near a heavy accepted cell are easily missed, so the sample's max understates the worst
+    const ErrorEstimate& getErrorEstimate() const { return error_; }
+
+    // Statistics from the most recent step
+    size_t getNodeCount() const { return tree_.getNodes().size(); }
+    size_t getMultipoleInteractions() const { return m2l_.size(); }
+    size_t getDirectInteractions() const { return p2p_.size(); }
+
+    const SpatialTree& getTree() const { return tree_; }
+
+    static constexpr unsigned int MAX_ORDER = 8;
+
+private:
+    // Source cells translated together per target in the M2L pass
+    static constexpr unsigned int M2L_BATCH = 4;
+
+    // Multi-index pair (a, b) with a precomputed coefficient; meaning depends on the table
+    struct Term {
+        uint16_t out, in, power;
+        double coefficient;
+    };
+
+    struct Interaction {
+        uint32_t target, source;
+    };
+
+    struct Scratch {
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        std::vector<float> ax, ay, az, potential;
+    };
+
+    void buildTables();
+    void computeMultipoles(ThreadPool& pool);
+    void walk(uint32_t target, uint32_t source);
+    bool separated(uint32_t a, uint32_t b) const;
+    void groupByTarget(const std::vector<Interaction>& list, std::vector<uint32_t>& offsets,
+                       std::vector<uint32_t>& sources);
+    void buildInteractions(BodyStore& store, ThreadPool& pool, bool threeD);
+    // M2L and L2L for the cells set in cells, or all of them; locals already translated are kept
+    void translateToLocals(ThreadPool& pool, const std::vector<uint8_t>* cells);
+    void evaluateLeaves(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& leaves,
+                        float softening2, const std::vector<uint8_t>* mask);
+    void evaluateLeaf(BodyStore& store, uint32_t leafIndex, Scratch& scratch,
+                      float softening2, const std::vector<uint8_t>* mask) const;
+    void estimateError(const BodyStore& store, float softening2, bool threeD);
+
+    // Monomials y^m for every multi-index up to the expansion order
+    void monomials(double x, double y, double z, double* out) const;
+    // Normalised 1/r derivatives T_n = (d^n / n!) (1 / |r|) for M2L_BATCH separations,
+    // written interleaved as out[n * M2L_BATCH + lane]
+    void derivatives(const double* x, const double* y, const double* z, double* out) const;
+
+    unsigned int order_;
+    float theta_;
+    size_t leafSize_;
+    size_t directThreshold_ = 0;       // Leaf-cell pair count below which P2P beats M2L
+    size_t errorSamples_ = 32;
+    size_t sampleOffset_ = 0;
+    ErrorEstimate error_;
+
+    // Multi-index tables, rebuilt when the order changes
+    size_t termCount_ = 0;
+    std::vector<uint8_t> exponents_;    // 3 per multi-index
+    std::vector<int> degreeBegin_;      // First multi-index of each total degree
+    std::vector<int> lower_;            // Index of n - e_i (3 per multi-index, -1 if none)
+    std::vector<int> lower2_;           // Index of n - 2 e_i
+    std::vector<Term> shiftTerms_;      // (n, k <= n): C(n, k), power n - k, for M2M / L2L
+    std::vector<Term> m2lTerms_;        // (k, n): (-1)^|n| C(n + k, k), power index n + k
+
+    SpatialTree tree_;
+    std::vector<float> radius_;         // Bound on body distance from each node's center of mass
+    std::vector<double> multipoles_;    // termCount_ per node
+    std::vector<double> locals_;
+
+    std::vector<Interaction> m2l_, p2p_;
+    std::vector<uint32_t> m2lOffsets_, m2lSources_;
+    std::vector<uint32_t> p2pOffsets_, p2pSources_;
+    std::vector<uint32_t> cursor_;
+    std::vector<Scratch> scratch_;
+
+    // computeShare(): targets flagged per body, the leaves that hold one, cells still
+    // to translate for them, and cells whose local expansion is complete
+    std::vector<uint8_t> shareMask_;
+    std::vector<uint32_t> shareLeaves_;
+    std::vector<uint8_t> shareCells_;
+    std::vector<uint8_t> translated_;
+
+    std::vector<uint32_t> sampleIndex_;
+    std::vector<float> sampleX_, sampleY_, sampleZ_, sampleAx_, sampleAy_, sampleAz_;
+};
@@ -0,0 +1,66 @@
+#include "ForceSolver.h"
+#include "GravityKernel.h"
+#include <algorithm>
+
+void ForceSolver::computeAccelerationsFor(BodyStore& store, ThreadPool& pool,
+                                          const std::vector<uint32_t>& targets,
+                                          float softening2, bool threeD) {
+    if (targets.empty()) {
+        return;
+    }
+
+    const GravityKernel::Sources sources = {
+        store.px.data(), store.py.data(), store.pz.data(), store.gm.data(), store.size()
+    };
+
+    // Small subsets are not worth waking the pool for
+    const size_t workers = targets.size() < 64 ? 1 : std::min(pool.size(), targets.size());
+    subsetScratch_.resize(std::max(subsetScratch_.size(), workers));
+
+    const auto evaluate = [&](size_t worker) {
+        const size_t begin = targets.size() * worker / workers;
+        const size_t end = targets.size() * (worker + 1) / workers;
+        const size_t count = end - begin;
+        SubsetScratch& scratch = subsetScratch_[worker];
+        scratch.x.resize(count);
+        scratch.y.resize(count);
+        scratch.z.resize(count);
+        scratch.ax.assign(count, 0.0f);
+        scratch.ay.assign(count, 0.0f);
+        scratch.az.assign(count, 0.0f);
+        for (size_t k = 0; k < count; ++k) {
+            const uint32_t i = targets[begin + k];
+            scratch.x[k] = store.px[i];
+            scratch.y[k] = store.py[i];
+            scratch.z[k] = store.pz[i];
+        }
+
+        const GravityKernel::Targets field = {scratch.x.data(), scratch.y.data(), scratch.z.data(), count};
+        GravityKernel::accumulateField(sources, field, softening2,
+                                       scratch.ax.data(), scratch.ay.data(), scratch.az.data(), threeD);
+
+        for (size_t k = 0; k < count; ++k) {
+            const uint32_t i = targets[begin + k];
+            store.ax[i] += scratch.ax[k];
+            store.ay[i] += scratch.ay[k];
+            if (threeD) {
+                store.az[i] += scratch.az[k];
+            }
+        }
+    };
+
+    if (workers == 1) {
+        evaluate(0);
+    } else {
+        pool.run([&](size_t worker) {
+            if (worker < workers) {
+                evaluate(worker);
+            }
+        });
+    }
+}
+
+void ForceSolver::computeShare(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& targets,
+                               float softening2, bool threeD, bool /*reuse*/) {
+    computeAccelerationsFor(store, pool, targets, softening2, threeD);
+}
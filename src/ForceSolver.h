@@ -0,0 +1,63 @@
+#pragma once
+#include "BodyStore.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * Strategy for evaluating gravitational accelerations over the packed body store.
+ * SolarSystem owns one solver and calls it once per physics step; solvers read the
+ * single-precision positions px/py/pz and gm, add into store.ax/ay/az (which the
+ * caller has zeroed) and leave everything else untouched.
+ */
+class ForceSolver {
+public:
+    virtual ~ForceSolver() = default;
+
+    // Short human-readable name for UI and logs
+    virtual const char* getName() const = 0;
+
+    /**
+     * Accumulate the acceleration every body exerts on every other body. When
+     * store.potential is non-empty (on diagnostics steps), also add each body's
+     * softened potential -sum gm / r into it, from the same interactions.
+     * @param store Packed body state; only the acceleration and potential arrays are written
+     * @param pool Worker threads available to the solver
+     * @param softening2 Squared Plummer softening length in simulation units
+     * @param threeD When false only px/py are used and az is left untouched
+     */
+    virtual void computeAccelerations(BodyStore& store, ThreadPool& pool,
+                                      float softening2, bool threeD) = 0;
+
+    /**
+     * Accumulate the acceleration of every body on the listed targets only, for
+     * integrators that update a subset per substep. Only the targets' acceleration
+     * entries are written (and must have been zeroed); the potential is left alone.
+     * The default sums directly over all sources, O(targets * N).
+     */
+    virtual void computeAccelerationsFor(BodyStore& store, ThreadPool& pool,
+                                         const std::vector<uint32_t>& targets,
+                                         float softening2, bool threeD);
+
+    /**
+     * One process's part of a full evaluation split between processes: the
+     * accelerations of the listed targets, as computeAccelerations() gives them.
+     * Only the targets' entries are written. With reuse set the positions are the
+     * same as in the previous call, so the solver may keep what it built for it (a
+     * tree solver its tree) instead of building it again. The default sums directly
+     * like computeAccelerationsFor().
+     */
+    virtual void computeShare(BodyStore& store, ThreadPool& pool, const std::vector<uint32_t>& targets,
+                              float softening2, bool threeD, bool reuse);
+
+    // False when computeShare() costs far more per target than a full evaluation
+    // does per body (an O(N) solver on the direct-sum default); those are not split
+    virtual bool canShare() const { return true; }
+
+private:
+    // Per-worker gather buffers for the default computeAccelerationsFor
+    struct SubsetScratch {
+        std::vector<float> x, y, z, ax, ay, az;
+    };
+    std::vector<SubsetScratch> subsetScratch_;
+};
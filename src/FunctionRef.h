@@ -0,0 +1,34 @@
+#pragma once
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Non-owning reference to a callable, for callbacks that are only invoked
+ * during the call they are passed to (thread pool tasks, range loops).
+ *
+ * A std::function parameter copies a lambda onto the heap once its captures
+ * outgrow the small-buffer, which for the physics loops meant a few
+ * allocations every step; this only stores a pointer to the caller's lambda.
+ * The referenced callable must outlive every call through the reference, so
+ * never keep one beyond the function it was passed to.
+ */
+template <typename Signature>
+class FunctionRef;
+
+template <typename R, typename... Args>
+class FunctionRef<R(Args...)> {
+public:
+    template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, FunctionRef>::value>>
+    FunctionRef(F&& f)
+        : object_(const_cast<void*>(static_cast<const void*>(std::addressof(f)))),
+          call_([](void* object, Args... args) -> R {
+              return (*static_cast<std::remove_reference_t<F>*>(object))(std::forward<Args>(args)...);
+          }) {}
+
+    R operator()(Args... args) const { return call_(object_, std::forward<Args>(args)...); }
+
+private:
+    void* object_;
+    R (*call_)(void*, Args...);
+};
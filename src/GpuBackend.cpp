@@ -0,0 +1,536 @@
+#include "GpuBackend.h"
+#include "SolarSystem.h"
+#include <SFML/Window.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#if defined(_WIN32)
+#define GPU_APIENTRY __stdcall
+#else
+#define GPU_APIENTRY
+#endif
+
+namespace {
+
+// OpenGL 1.1 headers stop short of what we need, so the enums and entry
+// points used by this backend are declared here and loaded at runtime
+constexpr GLenum GL_ARRAY_BUFFER_ = 0x8892;
+constexpr GLenum GL_DYNAMIC_DRAW_ = 0x88E8;
+constexpr GLenum GL_STATIC_DRAW_ = 0x88E4;
+constexpr GLenum GL_SHADER_STORAGE_BUFFER_ = 0x90D2;
+constexpr GLenum GL_COMPUTE_SHADER_ = 0x91B9;
+constexpr GLenum GL_VERTEX_SHADER_ = 0x8B31;
+constexpr GLenum GL_FRAGMENT_SHADER_ = 0x8B30;
+constexpr GLenum GL_COMPILE_STATUS_ = 0x8B81;
+constexpr GLenum GL_LINK_STATUS_ = 0x8B82;
+constexpr GLenum GL_INFO_LOG_LENGTH_ = 0x8B84;
+constexpr GLenum GL_PROGRAM_POINT_SIZE_ = 0x8642;
+constexpr GLenum GL_POINT_SPRITE_ = 0x8861;
+constexpr GLbitfield GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT_ = 0x00000001;
+constexpr GLbitfield GL_SHADER_STORAGE_BARRIER_BIT_ = 0x00002000;
+constexpr GLbitfield GL_BUFFER_UPDATE_BARRIER_BIT_ = 0x00000200;
+
+struct GlFunctions {
+    GLuint (GPU_APIENTRY* createShader)(GLenum);
+    void (GPU_APIENTRY* shaderSource)(GLuint, GLsizei, const char* const*, const GLint*);
+    void (GPU_APIENTRY* compileShader)(GLuint);
+    void (GPU_APIENTRY* getShaderiv)(GLuint, GLenum, GLint*);
+    void (GPU_APIENTRY* getShaderInfoLog)(GLuint, GLsizei, GLsizei*, char*);
+    void (GPU_APIENTRY* deleteShader)(GLuint);
+    GLuint (GPU_APIENTRY* createProgram)();
+    void (GPU_APIENTRY* attachShader)(GLuint, GLuint);
+    void (GPU_APIENTRY* linkProgram)(GLuint);
+    void (GPU_APIENTRY* getProgramiv)(GLuint, GLenum, GLint*);
+    void (GPU_APIENTRY* getProgramInfoLog)(GLuint, GLsizei, GLsizei*, char*);
+    void (GPU_APIENTRY* deleteProgram)(GLuint);
+    void (GPU_APIENTRY* useProgram)(GLuint);
+    GLint (GPU_APIENTRY* getUniformLocation)(GLuint, const char*);
+    void (GPU_APIENTRY* uniform1ui)(GLint, GLuint);
+    void (GPU_APIENTRY* uniform1i)(GLint, GLint);
+    void (GPU_APIENTRY* uniform1f)(GLint, GLfloat);
+    void (GPU_APIENTRY* uniform2f)(GLint, GLfloat, GLfloat);
+    void (GPU_APIENTRY* uniform4f)(GLint, GLfloat, GLfloat, GLfloat, GLfloat);
+    void (GPU_APIENTRY* uniformMatrix4fv)(GLint, GLsizei, GLboolean, const GLfloat*);
+    void (GPU_APIENTRY* genBuffers)(GLsizei, GLuint*);
+    void (GPU_APIENTRY* deleteBuffers)(GLsizei, const GLuint*);
+    void (GPU_APIENTRY* bindBuffer)(GLenum, GLuint);
+    void (GPU_APIENTRY* bufferData)(GLenum, std::ptrdiff_t, const void*, GLenum);
+    void (GPU_APIENTRY* getBufferSubData)(GLenum, std::ptrdiff_t, std::ptrdiff_t, void*);
+    void (GPU_APIENTRY* bindBufferBase)(GLenum, GLuint, GLuint);
+    void (GPU_APIENTRY* dispatchCompute)(GLuint, GLuint, GLuint);
+    void (GPU_APIENTRY* memoryBarrier)(GLbitfield);
+    void (GPU_APIENTRY* vertexAttribPointer)(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*);
+    void (GPU_APIENTRY* enableVertexAttribArray)(GLuint);
+    void (GPU_APIENTRY* disableVertexAttribArray)(GLuint);
+};
+
+GlFunctions gl;
+
+template <typename T>
+bool load(T& function, const char* name) {
+    function = reinterpret_cast<T>(sf::Context::getFunction(name));
+    return function != nullptr;
+}
+
+// Tiled accelerations: each work group stages WORK_GROUP_SIZE sources in shared
+// memory at a time. Only the first sourceCount entries (the bodies) are sources;
+// test particles after them are targets only. Padding sources have gm = 0 and
+// contribute nothing; a body's own term vanishes because its separation is zero.
+const char* FORCE_SHADER = R"(
+#version 430
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 0) readonly buffer Positions { vec4 position[]; };
+layout(std430, binding = 2) writeonly buffer Accelerations { vec4 acceleration[]; };
+
+uniform uint bodyCount;
+uniform uint sourceCount;
+uniform float softening2;
+
+shared vec4 tile[256];
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    vec3 self = i < bodyCount ? position[i].xyz : vec3(0.0);
+    vec3 sum = vec3(0.0);
+
+    for (uint base = 0u; base < sourceCount; base += 256u) {
+        uint j = base + gl_LocalInvocationID.x;
+        tile[gl_LocalInvocationID.x] = j < sourceCount ? position[j] : vec4(0.0);
+        barrier();
+
+        for (uint k = 0u; k < 256u; ++k) {
+            vec3 d = tile[k].xyz - self;
+            float invR = inversesqrt(dot(d, d) + softening2);
+            sum += (tile[k].w * invR * invR * invR) * d;
+        }
+        barrier();
+    }
+
+    if (i < bodyCount) {
+        acceleration[i] = vec4(sum, 0.0);
+    }
+}
+)";
+
+// Kick-drift-kick leapfrog, matching the CPU default: drift = 1 kicks by halfDt and
+// drifts by dt, drift = 0 only kicks (the closing half kick)
+const char* INTEGRATE_SHADER = R"(
+#version 430
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 0) buffer Positions { vec4 position[]; };
+layout(std430, binding = 1) buffer Velocities { vec4 velocity[]; };
+layout(std430, binding = 2) readonly buffer Accelerations { vec4 acceleration[]; };
+
+uniform uint bodyCount;
+uniform float dt;
+uniform int drift;
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= bodyCount) return;
+
+    vec4 v = velocity[i];
+    v.xyz += acceleration[i].xyz * (0.5 * dt);
+    velocity[i] = v;
+    if (drift != 0) {
+        position[i].xyz += v.xyz * dt;
+    }
+}
+)";
+
+// Same camera model as CameraProjection, then the SFML view transform
+const char* DRAW_VERTEX_SHADER = R"(
+#version 430
+layout(location = 0) in vec4 body;        // xyz position, w = gm
+layout(location = 1) in vec4 appearance;  // rgb colour, w = visual radius
+
+uniform mat4 viewMatrix;
+uniform vec2 center;
+uniform float cameraZ;
+uniform vec4 rotation;      // cos / sin of pitch, cos / sin of yaw
+uniform int threeD;
+uniform float pixelsPerUnit;
+uniform float visualScale;
+
+out vec3 color;
+
+void main() {
+    vec2 p = body.xy;
+    if (threeD != 0) {
+        vec3 r = vec3(body.xy - center, body.z - cameraZ);
+        float yRot = r.y * rotation.x - r.z * rotation.y;
+        float zPitch = r.y * rotation.y + r.z * rotation.x;
+        float xRot = r.x * rotation.z + zPitch * rotation.w;
+        float zRot = -r.x * rotation.w + zPitch * rotation.z;
+
+        const float perspective = 1000.0;
+        if (zRot < -perspective) zRot = -perspective + 1.0;
+        float depth = perspective / (perspective + zRot);
+        p = vec2(xRot, yRot) * depth + center;
+    }
+
+    gl_Position = viewMatrix * vec4(p, 0.0, 1.0);
+    gl_PointSize = 2.0 * max(2.0, appearance.w * visualScale) * pixelsPerUnit;
+    color = appearance.rgb;
+}
+)";
+
+const char* DRAW_FRAGMENT_SHADER = R"(
+#version 430
+in vec3 color;
+out vec4 fragColor;
+
+void main() {
+    vec2 d = gl_PointCoord * 2.0 - 1.0;
+    if (dot(d, d) > 1.0) discard;
+    fragColor = vec4(color, 1.0);
+}
+)";
+
+} // namespace
+
+GpuBackend::GpuBackend()
+    : available_(false), active_(false), bodyCount_(0), particleCount_(0), accelerationsValid_(false),
+      positionBuffer_(0), velocityBuffer_(0), accelerationBuffer_(0), appearanceBuffer_(0),
+      forceProgram_(0), integrateProgram_(0), drawProgram_(0) {
+}
+
+GpuBackend::~GpuBackend() {
+    if (!available_) {
+        return;
+    }
+    releaseBuffers();
+    gl.deleteProgram(forceProgram_);
+    gl.deleteProgram(integrateProgram_);
+    gl.deleteProgram(drawProgram_);
+}
+
+bool GpuBackend::initialize() {
+    if (available_) {
+        return true;
+    }
+
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    int major = 0;
+    int minor = 0;
+    if (!version || std::sscanf(version, "%d.%d", &major, &minor) != 2 || major * 10 + minor < 43) {
+        error_ = std::string("OpenGL 4.3 required, context is ") + (version ? version : "unknown");
+        return false;
+    }
+
+    if (!loadFunctions()) {
+        error_ = "Missing OpenGL 4.3 entry points";
+        return false;
+    }
+
+    const GLenum computeStage[] = {GL_COMPUTE_SHADER_};
+    forceProgram_ = compileProgram(&FORCE_SHADER, computeStage, 1);
+    integrateProgram_ = compileProgram(&INTEGRATE_SHADER, computeStage, 1);
+
+    const char* drawSources[] = {DRAW_VERTEX_SHADER, DRAW_FRAGMENT_SHADER};
+    const GLenum drawStages[] = {GL_VERTEX_SHADER_, GL_FRAGMENT_SHADER_};
+    drawProgram_ = compileProgram(drawSources, drawStages, 2);
+
+    if (!forceProgram_ || !integrateProgram_ || !drawProgram_) {
+        if (forceProgram_) gl.deleteProgram(forceProgram_);
+        if (integrateProgram_) gl.deleteProgram(integrateProgram_);
+        if (drawProgram_) gl.deleteProgram(drawProgram_);
+        forceProgram_ = integrateProgram_ = drawProgram_ = 0;
+        return false;
+    }
+
+    GLuint buffers[4];
+    gl.genBuffers(4, buffers);
+    positionBuffer_ = buffers[0];
+    velocityBuffer_ = buffers[1];
+    accelerationBuffer_ = buffers[2];
+    appearanceBuffer_ = buffers[3];
+
+    available_ = true;
+    return true;
+}
+
+bool GpuBackend::loadFunctions() {
+    bool ok = true;
+    ok &= load(gl.createShader, "glCreateShader");
+    ok &= load(gl.shaderSource, "glShaderSource");
+    ok &= load(gl.compileShader, "glCompileShader");
+    ok &= load(gl.getShaderiv, "glGetShaderiv");
+    ok &= load(gl.getShaderInfoLog, "glGetShaderInfoLog");
+    ok &= load(gl.deleteShader, "glDeleteShader");
+    ok &= load(gl.createProgram, "glCreateProgram");
+    ok &= load(gl.attachShader, "glAttachShader");
+    ok &= load(gl.linkProgram, "glLinkProgram");
+    ok &= load(gl.getProgramiv, "glGetProgramiv");
+    ok &= load(gl.getProgramInfoLog, "glGetProgramInfoLog");
+    ok &= load(gl.deleteProgram, "glDeleteProgram");
+    ok &= load(gl.useProgram, "glUseProgram");
+    ok &= load(gl.getUniformLocation, "glGetUniformLocation");
+    ok &= load(gl.uniform1ui, "glUniform1ui");
+    ok &= load(gl.uniform1i, "glUniform1i");
+    ok &= load(gl.uniform1f, "glUniform1f");
+    ok &= load(gl.uniform2f, "glUniform2f");
+    ok &= load(gl.uniform4f, "glUniform4f");
+    ok &= load(gl.uniformMatrix4fv, "glUniformMatrix4fv");
+    ok &= load(gl.genBuffers, "glGenBuffers");
+    ok &= load(gl.deleteBuffers, "glDeleteBuffers");
+    ok &= load(gl.bindBuffer, "glBindBuffer");
+    ok &= load(gl.bufferData, "glBufferData");
+    ok &= load(gl.getBufferSubData, "glGetBufferSubData");
+    ok &= load(gl.bindBufferBase, "glBindBufferBase");
+    ok &= load(gl.dispatchCompute, "glDispatchCompute");
+    ok &= load(gl.memoryBarrier, "glMemoryBarrier");
+    ok &= load(gl.vertexAttribPointer, "glVertexAttribPointer");
+    ok &= load(gl.enableVertexAttribArray, "glEnableVertexAttribArray");
+    ok &= load(gl.disableVertexAttribArray, "glDisableVertexAttribArray");
+    return ok;
+}
+
+GLuint GpuBackend::compileProgram(const char* const* sources, const GLenum* stages, size_t count) {
+    GLuint program = gl.createProgram();
+    std::vector<GLuint> shaders;
+
+    for (size_t s = 0; s < count; ++s) {
+        GLuint shader = gl.createShader(stages[s]);
+        gl.shaderSource(shader, 1, &sources[s], nullptr);
+        gl.compileShader(shader);
+
+        GLint status = 0;
+        gl.getShaderiv(shader, GL_COMPILE_STATUS_, &status);
+        if (!status) {
+            GLint length = 0;
+            gl.getShaderiv(shader, GL_INFO_LOG_LENGTH_, &length);
+            std::vector<char> log(static_cast<size_t>(length) + 1, '\0');
+            gl.getShaderInfoLog(shader, length, nullptr, log.data());
+            error_ = std::string("Shader compilation failed: ") + log.data();
+
+            gl.deleteShader(shader);
+            for (GLuint attached : shaders) gl.deleteShader(attached);
+            gl.deleteProgram(program);
+            return 0;
+        }
+
+        gl.attachShader(program, shader);
+        shaders.push_back(shader);
+    }
+
+    gl.linkProgram(program);
+    for (GLuint shader : shaders) {
+        gl.deleteShader(shader);
+    }
+
+    GLint status = 0;
+    gl.getProgramiv(program, GL_LINK_STATUS_, &status);
+    if (!status) {
+        GLint length = 0;
+        gl.getProgramiv(program, GL_INFO_LOG_LENGTH_, &length);
+        std::vector<char> log(static_cast<size_t>(length) + 1, '\0');
+        gl.getProgramInfoLog(program, length, nullptr, log.data());
+        error_ = std::string("Shader link failed: ") + log.data();
+        gl.deleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void GpuBackend::releaseBuffers() {
+    GLuint buffers[4] = {positionBuffer_, velocityBuffer_, accelerationBuffer_, appearanceBuffer_};
+    gl.deleteBuffers(4, buffers);
+    positionBuffer_ = velocityBuffer_ = accelerationBuffer_ = appearanceBuffer_ = 0;
+}
+
+void GpuBackend::upload(const SolarSystem& solarSystem) {
+    if (!available_) {
+        return;
+    }
+
+    const BodyStore& store = solarSystem.getStore();
+    const auto& bodies = solarSystem.getBodies();
+    const TestParticles& particles = solarSystem.getTestParticles();
+    const auto& particleColors = solarSystem.getTestParticleColors();
+    const bool threeD = solarSystem.is3DMode();
+    bodyCount_ = store.size();
+    particleCount_ = particles.size();
+    const size_t total = bodyCount_ + particleCount_;
+
+    std::vector<float> position(total * 4);
+    std::vector<float> velocity(total * 4);
+    std::vector<float> appearance(total * 4);
+    for (size_t i = 0; i < bodyCount_; ++i) {
+        position[i * 4 + 0] = static_cast<float>(store.x[i]);
+        position[i * 4 + 1] = static_cast<float>(store.y[i]);
+        position[i * 4 + 2] = threeD ? static_cast<float>(store.z[i]) : 0.0f;
+        position[i * 4 + 3] = store.gm[i];
+
+        velocity[i * 4 + 0] = static_cast<float>(store.vx[i]);
+        velocity[i * 4 + 1] = static_cast<float>(store.vy[i]);
+        velocity[i * 4 + 2] = threeD ? static_cast<float>(store.vz[i]) : 0.0f;
+        velocity[i * 4 + 3] = 0.0f;
+
+        const Color color = bodies[i]->getColor();
+        appearance[i * 4 + 0] = color.r / 255.0f;
+        appearance[i * 4 + 1] = color.g / 255.0f;
+        appearance[i * 4 + 2] = color.b / 255.0f;
+        appearance[i * 4 + 3] = bodies[i]->getVisualRadius();
+    }
+    // Test particles follow the bodies, massless
+    for (size_t k = 0; k < particleCount_; ++k) {
+        const size_t i = bodyCount_ + k;
+        position[i * 4 + 0] = static_cast<float>(particles.x[k]);
+        position[i * 4 + 1] = static_cast<float>(particles.y[k]);
+        position[i * 4 + 2] = threeD ? static_cast<float>(particles.z[k]) : 0.0f;
+        position[i * 4 + 3] = 0.0f;
+
+        velocity[i * 4 + 0] = static_cast<float>(particles.vx[k]);
+        velocity[i * 4 + 1] = static_cast<float>(particles.vy[k]);
+        velocity[i * 4 + 2] = threeD ? static_cast<float>(particles.vz[k]) : 0.0f;
+        velocity[i * 4 + 3] = 0.0f;
+
+        const Color color = particleColors[k];
+        appearance[i * 4 + 0] = color.r / 255.0f;
+        appearance[i * 4 + 1] = color.g / 255.0f;
+        appearance[i * 4 + 2] = color.b / 255.0f;
+        appearance[i * 4 + 3] = 1.0f;
+    }
+
+    const std::ptrdiff_t bytes = static_cast<std::ptrdiff_t>(total * 4 * sizeof(float));
+    gl.bindBuffer(GL_SHADER_STORAGE_BUFFER_, positionBuffer_);
+    gl.bufferData(GL_SHADER_STORAGE_BUFFER_, bytes, position.data(), GL_DYNAMIC_DRAW_);
+    gl.bindBuffer(GL_SHADER_STORAGE_BUFFER_, velocityBuffer_);
+    gl.bufferData(GL_SHADER_STORAGE_BUFFER_, bytes, velocity.data(), GL_DYNAMIC_DRAW_);
+    gl.bindBuffer(GL_SHADER_STORAGE_BUFFER_, accelerationBuffer_);
+    gl.bufferData(GL_SHADER_STORAGE_BUFFER_, bytes, nullptr, GL_DYNAMIC_DRAW_);
+    gl.bindBuffer(GL_SHADER_STORAGE_BUFFER_, appearanceBuffer_);
+    gl.bufferData(GL_SHADER_STORAGE_BUFFER_, bytes, appearance.data(), GL_STATIC_DRAW_);
+    gl.bindBuffer(GL_SHADER_STORAGE_BUFFER_, 0);
+
+    active_ = true;
+    accelerationsValid_ = false;
+}
+
+void GpuBackend::download(SolarSystem& solarSystem) {
+    if (!active_) {
+        return;
+    }
+    active_ = false;
+
+    BodyStore& store = solarSystem.getStore();
+    TestParticles& particles = solarSystem.getTestParticles();
+    if (store.size() != bodyCount_ || particles.size() != particleCount_) {
+        return;
+    }
+
+    gl.memoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT_);
+
+    const size_t total = bodyCount_ + particleCount_;
+    const std::ptrdiff_t bytes = static_cast<std::ptrdiff_t>(total * 4 * sizeof(float));
+    std::vector<float> position(total * 4);
+    std::vector<float> velocity(total * 4);
+    gl.bindBuffer(GL_SHADER_STORAGE_BUFFER_, positionBuffer_);
+    gl.getBufferSubData(GL_SHADER_STORAGE_BUFFER_, 0, bytes, position.data());
+    gl.bindBuffer(GL_SHADER_STORAGE_BUFFER_, velocityBuffer_);
+    gl.getBufferSubData(GL_SHADER_STORAGE_BUFFER_, 0, bytes, velocity.data());
+    gl.bindBuffer(GL_SHADER_STORAGE_BUFFER_, 0);
+
+    for (size_t i = 0; i < bodyCount_; ++i) {
+        store.x[i] = position[i * 4 + 0];
+        store.y[i] = position[i * 4 + 1];
+        store.z[i] = position[i * 4 + 2];
+        store.vx[i] = velocity[i * 4 + 0];
+        store.vy[i] = velocity[i * 4 + 1];
+        store.vz[i] = velocity[i * 4 + 2];
+    }
+    for (size_t k = 0; k < particleCount_; ++k) {
+        const size_t i = bodyCount_ + k;
+        particles.x[k] = position[i * 4 + 0];
+        particles.y[k] = position[i * 4 + 1];
+        particles.z[k] = position[i * 4 + 2];
+        particles.vx[k] = velocity[i * 4 + 0];
+        particles.vy[k] = velocity[i * 4 + 1];
+        particles.vz[k] = velocity[i * 4 + 2];
+    }
+    store.resetForces();
+    solarSystem.invalidateAccelerations();
+}
+
+void GpuBackend::step(const SolarSystem& solarSystem, double deltaTime) {
+    if (!active_ || solarSystem.isPaused() || bodyCount_ == 0) {
+        return;
+    }
+
+    const float dt = static_cast<float>(solarSystem.getStepSize(deltaTime * solarSystem.getTimeScale()));
+    const GLuint count = static_cast<GLuint>(bodyCount_ + particleCount_);
+    const GLuint groups = (count + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE;
+
+    gl.bindBufferBase(GL_SHADER_STORAGE_BUFFER_, 0, positionBuffer_);
+    gl.bindBufferBase(GL_SHADER_STORAGE_BUFFER_, 1, velocityBuffer_);
+    gl.bindBufferBase(GL_SHADER_STORAGE_BUFFER_, 2, accelerationBuffer_);
+
+    const auto computeForces = [&]() {
+        gl.useProgram(forceProgram_);
+        gl.uniform1ui(gl.getUniformLocation(forceProgram_, "bodyCount"), count);
+        gl.uniform1ui(gl.getUniformLocation(forceProgram_, "sourceCount"), static_cast<GLuint>(bodyCount_));
+        gl.uniform1f(gl.getUniformLocation(forceProgram_, "softening2"), SolarSystem::getSoftening2());
+        gl.dispatchCompute(groups, 1, 1);
+        gl.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT_);
+    };
+    const auto kick = [&](int drift) {
+        gl.useProgram(integrateProgram_);
+        gl.uniform1ui(gl.getUniformLocation(integrateProgram_, "bodyCount"), count);
+        gl.uniform1f(gl.getUniformLocation(integrateProgram_, "dt"), dt);
+        gl.uniform1i(gl.getUniformLocation(integrateProgram_, "drift"), drift);
+        gl.dispatchCompute(groups, 1, 1);
+        gl.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT_);
+    };
+
+    // The closing kick's accelerations open the next step
+    if (!accelerationsValid_) {
+        computeForces();
+        accelerationsValid_ = true;
+    }
+    kick(1);
+    computeForces();
+    kick(0);
+    gl.memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT_);
+
+    gl.useProgram(0);
+}
+
+void GpuBackend::draw(const Camera& camera) {
+    if (!active_ || bodyCount_ + particleCount_ == 0) {
+        return;
+    }
+
+    gl.useProgram(drawProgram_);
+    gl.uniformMatrix4fv(gl.getUniformLocation(drawProgram_, "viewMatrix"), 1, GL_FALSE, camera.viewMatrix);
+    gl.uniform2f(gl.getUniformLocation(drawProgram_, "center"), camera.centerX, camera.centerY);
+    gl.uniform1f(gl.getUniformLocation(drawProgram_, "cameraZ"), camera.cameraZ);
+    gl.uniform4f(gl.getUniformLocation(drawProgram_, "rotation"),
+                 std::cos(camera.pitch), std::sin(camera.pitch), std::cos(camera.yaw), std::sin(camera.yaw));
+    gl.uniform1i(gl.getUniformLocation(drawProgram_, "threeD"), camera.threeD ? 1 : 0);
+    gl.uniform1f(gl.getUniformLocation(drawProgram_, "pixelsPerUnit"), camera.pixelsPerUnit);
+    gl.uniform1f(gl.getUniformLocation(drawProgram_, "visualScale"), camera.visualScale);
+
+    // The storage buffers double as vertex buffers, so nothing is copied
+    gl.bindBuffer(GL_ARRAY_BUFFER_, positionBuffer_);
+    gl.vertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+    gl.enableVertexAttribArray(0);
+    gl.bindBuffer(GL_ARRAY_BUFFER_, appearanceBuffer_);
+    gl.vertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+    gl.enableVertexAttribArray(1);
+
+    glEnable(GL_PROGRAM_POINT_SIZE_);
+    glEnable(GL_POINT_SPRITE_);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(bodyCount_ + particleCount_));
+    glDisable(GL_POINT_SPRITE_);
+    glDisable(GL_PROGRAM_POINT_SIZE_);
+
+    gl.disableVertexAttribArray(0);
+    gl.disableVertexAttribArray(1);
+    gl.bindBuffer(GL_ARRAY_BUFFER_, 0);
+    gl.useProgram(0);
+}
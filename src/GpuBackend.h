@@ -0,0 +1,86 @@
+#pragma once
+#include <SFML/OpenGL.hpp>
+#include <cstddef>
+#include <string>
+
+class SolarSystem;
+
+/**
+ * Optional OpenGL 4.3 compute backend for forces and integration.
+ *
+ * While active, the body state lives in GPU buffers: a tiled compute shader
+ * evaluates the softened pairwise accelerations, a second one integrates, and
+ * the renderer draws point sprites straight from the position buffer. Nothing
+ * crosses the bus per frame; download() copies the state back when CPU code
+ * (trails, labels, the CPU solvers) needs it again.
+ *
+ * Test particles are uploaded after the bodies and are targets only: the
+ * force shader's sources stop at the last body, so they cost O(bodies) each.
+ *
+ * Device state is single precision, so long runs drift further from the CPU
+ * path, which integrates in double.
+ */
+class GpuBackend {
+public:
+    GpuBackend();
+    ~GpuBackend();
+
+    GpuBackend(const GpuBackend&) = delete;
+    GpuBackend& operator=(const GpuBackend&) = delete;
+
+    // Load the GL 4.3 entry points and build the shaders; the window's context must be active
+    bool initialize();
+    bool isAvailable() const { return available_; }
+    // Why initialize() failed
+    const std::string& getError() const { return error_; }
+
+    // Copy the simulation state into device buffers; the GPU owns it until download()
+    void upload(const SolarSystem& solarSystem);
+    // Copy positions and velocities back into the body store and stop stepping on the GPU
+    void download(SolarSystem& solarSystem);
+    bool isActive() const { return active_; }
+    size_t getBodyCount() const { return bodyCount_; }
+    size_t getParticleCount() const { return particleCount_; }
+
+    // Advance one frame by leapfrog with the same time scaling as SolarSystem::update
+    void step(const SolarSystem& solarSystem, double deltaTime);
+
+    // Camera state mirrored from the Renderer
+    struct Camera {
+        const float* viewMatrix;  // sf::View transform, column-major 4x4
+        float centerX, centerY;
+        float cameraZ;
+        float pitch, yaw;
+        bool threeD;
+        float pixelsPerUnit;      // Framebuffer pixels per world unit
+        float visualScale;        // Renderer::getVisualScale()
+    };
+
+    // Draw every body as a round point sprite, reading the device buffers directly
+    void draw(const Camera& camera);
+
+private:
+    bool loadFunctions();
+    GLuint compileProgram(const char* const* sources, const GLenum* stages, size_t count);
+    void releaseBuffers();
+
+    bool available_;
+    bool active_;
+    std::string error_;
+    size_t bodyCount_;
+    size_t particleCount_;      // Stored after the bodies in every buffer
+    bool accelerationsValid_;   // accelerationBuffer_ matches the current positions
+
+    // Shader storage buffers: position + gm, velocity, acceleration, colour + radius
+    GLuint positionBuffer_;
+    GLuint velocityBuffer_;
+    GLuint accelerationBuffer_;
+    GLuint appearanceBuffer_;
+
+    GLuint forceProgram_;
+    GLuint integrateProgram_;
+    GLuint drawProgram_;
+
+    // Bodies per compute work group; must match local_size_x in the shaders
+    static constexpr unsigned int WORK_GROUP_SIZE = 256;
+};
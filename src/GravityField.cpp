@@ -0,0 +1,74 @@
+#include "GravityField.h"
+#include <algorithm>
+
+void GravityField::build(const SolarSystem& solarSystem, const StateSnapshot& state) {
+    const auto& bodies = solarSystem.getBodies();
+    const size_t count = std::min(bodies.size(), state.size());
+    sources_.clear();
+    maxSpeed_ = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        maxSpeed_ = std::max(maxSpeed_, state.velocity[i].magnitude());
+    }
+
+    // Heaviest first, only as far as the split
+    order_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        order_[i] = static_cast<uint32_t>(i);
+    }
+    const size_t exact = std::min(count, EXACT_SOURCES);
+    auto heavier = [&](uint32_t a, uint32_t b) { return state.mass[a] > state.mass[b]; };
+    if (exact < count) {
+        std::nth_element(order_.begin(), order_.begin() + exact, order_.end(), heavier);
+    }
+    for (size_t k = 0; k < exact; ++k) {
+        const uint32_t i = order_[k];
+        sources_.push_back({static_cast<float>(state.position[i].x), static_cast<float>(state.position[i].y),
+                            static_cast<float>(state.mass[i])});
+    }
+    if (exact == count) {
+        return;
+    }
+
+    // Everything lighter goes into cells over its own bounding box
+    double minX = state.position[order_[exact]].x, maxX = minX;
+    double minY = state.position[order_[exact]].y, maxY = minY;
+    for (size_t k = exact + 1; k < count; ++k) {
+        const Vector3d& p = state.position[order_[k]];
+        minX = std::min(minX, p.x);
+        maxX = std::max(maxX, p.x);
+        minY = std::min(minY, p.y);
+        maxY = std::max(maxY, p.y);
+    }
+    const double scaleX = CELLS_PER_SIDE / std::max(maxX - minX, 1e-9);
+    const double scaleY = CELLS_PER_SIDE / std::max(maxY - minY, 1e-9);
+
+    cells_.assign(CELLS_PER_SIDE * CELLS_PER_SIDE, Cell());
+    for (size_t k = exact; k < count; ++k) {
+        const uint32_t i = order_[k];
+        const Vector3d& p = state.position[i];
+        const size_t cx = std::min(CELLS_PER_SIDE - 1, static_cast<size_t>((p.x - minX) * scaleX));
+        const size_t cy = std::min(CELLS_PER_SIDE - 1, static_cast<size_t>((p.y - minY) * scaleY));
+        Cell& cell = cells_[cy * CELLS_PER_SIDE + cx];
+        const double mass = state.mass[i];
+        cell.mass += mass;
+        cell.mx += mass * p.x;
+        cell.my += mass * p.y;
+    }
+    for (const Cell& cell : cells_) {
+        if (cell.mass > 0.0) {
+            sources_.push_back({static_cast<float>(cell.mx / cell.mass), static_cast<float>(cell.my / cell.mass),
+                                static_cast<float>(cell.mass)});
+        }
+    }
+}
+
+float GravityField::evaluate(const sf::Vector2f& point, float minDistance) const {
+    const float minDistanceSquared = minDistance * minDistance;
+    float total = 0.0f;
+    for (const Source& source : sources_) {
+        const float dx = point.x - source.x;
+        const float dy = point.y - source.y;
+        total += source.mass / std::max(dx * dx + dy * dy, minDistanceSquared);
+    }
+    return total;
+}
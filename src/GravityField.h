@@ -0,0 +1,46 @@
+#pragma once
+#include <SFML/System/Vector2.hpp>
+#include "SolarSystem.h"
+#include "StateSnapshot.h"
+#include <cstddef>
+#include <vector>
+
+/**
+ * Cheap approximation of the sum of m / d^2 over all bodies in the x-y
+ * plane, for visualising the field rather than integrating it.
+ *
+ * The EXACT_SOURCES heaviest bodies are kept as they are; the rest are
+ * binned into a CELLS_PER_SIDE square grid over their bounding box and each
+ * occupied cell is replaced by its total mass at its centre of mass. An
+ * evaluation then costs a few hundred terms however many bodies there are,
+ * and the bodies that dominate the field are still exact.
+ */
+class GravityField {
+public:
+    // Masses and positions come from the snapshot; the live bodies change under a running physics thread
+    void build(const SolarSystem& solarSystem, const StateSnapshot& state);
+
+    // Sum of mass / max(distance, minDistance)^2 in kg per world unit squared
+    float evaluate(const sf::Vector2f& point, float minDistance = 1.0f) const;
+
+    // Fastest body when built, world units per simulated second
+    double getMaxSpeed() const { return maxSpeed_; }
+
+    static constexpr size_t EXACT_SOURCES = 64;
+    static constexpr size_t CELLS_PER_SIDE = 32;
+
+private:
+    struct Source {
+        float x, y;
+        float mass;
+    };
+    std::vector<Source> sources_;     // Heavy bodies, then occupied cells
+
+    struct Cell {
+        double mass = 0.0;
+        double mx = 0.0, my = 0.0;    // Mass-weighted position sums
+    };
+    std::vector<Cell> cells_;
+    std::vector<uint32_t> order_;
+    double maxSpeed_ = 0.0;
+};
@@ -0,0 +1,275 @@
+#include "GravityKernel.h"
+#include <cmath>
+
+#if defined(GRAVITY_KERNEL_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define GRAVITY_KERNEL_NEON 1
+#endif
+
+namespace {
+
+template <bool ThreeD, bool Potential>
+void accumulateRows(const GravityKernel::Sources& s, size_t begin, size_t end, float softening2,
+                    float* ax, float* ay, float* az, float* potential) {
+    const size_t n = s.count;
+
+    for (size_t i = begin; i < end; ++i) {
+        const float xi = s.x[i];
+        const float yi = s.y[i];
+        const float zi = ThreeD ? s.z[i] : 0.0f;
+        const float gmi = s.gm[i];
+        float axi = 0.0f;
+        float ayi = 0.0f;
+        float azi = 0.0f;
+        float phi = 0.0f;
+
+        for (size_t j = i + 1; j < n; ++j) {
+            float dx = s.x[j] - xi;
+            float dy = s.y[j] - yi;
+            float r2 = dx * dx + dy * dy + softening2;
+            float dz = 0.0f;
+            if (ThreeD) {
+                dz = s.z[j] - zi;
+                r2 += dz * dz;
+            }
+
+            float invR = 1.0f / std::sqrt(r2);
+            float invR3 = invR * invR * invR;
+            float si = s.gm[j] * invR3;
+            float sj = gmi * invR3;
+
+            axi += si * dx;
+            ayi += si * dy;
+            ax[j] -= sj * dx;
+            ay[j] -= sj * dy;
+            if (ThreeD) {
+                azi += si * dz;
+                az[j] -= sj * dz;
+            }
+            if (Potential) {
+                phi -= s.gm[j] * invR;
+                potential[j] -= gmi * invR;
+            }
+        }
+
+        ax[i] += axi;
+        ay[i] += ayi;
+        if (ThreeD) {
+            az[i] += azi;
+        }
+        if (Potential) {
+            potential[i] += phi;
+        }
+    }
+}
+
+template <bool ThreeD, bool Potential>
+void accumulateTargets(const GravityKernel::Sources& s, const GravityKernel::Targets& t, float softening2,
+                       float* ax, float* ay, float* az, float* potential) {
+    for (size_t i = 0; i < t.count; ++i) {
+        const float xi = t.x[i];
+        const float yi = t.y[i];
+        const float zi = ThreeD ? t.z[i] : 0.0f;
+        float axi = 0.0f;
+        float ayi = 0.0f;
+        float azi = 0.0f;
+        float phi = 0.0f;
+
+        for (size_t j = 0; j < s.count; ++j) {
+            float dx = s.x[j] - xi;
+            float dy = s.y[j] - yi;
+            float r2 = dx * dx + dy * dy + softening2;
+            float dz = 0.0f;
+            if (ThreeD) {
+                dz = s.z[j] - zi;
+                r2 += dz * dz;
+            }
+
+            float invR = 1.0f / std::sqrt(r2);
+            float si = s.gm[j] * invR * invR * invR;
+            axi += si * dx;
+            ayi += si * dy;
+            if (ThreeD) {
+                azi += si * dz;
+            }
+            // A coincident source is the target itself in tree leaves; it adds no potential either
+            if (Potential && r2 != softening2) {
+                phi -= s.gm[j] * invR;
+            }
+        }
+
+        ax[i] += axi;
+        ay[i] += ayi;
+        if (ThreeD) {
+            az[i] += azi;
+        }
+        if (Potential) {
+            potential[i] += phi;
+        }
+    }
+}
+
+#if defined(GRAVITY_KERNEL_X86) && defined(_MSC_VER)
+bool cpuHasAvx2() {
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma) return false;
+
+    // The OS must save the YMM state
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+
+bool cpuHasAvx512() {
+    if (!cpuHasAvx2()) return false;
+
+    // The OS must also save the opmask and ZMM state
+    if ((_xgetbv(0) & 0xE6) != 0xE6) return false;
+
+    int info[4];
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 16)) != 0;
+}
+#endif
+
+GravityKernel::Isa& activeIsa() {
+    static GravityKernel::Isa isa = GravityKernel::detectIsa();
+    return isa;
+}
+
+} // namespace
+
+void GravityKernel::accumulatePairs(const Sources& sources, size_t begin, size_t end, float softening2,
+                                    float* ax, float* ay, float* az, bool threeD, float* potential) {
+    switch (activeIsa()) {
+#if defined(GRAVITY_KERNEL_X86)
+        case Isa::AVX512:
+            accumulatePairsAVX512(sources, begin, end, softening2, ax, ay, az, threeD, potential);
+            return;
+        case Isa::AVX2:
+            accumulatePairsAVX2(sources, begin, end, softening2, ax, ay, az, threeD, potential);
+            return;
+#endif
+#if defined(GRAVITY_KERNEL_NEON)
+        case Isa::NEON:
+            accumulatePairsNEON(sources, begin, end, softening2, ax, ay, az, threeD, potential);
+            return;
+#endif
+        default:
+            accumulatePairsScalar(sources, begin, end, softening2, ax, ay, az, threeD, potential);
+            return;
+    }
+}
+
+void GravityKernel::accumulatePairsScalar(const Sources& sources, size_t begin, size_t end, float softening2,
+                                          float* ax, float* ay, float* az, bool threeD, float* potential) {
+    if (potential) {
+        if (threeD) {
+            accumulateRows<true, true>(sources, begin, end, softening2, ax, ay, az, potential);
+        } else {
+            accumulateRows<false, true>(sources, begin, end, softening2, ax, ay, az, potential);
+        }
+    } else if (threeD) {
+        accumulateRows<true, false>(sources, begin, end, softening2, ax, ay, az, nullptr);
+    } else {
+        accumulateRows<false, false>(sources, begin, end, softening2, ax, ay, az, nullptr);
+    }
+}
+
+void GravityKernel::accumulateField(const Sources& sources, const Targets& targets, float softening2,
+                                    float* ax, float* ay, float* az, bool threeD, float* potential) {
+    switch (activeIsa()) {
+#if defined(GRAVITY_KERNEL_X86)
+        case Isa::AVX512:
+            accumulateFieldAVX512(sources, targets, softening2, ax, ay, az, threeD, potential);
+            return;
+        case Isa::AVX2:
+            accumulateFieldAVX2(sources, targets, softening2, ax, ay, az, threeD, potential);
+            return;
+#endif
+#if defined(GRAVITY_KERNEL_NEON)
+        case Isa::NEON:
+            accumulateFieldNEON(sources, targets, softening2, ax, ay, az, threeD, potential);
+            return;
+#endif
+        default:
+            accumulateFieldScalar(sources, targets, softening2, ax, ay, az, threeD, potential);
+            return;
+    }
+}
+
+void GravityKernel::accumulateFieldScalar(const Sources& sources, const Targets& targets, float softening2,
+                                          float* ax, float* ay, float* az, bool threeD, float* potential) {
+    if (potential) {
+        if (threeD) {
+            accumulateTargets<true, true>(sources, targets, softening2, ax, ay, az, potential);
+        } else {
+            accumulateTargets<false, true>(sources, targets, softening2, ax, ay, az, potential);
+        }
+    } else if (threeD) {
+        accumulateTargets<true, false>(sources, targets, softening2, ax, ay, az, nullptr);
+    } else {
+        accumulateTargets<false, false>(sources, targets, softening2, ax, ay, az, nullptr);
+    }
+}
+
+GravityKernel::Isa GravityKernel::getIsa() {
+    return activeIsa();
+}
+
+GravityKernel::Isa GravityKernel::detectIsa() {
+    if (isSupported(Isa::AVX512)) return Isa::AVX512;
+    if (isSupported(Isa::AVX2)) return Isa::AVX2;
+    if (isSupported(Isa::NEON)) return Isa::NEON;
+    return Isa::Scalar;
+}
+
+void GravityKernel::setIsa(Isa isa) {
+    activeIsa() = isSupported(isa) ? isa : detectIsa();
+}
+
+bool GravityKernel::isSupported(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar:
+            return true;
+#if defined(GRAVITY_KERNEL_X86) && defined(_MSC_VER)
+        case Isa::AVX2:
+            return cpuHasAvx2();
+        case Isa::AVX512:
+            return cpuHasAvx512();
+#elif defined(GRAVITY_KERNEL_X86)
+        case Isa::AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case Isa::AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f");
+#endif
+#if defined(GRAVITY_KERNEL_NEON)
+        case Isa::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+const char* GravityKernel::getIsaName(Isa isa) {
+    switch (isa) {
+        case Isa::AVX2: return "AVX2";
+        case Isa::AVX512: return "AVX-512";
+        case Isa::NEON: return "NEON";
+        default: return "Scalar";
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * Vectorized pairwise gravity over the packed BodyStore layout.
+ *
+ * Each interaction is Plummer-softened, a_i += gm_j * d / (d^2 + eps^2)^(3/2),
+ * so coincident or very close bodies need no branch or distance clamp. The
+ * instruction set is picked once at startup from what the CPU supports.
+ */
+class GravityKernel {
+public:
+    enum class Isa {
+        Scalar,
+        AVX2,
+        AVX512,
+        NEON
+    };
+
+    // Read-only view of the source arrays (simulation units)
+    struct Sources {
+        const float* x;
+        const float* y;
+        const float* z;   // Ignored for 2D evaluation
+        const float* gm;  // Gravitational parameter G * m per body
+        size_t count;
+    };
+
+    /**
+     * Accumulate accelerations for every pair (i, j) with begin <= i < end and i < j < count.
+     * Both sides are updated (Newton's third law), so ax/ay/az receive contributions at
+     * every index >= begin; callers running rows in parallel need one output block each.
+     * @param softening2 Squared softening length in simulation units
+     * @param threeD When false z is ignored and az is left untouched
+     * @param potential If not null, also accumulates the softened potential -sum gm_j / r
+     *        at each body into it, with the same index pattern as the accelerations
+     */
+    static void accumulatePairs(const Sources& sources, size_t begin, size_t end, float softening2,
+                                float* ax, float* ay, float* az, bool threeD,
+                                float* potential = nullptr);
+
+    // Target positions for one-sided evaluation
+    struct Targets {
+        const float* x;
+        const float* y;
+        const float* z;   // Ignored for 2D evaluation
+        size_t count;
+    };
+
+    /**
+     * Accumulate the acceleration every source exerts on every target, without any
+     * reaction on the sources (tree interaction lists, test particles). A target that
+     * coincides with a source, including itself, receives no contribution from it,
+     * to its potential either.
+     */
+    static void accumulateField(const Sources& sources, const Targets& targets, float softening2,
+                                float* ax, float* ay, float* az, bool threeD,
+                                float* potential = nullptr);
+
+    // Instruction set currently used by the kernels
+    static Isa getIsa();
+
+    // Best instruction set supported by this CPU and build
+    static Isa detectIsa();
+
+    // Force a specific instruction set (e.g. Scalar for validation); falls back if unsupported
+    static void setIsa(Isa isa);
+
+    static const char* getIsaName(Isa isa);
+
+private:
+    static bool isSupported(Isa isa);
+
+    static void accumulatePairsScalar(const Sources& sources, size_t begin, size_t end, float softening2,
+                                      float* ax, float* ay, float* az, bool threeD, float* potential);
+    static void accumulatePairsAVX2(const Sources& sources, size_t begin, size_t end, float softening2,
+                                    float* ax, float* ay, float* az, bool threeD, float* potential);
+    static void accumulatePairsAVX512(const Sources& sources, size_t begin, size_t end, float softening2,
+                                      float* ax, float* ay, float* az, bool threeD, float* potential);
+    static void accumulatePairsNEON(const Sources& sources, size_t begin, size_t end, float softening2,
+                                    float* ax, float* ay, float* az, bool threeD, float* potential);
+
+    static void accumulateFieldScalar(const Sources& sources, const Targets& targets, float softening2,
+                                      float* ax, float* ay, float* az, bool threeD, float* potential);
+    static void accumulateFieldAVX2(const Sources& sources, const Targets& targets, float softening2,
+                                    float* ax, float* ay, float* az, bool threeD, float* potential);
+    static void accumulateFieldAVX512(const Sources& sources, const Targets& targets, float softening2,
+                                      float* ax, float* ay, float* az, bool threeD, float* potential);
+    static void accumulateFieldNEON(const Sources& sources, const Targets& targets, float softening2,
+                                    float* ax, float* ay, float* az, bool threeD, float* potential);
+};
@@ -0,0 +1,236 @@
+// Built with AVX2/FMA code generation; only reached after runtime detection.
+#include "GravityKernel.h"
+
+#if defined(GRAVITY_KERNEL_X86)
+#include <immintrin.h>
+
+namespace {
+
+inline float horizontalSum(__m256 v) {
+    __m128 low = _mm256_castps256_ps128(v);
+    __m128 high = _mm256_extractf128_ps(v, 1);
+    __m128 sum = _mm_add_ps(low, high);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+}
+
+template <bool ThreeD, bool Potential>
+void accumulateRows(const GravityKernel::Sources& s, size_t begin, size_t end, float softening2,
+                    float* ax, float* ay, float* az, float* potential) {
+    const size_t n = s.count;
+    const __m256 eps2 = _mm256_set1_ps(softening2);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 threeHalves = _mm256_set1_ps(1.5f);
+
+    for (size_t i = begin; i < end; ++i) {
+        const __m256 xi = _mm256_set1_ps(s.x[i]);
+        const __m256 yi = _mm256_set1_ps(s.y[i]);
+        const __m256 zi = _mm256_set1_ps(ThreeD ? s.z[i] : 0.0f);
+        const __m256 gmi = _mm256_set1_ps(s.gm[i]);
+        __m256 axi = _mm256_setzero_ps();
+        __m256 ayi = _mm256_setzero_ps();
+        __m256 azi = _mm256_setzero_ps();
+        __m256 phii = _mm256_setzero_ps();
+
+        size_t j = i + 1;
+        for (; j + 8 <= n; j += 8) {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(s.x + j), xi);
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(s.y + j), yi);
+            __m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, eps2));
+            __m256 dz = _mm256_setzero_ps();
+            if (ThreeD) {
+                dz = _mm256_sub_ps(_mm256_loadu_ps(s.z + j), zi);
+                r2 = _mm256_fmadd_ps(dz, dz, r2);
+            }
+
+            // 12-bit rsqrt estimate plus one Newton step: y' = y * (1.5 - 0.5 * r2 * y^2)
+            __m256 invR = _mm256_rsqrt_ps(r2);
+            invR = _mm256_mul_ps(invR, _mm256_fnmadd_ps(_mm256_mul_ps(half, r2),
+                                                        _mm256_mul_ps(invR, invR), threeHalves));
+            __m256 invR3 = _mm256_mul_ps(_mm256_mul_ps(invR, invR), invR);
+
+            const __m256 gmj = _mm256_loadu_ps(s.gm + j);
+            __m256 si = _mm256_mul_ps(gmj, invR3);
+            __m256 sj = _mm256_mul_ps(gmi, invR3);
+
+            axi = _mm256_fmadd_ps(si, dx, axi);
+            ayi = _mm256_fmadd_ps(si, dy, ayi);
+            _mm256_storeu_ps(ax + j, _mm256_fnmadd_ps(sj, dx, _mm256_loadu_ps(ax + j)));
+            _mm256_storeu_ps(ay + j, _mm256_fnmadd_ps(sj, dy, _mm256_loadu_ps(ay + j)));
+            if (ThreeD) {
+                azi = _mm256_fmadd_ps(si, dz, azi);
+                _mm256_storeu_ps(az + j, _mm256_fnmadd_ps(sj, dz, _mm256_loadu_ps(az + j)));
+            }
+            if (Potential) {
+                phii = _mm256_fnmadd_ps(gmj, invR, phii);
+                _mm256_storeu_ps(potential + j, _mm256_fnmadd_ps(gmi, invR, _mm256_loadu_ps(potential + j)));
+            }
+        }
+
+        float axs = horizontalSum(axi);
+        float ays = horizontalSum(ayi);
+        float azs = ThreeD ? horizontalSum(azi) : 0.0f;
+        float phis = Potential ? horizontalSum(phii) : 0.0f;
+
+        // Remainder that does not fill a vector
+        const float xs = s.x[i];
+        const float ys = s.y[i];
+        const float zs = ThreeD ? s.z[i] : 0.0f;
+        for (; j < n; ++j) {
+            float dx = s.x[j] - xs;
+            float dy = s.y[j] - ys;
+            float r2 = dx * dx + dy * dy + softening2;
+            float dz = 0.0f;
+            if (ThreeD) {
+                dz = s.z[j] - zs;
+                r2 += dz * dz;
+            }
+
+            float invR = _mm_cvtss_f32(_mm_div_ss(_mm_set_ss(1.0f), _mm_sqrt_ss(_mm_set_ss(r2))));
+            float invR3 = invR * invR * invR;
+            float si = s.gm[j] * invR3;
+            float sj = s.gm[i] * invR3;
+
+            axs += si * dx;
+            ays += si * dy;
+            ax[j] -= sj * dx;
+            ay[j] -= sj * dy;
+            if (ThreeD) {
+                azs += si * dz;
+                az[j] -= sj * dz;
+            }
+            if (Potential) {
+                phis -= s.gm[j] * invR;
+                potential[j] -= s.gm[i] * invR;
+            }
+        }
+
+        ax[i] += axs;
+        ay[i] += ays;
+        if (ThreeD) {
+            az[i] += azs;
+        }
+        if (Potential) {
+            potential[i] += phis;
+        }
+    }
+}
+
+template <bool ThreeD, bool Potential>
+void accumulateTargets(const GravityKernel::Sources& s, const GravityKernel::Targets& t, float softening2,
+                       float* ax, float* ay, float* az, float* potential) {
+    const __m256 eps2 = _mm256_set1_ps(softening2);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 threeHalves = _mm256_set1_ps(1.5f);
+
+    for (size_t i = 0; i < t.count; ++i) {
+        const __m256 xi = _mm256_set1_ps(t.x[i]);
+        const __m256 yi = _mm256_set1_ps(t.y[i]);
+        const __m256 zi = _mm256_set1_ps(ThreeD ? t.z[i] : 0.0f);
+        __m256 axi = _mm256_setzero_ps();
+        __m256 ayi = _mm256_setzero_ps();
+        __m256 azi = _mm256_setzero_ps();
+        __m256 phii = _mm256_setzero_ps();
+
+        size_t j = 0;
+        for (; j + 8 <= s.count; j += 8) {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(s.x + j), xi);
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(s.y + j), yi);
+            __m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, eps2));
+            __m256 dz = _mm256_setzero_ps();
+            if (ThreeD) {
+                dz = _mm256_sub_ps(_mm256_loadu_ps(s.z + j), zi);
+                r2 = _mm256_fmadd_ps(dz, dz, r2);
+            }
+
+            __m256 invR = _mm256_rsqrt_ps(r2);
+            invR = _mm256_mul_ps(invR, _mm256_fnmadd_ps(_mm256_mul_ps(half, r2),
+                                                        _mm256_mul_ps(invR, invR), threeHalves));
+            __m256 invR3 = _mm256_mul_ps(_mm256_mul_ps(invR, invR), invR);
+            const __m256 gmj = _mm256_loadu_ps(s.gm + j);
+            __m256 si = _mm256_mul_ps(gmj, invR3);
+
+            axi = _mm256_fmadd_ps(si, dx, axi);
+            ayi = _mm256_fmadd_ps(si, dy, ayi);
+            if (ThreeD) {
+                azi = _mm256_fmadd_ps(si, dz, azi);
+            }
+            if (Potential) {
+                // Coincident sources (the target itself) are masked out
+                const __m256 apart = _mm256_cmp_ps(r2, eps2, _CMP_NEQ_OQ);
+                phii = _mm256_fnmadd_ps(_mm256_and_ps(gmj, apart), invR, phii);
+            }
+        }
+
+        float axs = horizontalSum(axi);
+        float ays = horizontalSum(ayi);
+        float azs = ThreeD ? horizontalSum(azi) : 0.0f;
+        float phis = Potential ? horizontalSum(phii) : 0.0f;
+
+        for (; j < s.count; ++j) {
+            float dx = s.x[j] - t.x[i];
+            float dy = s.y[j] - t.y[i];
+            float r2 = dx * dx + dy * dy + softening2;
+            float dz = 0.0f;
+            if (ThreeD) {
+                dz = s.z[j] - t.z[i];
+                r2 += dz * dz;
+            }
+
+            float invR = _mm_cvtss_f32(_mm_div_ss(_mm_set_ss(1.0f), _mm_sqrt_ss(_mm_set_ss(r2))));
+            float si = s.gm[j] * invR * invR * invR;
+            axs += si * dx;
+            ays += si * dy;
+            if (ThreeD) {
+                azs += si * dz;
+            }
+            if (Potential && r2 != softening2) {
+                phis -= s.gm[j] * invR;
+            }
+        }
+
+        ax[i] += axs;
+        ay[i] += ays;
+        if (ThreeD) {
+            az[i] += azs;
+        }
+        if (Potential) {
+            potential[i] += phis;
+        }
+    }
+}
+
+} // namespace
+
+void GravityKernel::accumulatePairsAVX2(const Sources& sources, size_t begin, size_t end, float softening2,
+                                        float* ax, float* ay, float* az, bool threeD, float* potential) {
+    if (potential) {
+        if (threeD) {
+            accumulateRows<true, true>(sources, begin, end, softening2, ax, ay, az, potential);
+        } else {
+            accumulateRows<false, true>(sources, begin, end, softening2, ax, ay, az, potential);
+        }
+    } else if (threeD) {
+        accumulateRows<true, false>(sources, begin, end, softening2, ax, ay, az, nullptr);
+    } else {
+        accumulateRows<false, false>(sources, begin, end, softening2, ax, ay, az, nullptr);
+    }
+}
+
+void GravityKernel::accumulateFieldAVX2(const Sources& sources, const Targets& targets, float softening2,
+                                        float* ax, float* ay, float* az, bool threeD, float* potential) {
+    if (potential) {
+        if (threeD) {
+            accumulateTargets<true, true>(sources, targets, softening2, ax, ay, az, potential);
+        } else {
+            accumulateTargets<false, true>(sources, targets, softening2, ax, ay, az, potential);
+        }
+    } else if (threeD) {
+        accumulateTargets<true, false>(sources, targets, softening2, ax, ay, az, nullptr);
+    } else {
+        accumulateTargets<false, false>(sources, targets, softening2, ax, ay, az, nullptr);
+    }
+}
+
+#endif
@@ -0,0 +1,170 @@
+// Built with AVX-512F code generation; only reached after runtime detection.
+#include "GravityKernel.h"
+
+#if defined(GRAVITY_KERNEL_X86)
+#include <immintrin.h>
+
+namespace {
+
+template <bool ThreeD, bool Potential>
+void accumulateRows(const GravityKernel::Sources& s, size_t begin, size_t end, float softening2,
+                    float* ax, float* ay, float* az, float* potential) {
+    const size_t n = s.count;
+    const __m512 eps2 = _mm512_set1_ps(softening2);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 threeHalves = _mm512_set1_ps(1.5f);
+
+    for (size_t i = begin; i < end; ++i) {
+        const __m512 xi = _mm512_set1_ps(s.x[i]);
+        const __m512 yi = _mm512_set1_ps(s.y[i]);
+        const __m512 zi = _mm512_set1_ps(ThreeD ? s.z[i] : 0.0f);
+        const __m512 gmi = _mm512_set1_ps(s.gm[i]);
+        __m512 axi = _mm512_setzero_ps();
+        __m512 ayi = _mm512_setzero_ps();
+        __m512 azi = _mm512_setzero_ps();
+        __m512 phii = _mm512_setzero_ps();
+
+        for (size_t j = i + 1; j < n; j += 16) {
+            // The last block is masked; inactive lanes load gm = 0 and are never stored
+            const size_t remaining = n - j;
+            const __mmask16 mask = remaining >= 16 ? static_cast<__mmask16>(0xFFFF)
+                                                   : static_cast<__mmask16>((1u << remaining) - 1u);
+
+            __m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, s.x + j), xi);
+            __m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, s.y + j), yi);
+            __m512 r2 = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, eps2));
+            __m512 dz = _mm512_setzero_ps();
+            if (ThreeD) {
+                dz = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, s.z + j), zi);
+                r2 = _mm512_fmadd_ps(dz, dz, r2);
+            }
+
+            // 14-bit rsqrt estimate plus one Newton step
+            __m512 invR = _mm512_rsqrt14_ps(r2);
+            invR = _mm512_mul_ps(invR, _mm512_fnmadd_ps(_mm512_mul_ps(half, r2),
+                                                        _mm512_mul_ps(invR, invR), threeHalves));
+            __m512 invR3 = _mm512_mul_ps(_mm512_mul_ps(invR, invR), invR);
+
+            const __m512 gmj = _mm512_maskz_loadu_ps(mask, s.gm + j);
+            __m512 si = _mm512_mul_ps(gmj, invR3);
+            __m512 sj = _mm512_maskz_mul_ps(mask, gmi, invR3);
+
+            axi = _mm512_fmadd_ps(si, dx, axi);
+            ayi = _mm512_fmadd_ps(si, dy, ayi);
+            _mm512_mask_storeu_ps(ax + j, mask, _mm512_fnmadd_ps(sj, dx, _mm512_maskz_loadu_ps(mask, ax + j)));
+            _mm512_mask_storeu_ps(ay + j, mask, _mm512_fnmadd_ps(sj, dy, _mm512_maskz_loadu_ps(mask, ay + j)));
+            if (ThreeD) {
+                azi = _mm512_fmadd_ps(si, dz, azi);
+                _mm512_mask_storeu_ps(az + j, mask, _mm512_fnmadd_ps(sj, dz, _mm512_maskz_loadu_ps(mask, az + j)));
+            }
+            if (Potential) {
+                phii = _mm512_fnmadd_ps(gmj, invR, phii);
+                _mm512_mask_storeu_ps(potential + j, mask,
+                                      _mm512_fnmadd_ps(gmi, invR, _mm512_maskz_loadu_ps(mask, potential + j)));
+            }
+        }
+
+        ax[i] += _mm512_reduce_add_ps(axi);
+        ay[i] += _mm512_reduce_add_ps(ayi);
+        if (ThreeD) {
+            az[i] += _mm512_reduce_add_ps(azi);
+        }
+        if (Potential) {
+            potential[i] += _mm512_reduce_add_ps(phii);
+        }
+    }
+}
+
+template <bool ThreeD, bool Potential>
+void accumulateTargets(const GravityKernel::Sources& s, const GravityKernel::Targets& t, float softening2,
+                       float* ax, float* ay, float* az, float* potential) {
+    const __m512 eps2 = _mm512_set1_ps(softening2);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 threeHalves = _mm512_set1_ps(1.5f);
+
+    for (size_t i = 0; i < t.count; ++i) {
+        const __m512 xi = _mm512_set1_ps(t.x[i]);
+        const __m512 yi = _mm512_set1_ps(t.y[i]);
+        const __m512 zi = _mm512_set1_ps(ThreeD ? t.z[i] : 0.0f);
+        __m512 axi = _mm512_setzero_ps();
+        __m512 ayi = _mm512_setzero_ps();
+        __m512 azi = _mm512_setzero_ps();
+        __m512 phii = _mm512_setzero_ps();
+
+        for (size_t j = 0; j < s.count; j += 16) {
+            const size_t remaining = s.count - j;
+            const __mmask16 mask = remaining >= 16 ? static_cast<__mmask16>(0xFFFF)
+                                                   : static_cast<__mmask16>((1u << remaining) - 1u);
+
+            __m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, s.x + j), xi);
+            __m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, s.y + j), yi);
+            __m512 r2 = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, eps2));
+            __m512 dz = _mm512_setzero_ps();
+            if (ThreeD) {
+                dz = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, s.z + j), zi);
+                r2 = _mm512_fmadd_ps(dz, dz, r2);
+            }
+
+            __m512 invR = _mm512_rsqrt14_ps(r2);
+            invR = _mm512_mul_ps(invR, _mm512_fnmadd_ps(_mm512_mul_ps(half, r2),
+                                                        _mm512_mul_ps(invR, invR), threeHalves));
+            __m512 invR3 = _mm512_mul_ps(_mm512_mul_ps(invR, invR), invR);
+            const __m512 gmj = _mm512_maskz_loadu_ps(mask, s.gm + j);
+            __m512 si = _mm512_mul_ps(gmj, invR3);
+
+            axi = _mm512_fmadd_ps(si, dx, axi);
+            ayi = _mm512_fmadd_ps(si, dy, ayi);
+            if (ThreeD) {
+                azi = _mm512_fmadd_ps(si, dz, azi);
+            }
+            if (Potential) {
+                // Coincident sources (the target itself) are masked out
+                const __mmask16 apart = _mm512_cmp_ps_mask(r2, eps2, _CMP_NEQ_OQ);
+                phii = _mm512_mask3_fnmadd_ps(gmj, invR, phii, apart);
+            }
+        }
+
+        ax[i] += _mm512_reduce_add_ps(axi);
+        ay[i] += _mm512_reduce_add_ps(ayi);
+        if (ThreeD) {
+            az[i] += _mm512_reduce_add_ps(azi);
+        }
+        if (Potential) {
+            potential[i] += _mm512_reduce_add_ps(phii);
+        }
+    }
+}
+
+} // namespace
+
+void GravityKernel::accumulatePairsAVX512(const Sources& sources, size_t begin, size_t end, float softening2,
+                                          float* ax, float* ay, float* az, bool threeD, float* potential) {
+    if (potential) {
+        if (threeD) {
+            accumulateRows<true, true>(sources, begin, end, softening2, ax, ay, az, potential);
+        } else {
+            accumulateRows<false, true>(sources, begin, end, softening2, ax, ay, az, potential);
+        }
+    } else if (threeD) {
+        accumulateRows<true, false>(sources, begin, end, softening2, ax, ay, az, nullptr);
+    } else {
+        accumulateRows<false, false>(sources, begin, end, softening2, ax, ay, az, nullptr);
+    }
+}
+
+void GravityKernel::accumulateFieldAVX512(const Sources& sources, const Targets& targets, float softening2,
+                                          float* ax, float* ay, float* az, bool threeD, float* potential) {
+    if (potential) {
+        if (threeD) {
+            accumulateTargets<true, true>(sources, targets, softening2, ax, ay, az, potential);
+        } else {
+            accumulateTargets<false, true>(sources, targets, softening2, ax, ay, az, potential);
+        }
+    } else if (threeD) {
+        accumulateTargets<true, false>(sources, targets, softening2, ax, ay, az, nullptr);
+    } else {
+        accumulateTargets<false, false>(sources, targets, softening2, ax, ay, az, nullptr);
+    }
+}
+
+#endif
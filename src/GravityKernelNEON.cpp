@@ -0,0 +1,222 @@
+// NEON is part of the AArch64 baseline, so this needs no special build flags.
+#include "GravityKernel.h"
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#include <cmath>
+
+namespace {
+
+template <bool ThreeD, bool Potential>
+void accumulateRows(const GravityKernel::Sources& s, size_t begin, size_t end, float softening2,
+                    float* ax, float* ay, float* az, float* potential) {
+    const size_t n = s.count;
+    const float32x4_t eps2 = vdupq_n_f32(softening2);
+
+    for (size_t i = begin; i < end; ++i) {
+        const float32x4_t xi = vdupq_n_f32(s.x[i]);
+        const float32x4_t yi = vdupq_n_f32(s.y[i]);
+        const float32x4_t zi = vdupq_n_f32(ThreeD ? s.z[i] : 0.0f);
+        const float32x4_t gmi = vdupq_n_f32(s.gm[i]);
+        float32x4_t axi = vdupq_n_f32(0.0f);
+        float32x4_t ayi = vdupq_n_f32(0.0f);
+        float32x4_t azi = vdupq_n_f32(0.0f);
+        float32x4_t phii = vdupq_n_f32(0.0f);
+
+        size_t j = i + 1;
+        for (; j + 4 <= n; j += 4) {
+            float32x4_t dx = vsubq_f32(vld1q_f32(s.x + j), xi);
+            float32x4_t dy = vsubq_f32(vld1q_f32(s.y + j), yi);
+            float32x4_t r2 = vfmaq_f32(vfmaq_f32(eps2, dy, dy), dx, dx);
+            float32x4_t dz = vdupq_n_f32(0.0f);
+            if (ThreeD) {
+                dz = vsubq_f32(vld1q_f32(s.z + j), zi);
+                r2 = vfmaq_f32(r2, dz, dz);
+            }
+
+            // 8-bit rsqrt estimate refined by two Newton steps
+            float32x4_t invR = vrsqrteq_f32(r2);
+            invR = vmulq_f32(invR, vrsqrtsq_f32(vmulq_f32(r2, invR), invR));
+            invR = vmulq_f32(invR, vrsqrtsq_f32(vmulq_f32(r2, invR), invR));
+            float32x4_t invR3 = vmulq_f32(vmulq_f32(invR, invR), invR);
+
+            const float32x4_t gmj = vld1q_f32(s.gm + j);
+            float32x4_t si = vmulq_f32(gmj, invR3);
+            float32x4_t sj = vmulq_f32(gmi, invR3);
+
+            axi = vfmaq_f32(axi, si, dx);
+            ayi = vfmaq_f32(ayi, si, dy);
+            vst1q_f32(ax + j, vfmsq_f32(vld1q_f32(ax + j), sj, dx));
+            vst1q_f32(ay + j, vfmsq_f32(vld1q_f32(ay + j), sj, dy));
+            if (ThreeD) {
+                azi = vfmaq_f32(azi, si, dz);
+                vst1q_f32(az + j, vfmsq_f32(vld1q_f32(az + j), sj, dz));
+            }
+            if (Potential) {
+                phii = vfmsq_f32(phii, gmj, invR);
+                vst1q_f32(potential + j, vfmsq_f32(vld1q_f32(potential + j), gmi, invR));
+            }
+        }
+
+        float axs = vaddvq_f32(axi);
+        float ays = vaddvq_f32(ayi);
+        float azs = ThreeD ? vaddvq_f32(azi) : 0.0f;
+        float phis = Potential ? vaddvq_f32(phii) : 0.0f;
+
+        // Remainder that does not fill a vector
+        for (; j < n; ++j) {
+            float dx = s.x[j] - s.x[i];
+            float dy = s.y[j] - s.y[i];
+            float r2 = dx * dx + dy * dy + softening2;
+            float dz = 0.0f;
+            if (ThreeD) {
+                dz = s.z[j] - s.z[i];
+                r2 += dz * dz;
+            }
+
+            float invR = 1.0f / std::sqrt(r2);
+            float invR3 = invR * invR * invR;
+            float si = s.gm[j] * invR3;
+            float sj = s.gm[i] * invR3;
+
+            axs += si * dx;
+            ays += si * dy;
+            ax[j] -= sj * dx;
+            ay[j] -= sj * dy;
+            if (ThreeD) {
+                azs += si * dz;
+                az[j] -= sj * dz;
+            }
+            if (Potential) {
+                phis -= s.gm[j] * invR;
+                potential[j] -= s.gm[i] * invR;
+            }
+        }
+
+        ax[i] += axs;
+        ay[i] += ays;
+        if (ThreeD) {
+            az[i] += azs;
+        }
+        if (Potential) {
+            potential[i] += phis;
+        }
+    }
+}
+
+template <bool ThreeD, bool Potential>
+void accumulateTargets(const GravityKernel::Sources& s, const GravityKernel::Targets& t, float softening2,
+                       float* ax, float* ay, float* az, float* potential) {
+    const float32x4_t eps2 = vdupq_n_f32(softening2);
+
+    for (size_t i = 0; i < t.count; ++i) {
+        const float32x4_t xi = vdupq_n_f32(t.x[i]);
+        const float32x4_t yi = vdupq_n_f32(t.y[i]);
+        const float32x4_t zi = vdupq_n_f32(ThreeD ? t.z[i] : 0.0f);
+        float32x4_t axi = vdupq_n_f32(0.0f);
+        float32x4_t ayi = vdupq_n_f32(0.0f);
+        float32x4_t azi = vdupq_n_f32(0.0f);
+        float32x4_t phii = vdupq_n_f32(0.0f);
+
+        size_t j = 0;
+        for (; j + 4 <= s.count; j += 4) {
+            float32x4_t dx = vsubq_f32(vld1q_f32(s.x + j), xi);
+            float32x4_t dy = vsubq_f32(vld1q_f32(s.y + j), yi);
+            float32x4_t r2 = vfmaq_f32(vfmaq_f32(eps2, dy, dy), dx, dx);
+            float32x4_t dz = vdupq_n_f32(0.0f);
+            if (ThreeD) {
+                dz = vsubq_f32(vld1q_f32(s.z + j), zi);
+                r2 = vfmaq_f32(r2, dz, dz);
+            }
+
+            float32x4_t invR = vrsqrteq_f32(r2);
+            invR = vmulq_f32(invR, vrsqrtsq_f32(vmulq_f32(r2, invR), invR));
+            invR = vmulq_f32(invR, vrsqrtsq_f32(vmulq_f32(r2, invR), invR));
+            float32x4_t invR3 = vmulq_f32(vmulq_f32(invR, invR), invR);
+            const float32x4_t gmj = vld1q_f32(s.gm + j);
+            float32x4_t si = vmulq_f32(gmj, invR3);
+
+            axi = vfmaq_f32(axi, si, dx);
+            ayi = vfmaq_f32(ayi, si, dy);
+            if (ThreeD) {
+                azi = vfmaq_f32(azi, si, dz);
+            }
+            if (Potential) {
+                // Coincident sources (the target itself) are masked out
+                const uint32x4_t same = vceqq_f32(r2, eps2);
+                const float32x4_t gmApart = vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(gmj), same));
+                phii = vfmsq_f32(phii, gmApart, invR);
+            }
+        }
+
+        float axs = vaddvq_f32(axi);
+        float ays = vaddvq_f32(ayi);
+        float azs = ThreeD ? vaddvq_f32(azi) : 0.0f;
+        float phis = Potential ? vaddvq_f32(phii) : 0.0f;
+
+        for (; j < s.count; ++j) {
+            float dx = s.x[j] - t.x[i];
+            float dy = s.y[j] - t.y[i];
+            float r2 = dx * dx + dy * dy + softening2;
+            float dz = 0.0f;
+            if (ThreeD) {
+                dz = s.z[j] - t.z[i];
+                r2 += dz * dz;
+            }
+
+            float invR = 1.0f / std::sqrt(r2);
+            float si = s.gm[j] * invR * invR * invR;
+            axs += si * dx;
+            ays += si * dy;
+            if (ThreeD) {
+                azs += si * dz;
+            }
+            if (Potential && r2 != softening2) {
+                phis -= s.gm[j] * invR;
+            }
+        }
+
+        ax[i] += axs;
+        ay[i] += ays;
+        if (ThreeD) {
+            az[i] += azs;
+        }
+        if (Potential) {
+            potential[i] += phis;
+        }
+    }
+}
+
+} // namespace
+
+void GravityKernel::accumulatePairsNEON(const Sources& sources, size_t begin, size_t end, float softening2,
+                                        float* ax, float* ay, float* az, bool threeD, float* potential) {
+    if (potential) {
+        if (threeD) {
+            accumulateRows<true, true>(sources, begin, end, softening2, ax, ay, az, potential);
+        } else {
+            accumulateRows<false, true>(sources, begin, end, softening2, ax, ay, az, potential);
+        }
+    } else if (threeD) {
+        accumulateRows<true, false>(sources, begin, end, softening2, ax, ay, az, nullptr);
+    } else {
+        accumulateRows<false, false>(sources, begin, end, softening2, ax, ay, az, nullptr);
+    }
+}
+
+void GravityKernel::accumulateFieldNEON(const Sources& sources, const Targets& targets, float softening2,
+                                        float* ax, float* ay, float* az, bool threeD, float* potential) {
+    if (potential) {
+        if (threeD) {
+            accumulateTargets<true, true>(sources, targets, softening2, ax, ay, az, potential);
+        } else {
+            accumulateTargets<false, true>(sources, targets, softening2, ax, ay, az, potential);
+        }
+    } else if (threeD) {
+        accumulateTargets<true, false>(sources, targets, softening2, ax, ay, az, nullptr);
+    } else {
+        accumulateTargets<false, false>(sources, targets, softening2, ax, ay, az, nullptr);
+    }
+}
+
+#endif
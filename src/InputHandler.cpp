@@ -1,8 +1,18 @@
 #include "InputHandler.h"
+#include "BarnesHutSolver.h"
+#include "DirectSolver.h"
+#include "FmmSolver.h"
+#include "SymplecticIntegrators.h"
+#include "DormandPrinceIntegrator.h"
+#include "BlockTimestepIntegrator.h"
+#include "GpuBackend.h"
+#include "Checkpoint.h"
+#include "Physics.h"
+#include "Profiler.h"
 #include <iostream>
 
 InputHandler::InputHandler(sf::RenderWindow& window, SolarSystem& solarSystem, Renderer& renderer)
-    : window_(window), solarSystem_(solarSystem), renderer_(renderer), shouldExit_(false),
+    : window_(window), solarSystem_(solarSystem), renderer_(renderer), gpu_(nullptr), shouldExit_(false),
       mousePressed_(false), dragging_(false), cameraSpeed_(100.0f), zoomSpeed_(2.0f),
       zoomStep_(0.1f), timeScaleStep_(0.5f) {
 }
@@ -39,6 +49,10 @@ void InputHandler::handleEvents() {
                 handleMouseWheelScrolled(event);
                 break;
 
+            case sf::Event::MouseLeft:
+                renderer_.clearPointer();
+                break;
+
             case sf::Event::Resized:
                 handleWindowResized(event);
                 break;
@@ -69,8 +83,53 @@ void InputHandler::handleKeyPressed(const sf::Event& event) {
 
         case sf::Keyboard::R:
             solarSystem_.reset();
+            if (gpu_ && gpu_->isActive()) {
+                gpu_->upload(solarSystem_);
+            }
+            break;
+
+        case sf::Keyboard::F5:
+        case sf::Keyboard::F9: {
+            // Quick save / load; the GPU state is brought back first so the file is current
+            const char* path = "checkpoint.gsc";
+            std::string error;
+            if (gpu_ && gpu_->isActive()) {
+                gpu_->download(solarSystem_);
+            }
+            const bool save = event.key.code == sf::Keyboard::F5;
+            const bool ok = save ? Checkpoint::save(solarSystem_, path, error) : Checkpoint::load(solarSystem_, path, error);
+            if (ok) {
+                std::cout << (save ? "Saved " : "Loaded ") << path << std::endl;
+                if (!save) {
+                    renderer_.clearTrails();
+                }
+            } else {
+                std::cout << "Checkpoint failed: " << error << std::endl;
+            }
+            if (gpu_ && gpu_->isActive()) {
+                gpu_->upload(solarSystem_);
+            }
+            break;
+        }
+
+        case sf::Keyboard::F3:
+            // Recording only runs while the overlay is up, so it costs nothing otherwise
+            renderer_.setShowProfiler(!renderer_.getShowProfiler());
+            Profiler::setEnabled(renderer_.getShowProfiler());
+            std::cout << "Profiler " << (renderer_.getShowProfiler() ? "on" : "off") << std::endl;
             break;
 
+        case sf::Keyboard::F4: {
+            const char* path = "profile.json";
+            std::string error;
+            if (Profiler::writeChromeTrace(path, error)) {
+                std::cout << "Wrote the last few seconds of profile to " << path << std::endl;
+            } else {
+                std::cout << "Profile export failed: " << error << std::endl;
+            }
+            break;
+        }
+
         case sf::Keyboard::T:
             renderer_.setShowTrails(!renderer_.getShowTrails());
             if (!renderer_.getShowTrails()) {
@@ -91,8 +150,14 @@ void InputHandler::handleKeyPressed(const sf::Event& event) {
             break;
 
         case sf::Keyboard::M:
-            // Toggle 3D mode
-            solarSystem_.set3DMode(!solarSystem_.is3DMode());
+            // Toggle 3D mode; the GPU state round-trips so the switch sees current positions
+            if (gpu_ && gpu_->isActive()) {
+                gpu_->download(solarSystem_);
+                solarSystem_.set3DMode(!solarSystem_.is3DMode());
+                gpu_->upload(solarSystem_);
+            } else {
+                solarSystem_.set3DMode(!solarSystem_.is3DMode());
+            }
             std::cout << (solarSystem_.is3DMode() ? "Switched to 3D mode" : "Switched to 2D mode") << std::endl;
             break;
 
@@ -104,6 +169,53 @@ void InputHandler::handleKeyPressed(const sf::Event& event) {
                 "Spacetime warping visualization disabled") << std::endl;
             break;
 
+        case sf::Keyboard::B:
+            // Cycle direct -> Barnes-Hut -> FMM force evaluation
+            if (dynamic_cast<BarnesHutSolver*>(&solarSystem_.getForceSolver())) {
+                solarSystem_.setForceSolver(std::make_unique<FmmSolver>());
+            } else if (dynamic_cast<FmmSolver*>(&solarSystem_.getForceSolver())) {
+                solarSystem_.setForceSolver(std::make_unique<DirectSolver>());
+            } else {
+                solarSystem_.setForceSolver(std::make_unique<BarnesHutSolver>());
+            }
+            std::cout << "Force solver: " << solarSystem_.getForceSolver().getName() << std::endl;
+            break;
+
+        case sf::Keyboard::LBracket:
+        case sf::Keyboard::RBracket:
+            // Narrow / widen the Barnes-Hut opening angle
+            if (auto* tree = dynamic_cast<BarnesHutSolver*>(&solarSystem_.getForceSolver())) {
+                tree->setTheta(tree->getTheta() + (event.key.code == sf::Keyboard::RBracket ? 0.1f : -0.1f));
+                std::cout << "Barnes-Hut theta: " << tree->getTheta() << std::endl;
+            }
+            break;
+
+        case sf::Keyboard::N:
+            // Cycle Euler -> leapfrog -> Yoshida-4 -> RK45 -> block leapfrog time integration
+            if (dynamic_cast<DormandPrinceIntegrator*>(&solarSystem_.getIntegrator())) {
+                solarSystem_.setIntegrator(std::make_unique<BlockTimestepIntegrator>());
+            } else if (dynamic_cast<YoshidaIntegrator*>(&solarSystem_.getIntegrator())) {
+                solarSystem_.setIntegrator(std::make_unique<DormandPrinceIntegrator>());
+            } else if (dynamic_cast<LeapfrogIntegrator*>(&solarSystem_.getIntegrator())) {
+                solarSystem_.setIntegrator(std::make_unique<YoshidaIntegrator>());
+            } else if (dynamic_cast<EulerIntegrator*>(&solarSystem_.getIntegrator())) {
+                solarSystem_.setIntegrator(std::make_unique<LeapfrogIntegrator>());
+            } else {
+                solarSystem_.setIntegrator(std::make_unique<EulerIntegrator>());
+            }
+            std::cout << "Integrator: " << solarSystem_.getIntegrator().getName() << std::endl;
+            break;
+
+        case sf::Keyboard::U:
+            toggleGpuBackend();
+            break;
+
+        case sf::Keyboard::P:
+            // Merge bodies whose spheres touch during a step
+            solarSystem_.setCollisions(!solarSystem_.getCollisions());
+            std::cout << (solarSystem_.getCollisions() ? "Collisions enabled" : "Collisions disabled") << std::endl;
+            break;
+
         // Camera movement
         case sf::Keyboard::W:
         case sf::Keyboard::Up:
@@ -267,12 +379,17 @@ void InputHandler::handleMousePressed(const sf::Event& event) {
 
 void InputHandler::handleMouseReleased(const sf::Event& event) {
     if (event.mouseButton.button == sf::Mouse::Left) {
+        // A click that did not pan selects the body under the pointer
+        if (!dragging_) {
+            printBodyInfo(renderer_.getHoveredBody());
+        }
         mousePressed_ = false;
         dragging_ = false;
     }
 }
 
 void InputHandler::handleMouseMoved(const sf::Event& event) {
+    renderer_.setPointer(sf::Vector2i(event.mouseMove.x, event.mouseMove.y));
     if (mousePressed_) {
         sf::Vector2i currentMousePos(event.mouseMove.x, event.mouseMove.y);
         sf::Vector2i mouseDelta = lastMousePos_ - currentMousePos;
@@ -361,6 +478,42 @@ void InputHandler::centerOnSun() {
     }
 }
 
+void InputHandler::printBodyInfo(size_t index) {
+    const CelestialBody* body = solarSystem_.getBody(index);
+    if (!body) {
+        return;
+    }
+    const Vector3d velocity = body->getPreciseVelocity() * (1.0 / Physics::DISTANCE_SCALE);
+    std::cout << (body->getName().empty() ? "Body #" + std::to_string(index) : body->getName())
+              << ": mass " << body->getMass() << " kg, speed " << velocity.magnitude() / 1000.0 << " km/s";
+    const CelestialBody* central = solarSystem_.getCentralBody();
+    if (central && central != body) {
+        std::cout << ", " << body->distanceTo(*central) / Physics::DISTANCE_SCALE / Physics::AU << " AU from "
+                  << central->getName();
+    }
+    std::cout << std::endl;
+}
+
+void InputHandler::toggleGpuBackend() {
+    if (!gpu_ || !gpu_->isAvailable()) {
+        std::cout << "GPU backend unavailable";
+        if (gpu_ && !gpu_->getError().empty()) {
+            std::cout << ": " << gpu_->getError();
+        }
+        std::cout << std::endl;
+        return;
+    }
+
+    if (gpu_->isActive()) {
+        gpu_->download(solarSystem_);
+        renderer_.clearTrails();
+        std::cout << "Simulating on the CPU" << std::endl;
+    } else {
+        gpu_->upload(solarSystem_);
+        std::cout << "Simulating on the GPU (" << gpu_->getBodyCount() << " bodies)" << std::endl;
+    }
+}
+
 void InputHandler::showHelpMessage() {
     std::cout << "\n=== Solar System Gravity Simulator Help ===\n";
     std::cout << "Camera Controls:\n";
@@ -379,7 +532,13 @@ void InputHandler::showHelpMessage() {
     std::cout << "Simulation Controls:\n";
     std::cout << "  Space: Pause/Resume simulation\n";
     std::cout << "  R: Reset to initial conditions\n";
-    std::cout << "  +/-: Increase/Decrease time scale\n\n";
+    std::cout << "  +/-: Increase/Decrease time scale\n";
+    std::cout << "  B: Cycle force solver (direct / Barnes-Hut / FMM)\n";
+    std::cout << "  [/]: Narrow/widen the Barnes-Hut opening angle\n";
+    std::cout << "  N: Cycle integrator (Euler / leapfrog / Yoshida-4 / RK45 / block)\n";
+    std::cout << "  U: Toggle GPU compute backend\n";
+    std::cout << "  P: Toggle collisions (merge touching bodies)\n";
+    std::cout << "  F5/F9: Save/load checkpoint.gsc\n\n";
 
     std::cout << "Visual Options:\n";
     std::cout << "  T: Toggle orbital trails\n";
@@ -390,6 +549,8 @@ void InputHandler::showHelpMessage() {
     std::cout << "  X: Toggle spacetime warping visualization\n\n";
 
     std::cout << "Other:\n";
+    std::cout << "  F3: Toggle the frame profiler overlay\n";
+    std::cout << "  F4: Write the recorded profile to profile.json (Chrome trace)\n";
     std::cout << "  H: Show this help\n";
     std::cout << "  ESC: Exit simulation\n";
     std::cout << "=========================================\n\n";
@@ -3,6 +3,8 @@
 #include "SolarSystem.h"
 #include "Renderer.h"
 
+class GpuBackend;
+
 /**
  * Handles user input for controlling the simulation
  */
@@ -20,6 +22,9 @@ public:
     // Check if user wants to exit
     bool shouldExit() const { return shouldExit_; }
 
+    // Enables the U toggle; the backend must outlive the handler
+    void setGpuBackend(GpuBackend* gpu) { gpu_ = gpu; }
+
     // Helper methods
     void showHelpMessage();
 
@@ -27,6 +32,7 @@ private:
     sf::RenderWindow& window_;
     SolarSystem& solarSystem_;
     Renderer& renderer_;
+    GpuBackend* gpu_;
     bool shouldExit_;
 
     // Input state
@@ -78,4 +84,6 @@ private:
     void toggleVisualOption(const std::string& option);
     void resetCamera();
     void centerOnSun();
+    void toggleGpuBackend();
+    void printBodyInfo(size_t index);
 };
@@ -0,0 +1,59 @@
+#include "Integrator.h"
+
+namespace {
+
+// The mode is fixed per instantiation, so the 2D loops neither branch per body nor touch z
+template <bool ThreeD>
+void kickRange(BodyStore& s, size_t begin, size_t end, double h) {
+    for (size_t i = begin; i < end; ++i) {
+        s.vx[i] += s.ax[i] * h;
+        s.vy[i] += s.ay[i] * h;
+        if (ThreeD) {
+            s.vz[i] += s.az[i] * h;
+        }
+    }
+}
+
+template <bool ThreeD>
+void driftRange(BodyStore& s, size_t begin, size_t end, double h) {
+    for (size_t i = begin; i < end; ++i) {
+        s.x[i] += s.vx[i] * h;
+        s.y[i] += s.vy[i] * h;
+        if (ThreeD) {
+            s.z[i] += s.vz[i] * h;
+        }
+    }
+}
+
+} // namespace
+
+void Integrator::ensureAccelerations(Context& context) {
+    if (accelerationsValid_ && validCount_ == context.store.size()) {
+        return;
+    }
+    context.evaluate();
+    markAccelerationsValid(context);
+}
+
+void Integrator::markAccelerationsValid(const Context& context) {
+    accelerationsValid_ = true;
+    validCount_ = context.store.size();
+}
+
+void Integrator::kick(Context& context, double h) {
+    BodyStore& s = context.store;
+    if (context.threeD) {
+        context.forEachBody([&](size_t begin, size_t end) { kickRange<true>(s, begin, end, h); });
+    } else {
+        context.forEachBody([&](size_t begin, size_t end) { kickRange<false>(s, begin, end, h); });
+    }
+}
+
+void Integrator::drift(Context& context, double h) {
+    BodyStore& s = context.store;
+    if (context.threeD) {
+        context.forEachBody([&](size_t begin, size_t end) { driftRange<true>(s, begin, end, h); });
+    } else {
+        context.forEachBody([&](size_t begin, size_t end) { driftRange<false>(s, begin, end, h); });
+    }
+}
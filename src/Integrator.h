@@ -0,0 +1,72 @@
+#pragma once
+#include "BodyStore.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * Strategy for advancing the packed body state in time.
+ * SolarSystem owns one integrator and calls step() once per frame with the
+ * time-scaled frame interval; the integrator decides how many force
+ * evaluations that takes.
+ *
+ * The accelerations left in the store after a step belong to the final
+ * positions, so the next step can reuse them as its first evaluation. Code
+ * that edits positions behind the integrator's back must call invalidate().
+ */
+class Integrator {
+public:
+    // Hooks into the owning system
+    struct Context {
+        BodyStore& store;
+        bool threeD;
+        // Overwrite store.ax/ay/az with the accelerations at the current positions
+        std::function<void()> evaluate;
+        // Overwrite the accelerations of the listed bodies only, from all current positions
+        std::function<void(const std::vector<uint32_t>& targets)> evaluateSubset;
+        // Run a task over [0, N), split across the worker pool when worthwhile
+        std::function<void(const ThreadPool::RangeTask&)> forEachBody;
+    };
+
+    virtual ~Integrator() = default;
+
+    // Short human-readable name for UI and logs
+    virtual const char* getName() const = 0;
+
+    // Advance positions and velocities by dt simulated seconds; returns the seconds actually
+    // covered, which falls short of dt only when an adaptive scheme gives up part way
+    virtual double step(Context& context, double dt) = 0;
+
+    // The accelerations in the store no longer match the positions
+    void invalidate() { accelerationsValid_ = false; }
+
+    // Whether the last step left accelerations for the final positions of store's bodies
+    bool hasValidAccelerations(const BodyStore& store) const {
+        return accelerationsValid_ && validCount_ == store.size();
+    }
+
+    // State the scheme carries from one step to the next, for checkpoints; none by default
+    virtual void saveState(std::vector<uint8_t>& out) const { (void)out; }
+    // Restore what saveState() wrote for a system of bodyCount bodies; false if it does not fit
+    virtual bool loadState(const uint8_t* data, size_t size, size_t bodyCount) {
+        (void)data;
+        (void)bodyCount;
+        return size == 0;
+    }
+
+protected:
+    // Evaluate unless the store still holds accelerations for the current positions
+    void ensureAccelerations(Context& context);
+    // Mark the store's accelerations as up to date after an evaluation
+    void markAccelerationsValid(const Context& context);
+
+    // v += a * h
+    static void kick(Context& context, double h);
+    // x += v * h
+    static void drift(Context& context, double h);
+
+private:
+    bool accelerationsValid_ = false;
+    size_t validCount_ = 0;
+};
@@ -0,0 +1,75 @@
+#include "MortonOrder.h"
+#include <algorithm>
+
+namespace {
+
+// Spread the low 21 bits of v so there are two zero bits between each
+uint64_t spreadBy2(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+// Spread the 32 bits of v so there is a zero bit between each
+uint64_t spreadBy1(uint64_t v) {
+    v &= 0xffffffff;
+    v = (v | v << 16) & 0x0000ffff0000ffffULL;
+    v = (v | v << 8) & 0x00ff00ff00ff00ffULL;
+    v = (v | v << 4) & 0x0f0f0f0f0f0f0f0fULL;
+    v = (v | v << 2) & 0x3333333333333333ULL;
+    v = (v | v << 1) & 0x5555555555555555ULL;
+    return v;
+}
+
+} // namespace
+
+uint64_t MortonOrder::encode(uint32_t x, uint32_t y, uint32_t z, bool threeD) {
+    if (threeD) {
+        return spreadBy2(x) | spreadBy2(y) << 1 | spreadBy2(z) << 2;
+    }
+    return spreadBy1(x) | spreadBy1(y) << 1;
+}
+
+const std::vector<uint32_t>& MortonOrder::sort(const float* x, const float* y, const float* z, size_t n,
+                                               bool threeD) {
+    keyed_.resize(n);
+    order_.resize(n);
+    if (n == 0) {
+        return order_;
+    }
+
+    float minX = x[0], maxX = x[0], minY = y[0], maxY = y[0], minZ = 0.0f, maxZ = 0.0f;
+    if (threeD) {
+        minZ = maxZ = z[0];
+    }
+    for (size_t i = 1; i < n; ++i) {
+        minX = std::min(minX, x[i]);
+        maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]);
+        maxY = std::max(maxY, y[i]);
+        if (threeD) {
+            minZ = std::min(minZ, z[i]);
+            maxZ = std::max(maxZ, z[i]);
+        }
+    }
+
+    // One cube over all axes, so the curve's cells stay square
+    const double extent = std::max({double(maxX) - minX, double(maxY) - minY, double(maxZ) - minZ});
+    const double cells = threeD ? double(1u << 21) : 4294967296.0;
+    const double scale = extent > 0.0 ? (cells - 1.0) / extent : 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        const uint32_t cx = static_cast<uint32_t>((x[i] - double(minX)) * scale);
+        const uint32_t cy = static_cast<uint32_t>((y[i] - double(minY)) * scale);
+        const uint32_t cz = threeD ? static_cast<uint32_t>((z[i] - double(minZ)) * scale) : 0;
+        keyed_[i] = {encode(cx, cy, cz, threeD), static_cast<uint32_t>(i)};
+    }
+    std::sort(keyed_.begin(), keyed_.end());
+    for (size_t i = 0; i < n; ++i) {
+        order_[i] = keyed_[i].second;
+    }
+    return order_;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * Orders points along a Morton (Z-order) curve over their bounding box, so any
+ * contiguous run of the result is compact in space. DistributedSolver cuts its
+ * bodies into per-process runs this way, which keeps each process's targets in
+ * few tree leaves. Keys interleave 21 bits per axis in 3D and 32 in 2D.
+ */
+class MortonOrder {
+public:
+    // Indices of the n points sorted along the curve; valid until the next call
+    const std::vector<uint32_t>& sort(const float* x, const float* y, const float* z, size_t n, bool threeD);
+
+    // Interleave cell coordinates below 2^21 (3D) or 2^32 (2D) into a curve key
+    static uint64_t encode(uint32_t x, uint32_t y, uint32_t z, bool threeD);
+
+private:
+    std::vector<std::pair<uint64_t, uint32_t>> keyed_;
+    std::vector<uint32_t> order_;
+};
@@ -0,0 +1,143 @@
+#include "ParticleDomain.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Values sent per particle when it moves: position, velocity, parent and colour
+constexpr size_t MIGRATED_VALUES = 8;
+
+double packColor(const Color& c) {
+    return static_cast<double>(uint32_t(c.r) << 24 | uint32_t(c.g) << 16 | uint32_t(c.b) << 8 | uint32_t(c.a));
+}
+
+Color unpackColor(double value) {
+    const uint32_t c = static_cast<uint32_t>(value);
+    return Color(uint8_t(c >> 24), uint8_t(c >> 16), uint8_t(c >> 8), uint8_t(c));
+}
+
+} // namespace
+
+ParticleDomain::ParticleDomain(Communicator& communicator, uint64_t total) : communicator_(communicator) {
+    const uint64_t size = static_cast<uint64_t>(communicator_.getSize());
+    starts_.resize(size + 1);
+    for (uint64_t r = 0; r <= size; ++r) {
+        starts_[r] = total * r / size;
+    }
+}
+
+void ParticleDomain::recordStep(double seconds) {
+    seconds_ += seconds;
+    ++steps_;
+}
+
+void ParticleDomain::rebalance(SolarSystem& system) {
+    const size_t size = static_cast<size_t>(communicator_.getSize());
+    communicator_.allGather(steps_ > 0 ? seconds_ / steps_ : 0.0, rankSeconds_);
+    seconds_ = 0.0;
+    steps_ = 0;
+    if (size == 1) {
+        return;
+    }
+
+    double mean = 0.0, slowest = 0.0;
+    for (double seconds : rankSeconds_) {
+        mean += seconds / size;
+        slowest = std::max(slowest, seconds);
+    }
+    if (mean <= 0.0 || slowest < REBALANCE_TOLERANCE * mean) {
+        return;
+    }
+
+    // Particles per second on each process; an empty range still counts as one
+    // particle, so a process that has none can be given some back
+    rankSpeed_.resize(size);
+    double totalSpeed = 0.0;
+    for (size_t r = 0; r < size; ++r) {
+        const double count = std::max<double>(1.0, double(starts_[r + 1] - starts_[r]));
+        rankSpeed_[r] = rankSeconds_[r] > 0.0 ? count / rankSeconds_[r] : 0.0;
+        totalSpeed += rankSpeed_[r];
+    }
+    if (totalSpeed <= 0.0) {
+        return;
+    }
+
+    // Half way to the split in proportion to speed, so one noisy interval cannot swing it
+    const double total = double(getTotal());
+    newStarts_.resize(size + 1);
+    newStarts_[0] = 0;
+    double running = 0.0;
+    for (size_t r = 0; r < size; ++r) {
+        const double count = double(starts_[r + 1] - starts_[r]);
+        running += 0.5 * (count + total * rankSpeed_[r] / totalSpeed);
+        newStarts_[r + 1] = std::min<uint64_t>(getTotal(), static_cast<uint64_t>(std::llround(running)));
+    }
+    newStarts_[size] = getTotal();
+    if (newStarts_ != starts_) {
+        migrate(system);
+    }
+}
+
+void ParticleDomain::migrate(SolarSystem& system) {
+    GRAVITY_PROFILE_SCOPE("migrateParticles");
+    const size_t size = static_cast<size_t>(communicator_.getSize());
+    const TestParticles& particles = system.getTestParticles();
+    const std::vector<Color>& colors = system.getTestParticleColors();
+    const uint64_t first = getFirst(), last = getLast();
+
+    // Ranges only shift along the scenario order, so what each process receives,
+    // taken in rank order, is already its new range in order
+    send_.clear();
+    sendCounts_.assign(size, 0);
+    for (size_t r = 0; r < size; ++r) {
+        const uint64_t begin = std::max(first, newStarts_[r]);
+        const uint64_t end = std::min(last, newStarts_[r + 1]);
+        for (uint64_t g = begin; g < end; ++g) {
+            const size_t i = static_cast<size_t>(g - first);
+            send_.insert(send_.end(), {particles.x[i], particles.y[i], particles.z[i],
+                                       particles.vx[i], particles.vy[i], particles.vz[i],
+                                       static_cast<double>(particles.parent[i]), packColor(colors[i])});
+        }
+        sendCounts_[r] = static_cast<int>(end > begin ? MIGRATED_VALUES * (end - begin) : 0);
+    }
+    communicator_.allToAll(send_, sendCounts_, received_);
+
+    const size_t count = received_.size() / MIGRATED_VALUES;
+    TestParticles moved;
+    std::vector<Color> movedColors;
+    moved.reserve(count);
+    movedColors.reserve(count);
+    for (size_t k = 0; k < count; ++k) {
+        const double* v = received_.data() + MIGRATED_VALUES * k;
+        moved.add(v[0], v[1], v[2], v[3], v[4], v[5], static_cast<uint32_t>(v[6]));
+        movedColors.push_back(unpackColor(v[7]));
+    }
+    system.setTestParticles(std::move(moved), std::move(movedColors));
+    starts_ = newStarts_;
+}
+
+void ParticleDomain::gather(const SolarSystem& system, StateWriter write) {
+    const TestParticles& particles = system.getTestParticles();
+    send_.resize(6 * particles.size());
+    for (size_t i = 0; i < particles.size(); ++i) {
+        double* v = send_.data() + 6 * i;
+        v[0] = particles.x[i];
+        v[1] = particles.y[i];
+        v[2] = particles.z[i];
+        v[3] = particles.vx[i];
+        v[4] = particles.vy[i];
+        v[5] = particles.vz[i];
+    }
+    if (!communicator_.isRoot()) {
+        communicator_.send(send_, 0);
+        return;
+    }
+
+    // One process's range at a time, so the root never holds more than the largest
+    write(send_.data(), particles.size());
+    for (int r = 1; r < communicator_.getSize(); ++r) {
+        communicator_.receive(received_, r);
+        write(received_.data(), received_.size() / 6);
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "Communicator.h"
+#include "FunctionRef.h"
+#include "SolarSystem.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * This process's part of the test particles in a distributed job.
+ *
+ * Particles feel only the bodies, which every process holds, and never each
+ * other, so unlike the bodies they need no spatial decomposition: each process
+ * steps a contiguous range of them in scenario order, and loads only that range.
+ * When the processes' step times (less the time spent in the body solver) drift
+ * further apart than REBALANCE_TOLERANCE, usually from unequal nodes, particles
+ * move between neighbouring ranges towards a split in proportion to each
+ * process's measured speed.
+ */
+class ParticleDomain {
+public:
+    static constexpr size_t REBALANCE_STEPS = 64;
+    static constexpr double REBALANCE_TOLERANCE = 1.05;   // Slowest over mean step time
+
+    // Position and velocity of count particles, six values each, in scenario order
+    using StateWriter = FunctionRef<void(const double* states, size_t count)>;
+
+    // Split total particles evenly between the processes to begin with
+    ParticleDomain(Communicator& communicator, uint64_t total);
+
+    // This process's range of the scenario's particles
+    uint64_t getFirst() const { return starts_[communicator_.getRank()]; }
+    uint64_t getLast() const { return starts_[communicator_.getRank() + 1]; }
+    uint64_t getTotal() const { return starts_.back(); }
+
+    // Time this process spent outside the body solver in a step
+    void recordStep(double seconds);
+
+    // Collective, after the same step everywhere: move particles if the load is uneven
+    void rebalance(SolarSystem& system);
+
+    // Collective: the root is handed every particle's state in order, the others send theirs
+    void gather(const SolarSystem& system, StateWriter write);
+
+private:
+    void migrate(SolarSystem& system);
+
+    Communicator& communicator_;
+    std::vector<uint64_t> starts_;      // Process r holds particles [starts_[r], starts_[r + 1])
+    std::vector<uint64_t> newStarts_;
+    double seconds_ = 0.0;
+    size_t steps_ = 0;
+    std::vector<double> rankSeconds_, rankSpeed_;
+    std::vector<double> send_, received_;
+    std::vector<int> sendCounts_;
+};
@@ -1,5 +1,5 @@
 #pragma once
-#include <SFML/Graphics.hpp>
+#include <SFML/System/Vector2.hpp>
 
 /**
  * Physics utility class containing constants and helper functions
@@ -18,6 +18,7 @@ public:
     // Simulation scaling factors
     static constexpr double DISTANCE_SCALE = 1e-9;     // Scale factor for distances (1 pixel = 1e9 meters)
     static constexpr double TIME_SCALE = 86400.0;      // Time scale factor (1 simulation second = 1 day)
+    static constexpr double SOFTENING_LENGTH = 1e6;    // Plummer softening length for close encounters (meters)
 
     /**
      * Calculate gravitational force between two bodies
@@ -0,0 +1,120 @@
+#include "PhysicsThread.h"
+#include "Profiler.h"
+#include <algorithm>
+
+PhysicsThread::PhysicsThread(SolarSystem& solarSystem, double stepRate)
+    : solarSystem_(solarSystem), stepRate_(stepRate > 0.0 ? stepRate : 1000.0),
+      stepInterval_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / stepRate_))),
+      epoch_(Clock::now()) {
+}
+
+PhysicsThread::~PhysicsThread() {
+    stop();
+}
+
+void PhysicsThread::start() {
+    if (thread_.joinable()) {
+        return;
+    }
+
+    // Publish the current state so sample() has something before the first step
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        republish();
+    }
+
+    running_ = true;
+    thread_ = std::thread(&PhysicsThread::run, this);
+}
+
+void PhysicsThread::republish() {
+    // Writers of the buffer are serialised by the mutex, so this cannot race the thread's publish
+    Published& out = published_.writeBuffer();
+    capture(out.latest, Clock::now());
+    out.previous = out.latest;
+    published_.publish();
+}
+
+void PhysicsThread::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+const StateSnapshot& PhysicsThread::sample() {
+    published_.update();
+    const Published& in = published_.readBuffer();
+
+    // Render one step behind the clock so the sample falls between the two states
+    const double renderTime = toSeconds(Clock::now() - stepInterval_);
+    const double span = in.latest.time - in.previous.time;
+    const double alpha = span > 0.0 ? std::min(1.0, std::max(0.0, (renderTime - in.previous.time) / span)) : 1.0;
+    sampled_.interpolate(in.previous, in.latest, alpha);
+    return sampled_;
+}
+
+void PhysicsThread::run() {
+    Profiler::setThreadName("physics");
+    const double stepSeconds = 1.0 / stepRate_;
+    const auto maxBacklog = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(MAX_BACKLOG));
+
+    Clock::time_point due = Clock::now();
+    Clock::time_point rateWindow = due;
+    size_t rateSteps = 0;
+
+    while (running_) {
+        const Clock::time_point now = Clock::now();
+        if (suspended_) {
+            // Resume from the current time instead of catching up on the pause
+            due = now + stepInterval_;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+
+        if (now - due > maxBacklog) {
+            // Too far behind to catch up; let simulated time slip rather than spiral
+            const auto behind = (now - due - maxBacklog) / stepInterval_;
+            droppedSteps_ += static_cast<size_t>(behind);
+            due += stepInterval_ * behind;
+        }
+
+        // Run every step that is due; the last one also captures the states around it
+        while (due <= now && running_) {
+            const bool last = due + stepInterval_ > now;
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (suspended_) {
+                break;
+            }
+            if (last) {
+                Published& out = published_.writeBuffer();
+                capture(out.previous, due - stepInterval_);
+                solarSystem_.update(stepSeconds);
+                capture(out.latest, due);
+                published_.publish();
+            } else {
+                solarSystem_.update(stepSeconds);
+            }
+            due += stepInterval_;
+            ++rateSteps;
+        }
+
+        if (now - rateWindow >= std::chrono::seconds(1)) {
+            measuredRate_ = rateSteps / std::chrono::duration<double>(now - rateWindow).count();
+            rateWindow = now;
+            rateSteps = 0;
+        }
+
+        std::this_thread::sleep_until(due);
+    }
+}
+
+void PhysicsThread::capture(StateSnapshot& snapshot, Clock::time_point time) const {
+    GRAVITY_PROFILE_SCOPE("capture");
+    solarSystem_.captureSnapshot(snapshot);
+    snapshot.time = toSeconds(time);
+}
+
+double PhysicsThread::toSeconds(Clock::time_point time) const {
+    return std::chrono::duration<double>(time - epoch_).count();
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "SolarSystem.h"
+#include "StateSnapshot.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+/**
+ * Runs SolarSystem::update() at a fixed rate on its own thread.
+ *
+ * Each step advances the system by one step interval of wall-clock time (times
+ * the system's time scale), so simulated time follows the clock however fast
+ * the window renders. After each batch of due steps the thread publishes the
+ * states before and after the last step through a triple buffer; sample()
+ * blends them for the current clock time, one step interval behind, so motion
+ * stays smooth when rendering and physics run at unrelated rates.
+ *
+ * Anything else that touches the system (input, the GPU backend, UI
+ * statistics) must hold getMutex(); the thread takes it for one step at a time.
+ */
+class PhysicsThread {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PhysicsThread(SolarSystem& solarSystem, double stepRate = 1000.0);
+    ~PhysicsThread();
+
+    PhysicsThread(const PhysicsThread&) = delete;
+    PhysicsThread& operator=(const PhysicsThread&) = delete;
+
+    void start();
+    void stop();
+    bool isRunning() const { return thread_.joinable(); }
+
+    // Guards the SolarSystem against the physics thread
+    std::mutex& getMutex() { return mutex_; }
+
+    // Stop stepping, e.g. while another backend owns the state; call with the mutex held
+    void setSuspended(bool suspended) { suspended_ = suspended; }
+    bool isSuspended() const { return suspended_; }
+
+    // Publish the current state as both sample points after the body layout changed
+    // outside a step (e.g. compaction); call with the mutex held
+    void republish();
+
+    double getStepRate() const { return stepRate_; }
+
+    // Steps actually run per second of clock time, measured over the last second
+    double getMeasuredStepRate() const { return measuredRate_; }
+
+    // Steps dropped because the thread fell more than MAX_BACKLOG behind the clock
+    size_t getDroppedSteps() const { return droppedSteps_; }
+
+    // Interpolated state at the current clock time; call from the render thread only
+    const StateSnapshot& sample();
+
+    // Longest stretch of clock time the thread will catch up on before dropping steps
+    static constexpr double MAX_BACKLOG = 0.25;
+
+private:
+    // The two most recent states, published together
+    struct Published {
+        StateSnapshot previous;
+        StateSnapshot latest;
+    };
+
+    void run();
+    void capture(StateSnapshot& snapshot, Clock::time_point time) const;
+    double toSeconds(Clock::time_point time) const;
+
+    SolarSystem& solarSystem_;
+    double stepRate_;
+    Clock::duration stepInterval_;
+    Clock::time_point epoch_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> suspended_{false};
+    std::atomic<double> measuredRate_{0.0};
+    std::atomic<size_t> droppedSteps_{0};
+
+    TripleBuffer<Published> published_;
+    StateSnapshot sampled_;   // Render-thread output of sample()
+};
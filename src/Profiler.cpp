@@ -0,0 +1,183 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+
+std::atomic<bool> Profiler::enabled_(false);
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+const Clock::time_point epoch = Clock::now();
+
+struct ThreadRing {
+    std::mutex mutex;
+    std::vector<Profiler::Event> events;  // Sized on the first event
+    uint64_t written = 0;                 // Events ever recorded; the newest is at (written - 1) % capacity
+    std::string name;
+    uint32_t index = 0;
+};
+
+// Rings outlive their threads, so a trace still shows pool workers that have been stopped;
+// they are never freed, which also keeps them valid for threads still running at exit
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadRing*> rings;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+thread_local ThreadRing* currentRing = nullptr;
+
+ThreadRing& ring() {
+    if (!currentRing) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        currentRing = new ThreadRing();
+        currentRing->index = static_cast<uint32_t>(r.rings.size());
+        currentRing->name = "thread " + std::to_string(currentRing->index);
+        r.rings.push_back(currentRing);
+    }
+    return *currentRing;
+}
+
+void record(const Profiler::Event& event) {
+    ThreadRing& r = ring();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.events.empty()) {
+        r.events.resize(Profiler::RING_CAPACITY);
+    }
+    Profiler::Event& slot = r.events[r.written % Profiler::RING_CAPACITY];
+    slot = event;
+    slot.thread = r.index;
+    ++r.written;
+}
+
+// JSON string contents; names are identifiers in practice, but thread names come from callers
+std::string escape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+uint64_t Profiler::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count());
+}
+
+void Profiler::recordScope(const char* name, uint64_t start, uint64_t end) {
+    record({name, start, end > start ? end - start : 0, 0.0, 0, Type::Scope});
+}
+
+void Profiler::recordCounter(const char* name, double value) {
+    record({name, now(), 0, value, 0, Type::Counter});
+}
+
+void Profiler::recordFrame() {
+    record({"frame", now(), 0, 0.0, 0, Type::Frame});
+}
+
+void Profiler::setThreadName(const char* name) {
+    ThreadRing& r = ring();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.name = name;
+}
+
+std::string Profiler::getThreadName(uint32_t thread) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (thread >= r.rings.size()) {
+        return std::string();
+    }
+    std::lock_guard<std::mutex> ringLock(r.rings[thread]->mutex);
+    return r.rings[thread]->name;
+}
+
+uint32_t Profiler::getThreadIndex() {
+    return ring().index;
+}
+
+std::vector<Profiler::Event> Profiler::collect(uint64_t since) {
+    std::vector<Event> events;
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (ThreadRing* threadRing : r.rings) {
+        std::lock_guard<std::mutex> ringLock(threadRing->mutex);
+        const uint64_t kept = std::min<uint64_t>(threadRing->written, RING_CAPACITY);
+        for (uint64_t k = threadRing->written - kept; k < threadRing->written; ++k) {
+            const Event& event = threadRing->events[k % RING_CAPACITY];
+            if (event.start >= since) {
+                events.push_back(event);
+            }
+        }
+    }
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.start < b.start; });
+    return events;
+}
+
+void Profiler::clear() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (ThreadRing* threadRing : r.rings) {
+        std::lock_guard<std::mutex> ringLock(threadRing->mutex);
+        threadRing->written = 0;
+    }
+}
+
+bool Profiler::writeChromeTrace(const std::string& path, std::string& error) {
+    const std::vector<Event> events = collect();
+    std::ofstream out(path);
+    if (!out) {
+        error = "Cannot open " + path;
+        return false;
+    }
+
+    // Timestamps and durations are in microseconds
+    out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    size_t threads = 0;
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        threads = r.rings.size();
+    }
+    bool first = true;
+    for (uint32_t t = 0; t < threads; ++t) {
+        out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t
+            << ", \"args\": {\"name\": \"" << escape(getThreadName(t)) << "\"}}";
+        first = false;
+    }
+    for (const Event& event : events) {
+        out << (first ? "" : ",\n") << "{\"name\": \"" << escape(event.name) << "\", \"pid\": 1, \"tid\": "
+            << event.thread << ", \"ts\": " << event.start * 1e-3;
+        switch (event.type) {
+            case Type::Scope:
+                out << ", \"ph\": \"X\", \"dur\": " << event.duration * 1e-3 << "}";
+                break;
+            case Type::Counter:
+                out << ", \"ph\": \"C\", \"args\": {\"value\": " << std::defaultfloat << std::setprecision(10)
+                    << event.value << std::fixed << std::setprecision(3) << "}}";
+                break;
+            case Type::Frame:
+                out << ", \"ph\": \"i\", \"s\": \"t\"}";
+                break;
+        }
+        first = false;
+    }
+    out << "\n]}\n";
+    if (!out) {
+        error = "Cannot write " + path;
+        return false;
+    }
+    return true;
+}
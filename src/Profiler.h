@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Scoped timers and counters on the hot paths, for the frame profiler overlay
+ * and for Chrome trace export.
+ *
+ * Each thread records into its own fixed ring of events, so recording takes
+ * an uncontended lock and never allocates after the ring is made; the oldest
+ * events are overwritten, leaving a few seconds of history at the physics
+ * rate. Recording is off by default, and a disabled GRAVITY_PROFILE_SCOPE
+ * costs one relaxed atomic load. Configuring with -DGRAVITY_WITH_PROFILER=OFF
+ * removes the macros altogether.
+ *
+ * Names must be string literals (or otherwise outlive the profiler): events
+ * keep the pointer, not a copy.
+ */
+class Profiler {
+public:
+    enum class Type : uint8_t {
+        Scope,      // start and duration
+        Counter,    // value at start
+        Frame       // boundary between two frames of the recording thread
+    };
+
+    struct Event {
+        const char* name;
+        uint64_t start;       // ns since the profiler's epoch
+        uint64_t duration;    // ns; 0 for counters and frames
+        double value;         // Counters only
+        uint32_t thread;      // Index in registration order, see getThreadName()
+        Type type;
+    };
+
+    static void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Monotonic ns since the profiler's epoch
+    static uint64_t now();
+
+    static void recordScope(const char* name, uint64_t start, uint64_t end);
+    static void recordCounter(const char* name, double value);
+    static void recordFrame();
+
+    // Label the calling thread in the overlay and in traces
+    static void setThreadName(const char* name);
+    static std::string getThreadName(uint32_t thread);
+    // Index of the calling thread, registering it if needed
+    static uint32_t getThreadIndex();
+
+    // Buffered events of every thread that started at or after since, ordered by start
+    static std::vector<Event> collect(uint64_t since = 0);
+
+    // Drop everything recorded so far
+    static void clear();
+
+    // Write the buffered events as a Chrome trace (chrome://tracing, Perfetto, Tracy's importer)
+    static bool writeChromeTrace(const std::string& path, std::string& error);
+
+    // Events kept per thread
+    static constexpr size_t RING_CAPACITY = 1 << 15;
+
+    // Times the enclosing block when recording was on at its start
+    class Scope {
+    public:
+        explicit Scope(const char* name) : name_(isEnabled() ? name : nullptr), start_(name_ ? now() : 0) {}
+        ~Scope() {
+            if (name_) {
+                recordScope(name_, start_, now());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name_;
+        uint64_t start_;
+    };
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+#if defined(GRAVITY_PROFILER)
+#define GRAVITY_PROFILE_JOIN2(a, b) a##b
+#define GRAVITY_PROFILE_JOIN(a, b) GRAVITY_PROFILE_JOIN2(a, b)
+#define GRAVITY_PROFILE_SCOPE(name) const Profiler::Scope GRAVITY_PROFILE_JOIN(profileScope_, __LINE__)(name)
+#define GRAVITY_PROFILE_COUNTER(name, value) \
+    do { if (Profiler::isEnabled()) Profiler::recordCounter(name, static_cast<double>(value)); } while (0)
+#define GRAVITY_PROFILE_FRAME() \
+    do { if (Profiler::isEnabled()) Profiler::recordFrame(); } while (0)
+#else
+#define GRAVITY_PROFILE_SCOPE(name) do {} while (0)
+#define GRAVITY_PROFILE_COUNTER(name, value) do {} while (0)
+#define GRAVITY_PROFILE_FRAME() do {} while (0)
+#endif
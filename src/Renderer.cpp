@@ -1,15 +1,97 @@
 #include "Renderer.h"
 #include "Physics.h"
+#include "FmmSolver.h"
+#include "DormandPrinceIntegrator.h"
+#include "BlockTimestepIntegrator.h"
+#include "GpuBackend.h"
+#include "Profiler.h"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+sf::Color toSfColor(const Color& color) {
+    return sf::Color(color.r, color.g, color.b, color.a);
+}
+
+// Body impostors: each quad carries texture coordinates spanning [-1, 1], and the
+// fragment shader keeps the unit disc with a white rim of OUTLINE pixels
+const char* const BODY_VERTEX_SHADER = R"(
+varying vec2 offset;
+void main() {
+    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+    gl_FrontColor = gl_Color;
+    offset = gl_MultiTexCoord0.xy;
+}
+)";
+
+const char* const BODY_FRAGMENT_SHADER = R"(
+varying vec2 offset;
+uniform float outline;
+void main() {
+    float r = length(offset);
+    float pixel = fwidth(r);
+    if (r > 1.0) discard;
+    float rim = smoothstep(1.0 - (outline + 1.0) * pixel, 1.0 - outline * pixel, r);
+    vec4 color = mix(gl_Color, vec4(1.0), rim);
+    color.a *= 1.0 - smoothstep(1.0 - pixel, 1.0, r);
+    gl_FragColor = color;
+}
+)";
+
+// Side of the fallback disc texture; smoothing keeps it round at any drawn size
+constexpr unsigned int DISC_TEXTURE_SIZE = 64;
+
+// Bodies under this on-screen radius are accumulated into splats of SPLAT_CELL_PIXELS squares
+constexpr float SPLAT_PIXEL_RADIUS = 1.0f;
+constexpr unsigned int SPLAT_CELL_PIXELS = 2;
+// Opacity of a splat holding a single faint body, so sparse regions stay visible
+constexpr float SPLAT_MIN_ALPHA = 0.25f;
+// On-screen radius a test particle counts for in its splat
+constexpr float PARTICLE_PIXEL_RADIUS = 0.5f;
+
+// Trails are not extended by less than this on screen
+constexpr float TRAIL_TOLERANCE_PIXELS = 1.0f;
+
+// The spacetime grid is re-evaluated once bodies may have moved this far on screen
+constexpr float WARP_TOLERANCE_PIXELS = 1.0f;
+
+// Bodies drawn smaller than this can still be picked within it
+constexpr float PICK_PIXELS = 6.0f;
+
+// Labels smaller than this on screen are not drawn, nor more than MAX_LABELS at once
+constexpr float MIN_LABEL_PIXELS = 6.0f;
+constexpr size_t MAX_LABELS = 256;
+
+// The status text is laid out at most this often while none of the settings it shows changes
+constexpr double STATUS_REFRESH_SECONDS = 0.25;
+
+// Profiler overlay: one bar of PROFILER_BAR_PIXELS per frame for the last PROFILER_FRAMES frames,
+// PROFILER_PIXELS_PER_MS high, and a table of the scopes timed over the last PROFILER_WINDOW_NS
+constexpr size_t PROFILER_FRAMES = 120;
+constexpr float PROFILER_BAR_PIXELS = 3.0f;
+constexpr float PROFILER_PIXELS_PER_MS = 4.0f;
+constexpr uint64_t PROFILER_WINDOW_NS = 1000000000;
+const sf::Color PROFILER_COLORS[] = {
+    sf::Color(230, 90, 80), sf::Color(90, 170, 230), sf::Color(120, 200, 100), sf::Color(240, 190, 70),
+    sf::Color(190, 120, 220), sf::Color(80, 210, 200), sf::Color(240, 140, 190), sf::Color(170, 170, 170)
+};
+constexpr size_t PROFILER_COLOR_COUNT = sizeof(PROFILER_COLORS) / sizeof(PROFILER_COLORS[0]);
+
+} // namespace
 
 Renderer::Renderer(sf::RenderWindow& window)
-    : window_(window), zoom_(1.0f), center_(0.0f, 0.0f),
+    : window_(window), gpu_(nullptr), zoom_(1.0f), center_(0.0f, 0.0f),
+      cameraZ_(-1000.0f), cameraRotationX_(0.0f), cameraRotationY_(0.0f),
       showTrails_(true), showLabels_(true), showVelocityVectors_(false),
       showForceVectors_(false), showGrid_(false), showSpacetimeWarping_(false),
-      maxTrailLength_(1000),
-      cameraZ_(-1000.0f), cameraRotationX_(0.0f), cameraRotationY_(0.0f) {
+      gridRevision_(0), gridCount_(0), gridSimulationTime_(0.0), gridMaxSpeed_(0.0), gridMaxVisualRadius_(0.0f),
+      splatVertices_(sf::Triangles), warpRevision_(0), warpCount_(0), warpSimulationTime_(0.0),
+      warpVertices_(sf::Lines), bodyVertices_(sf::Triangles), vectorVertices_(sf::Lines),
+      useBodyShader_(false), profilerVertices_(sf::Triangles) {
 
     // Initialize view
     view_ = window_.getDefaultView();
@@ -20,20 +102,33 @@ Renderer::Renderer(sf::RenderWindow& window)
         std::cerr << "Warning: Failed to load font. Labels will not be displayed correctly." << std::endl;
     }
 
+    loadBodyShader();
+
     // Initialize shapes for reuse
-    circleShape_.setOrigin(1.0f, 1.0f); // Set origin to center
     lineShape_.setSize(sf::Vector2f(1.0f, 1.0f));
+    statusLabel_.setFont(font_);
+    statusLabel_.setCharacterSize(14);
+    statusLabel_.setFillColor(sf::Color::White);
+    statusLabel_.setPosition(10, 10);
 }
 
-void Renderer::render(const SolarSystem& solarSystem, double deltaTime) {
+void Renderer::render(const SolarSystem& solarSystem, const StateSnapshot& state, double /*deltaTime*/) {
     window_.clear(sf::Color::Black);
 
     // Update view
     updateView();
     window_.setView(view_);
+    projection_.setCamera(center_, cameraZ_, cameraRotationX_, cameraRotationY_);
+
+    // The CPU copy of the state goes stale while the GPU backend owns it
+    const bool onGpu = gpu_ && gpu_->isActive();
 
     // Update trails
-    updateTrails(solarSystem);
+    if (!onGpu) {
+        GRAVITY_PROFILE_SCOPE("updateTrails");
+        trails_.setTolerance(TRAIL_TOLERANCE_PIXELS / getPixelsPerUnit());
+        trails_.update(solarSystem, state);
+    }
 
     // Render grid if enabled
     if (showGrid_) {
@@ -42,26 +137,38 @@ void Renderer::render(const SolarSystem& solarSystem, double deltaTime) {
 
     // Render spacetime warping grid if enabled
     if (showSpacetimeWarping_) {
-        renderSpacetimeWarpingGrid(solarSystem);
+        GRAVITY_PROFILE_SCOPE("spacetimeGrid");
+        renderSpacetimeWarpingGrid(solarSystem, state);
     }
 
     // Render trails first (so they appear behind bodies)
-    if (showTrails_) {
-        for (size_t i = 0; i < trails_.size(); ++i) {
-            renderTrail(i);
-        }
+    if (showTrails_ && !onGpu) {
+        GRAVITY_PROFILE_SCOPE("drawTrails");
+        trails_.draw(window_, projection_, solarSystem.is3DMode());
     }
 
     // Render celestial bodies
-    const auto& bodies = solarSystem.getBodies();
-    for (size_t i = 0; i < bodies.size(); ++i) {
-        renderCelestialBody(*bodies[i], i, solarSystem);
+    {
+        GRAVITY_PROFILE_SCOPE("drawBodies");
+        if (onGpu) {
+            renderGpuBodies(solarSystem);
+        } else {
+            renderBodies(solarSystem, state);
+        }
     }
 
     // Render UI elements in screen coordinates
     window_.setView(window_.getDefaultView());
-    renderUI(solarSystem, deltaTime);
+    {
+        GRAVITY_PROFILE_SCOPE("drawUI");
+        renderUI();
+        if (showProfiler_) {
+            renderProfiler();
+        }
+    }
 
+    // Includes the wait for vertical sync
+    GRAVITY_PROFILE_SCOPE("present");
     window_.display();
 }
 
@@ -93,9 +200,11 @@ sf::Vector2i Renderer::worldToScreen(const sf::Vector2f& worldPos) const {
 }
 
 void Renderer::clearTrails() {
-    for (auto& trail : trails_) {
-        trail.clear();
-    }
+    trails_.clear();
+}
+
+float Renderer::getPixelsPerUnit() const {
+    return static_cast<float>(window_.getSize().y) / view_.getSize().y;
 }
 
 sf::FloatRect Renderer::getViewBounds() const {
@@ -114,94 +223,338 @@ float Renderer::getVisualScale() const {
     return std::max(0.5f, std::min(3.0f, 1.0f / zoom_));
 }
 
-void Renderer::renderCelestialBody(const CelestialBody& body, size_t bodyIndex, const SolarSystem& solarSystem) {
-    sf::Vector2f pos;
-
-    if (solarSystem.is3DMode()) {
-        // Use 3D projection
-        Vector3f pos3D = body.getPosition3D();
-        pos = project3DTo2D(pos3D, solarSystem);
-    } else {
-        // Use 2D position directly
-        pos = body.getPosition();
+void Renderer::renderBodies(const SolarSystem& solarSystem, const StateSnapshot& state) {
+    // Bodies added since the snapshot was taken appear with the next one
+    const auto& bodies = solarSystem.getBodies();
+    const size_t count = std::min(bodies.size(), state.size());
+    const bool threeD = solarSystem.is3DMode();
+    const float pixelsPerUnit = getPixelsPerUnit();
+    const sf::FloatRect bounds = getViewBounds();
+
+    bodyVertices_.clear();
+    vectorVertices_.clear();
+    labelCandidates_.clear();
+    beginSplats();
+    findVisibleBodies(solarSystem, state, count);
+    GRAVITY_PROFILE_COUNTER("visibleBodies", visible_.size());
+
+    hoveredBody_ = hasPointer_ ? pickBody(screenToWorld(pointer_), solarSystem, state, count) : NO_BODY;
+    if (hoveredBody_ != NO_BODY) {
+        const CelestialBody& body = *bodies[hoveredBody_];
+        const Vector3f pos3D = state.position[hoveredBody_].toFloat();
+        labelCandidates_.push_back({&body, state.mass[hoveredBody_], hoveredBody_,
+                                    threeD ? projection_.project(pos3D) : pos3D.to2D(),
+                                    calculateBodyVisualRadius(state.visualRadius[hoveredBody_]), true});
     }
 
-    float radius = calculateBodyVisualRadius(body);
+    for (const uint32_t i : visible_) {
+        const CelestialBody& body = *bodies[i];
+        const Vector3f pos3D = state.position[i].toFloat();
+        const sf::Vector2f pos = threeD ? projection_.project(pos3D) : pos3D.to2D();
+        const float radius = calculateBodyVisualRadius(state.visualRadius[i]);
+        if (pos.x + radius < bounds.left || pos.x - radius > bounds.left + bounds.width ||
+            pos.y + radius < bounds.top || pos.y - radius > bounds.top + bounds.height) {
+            continue;
+        }
 
-    // Set up circle shape
-    circleShape_.setRadius(radius);
-    circleShape_.setOrigin(radius, radius);
-    circleShape_.setPosition(pos);
-    circleShape_.setFillColor(body.getColor());
-    circleShape_.setOutlineColor(sf::Color::White);
-    circleShape_.setOutlineThickness(0.5f * getVisualScale());
+        if (radius * pixelsPerUnit < SPLAT_PIXEL_RADIUS) {
+            addSplat(pos, radius * pixelsPerUnit, toSfColor(body.getColor()));
+            continue;
+        }
+        appendBodyQuad(pos, radius, toSfColor(body.getColor()));
 
-    window_.draw(circleShape_);
+        if (showVelocityVectors_) {
+            appendVelocityVector(pos3D.to2D(), state.velocity[i].toFloat().to2D());
+        }
+        if (showLabels_ && !body.getName().empty() && i != hoveredBody_) {
+            // Labels sit beside the unprojected position, as they always have
+            labelCandidates_.push_back({&body, state.mass[i], i, pos3D.to2D(), radius, false});
+        }
+        if (showForceVectors_) {
+            renderForceVector(body);
+        }
+    }
 
-    // Render additional visual elements
-    if (showLabels_) {
-        renderLabel(body);
+    // Test particles may number millions; they only ever add to the splats
+    const auto& particleColors = solarSystem.getTestParticleColors();
+    const size_t particles = std::min(particleColors.size(), state.particlePosition.size());
+    if (threeD) {
+        particleProjected_.resize(particles);
+        projection_.project(state.particlePosition.data(), particles, particleProjected_.data());
+    }
+    for (size_t i = 0; i < particles; ++i) {
+        const sf::Vector2f pos = threeD ? particleProjected_[i] : state.particlePosition[i].to2D();
+        if (pos.x < bounds.left || pos.x > bounds.left + bounds.width ||
+            pos.y < bounds.top || pos.y > bounds.top + bounds.height) {
+            continue;
+        }
+        addSplat(pos, PARTICLE_PIXEL_RADIUS, toSfColor(particleColors[i]));
     }
+    finishSplats();
 
-    if (showVelocityVectors_) {
-        renderVelocityVector(body);
+    window_.draw(splatVertices_);
+    sf::RenderStates states;
+    if (useBodyShader_) {
+        bodyShader_.setUniform("outline", 0.5f * getVisualScale() * pixelsPerUnit);
+        states.shader = &bodyShader_;
+    } else {
+        states.texture = &discTexture_;
     }
+    window_.draw(bodyVertices_, states);
+    window_.draw(vectorVertices_);
 
-    if (showForceVectors_) {
-        renderForceVector(body);
+    if (solarSystem.getLayoutRevision() != labelLayout_) {
+        labelStrings_.clear();
+        labelLayout_ = solarSystem.getLayoutRevision();
     }
+    renderLabels();
 }
 
-void Renderer::renderTrail(size_t bodyIndex) {
-    if (bodyIndex >= trails_.size() || trails_[bodyIndex].size() < 2) {
+void Renderer::findVisibleBodies(const SolarSystem& solarSystem, const StateSnapshot& state, size_t count) {
+    visible_.clear();
+
+    // The grid indexes world x-y, which the perspective camera does not map onto a rectangle
+    if (solarSystem.is3DMode()) {
+        for (size_t i = 0; i < count; ++i) {
+            visible_.push_back(static_cast<uint32_t>(i));
+        }
         return;
     }
 
-    const auto& trail = trails_[bodyIndex];
-    sf::VertexArray lines(sf::LineStrip, trail.size());
-
-    for (size_t i = 0; i < trail.size(); ++i) {
-        lines[i].position = trail[i].position;
-        lines[i].color = trail[i].color;
-        lines[i].color.a = static_cast<sf::Uint8>(trail[i].alpha * 255);
+    // Rebuild once bodies may have left the cells they were filed in by more than a cell
+    if (state.revision != gridRevision_ || count != gridCount_ || getGridDrift(state) > bodyGrid_.getCellSize()) {
+        bodyGrid_.build(state.position, count);
+        gridRevision_ = state.revision;
+        gridCount_ = count;
+        gridSimulationTime_ = state.simulationTime;
+        gridMaxSpeed_ = 0.0;
+        gridMaxVisualRadius_ = 0.0f;
+        for (size_t i = 0; i < count; ++i) {
+            gridMaxSpeed_ = std::max(gridMaxSpeed_, state.velocity[i].magnitude());
+            gridMaxVisualRadius_ = std::max(gridMaxVisualRadius_, state.visualRadius[i]);
+        }
     }
 
-    window_.draw(lines);
+    const double reach = getGridDrift(state) + std::max(2.0f, gridMaxVisualRadius_ * getVisualScale());
+    const sf::FloatRect bounds = getViewBounds();
+    bodyGrid_.query(bounds.left - reach, bounds.top - reach,
+                    bounds.left + bounds.width + reach, bounds.top + bounds.height + reach,
+                    [this](uint32_t i) { visible_.push_back(i); });
 }
 
-void Renderer::renderLabel(const CelestialBody& body) {
-    if (!font_.getInfo().family.empty()) {
-        labelText_.setFont(font_);
-        labelText_.setString(body.getName());
-        labelText_.setCharacterSize(static_cast<unsigned int>(16 * getVisualScale()));
-        labelText_.setFillColor(sf::Color::White);
+double Renderer::getGridDrift(const StateSnapshot& state) const {
+    // Twice the fastest speed at the build allows for bodies speeding up since
+    return 2.0 * gridMaxSpeed_ * std::abs(state.simulationTime - gridSimulationTime_);
+}
 
-        sf::Vector2f pos = body.getPosition();
-        float radius = calculateBodyVisualRadius(body);
-        labelText_.setPosition(pos.x + radius + 5, pos.y - 8);
+size_t Renderer::pickBody(const sf::Vector2f& point, const SolarSystem& solarSystem, const StateSnapshot& state,
+                          size_t count) const {
+    const bool threeD = solarSystem.is3DMode();
+    const float pickRadius = PICK_PIXELS / getPixelsPerUnit();
+
+    // Nearest centre among the bodies whose drawn disc, or the pick radius, covers the point
+    size_t best = NO_BODY;
+    float bestDistanceSquared = 0.0f;
+    auto consider = [&](uint32_t i) {
+        const Vector3f pos3D = state.position[i].toFloat();
+        const sf::Vector2f pos = threeD ? projection_.project(pos3D) : pos3D.to2D();
+        const float radius = std::max(pickRadius, calculateBodyVisualRadius(state.visualRadius[i]));
+        const float dx = pos.x - point.x, dy = pos.y - point.y;
+        const float distanceSquared = dx * dx + dy * dy;
+        if (distanceSquared <= radius * radius && (best == NO_BODY || distanceSquared < bestDistanceSquared)) {
+            best = i;
+            bestDistanceSquared = distanceSquared;
+        }
+    };
 
-        window_.draw(labelText_);
+    if (threeD) {
+        // No grid in 3D; visible_ already holds every body
+        for (const uint32_t i : visible_) {
+            consider(i);
+        }
+        return best;
     }
+    const double reach = getGridDrift(state) +
+                         std::max(pickRadius, std::max(2.0f, gridMaxVisualRadius_ * getVisualScale()));
+    bodyGrid_.query(point.x - reach, point.y - reach, point.x + reach, point.y + reach, [&](uint32_t i) {
+        if (i < count) consider(i);
+    });
+    return best;
 }
 
-void Renderer::renderVelocityVector(const CelestialBody& body) {
-    sf::Vector2f pos = body.getPosition();
-    sf::Vector2f vel = body.getVelocity();
+void Renderer::beginSplats() {
+    const sf::Vector2u windowSize = window_.getSize();
+    splatColumns_ = windowSize.x / SPLAT_CELL_PIXELS + 1;
+    splatRows_ = windowSize.y / SPLAT_CELL_PIXELS + 1;
+    if (splatCells_.size() != static_cast<size_t>(splatColumns_) * splatRows_) {
+        splatCells_.assign(static_cast<size_t>(splatColumns_) * splatRows_, SplatCell());
+        splatTouched_.clear();
+    }
+    splatVertices_.clear();
+}
+
+void Renderer::addSplat(const sf::Vector2f& position, float pixelRadius, const sf::Color& color) {
+    const sf::FloatRect bounds = getViewBounds();
+    const float pixelsPerUnit = getPixelsPerUnit();
+    const float px = std::max(0.0f, (position.x - bounds.left) * pixelsPerUnit);
+    const float py = std::max(0.0f, (position.y - bounds.top) * pixelsPerUnit);
+    const unsigned int column = std::min(splatColumns_ - 1, static_cast<unsigned int>(px) / SPLAT_CELL_PIXELS);
+    const unsigned int row = std::min(splatRows_ - 1, static_cast<unsigned int>(py) / SPLAT_CELL_PIXELS);
+    const uint32_t index = row * splatColumns_ + column;
+
+    SplatCell& cell = splatCells_[index];
+    if (cell.count == 0) {
+        splatTouched_.push_back(index);
+    }
+    ++cell.count;
+    cell.coverage += 3.14159265f * pixelRadius * pixelRadius;
+    cell.r += color.r;
+    cell.g += color.g;
+    cell.b += color.b;
+}
 
-    // Scale velocity for visualization
-    float scale = 0.001f * getVisualScale();
-    sf::Vector2f endPos = pos + vel * scale;
+void Renderer::finishSplats() {
+    const sf::FloatRect bounds = getViewBounds();
+    const float cellSize = SPLAT_CELL_PIXELS / getPixelsPerUnit();
+    const float cellArea = static_cast<float>(SPLAT_CELL_PIXELS * SPLAT_CELL_PIXELS);
+
+    // One square per occupied cell: the mean colour, as opaque as the bodies in it would cover
+    for (const uint32_t index : splatTouched_) {
+        SplatCell& cell = splatCells_[index];
+        const float alpha = std::min(1.0f, std::max(SPLAT_MIN_ALPHA, cell.coverage / cellArea));
+        const sf::Color color(static_cast<sf::Uint8>(cell.r / cell.count), static_cast<sf::Uint8>(cell.g / cell.count),
+                              static_cast<sf::Uint8>(cell.b / cell.count), static_cast<sf::Uint8>(255 * alpha));
+        const sf::Vector2f corner(bounds.left + (index % splatColumns_) * cellSize,
+                                  bounds.top + (index / splatColumns_) * cellSize);
+        const sf::Vertex a(corner, color);
+        const sf::Vertex b(corner + sf::Vector2f(cellSize, 0.0f), color);
+        const sf::Vertex c(corner + sf::Vector2f(cellSize, cellSize), color);
+        const sf::Vertex d(corner + sf::Vector2f(0.0f, cellSize), color);
+        splatVertices_.append(a);
+        splatVertices_.append(b);
+        splatVertices_.append(c);
+        splatVertices_.append(a);
+        splatVertices_.append(c);
+        splatVertices_.append(d);
+        cell = SplatCell();
+    }
+    splatTouched_.clear();
+}
 
-    // Draw velocity vector as a line
-    sf::Vertex line[] = {
-        sf::Vertex(pos, sf::Color::Green),
-        sf::Vertex(endPos, sf::Color::Green)
+void Renderer::appendBodyQuad(const sf::Vector2f& position, float radius, const sf::Color& color) {
+    // The rim is drawn inside the quad, so grow it by the outline the circle shape used to add outside
+    const float half = radius + 0.5f * getVisualScale();
+    const float t = useBodyShader_ ? 1.0f : static_cast<float>(DISC_TEXTURE_SIZE);
+    const float t0 = useBodyShader_ ? -1.0f : 0.0f;
+    const sf::Vertex corners[4] = {
+        sf::Vertex(position + sf::Vector2f(-half, -half), color, sf::Vector2f(t0, t0)),
+        sf::Vertex(position + sf::Vector2f(half, -half), color, sf::Vector2f(t, t0)),
+        sf::Vertex(position + sf::Vector2f(half, half), color, sf::Vector2f(t, t)),
+        sf::Vertex(position + sf::Vector2f(-half, half), color, sf::Vector2f(t0, t)),
     };
+    bodyVertices_.append(corners[0]);
+    bodyVertices_.append(corners[1]);
+    bodyVertices_.append(corners[2]);
+    bodyVertices_.append(corners[0]);
+    bodyVertices_.append(corners[2]);
+    bodyVertices_.append(corners[3]);
+}
 
-    window_.draw(line, 2, sf::Lines);
+void Renderer::renderGpuBodies(const SolarSystem& solarSystem) {
+    GpuBackend::Camera camera;
+    camera.viewMatrix = view_.getTransform().getMatrix();
+    camera.centerX = center_.x;
+    camera.centerY = center_.y;
+    camera.cameraZ = cameraZ_;
+    camera.pitch = cameraRotationX_;
+    camera.yaw = cameraRotationY_;
+    camera.threeD = solarSystem.is3DMode();
+    camera.pixelsPerUnit = static_cast<float>(window_.getSize().y) / view_.getSize().y;
+    camera.visualScale = getVisualScale();
+
+    // Raw GL draw between SFML draws; SFML's cached state must be reset afterwards
+    window_.setActive(true);
+    gpu_->draw(camera);
+    window_.resetGLStates();
 }
 
-void Renderer::renderForceVector(const CelestialBody& body) {
+void Renderer::renderLabels() {
+    if (labelCandidates_.empty() || font_.getInfo().family.empty()) {
+        return;
+    }
+    const unsigned int characterSize = static_cast<unsigned int>(16 * getVisualScale());
+    labelText_.setFont(font_);
+    labelText_.setFillColor(sf::Color::White);
+
+    const LabelCandidate* hovered = nullptr;
+    if (characterSize * getPixelsPerUnit() >= MIN_LABEL_PIXELS) {
+        labelText_.setCharacterSize(characterSize);
+
+        // Heaviest bodies claim their space first; a label that would overlap one already placed is dropped
+        std::sort(labelCandidates_.begin(), labelCandidates_.end(),
+                  [](const LabelCandidate& a, const LabelCandidate& b) { return a.mass > b.mass; });
+        placedLabels_.clear();
+        for (const LabelCandidate& candidate : labelCandidates_) {
+            if (candidate.hovered) {
+                continue;
+            }
+            labelText_.setString(getLabelString(candidate));
+            labelText_.setPosition(candidate.position.x + candidate.radius + 5, candidate.position.y - 8);
+            const sf::FloatRect box = labelText_.getGlobalBounds();
+            bool overlaps = false;
+            for (const sf::FloatRect& placed : placedLabels_) {
+                if (placed.intersects(box)) {
+                    overlaps = true;
+                    break;
+                }
+            }
+            if (overlaps) {
+                continue;
+            }
+            placedLabels_.push_back(box);
+            window_.draw(labelText_);
+            if (placedLabels_.size() >= MAX_LABELS) {
+                break;
+            }
+        }
+    }
+    for (const LabelCandidate& candidate : labelCandidates_) {
+        if (candidate.hovered) {
+            hovered = &candidate;
+        }
+    }
+
+    // The hovered body's label goes on top in screen space, readable at any zoom
+    if (hovered) {
+        const sf::Vector2i anchor = worldToScreen(hovered->position + sf::Vector2f(hovered->radius, 0.0f));
+        labelText_.setCharacterSize(16);
+        labelText_.setString(getLabelString(*hovered));
+        labelText_.setPosition(static_cast<float>(anchor.x + 5), static_cast<float>(anchor.y - 8));
+        window_.setView(window_.getDefaultView());
+        window_.draw(labelText_);
+        window_.setView(view_);
+    }
+}
+
+const sf::String& Renderer::getLabelString(const LabelCandidate& candidate) {
+    auto it = labelStrings_.find(candidate.index);
+    if (it == labelStrings_.end()) {
+        const std::string& name = candidate.body->getName();
+        it = labelStrings_.emplace(candidate.index, name.empty() ? "#" + std::to_string(candidate.index) : name).first;
+    }
+    return it->second;
+}
+
+void Renderer::appendVelocityVector(const sf::Vector2f& position, const sf::Vector2f& velocity) {
+    // Scale velocity for visualization: one world unit per km/s
+    float scale = static_cast<float>(0.001 / Physics::DISTANCE_SCALE) * getVisualScale();
+    sf::Vector2f endPos = position + velocity * scale;
+
+    vectorVertices_.append(sf::Vertex(position, sf::Color::Green));
+    vectorVertices_.append(sf::Vertex(endPos, sf::Color::Green));
+}
+
+void Renderer::renderForceVector(const CelestialBody& /*body*/) {
     // This would require access to current forces, which we don't have in the rendering phase
     // Could be implemented by storing force information in the celestial body
 }
@@ -231,16 +584,71 @@ void Renderer::renderGrid() {
     }
 }
 
-void Renderer::renderUI(const SolarSystem& solarSystem, double deltaTime) {
-    if (font_.getInfo().family.empty()) return;
+bool Renderer::StatusKey::operator==(const StatusKey& other) const {
+    return bodies == other.bodies && particles == other.particles && merged == other.merged &&
+           gpuBodies == other.gpuBodies && timeScale == other.timeScale && zoom == other.zoom &&
+           cameraZ == other.cameraZ && pitch == other.pitch && yaw == other.yaw && solver == other.solver &&
+           integrator == other.integrator && threeD == other.threeD && collisions == other.collisions &&
+           spacetime == other.spacetime && paused == other.paused;
+}
+
+void Renderer::updateStatus(const SolarSystem& solarSystem, double deltaTime) {
+    // Substep counts, drift and the FMM error only change the text slowly enough to read
+    const bool onGpu = gpu_ && gpu_->isActive();
+    const StatusKey key = {
+        solarSystem.getBodyCount(), solarSystem.getTestParticleCount(), solarSystem.getMergeCount(),
+        onGpu ? gpu_->getBodyCount() : 0, solarSystem.getTimeScale(), zoom_, cameraZ_,
+        cameraRotationX_, cameraRotationY_, &solarSystem.getForceSolver(), &solarSystem.getIntegrator(),
+        solarSystem.is3DMode(), solarSystem.getCollisions(), showSpacetimeWarping_, solarSystem.isPaused()
+    };
+    statusAge_ += deltaTime;
+    if (statusValid_ && key == statusKey_ && statusAge_ < STATUS_REFRESH_SECONDS) {
+        return;
+    }
+    statusKey_ = key;
+    statusAge_ = 0.0;
+    statusValid_ = true;
 
     std::stringstream ss;
     ss << std::fixed << std::setprecision(2);
     ss << "Solar System Gravity Simulator\n";
     ss << "Bodies: " << solarSystem.getBodyCount() << "\n";
+    if (solarSystem.getTestParticleCount() > 0) {
+        ss << "Test particles: " << solarSystem.getTestParticleCount() << "\n";
+    }
     ss << "Time Scale: " << solarSystem.getTimeScale() << "x\n";
     ss << "Zoom: " << zoom_ << "x\n";
     ss << "Mode: " << (solarSystem.is3DMode() ? "3D" : "2D") << "\n";
+    if (solarSystem.getCollisions()) {
+        ss << "Collisions: on (" << solarSystem.getMergeCount() << " merged)\n";
+    }
+    if (onGpu) {
+        ss << "Backend: GPU (" << gpu_->getBodyCount() << " bodies)\n";
+    }
+    ss << "Solver: " << solarSystem.getForceSolver().getName();
+    if (const auto* fmm = dynamic_cast<const FmmSolver*>(&solarSystem.getForceSolver())) {
+        if (fmm->getErrorEstimate().samples > 0) {
+            ss << " (err " << std::scientific << std::setprecision(1)
+               << fmm->getErrorEstimate().rmsRelative << std::fixed << std::setprecision(2) << ")";
+        }
+    }
+    ss << "\n";
+    ss << "Integrator: " << solarSystem.getIntegrator().getName();
+    if (const auto* rk = dynamic_cast<const DormandPrinceIntegrator*>(&solarSystem.getIntegrator())) {
+        ss << " (" << rk->getAcceptedSubsteps() << " substeps";
+        if (solarSystem.getShortStepCount() > 0) {
+            ss << ", " << solarSystem.getShortStepCount() << " steps cut short";
+        }
+        ss << ")";
+    } else if (const auto* block = dynamic_cast<const BlockTimestepIntegrator*>(&solarSystem.getIntegrator())) {
+        ss << " (level " << block->getDeepestLevel() << ", " << block->getSubstepCount() << " substeps)";
+    }
+    ss << "\n";
+    const SolarSystem::Diagnostics& diagnostics = solarSystem.getDiagnostics();
+    if (diagnostics.valid && !onGpu) {
+        ss << "Energy drift: " << std::scientific << std::setprecision(1) << diagnostics.energyDrift
+           << " (L " << diagnostics.angularMomentumDrift << ")" << std::fixed << std::setprecision(2) << "\n";
+    }
     ss << "Spacetime: " << (showSpacetimeWarping_ ? "ON" : "OFF") << "\n";
     if (solarSystem.is3DMode()) {
         ss << "Camera Z: " << cameraZ_ << "\n";
@@ -264,44 +672,151 @@ void Renderer::renderUI(const SolarSystem& solarSystem, double deltaTime) {
     ss << "M: Toggle 2D/3D mode\n";
     ss << "X: Toggle spacetime warping\n";
     ss << "+/-: Adjust time scale\n";
+    ss << "B: Cycle force solver\n";
+    ss << "N: Cycle integrator\n";
+    ss << "U: Toggle GPU backend\n";
+    ss << "P: Toggle collisions\n";
     ss << "ESC: Exit\n";
+    statusLabel_.setString(ss.str());
+}
 
-    labelText_.setFont(font_);
-    labelText_.setString(ss.str());
-    labelText_.setCharacterSize(14);
-    labelText_.setFillColor(sf::Color::White);
-    labelText_.setPosition(10, 10);
+void Renderer::renderUI() {
+    if (font_.getInfo().family.empty()) return;
 
-    window_.draw(labelText_);
+    window_.draw(statusLabel_);
 }
 
-void Renderer::updateTrails(const SolarSystem& solarSystem) {
-    const auto& bodies = solarSystem.getBodies();
-
-    // Resize trails vector if needed
-    if (trails_.size() != bodies.size()) {
-        trails_.resize(bodies.size());
+void Renderer::renderProfiler() {
+    const uint64_t now = Profiler::now();
+    const uint64_t since = now > 2 * PROFILER_WINDOW_NS ? now - 2 * PROFILER_WINDOW_NS : 0;
+    const std::vector<Profiler::Event> events = Profiler::collect(since);
+    const uint32_t thread = Profiler::getThreadIndex();
+
+    // Frames of this thread, oldest first, bounded by its frame marks
+    std::vector<uint64_t> marks;
+    for (const Profiler::Event& event : events) {
+        if (event.type == Profiler::Type::Frame && event.thread == thread) {
+            marks.push_back(event.start);
+        }
+    }
+    if (marks.size() > PROFILER_FRAMES + 1) {
+        marks.erase(marks.begin(), marks.end() - (PROFILER_FRAMES + 1));
     }
 
-    // Add current positions to trails
-    for (size_t i = 0; i < bodies.size(); ++i) {
-        TrailPoint point;
-        point.position = bodies[i]->getPosition();
-        point.color = bodies[i]->getColor();
-        point.alpha = 1.0f;
+    // Scopes get colours in order of first appearance, the same in the bars and the table
+    std::vector<std::string> names;
+    auto colorOf = [&names](const char* name) {
+        const auto it = std::find(names.begin(), names.end(), name);
+        const size_t index = it - names.begin();
+        if (it == names.end()) {
+            names.push_back(name);
+        }
+        return PROFILER_COLORS[index % PROFILER_COLOR_COUNT];
+    };
 
-        trails_[i].push_back(point);
+    const sf::Vector2u windowSize = window_.getSize();
+    const float left = 10.0f;
+    const float baseline = static_cast<float>(windowSize.y) - 10.0f;
+    auto addRect = [this](float x0, float y0, float x1, float y1, const sf::Color& color) {
+        profilerVertices_.append(sf::Vertex(sf::Vector2f(x0, y0), color));
+        profilerVertices_.append(sf::Vertex(sf::Vector2f(x1, y0), color));
+        profilerVertices_.append(sf::Vertex(sf::Vector2f(x1, y1), color));
+        profilerVertices_.append(sf::Vertex(sf::Vector2f(x0, y0), color));
+        profilerVertices_.append(sf::Vertex(sf::Vector2f(x1, y1), color));
+        profilerVertices_.append(sf::Vertex(sf::Vector2f(x0, y1), color));
+    };
 
-        // Remove old trail points
-        if (trails_[i].size() > maxTrailLength_) {
-            trails_[i].pop_front();
+    // Each frame is a grey bar of its whole duration with its scopes stacked over it in colour;
+    // the two lines mark 60 and 30 frames per second
+    profilerVertices_.clear();
+    const float graphWidth = PROFILER_FRAMES * PROFILER_BAR_PIXELS;
+    addRect(left, baseline - 16.7f * PROFILER_PIXELS_PER_MS, left + graphWidth, baseline - 16.7f * PROFILER_PIXELS_PER_MS + 1.0f,
+            sf::Color(255, 255, 255, 80));
+    addRect(left, baseline - 33.3f * PROFILER_PIXELS_PER_MS, left + graphWidth, baseline - 33.3f * PROFILER_PIXELS_PER_MS + 1.0f,
+            sf::Color(255, 255, 255, 80));
+    size_t e = 0;
+    for (size_t f = 0; f + 1 < marks.size(); ++f) {
+        const float x0 = left + f * PROFILER_BAR_PIXELS;
+        const float x1 = x0 + PROFILER_BAR_PIXELS - 1.0f;
+        addRect(x0, baseline - (marks[f + 1] - marks[f]) * 1e-6f * PROFILER_PIXELS_PER_MS, x1, baseline,
+                sf::Color(90, 90, 90, 200));
+        float top = baseline;
+        for (; e < events.size() && events[e].start < marks[f + 1]; ++e) {
+            const Profiler::Event& event = events[e];
+            if (event.type != Profiler::Type::Scope || event.thread != thread || event.start < marks[f]) {
+                continue;
+            }
+            const float height = event.duration * 1e-6f * PROFILER_PIXELS_PER_MS;
+            addRect(x0, top - height, x1, top, colorOf(event.name));
+            top -= height;
+        }
+    }
+    window_.draw(profilerVertices_);
+
+    // Every thread's scopes over the last window
+    struct Row {
+        std::string name;
+        uint32_t thread;
+        size_t calls = 0;
+        uint64_t total = 0;
+        uint64_t longest = 0;
+    };
+    std::vector<Row> rows;
+    const uint64_t windowStart = now > PROFILER_WINDOW_NS ? now - PROFILER_WINDOW_NS : 0;
+    for (const Profiler::Event& event : events) {
+        if (event.type != Profiler::Type::Scope || event.start < windowStart) {
+            continue;
+        }
+        auto it = std::find_if(rows.begin(), rows.end(), [&event](const Row& row) {
+            return row.thread == event.thread && row.name == event.name;
+        });
+        if (it == rows.end()) {
+            rows.push_back({event.name, event.thread});
+            it = rows.end() - 1;
         }
+        ++it->calls;
+        it->total += event.duration;
+        it->longest = std::max(it->longest, event.duration);
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+        return a.thread != b.thread ? a.thread < b.thread : a.total > b.total;
+    });
 
-        // Update alpha values for fade effect
-        for (size_t j = 0; j < trails_[i].size(); ++j) {
-            float t = static_cast<float>(j) / static_cast<float>(trails_[i].size());
-            trails_[i][j].alpha = t * t; // Quadratic fade
+    if (font_.getInfo().family.empty()) return;
+    const double windowSeconds = PROFILER_WINDOW_NS * 1e-9;
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "Profiler (last " << std::setprecision(0) << windowSeconds << " s)" << std::setprecision(2) << "\n";
+    uint32_t lastThread = UINT32_MAX;
+    for (const Row& row : rows) {
+        if (row.thread != lastThread) {
+            ss << "[" << Profiler::getThreadName(row.thread) << "]\n";
+            lastThread = row.thread;
         }
+        ss << "  " << row.name << ": " << row.calls / windowSeconds << "/s, "
+           << row.total * 1e-6 / row.calls << " ms avg, " << row.longest * 1e-6 << " ms max, "
+           << std::setprecision(1) << 100.0 * row.total * 1e-9 / windowSeconds << "%" << std::setprecision(2) << "\n";
+    }
+    if (rows.empty()) {
+        ss << "  (recording off)\n";
+    }
+    labelText_.setFont(font_);
+    labelText_.setString(ss.str());
+    labelText_.setCharacterSize(12);
+    labelText_.setFillColor(sf::Color::White);
+    const sf::FloatRect textBounds = labelText_.getLocalBounds();
+    labelText_.setPosition(static_cast<float>(windowSize.x) - textBounds.width - 20.0f, 10.0f);
+    window_.draw(labelText_);
+
+    // Colour key for the bars
+    float keyX = left;
+    const float keyY = baseline - 40.0f * PROFILER_PIXELS_PER_MS - 16.0f;
+    for (size_t i = 0; i < names.size(); ++i) {
+        labelText_.setString(names[i]);
+        labelText_.setFillColor(PROFILER_COLORS[i % PROFILER_COLOR_COUNT]);
+        labelText_.setPosition(keyX, keyY);
+        window_.draw(labelText_);
+        keyX += labelText_.getLocalBounds().width + 12.0f;
     }
 }
 
@@ -331,8 +846,30 @@ bool Renderer::loadFont() {
     return false;
 }
 
-float Renderer::calculateBodyVisualRadius(const CelestialBody& body) const {
-    float baseRadius = body.getVisualRadius();
+void Renderer::loadBodyShader() {
+    useBodyShader_ = sf::Shader::isAvailable() &&
+                     bodyShader_.loadFromMemory(BODY_VERTEX_SHADER, BODY_FRAGMENT_SHADER);
+    if (useBodyShader_) {
+        return;
+    }
+
+    // Without shaders the quads are textured with a soft-edged disc; the vertex
+    // colour tints the whole texture, so this path has no white rim
+    sf::Image disc;
+    disc.create(DISC_TEXTURE_SIZE, DISC_TEXTURE_SIZE, sf::Color::Transparent);
+    const float centre = 0.5f * DISC_TEXTURE_SIZE;
+    for (unsigned int y = 0; y < DISC_TEXTURE_SIZE; ++y) {
+        for (unsigned int x = 0; x < DISC_TEXTURE_SIZE; ++x) {
+            const float dx = x + 0.5f - centre, dy = y + 0.5f - centre;
+            const float coverage = std::max(0.0f, std::min(1.0f, centre - std::sqrt(dx * dx + dy * dy)));
+            disc.setPixel(x, y, sf::Color(255, 255, 255, static_cast<sf::Uint8>(255 * coverage)));
+        }
+    }
+    discTexture_.loadFromImage(disc);
+    discTexture_.setSmooth(true);
+}
+
+float Renderer::calculateBodyVisualRadius(float baseRadius) const {
     float scaledRadius = baseRadius * getVisualScale();
 
     // Ensure minimum visibility
@@ -345,118 +882,78 @@ sf::Color Renderer::adjustColorAlpha(const sf::Color& color, sf::Uint8 alpha) co
     return adjustedColor;
 }
 
-float Renderer::calculateSpacetimeCurvature(const sf::Vector2f& position,
-                                          const SolarSystem& solarSystem) const {
-    const auto& bodies = solarSystem.getBodies();
-    float totalCurvature = 0.0f;
-
-    // Calculate gravitational field strength at this point
-    for (const auto& body : bodies) {
-        sf::Vector2f bodyPos = body->getPosition();
-        sf::Vector2f diff = position - bodyPos;
-        float distance = Physics::magnitude(diff);
-
-        // Prevent division by zero
-        if (distance < 1.0f) {
-            distance = 1.0f;
-        }
-
-        // Schwarzschild radius approximation for curvature visualization
-        // This is a simplified model for educational purposes
-        float mass = body->getMass();
-        float schwarzschildRadius = 2.0f * mass / (3e8 * 3e8); // Simplified calculation
-
-        // Calculate curvature based on gravitational potential
-        float curvature = schwarzschildRadius / (distance * distance);
-        totalCurvature += curvature;
-    }
+float Renderer::calculateSpacetimeCurvature(const sf::Vector2f& position) const {
+    // Schwarzschild radius approximation for curvature visualization
+    // This is a simplified model for educational purposes
+    const float schwarzschildFactor = 2.0f / (3e8f * 3e8f);
+    const float totalCurvature = schwarzschildFactor * warpField_.evaluate(position);
 
     // Normalize curvature for visualization
     return std::min(1.0f, totalCurvature * 1e15f); // Scale factor for visibility
 }
 
-void Renderer::renderSpacetimeWarpingGrid(const SolarSystem& solarSystem) {
+void Renderer::renderSpacetimeWarpingGrid(const SolarSystem& solarSystem, const StateSnapshot& state) {
     if (!showSpacetimeWarping_) {
         return;
     }
 
-    sf::FloatRect bounds = getViewBounds();
-    float gridSpacing = 100.0f / zoom_; // Adaptive grid spacing for spacetime
-
-    // Create vertex array for the warped grid
-    sf::VertexArray grid(sf::Lines);
-
-    // Draw vertical grid lines with curvature
-    float startX = std::floor(bounds.left / gridSpacing) * gridSpacing;
-    for (float x = startX; x < bounds.left + bounds.width; x += gridSpacing) {
-        std::vector<sf::Vertex> vertices;
+    // The lines only change with the view or once bodies have moved by about a pixel
+    const sf::FloatRect bounds = getViewBounds();
+    const double drift = warpField_.getMaxSpeed() * std::abs(state.simulationTime - warpSimulationTime_);
+    if (bounds == warpBounds_ && state.revision == warpRevision_ && state.size() == warpCount_ &&
+        drift * getPixelsPerUnit() < WARP_TOLERANCE_PIXELS) {
+        window_.draw(warpVertices_);
+        return;
+    }
+    warpField_.build(solarSystem, state);
+    warpBounds_ = bounds;
+    warpRevision_ = state.revision;
+    warpCount_ = state.size();
+    warpSimulationTime_ = state.simulationTime;
 
-        float startY = bounds.top;
-        float endY = bounds.top + bounds.height;
-        int segments = 20; // Number of segments per line for smooth curves
+    float gridSpacing = 100.0f / zoom_; // Adaptive grid spacing for spacetime
+    const int segments = 20; // Number of segments per line for smooth curves
+    warpVertices_.clear();
 
+    // One line from start to end, displaced across itself by the curvature along it
+    auto appendLine = [&](const sf::Vector2f& start, const sf::Vector2f& end, const sf::Vector2f& across) {
+        sf::Vertex previous;
         for (int i = 0; i <= segments; ++i) {
             float t = static_cast<float>(i) / static_cast<float>(segments);
-            float y = startY + t * (endY - startY);
+            sf::Vector2f gridPoint = start + (end - start) * t;
 
             // Calculate curvature at this point
-            sf::Vector2f gridPoint(x, y);
-            float curvature = calculateSpacetimeCurvature(gridPoint, solarSystem);
+            float curvature = calculateSpacetimeCurvature(gridPoint);
 
-            // Apply warping effect to x position
-            float warpOffset = curvature * 50.0f * std::sin(t * 3.14159f); // Sine wave warping
-            float warpedX = x + warpOffset;
+            // Sine wave warping
+            float warpOffset = curvature * 50.0f * std::sin(t * 3.14159f);
 
             // Color based on curvature intensity
             sf::Uint8 intensity = static_cast<sf::Uint8>(255 * (1.0f - curvature));
             sf::Color lineColor(intensity, intensity, 255, 128); // Blue tinted, semi-transparent
 
-            vertices.push_back(sf::Vertex(sf::Vector2f(warpedX, y), lineColor));
+            const sf::Vertex vertex(gridPoint + across * warpOffset, lineColor);
+            if (i > 0) {
+                warpVertices_.append(previous);
+                warpVertices_.append(vertex);
+            }
+            previous = vertex;
         }
+    };
 
-        // Add vertices to grid
-        for (size_t i = 0; i < vertices.size() - 1; ++i) {
-            grid.append(vertices[i]);
-            grid.append(vertices[i + 1]);
-        }
+    // Vertical grid lines, warped along x
+    float startX = std::floor(bounds.left / gridSpacing) * gridSpacing;
+    for (float x = startX; x < bounds.left + bounds.width; x += gridSpacing) {
+        appendLine(sf::Vector2f(x, bounds.top), sf::Vector2f(x, bounds.top + bounds.height), sf::Vector2f(1.0f, 0.0f));
     }
 
-    // Draw horizontal grid lines with curvature
+    // Horizontal grid lines, warped along y
     float startY = std::floor(bounds.top / gridSpacing) * gridSpacing;
     for (float y = startY; y < bounds.top + bounds.height; y += gridSpacing) {
-        std::vector<sf::Vertex> vertices;
-
-        float startX2 = bounds.left;
-        float endX = bounds.left + bounds.width;
-        int segments = 20; // Number of segments per line for smooth curves
-
-        for (int i = 0; i <= segments; ++i) {
-            float t = static_cast<float>(i) / static_cast<float>(segments);
-            float x = startX2 + t * (endX - startX2);
-
-            // Calculate curvature at this point
-            sf::Vector2f gridPoint(x, y);
-            float curvature = calculateSpacetimeCurvature(gridPoint, solarSystem);
-
-            // Apply warping effect to y position
-            float warpOffset = curvature * 50.0f * std::sin(t * 3.14159f); // Sine wave warping
-            float warpedY = y + warpOffset;
-
-            // Color based on curvature intensity
-            sf::Uint8 intensity = static_cast<sf::Uint8>(255 * (1.0f - curvature));
-            sf::Color lineColor(intensity, intensity, 255, 128); // Blue tinted, semi-transparent
-
-            vertices.push_back(sf::Vertex(sf::Vector2f(x, warpedY), lineColor));
-        }
-
-        // Add vertices to grid
-        for (size_t i = 0; i < vertices.size() - 1; ++i) {
-            grid.append(vertices[i]);
-            grid.append(vertices[i + 1]);
-        }
+        appendLine(sf::Vector2f(bounds.left, y), sf::Vector2f(bounds.left + bounds.width, y), sf::Vector2f(0.0f, 1.0f));
     }
 
-    window_.draw(grid);
+    window_.draw(warpVertices_);
 }
 
 // 3D Camera control methods
@@ -483,41 +980,3 @@ void Renderer::rotateCameraY(float deltaAngle) {
     while (cameraRotationY_ > 6.28f) cameraRotationY_ -= 6.28f;
     while (cameraRotationY_ < 0.0f) cameraRotationY_ += 6.28f;
 }
-
-sf::Vector2f Renderer::project3DTo2D(const Vector3f& position3D, const SolarSystem& solarSystem) const {
-    if (!solarSystem.is3DMode()) {
-        // In 2D mode, just return the X,Y coordinates
-        return sf::Vector2f(position3D.x, position3D.y);
-    }
-
-    // Apply 3D camera transformations
-    // First translate by camera position
-    float x = position3D.x - center_.x;
-    float y = position3D.y - center_.y;
-    float z = position3D.z - cameraZ_;
-
-    // Apply rotations
-    // Rotation around X-axis (pitch)
-    float cosX = std::cos(cameraRotationX_);
-    float sinX = std::sin(cameraRotationX_);
-    float y_rotX = y * cosX - z * sinX;
-    float z_rotX = y * sinX + z * cosX;
-
-    // Rotation around Y-axis (yaw)
-    float cosY = std::cos(cameraRotationY_);
-    float sinY = std::sin(cameraRotationY_);
-    float x_rot = x * cosY + z_rotX * sinY;
-    float z_rot = -x * sinY + z_rotX * cosY;
-
-    // Perspective projection
-    float perspective_distance = 1000.0f; // Distance to "screen"
-    if (z_rot < -perspective_distance) z_rot = -perspective_distance + 1.0f; // Prevent division by zero
-
-    float depth_factor = perspective_distance / (perspective_distance + z_rot);
-
-    // Apply the depth factor and add back the camera center offset
-    float projected_x = x_rot * depth_factor + center_.x;
-    float projected_y = y_rotX * depth_factor + center_.y;
-
-    return sf::Vector2f(projected_x, projected_y);
-}
@@ -2,8 +2,15 @@
 #include <SFML/Graphics.hpp>
 #include "SolarSystem.h"
 #include "CelestialBody.h"
+#include "StateSnapshot.h"
+#include "TrailRenderer.h"
+#include "BodyGrid.h"
+#include "GravityField.h"
+#include "CameraProjection.h"
+#include <unordered_map>
 #include <vector>
-#include <deque>
+
+class GpuBackend;
 
 /**
  * Handles all rendering operations for the gravity simulation
@@ -13,8 +20,12 @@ public:
     Renderer(sf::RenderWindow& window);
     ~Renderer() = default;
 
-    // Main rendering method
-    void render(const SolarSystem& solarSystem, double deltaTime);
+    // Main rendering method; body positions and velocities come from state, not the live store
+    void render(const SolarSystem& solarSystem, const StateSnapshot& state, double deltaTime);
+
+    // Rebuild the status overlay from the system's settings and statistics;
+    // call where the system cannot change underneath (the physics mutex held)
+    void updateStatus(const SolarSystem& solarSystem, double deltaTime);
 
     // Camera controls
     void setZoom(float zoom);
@@ -57,23 +68,39 @@ public:
     void setShowSpacetimeWarping(bool show) { showSpacetimeWarping_ = show; }
     bool getShowSpacetimeWarping() const { return showSpacetimeWarping_; }
 
+    // Frame profiler overlay: recent frame times split by the scopes they went to, and a table of
+    // every thread's scopes; it shows what Profiler records but does not turn recording on
+    void setShowProfiler(bool show) { showProfiler_ = show; }
+    bool getShowProfiler() const { return showProfiler_; }
+
     // Alternative method names for compatibility
     void setSpacetimeWarpingEnabled(bool enabled) { showSpacetimeWarping_ = enabled; }
     bool isSpacetimeWarpingEnabled() const { return showSpacetimeWarping_; }
 
     // Trail management
     void clearTrails();
-    void setMaxTrailLength(size_t maxLength) { maxTrailLength_ = maxLength; }
-    size_t getMaxTrailLength() const { return maxTrailLength_; }
+    void setMaxTrailLength(size_t maxLength) { trails_.setLength(maxLength); }
+    size_t getMaxTrailLength() const { return trails_.getLength(); }
+
+    // Draw bodies from the GPU backend's buffers while it owns the simulation state
+    void setGpuBackend(GpuBackend* gpu) { gpu_ = gpu; }
+
+    // Body under the mouse pointer as of the last frame, or NO_BODY; found through the culling grid
+    static constexpr size_t NO_BODY = static_cast<size_t>(-1);
+    void setPointer(const sf::Vector2i& screenPosition) { pointer_ = screenPosition; hasPointer_ = true; }
+    void clearPointer() { hasPointer_ = false; }
+    size_t getHoveredBody() const { return hoveredBody_; }
 
-    // Get camera bounds for optimization
+    // Visible rectangle in world units; bodies, splats and labels outside it are skipped
     sf::FloatRect getViewBounds() const;
+    float getPixelsPerUnit() const;
 
     // Visual scaling for different zoom levels
     float getVisualScale() const;
 
 private:
     sf::RenderWindow& window_;
+    GpuBackend* gpu_;
     sf::View view_;
     sf::Font font_;
 
@@ -85,6 +112,7 @@ private:
     float cameraZ_;            // Z-axis position for 3D viewing
     float cameraRotationX_;    // Rotation around X-axis (pitch)
     float cameraRotationY_;    // Rotation around Y-axis (yaw)
+    CameraProjection projection_;  // The camera above, refreshed at the start of each frame
 
     // Visual options
     bool showTrails_;
@@ -93,40 +121,121 @@ private:
     bool showForceVectors_;
     bool showGrid_;
     bool showSpacetimeWarping_;
+    bool showProfiler_ = false;
 
     // Trail system
-    struct TrailPoint {
+    TrailRenderer trails_;
+
+    // View culling: bodies are filed in a grid over their x-y positions, rebuilt only
+    // as often as they drift out of their cells, and visible_ holds the candidates it
+    // returns for the current view (every body in 3D mode)
+    BodyGrid bodyGrid_;
+    uint64_t gridRevision_;
+    size_t gridCount_;
+    double gridSimulationTime_;
+    double gridMaxSpeed_;           // Fastest body at the build, world units per simulated second
+    float gridMaxVisualRadius_;
+    std::vector<uint32_t> visible_;
+
+    sf::Vector2i pointer_;
+    bool hasPointer_ = false;
+    size_t hoveredBody_ = NO_BODY;
+
+    // Bodies too small to see are summed into a screen-space grid and drawn as one square per cell
+    struct SplatCell {
+        uint32_t count = 0;
+        float coverage = 0.0f;      // Total disc area in pixels
+        float r = 0.0f, g = 0.0f, b = 0.0f;
+    };
+    std::vector<SplatCell> splatCells_;
+    std::vector<uint32_t> splatTouched_;
+    std::vector<sf::Vector2f> particleProjected_;  // Test particles on screen in 3D, projected in one pass
+    unsigned int splatColumns_ = 0, splatRows_ = 0;
+    sf::VertexArray splatVertices_;
+
+    // Labels are laid out after the bodies, largest mass first, without overlaps
+    struct LabelCandidate {
+        const CelestialBody* body;   // For its name, which never changes
+        double mass;
+        size_t index;
         sf::Vector2f position;
-        sf::Color color;
-        float alpha;
+        float radius;
+        bool hovered;           // Placed first and shown at any size
     };
-    std::vector<std::deque<TrailPoint>> trails_; // One trail per celestial body
-    size_t maxTrailLength_;
+    std::vector<LabelCandidate> labelCandidates_;
+    std::vector<sf::FloatRect> placedLabels_;
+    // Label strings by body index, kept until bodies are added, removed or replaced, so a
+    // frame does not convert every visible name again
+    std::unordered_map<size_t, sf::String> labelStrings_;
+    uint64_t labelLayout_ = 0;
+
+    // Spacetime grid: the field is approximated by warpField_ and the lines are kept
+    // until the view changes or the bodies have moved
+    GravityField warpField_;
+    sf::FloatRect warpBounds_;
+    uint64_t warpRevision_;
+    size_t warpCount_;
+    double warpSimulationTime_;
+    sf::VertexArray warpVertices_;
+
+    // Bodies are drawn as one batch of camera-facing quads per frame, shaded as
+    // circles by bodyShader_ or, without shader support, textured with discTexture_
+    sf::VertexArray bodyVertices_;
+    sf::VertexArray vectorVertices_;  // Velocity vectors, also one batch
+    sf::Shader bodyShader_;
+    sf::Texture discTexture_;
+    bool useBodyShader_;
+
+    // Profiler overlay bars, rebuilt each frame it is shown
+    sf::VertexArray profilerVertices_;
 
     // Rendering shapes (reused for performance)
-    sf::CircleShape circleShape_;
     sf::RectangleShape lineShape_;
     sf::Text labelText_;
 
+    // The status text is laid out again when a setting it shows changes, otherwise only every
+    // STATUS_REFRESH_SECONDS for the running figures
+    struct StatusKey {
+        size_t bodies, particles, merged, gpuBodies;
+        double timeScale;
+        float zoom, cameraZ, pitch, yaw;
+        const void* solver;
+        const void* integrator;
+        bool threeD, collisions, spacetime, paused;
+
+        bool operator==(const StatusKey& other) const;
+    };
+    StatusKey statusKey_ = {};
+    double statusAge_ = 0.0;
+    bool statusValid_ = false;
+    sf::Text statusLabel_;
+
     // Private methods
-    void renderCelestialBody(const CelestialBody& body, size_t bodyIndex, const SolarSystem& solarSystem);
-    void renderTrail(size_t bodyIndex);
-    void renderLabel(const CelestialBody& body);
-    void renderVelocityVector(const CelestialBody& body);
+    void renderBodies(const SolarSystem& solarSystem, const StateSnapshot& state);
+    void findVisibleBodies(const SolarSystem& solarSystem, const StateSnapshot& state, size_t count);
+    double getGridDrift(const StateSnapshot& state) const;
+    size_t pickBody(const sf::Vector2f& point, const SolarSystem& solarSystem, const StateSnapshot& state,
+                    size_t count) const;
+    void appendBodyQuad(const sf::Vector2f& position, float radius, const sf::Color& color);
+    void beginSplats();
+    void addSplat(const sf::Vector2f& position, float pixelRadius, const sf::Color& color);
+    void finishSplats();
+    void renderLabels();
+    const sf::String& getLabelString(const LabelCandidate& candidate);
+    void appendVelocityVector(const sf::Vector2f& position, const sf::Vector2f& velocity);
     void renderForceVector(const CelestialBody& body);
     void renderGrid();
-    void renderSpacetimeWarpingGrid(const SolarSystem& solarSystem);
-    void renderUI(const SolarSystem& solarSystem, double deltaTime);
+    void renderSpacetimeWarpingGrid(const SolarSystem& solarSystem, const StateSnapshot& state);
+    void renderUI();
+    void renderProfiler();
+    void renderGpuBodies(const SolarSystem& solarSystem);
 
-    void updateTrails(const SolarSystem& solarSystem);
     void updateView();
 
     // Helper methods
     bool loadFont();
-    float calculateBodyVisualRadius(const CelestialBody& body) const;
+    void loadBodyShader();
+    float calculateBodyVisualRadius(float baseRadius) const;
     sf::Color adjustColorAlpha(const sf::Color& color, sf::Uint8 alpha) const;
-    float calculateSpacetimeCurvature(const sf::Vector2f& point, const SolarSystem& solarSystem) const;
-
-    // 3D projection helper
-    sf::Vector2f project3DTo2D(const Vector3f& position3D, const SolarSystem& solarSystem) const;
+    float calculateSpacetimeCurvature(const sf::Vector2f& point) const;
 };
@@ -0,0 +1,635 @@
+#include "Scenario.h"
+#include "Physics.h"
+#include "MappedFile.h"
+#include "Ephemeris.h"
+#include "Checkpoint.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+
+namespace {
+
+constexpr char BINARY_MAGIC[8] = {'G', 'R', 'A', 'V', 'S', 'C', 'E', 'N'};
+constexpr uint32_t FLAG_THREE_D = 1u << 0;
+constexpr double TWO_PI = 6.283185307179586;
+
+struct BinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t bodyCount;
+    uint64_t beltCount;
+    uint64_t nameBytes;
+    uint64_t sourceCount;
+    double epoch;
+};
+
+// Followed by pathBytes of path
+struct BinarySource {
+    uint64_t pathBytes;
+    uint64_t bytes;
+    int64_t modified;
+};
+
+struct BinaryBelt {
+    uint32_t parent;
+    uint32_t color;
+    uint64_t count;
+    uint64_t seed;
+    double innerRadius, outerRadius, thickness, minMass, maxMass;
+    float visualRadius;
+    uint32_t reserved;
+};
+
+uint32_t packColor(const Color& c) {
+    return uint32_t(c.r) | uint32_t(c.g) << 8 | uint32_t(c.b) << 16 | uint32_t(c.a) << 24;
+}
+
+Color unpackColor(uint32_t c) {
+    return Color(c & 0xff, (c >> 8) & 0xff, (c >> 16) & 0xff, c >> 24);
+}
+
+// splitmix64: a full-period counter-based generator, so particle i needs no state from i - 1
+uint64_t mix(uint64_t z) {
+    z += 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1) from the top 53 bits
+double unit(uint64_t bits) {
+    return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+std::string trim(const std::string& s) {
+    const size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return std::string();
+    const size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+std::vector<std::string> splitFields(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t begin = 0;
+    for (;;) {
+        const size_t comma = line.find(',', begin);
+        fields.push_back(trim(line.substr(begin, comma == std::string::npos ? std::string::npos : comma - begin)));
+        if (comma == std::string::npos) break;
+        begin = comma + 1;
+    }
+    return fields;
+}
+
+bool parseNumber(const std::string& text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && std::isfinite(value);
+}
+
+bool parseInteger(const std::string& text, uint64_t& value) {
+    char* end = nullptr;
+    value = std::strtoull(text.c_str(), &end, 10);
+    return !text.empty() && text[0] != '-' && *end == '\0';
+}
+
+bool parseColor(const std::string& text, Color& color) {
+    if ((text.size() != 7 && text.size() != 9) || text[0] != '#') return false;
+    char* end = nullptr;
+    const unsigned long value = std::strtoul(text.c_str() + 1, &end, 16);
+    if (*end != '\0') return false;
+    if (text.size() == 7) {
+        color = Color((value >> 16) & 0xff, (value >> 8) & 0xff, value & 0xff);
+    } else {
+        color = Color((value >> 24) & 0xff, (value >> 16) & 0xff, (value >> 8) & 0xff, value & 0xff);
+    }
+    return true;
+}
+
+bool describeSource(const std::string& path, Scenario::Source& source) {
+    std::error_code error;
+    const uintmax_t bytes = std::filesystem::file_size(path, error);
+    if (error) return false;
+    const auto modified = std::filesystem::last_write_time(path, error);
+    if (error) return false;
+    source.path = path;
+    source.bytes = bytes;
+    source.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+    return true;
+}
+
+// Sequential reader over a bounds-checked byte range
+class Cursor {
+public:
+    Cursor(const uint8_t* data, size_t size) : data_(data), left_(size) {}
+
+    bool take(void* out, size_t bytes) {
+        if (bytes > left_) return false;
+        if (bytes > 0) std::memcpy(out, data_, bytes);
+        data_ += bytes;
+        left_ -= bytes;
+        return true;
+    }
+
+    template <typename T>
+    bool takeArray(std::vector<T>& out, size_t count) {
+        if (count > left_ / sizeof(T)) return false;
+        out.resize(count);
+        return take(out.data(), count * sizeof(T));
+    }
+
+    bool atEnd() const { return left_ == 0; }
+
+private:
+    const uint8_t* data_;
+    size_t left_;
+};
+
+template <typename T>
+void append(std::vector<uint8_t>& image, const T* values, size_t count) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(values);
+    image.insert(image.end(), bytes, bytes + count * sizeof(T));
+}
+
+// Shared by the text and binary readers: everything the loader relies on
+bool validate(const Scenario& scenario, std::string& error) {
+    const size_t n = scenario.bodies.size();
+    for (size_t i = 0; i < n; ++i) {
+        const Scenario::Body& b = scenario.bodies[i];
+        if ((b.parent != Scenario::NO_PARENT && b.parent >= i) || !(b.mass >= 0.0) || !std::isfinite(b.mass)) {
+            error = "bad body " + std::to_string(i);
+            return false;
+        }
+    }
+    for (size_t k = 0; k < scenario.belts.size(); ++k) {
+        const Scenario::Belt& belt = scenario.belts[k];
+        if (belt.parent >= n || !(belt.innerRadius >= 0.0) || !(belt.outerRadius >= belt.innerRadius) ||
+            !(belt.minMass >= 0.0) || !(belt.maxMass >= belt.minMass) || !(belt.thickness >= 0.0)) {
+            error = "bad belt " + std::to_string(k);
+            return false;
+        }
+    }
+    // Parent indices are 32-bit in the store
+    if (scenario.getBodyCount() >= Scenario::NO_PARENT) {
+        error = "too many bodies";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void Scenario::Belt::sample(uint64_t i, const Body& parentBody, bool threeD,
+                            Vector3d& position, Vector3d& velocity, double& mass) const {
+    const uint64_t key = mix(seed) ^ (i * 0xd1342543de82ef95ull);
+    const double u0 = unit(mix(key));
+    const double u1 = unit(mix(key + 1));
+    const double u2 = unit(mix(key + 2));
+    const double u3 = unit(mix(key + 3));
+
+    const double inner2 = innerRadius * innerRadius;
+    const double r = std::sqrt(inner2 + u0 * (outerRadius * outerRadius - inner2));
+    const double angle = TWO_PI * u1;
+    const double c = std::cos(angle), s = std::sin(angle);
+    const double z = threeD ? thickness * (u2 - 0.5) : 0.0;
+    const double speed = Physics::calculateOrbitalVelocity(parentBody.mass, r);
+
+    position = parentBody.position + Vector3d(r * c, r * s, z);
+    velocity = parentBody.velocity + Vector3d(-speed * s, speed * c, 0.0);
+    mass = minMass + u3 * (maxMass - minMass);
+}
+
+size_t Scenario::getBodyCount() const {
+    size_t count = bodies.size();
+    for (const Belt& belt : belts) {
+        if (!belt.isTestParticles()) {
+            count += static_cast<size_t>(belt.count);
+        }
+    }
+    return count;
+}
+
+size_t Scenario::getParticleCount() const {
+    size_t count = 0;
+    for (const Belt& belt : belts) {
+        if (belt.isTestParticles()) {
+            count += static_cast<size_t>(belt.count);
+        }
+    }
+    return count;
+}
+
+uint32_t Scenario::addOrbiting(const std::string& name, uint32_t parent, double mass, double radius,
+                               double distance, const Color& color, float visualRadius) {
+    const Body& p = bodies[parent];
+    Body body;
+    body.name = name;
+    body.mass = mass;
+    body.radius = radius;
+    body.position = p.position + Vector3d(distance, 0.0, 0.0);
+    body.velocity = p.velocity + Vector3d(0.0, Physics::calculateOrbitalVelocity(p.mass, distance), 0.0);
+    body.color = color;
+    body.visualRadius = visualRadius;
+    body.parent = parent;
+    bodies.push_back(std::move(body));
+    return static_cast<uint32_t>(bodies.size() - 1);
+}
+
+Scenario Scenario::solarSystem() {
+    Scenario scenario;
+
+    // Planets and moons are drawn larger than their true size, with a floor so they stay visible
+    auto planetRadius = [](double radius, float scale) {
+        return std::max(4.0f, Physics::metersToPixels(radius) * scale);
+    };
+    auto moonRadius = [](double radius, float scale) {
+        return std::max(2.0f, Physics::metersToPixels(radius) * scale);
+    };
+
+    Body sun;
+    sun.name = "Sun";
+    sun.mass = Physics::SUN_MASS;
+    sun.radius = 696340e3;
+    sun.color = Color::Yellow;
+    sun.visualRadius = 20.0f;
+    scenario.bodies.push_back(sun);
+
+    // Simplified circular orbits for stability; distances in AU, masses relative to Earth
+    struct Planet { const char* name; double mass, radius, distance; Color color; float scale; };
+    const Planet planets[] = {
+        {"Mercury", 0.0553 * Physics::EARTH_MASS, 2439.7e3, 0.39 * Physics::AU, Color(169, 169, 169), 5.0f},
+        {"Venus", 0.815 * Physics::EARTH_MASS, 6051.8e3, 0.72 * Physics::AU, Color(255, 198, 73), 4.0f},
+        {"Earth", Physics::EARTH_MASS, 6371e3, 1.0 * Physics::AU, Color(100, 149, 237), 4.0f},
+        {"Mars", 0.107 * Physics::EARTH_MASS, 3389.5e3, 1.52 * Physics::AU, Color(205, 92, 92), 3.0f},
+        {"Jupiter", 317.8 * Physics::EARTH_MASS, 69911e3, 5.2 * Physics::AU, Color(255, 165, 0), 2.0f},
+        {"Saturn", 95.2 * Physics::EARTH_MASS, 58232e3, 9.5 * Physics::AU, Color(218, 165, 32), 1.8f},
+        {"Uranus", 14.5 * Physics::EARTH_MASS, 25362e3, 19.2 * Physics::AU, Color(64, 224, 208), 1.5f},
+        {"Neptune", 17.1 * Physics::EARTH_MASS, 24622e3, 30.1 * Physics::AU, Color(65, 105, 225), 1.5f},
+    };
+    uint32_t index[8];
+    for (size_t i = 0; i < 8; ++i) {
+        const Planet& p = planets[i];
+        index[i] = scenario.addOrbiting(p.name, 0, p.mass, p.radius, p.distance, p.color,
+                                        planetRadius(p.radius, p.scale));
+    }
+
+    // Major moons; those of Uranus and Neptune are small enough to leave out
+    struct Moon { const char* name; size_t planet; double mass, radius, distance; Color color; float scale; };
+    const Moon moons[] = {
+        {"Luna", 2, 7.342e22, 1737.4e3, 384400e3, Color::White, 8.0f},
+        {"Phobos", 3, 1.0659e16, 11.1e3, 9376e3, Color(139, 139, 139), 15.0f},
+        {"Deimos", 3, 1.4762e15, 6.2e3, 23463e3, Color(105, 105, 105), 18.0f},
+        {"Io", 4, 8.9319e22, 1821.6e3, 421700e3, Color(255, 255, 0), 4.0f},
+        {"Europa", 4, 4.7998e22, 1560.8e3, 671034e3, Color(173, 216, 230), 4.5f},
+        {"Ganymede", 4, 1.4819e23, 2634.1e3, 1070412e3, Color(139, 119, 101), 3.0f},
+        {"Callisto", 4, 1.0759e23, 2410.3e3, 1882709e3, Color(64, 64, 64), 3.2f},
+        {"Titan", 5, 1.3452e23, 2574e3, 1221830e3, Color(255, 165, 0), 3.5f},
+        {"Enceladus", 5, 1.08022e20, 252.1e3, 238020e3, Color::White, 12.0f},
+    };
+    for (const Moon& m : moons) {
+        scenario.addOrbiting(m.name, index[m.planet], m.mass, m.radius, m.distance, m.color,
+                             moonRadius(m.radius, m.scale));
+    }
+    return scenario;
+}
+
+bool Scenario::load(const std::string& path, Scenario& scenario, std::string& error, bool useCache) {
+    MappedFile file;
+    if (!file.open(path, error)) {
+        return false;
+    }
+    const bool binary = file.size() >= sizeof(BINARY_MAGIC) &&
+                        std::memcmp(file.data(), BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+    if (binary) {
+        if (!parseBinary(file.data(), file.size(), scenario, error)) {
+            error = path + ": " + error;
+            return false;
+        }
+        return true;
+    }
+
+    // A cache is only trusted if it was built from this very file and nothing it read has changed since
+    Source self;
+    const bool described = describeSource(path, self);
+    const std::string cache = cachePath(path);
+    if (useCache && described) {
+        MappedFile cached;
+        std::string ignored;
+        if (cached.open(cache, ignored) && parseBinary(cached.data(), cached.size(), scenario, ignored) &&
+            !scenario.sources.empty() && scenario.sources.front().path == path && scenario.isCurrent()) {
+            return true;
+        }
+    }
+
+    const std::string directory = std::filesystem::path(path).parent_path().string();
+    if (!parseText(reinterpret_cast<const char*>(file.data()), file.size(), scenario, error, directory)) {
+        error = path + ": " + error;
+        return false;
+    }
+    if (described) {
+        scenario.sources.insert(scenario.sources.begin(), self);
+    }
+
+    // Plain text scenarios parse faster than a cache could be checked; only ephemeris reads are worth saving
+    if (useCache && described && scenario.sources.size() > 1) {
+        // A read-only directory just means no cache
+        std::string ignored;
+        scenario.saveBinary(cache, ignored);
+    }
+    return true;
+}
+
+bool Scenario::isCurrent() const {
+    for (const Source& source : sources) {
+        Source now;
+        if (!describeSource(source.path, now) || now.bytes != source.bytes || now.modified != source.modified) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Scenario::parseText(const char* text, size_t size, Scenario& scenario, std::string& error,
+                         const std::string& directory) {
+    scenario = Scenario();
+    std::unordered_map<std::string, uint32_t> indexByName;
+    bool epochUsed = false;
+
+    auto findParent = [&](const std::string& name, uint32_t& parent) {
+        auto it = indexByName.find(name);
+        if (it == indexByName.end()) return false;
+        parent = it->second;
+        return true;
+    };
+
+    size_t lineNumber = 0;
+    size_t begin = 0;
+    while (begin < size) {
+        const char* newline = static_cast<const char*>(std::memchr(text + begin, '\n', size - begin));
+        const size_t end = newline ? static_cast<size_t>(newline - text) : size;
+        std::string line(text + begin, end - begin);
+        begin = end + 1;
+        ++lineNumber;
+
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        const std::vector<std::string> f = splitFields(line);
+        const std::string& kind = f[0];
+        auto fail = [&](const std::string& what) {
+            error = "line " + std::to_string(lineNumber) + ": " + what;
+            return false;
+        };
+
+        if (kind == "mode") {
+            if (f.size() != 2 || (f[1] != "2d" && f[1] != "3d")) return fail("expected mode,2d or mode,3d");
+            scenario.threeD = f[1] == "3d";
+            continue;
+        } else if (kind == "epoch") {
+            double epoch = 0.0;
+            if (f.size() != 2 || !parseNumber(f[1], epoch) || !(epoch > 0.0)) return fail("expected epoch,JULIAN_DATE");
+            if (epochUsed) return fail("epoch must come before the first horizons record");
+            scenario.epoch = epoch;
+            continue;
+        } else if (kind == "horizons") {
+            if (f.size() != 7 && f.size() != 8) return fail("horizons needs 6 or 7 fields");
+            Body b;
+            b.name = f[1];
+            double visual = 0.0;
+            if (!parseNumber(f[3], b.mass) || !parseNumber(f[4], b.radius) || !parseNumber(f[6], visual)) {
+                return fail("bad number");
+            }
+            if (!parseColor(f[5], b.color)) return fail("bad colour '" + f[5] + "'");
+            if (f.size() == 8 && !f[7].empty() && !findParent(f[7], b.parent)) return fail("unknown parent '" + f[7] + "'");
+
+            const std::string path = (std::filesystem::path(directory) / f[2]).string();
+            std::vector<Ephemeris::State> states;
+            std::string why;
+            if (!Ephemeris::loadHorizons(path, states, why)) return fail(why);
+            if (scenario.epoch == 0.0) {
+                scenario.epoch = states.front().julianDate;
+            }
+            epochUsed = true;
+            const Ephemeris::State* state = Ephemeris::nearest(states, scenario.epoch, Ephemeris::EPOCH_TOLERANCE);
+            if (!state) return fail(path + " has no state at JD " + std::to_string(scenario.epoch));
+
+            Source source;
+            if (describeSource(path, source)) {
+                scenario.sources.push_back(source);
+            }
+            b.position = state->position;
+            b.velocity = state->velocity;
+            b.visualRadius = static_cast<float>(visual);
+            scenario.bodies.push_back(std::move(b));
+        } else if (kind == "body") {
+            if (f.size() != 12 && f.size() != 13) return fail("body needs 11 or 12 fields");
+            Body b;
+            b.name = f[1];
+            double v[8];
+            double visual = 0.0;
+            for (int k = 0; k < 8; ++k) {
+                if (!parseNumber(f[2 + k], v[k])) return fail("bad number '" + f[2 + k] + "'");
+            }
+            if (!parseColor(f[10], b.color)) return fail("bad colour '" + f[10] + "'");
+            if (!parseNumber(f[11], visual)) return fail("bad visual radius '" + f[11] + "'");
+            if (f.size() == 13 && !f[12].empty() && !findParent(f[12], b.parent)) return fail("unknown parent '" + f[12] + "'");
+            b.mass = v[0];
+            b.radius = v[1];
+            b.position = Vector3d(v[2], v[3], v[4]);
+            b.velocity = Vector3d(v[5], v[6], v[7]);
+            b.visualRadius = static_cast<float>(visual);
+            scenario.bodies.push_back(std::move(b));
+        } else if (kind == "orbit") {
+            if (f.size() != 8) return fail("orbit needs 7 fields");
+            uint32_t parent = 0;
+            double mass = 0.0, radius = 0.0, distance = 0.0, visual = 0.0;
+            Color color;
+            if (!findParent(f[2], parent)) return fail("unknown parent '" + f[2] + "'");
+            if (!parseNumber(f[3], mass) || !parseNumber(f[4], radius) || !parseNumber(f[5], distance) ||
+                !parseNumber(f[7], visual)) {
+                return fail("bad number");
+            }
+            if (!parseColor(f[6], color)) return fail("bad colour '" + f[6] + "'");
+            scenario.addOrbiting(f[1], parent, mass, radius, distance, color, static_cast<float>(visual));
+        } else if (kind == "belt") {
+            if (f.size() != 11) return fail("belt needs 10 fields");
+            Belt belt;
+            double visual = 0.0;
+            if (!findParent(f[1], belt.parent)) return fail("unknown parent '" + f[1] + "'");
+            if (!parseInteger(f[2], belt.count) || !parseInteger(f[3], belt.seed)) return fail("bad count or seed");
+            if (!parseNumber(f[4], belt.innerRadius) || !parseNumber(f[5], belt.outerRadius) ||
+                !parseNumber(f[6], belt.thickness) || !parseNumber(f[7], belt.minMass) ||
+                !parseNumber(f[8], belt.maxMass) || !parseNumber(f[10], visual)) {
+                return fail("bad number");
+            }
+            if (!parseColor(f[9], belt.color)) return fail("bad colour '" + f[9] + "'");
+            belt.visualRadius = static_cast<float>(visual);
+            scenario.belts.push_back(belt);
+            continue;
+        } else {
+            return fail("unknown record '" + kind + "'");
+        }
+
+        // Later records refer to bodies by name; a repeated name refers to the latest
+        indexByName[scenario.bodies.back().name] = static_cast<uint32_t>(scenario.bodies.size() - 1);
+    }
+    return validate(scenario, error);
+}
+
+bool Scenario::parseBinary(const uint8_t* data, size_t size, Scenario& scenario, std::string& error) {
+    scenario = Scenario();
+    Cursor in(data, size);
+    BinaryHeader header;
+    if (!in.take(&header, sizeof(header)) || std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+        error = "not a binary scenario";
+        return false;
+    }
+    if (header.version != BINARY_VERSION) {
+        error = "unsupported scenario version " + std::to_string(header.version);
+        return false;
+    }
+
+    const size_t n = static_cast<size_t>(header.bodyCount);
+    std::vector<double> mass, radius, state[6];
+    std::vector<uint32_t> color, parent;
+    std::vector<float> visualRadius;
+    std::vector<uint64_t> nameOffsets;
+    std::vector<char> names;
+    std::vector<BinaryBelt> belts;
+    bool ok = in.takeArray(mass, n) && in.takeArray(radius, n);
+    for (auto& component : state) {
+        ok = ok && in.takeArray(component, n);
+    }
+    ok = ok && in.takeArray(color, n) && in.takeArray(visualRadius, n) && in.takeArray(parent, n) &&
+         in.takeArray(nameOffsets, n + 1) && in.takeArray(names, static_cast<size_t>(header.nameBytes)) &&
+         in.takeArray(belts, static_cast<size_t>(header.beltCount));
+    for (uint64_t k = 0; ok && k < header.sourceCount; ++k) {
+        BinarySource record;
+        std::vector<char> path;
+        ok = in.take(&record, sizeof(record)) && in.takeArray(path, static_cast<size_t>(record.pathBytes));
+        if (ok) {
+            Source source;
+            source.path.assign(path.begin(), path.end());
+            source.bytes = record.bytes;
+            source.modified = record.modified;
+            scenario.sources.push_back(std::move(source));
+        }
+    }
+    if (!ok || !in.atEnd() || nameOffsets[0] != 0 || nameOffsets[n] != header.nameBytes) {
+        error = "truncated or malformed";
+        return false;
+    }
+
+    scenario.threeD = (header.flags & FLAG_THREE_D) != 0;
+    scenario.epoch = header.epoch;
+    scenario.bodies.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (nameOffsets[i] > nameOffsets[i + 1]) {
+            error = "bad name table";
+            return false;
+        }
+        Body& b = scenario.bodies[i];
+        b.name.assign(names.data() + nameOffsets[i], names.data() + nameOffsets[i + 1]);
+        b.mass = mass[i];
+        b.radius = radius[i];
+        b.position = Vector3d(state[0][i], state[1][i], state[2][i]);
+        b.velocity = Vector3d(state[3][i], state[4][i], state[5][i]);
+        b.color = unpackColor(color[i]);
+        b.visualRadius = visualRadius[i];
+        b.parent = parent[i];
+    }
+    for (const BinaryBelt& record : belts) {
+        Belt belt;
+        belt.parent = record.parent;
+        belt.count = record.count;
+        belt.seed = record.seed;
+        belt.innerRadius = record.innerRadius;
+        belt.outerRadius = record.outerRadius;
+        belt.thickness = record.thickness;
+        belt.minMass = record.minMass;
+        belt.maxMass = record.maxMass;
+        belt.color = unpackColor(record.color);
+        belt.visualRadius = record.visualRadius;
+        scenario.belts.push_back(belt);
+    }
+    return validate(scenario, error);
+}
+
+bool Scenario::saveBinary(const std::string& path, std::string& error) const {
+    const size_t n = bodies.size();
+    std::vector<double> mass(n), radius(n), state[6];
+    std::vector<uint32_t> color(n), parent(n);
+    std::vector<float> visualRadius(n);
+    std::vector<uint64_t> nameOffsets(n + 1, 0);
+    std::string names;
+    for (auto& component : state) {
+        component.resize(n);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        const Body& b = bodies[i];
+        mass[i] = b.mass;
+        radius[i] = b.radius;
+        state[0][i] = b.position.x;
+        state[1][i] = b.position.y;
+        state[2][i] = b.position.z;
+        state[3][i] = b.velocity.x;
+        state[4][i] = b.velocity.y;
+        state[5][i] = b.velocity.z;
+        color[i] = packColor(b.color);
+        visualRadius[i] = b.visualRadius;
+        parent[i] = b.parent;
+        names += b.name;
+        nameOffsets[i + 1] = names.size();
+    }
+
+    BinaryHeader header{};
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.flags = threeD ? FLAG_THREE_D : 0;
+    header.bodyCount = n;
+    header.beltCount = belts.size();
+    header.nameBytes = names.size();
+    header.sourceCount = sources.size();
+    header.epoch = epoch;
+
+    std::vector<uint8_t> image;
+    append(image, &header, 1);
+    append(image, mass.data(), n);
+    append(image, radius.data(), n);
+    for (const auto& component : state) {
+        append(image, component.data(), n);
+    }
+    append(image, color.data(), n);
+    append(image, visualRadius.data(), n);
+    append(image, parent.data(), n);
+    append(image, nameOffsets.data(), n + 1);
+    append(image, names.data(), names.size());
+    for (const Belt& belt : belts) {
+        BinaryBelt record{};
+        record.parent = belt.parent;
+        record.color = packColor(belt.color);
+        record.count = belt.count;
+        record.seed = belt.seed;
+        record.innerRadius = belt.innerRadius;
+        record.outerRadius = belt.outerRadius;
+        record.thickness = belt.thickness;
+        record.minMass = belt.minMass;
+        record.maxMass = belt.maxMass;
+        record.visualRadius = belt.visualRadius;
+        append(image, &record, 1);
+    }
+    for (const Source& source : sources) {
+        BinarySource record{};
+        record.pathBytes = source.path.size();
+        record.bytes = source.bytes;
+        record.modified = source.modified;
+        append(image, &record, 1);
+        append(image, source.path.data(), source.path.size());
+    }
+
+    // Written beside the target and renamed over it, so a concurrent load never sees half a cache
+    return Checkpoint::write(image, path, error);
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "CelestialBody.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Initial conditions for a SolarSystem: explicit bodies plus procedurally
+ * generated belts, in SI units (metres, m/s, kg). SolarSystem::load() turns
+ * it into bodies with a single reservation of the store.
+ *
+ * Scenarios come from code (solarSystem()), from a CSV text file or from the
+ * compact binary form written by saveBinary(); load() tells them apart by the
+ * binary magic. A text file holds one record per line; lines starting with '#'
+ * are comments:
+ *
+ *   mode,3d
+ *   epoch,JULIAN_DATE
+ *   body,NAME,MASS,RADIUS,X,Y,Z,VX,VY,VZ,COLOR,VISUAL_RADIUS[,PARENT]
+ *   orbit,NAME,PARENT,MASS,RADIUS,DISTANCE,COLOR,VISUAL_RADIUS
+ *   horizons,NAME,FILE,MASS,RADIUS,COLOR,VISUAL_RADIUS[,PARENT]
+ *   belt,PARENT,COUNT,SEED,INNER,OUTER,THICKNESS,MIN_MASS,MAX_MASS,COLOR,VISUAL_RADIUS
+ *
+ * PARENT names an earlier body, COLOR is #rrggbb or #rrggbbaa and visual
+ * radii are in pixels. An orbit record starts the body on a circular orbit
+ * of its parent, offset along +x. A horizons record takes the body's state
+ * from a JPL Horizons vector table (see Ephemeris.h; FILE is relative to the
+ * scenario) at the epoch, which defaults to the first date of the first
+ * table. A belt's particles are generated from its seed when the scenario is
+ * loaded, so a million-body belt costs one line. A belt whose masses are
+ * both 0 is made of massless test particles (see TestParticles.h): they
+ * follow the bodies without pulling on them or on each other.
+ *
+ * Parsing ephemeris tables is the slow part of a start-up, so load() keeps a
+ * binary copy of such scenarios next to the file and uses it for as long as
+ * the scenario and every table it read are unchanged.
+ */
+struct Scenario {
+    static constexpr uint32_t NO_PARENT = BodyStore::NO_PARENT;
+
+    struct Body {
+        std::string name;
+        double mass = 0.0;
+        double radius = 0.0;
+        Vector3d position;       // m
+        Vector3d velocity;       // m/s
+        Color color;
+        float visualRadius = 1.0f;   // px
+        uint32_t parent = NO_PARENT; // Index of the body it orbits, if any
+    };
+
+    /**
+     * Ring of small bodies on circular orbits about a parent body.
+     * Particle i is generated from (seed, i) alone, so any subset can be
+     * rebuilt and the same seed always yields the same belt.
+     */
+    struct Belt {
+        uint32_t parent = 0;
+        uint64_t count = 0;
+        uint64_t seed = 1;
+        double innerRadius = 0.0;    // m
+        double outerRadius = 0.0;    // m
+        double thickness = 0.0;      // Full height in m; only used in 3D
+        double minMass = 0.0;        // kg, drawn uniformly in [minMass, maxMass]
+        double maxMass = 0.0;
+        Color color;
+        float visualRadius = 1.0f;
+
+        // Massless belts become test particles rather than bodies
+        bool isTestParticles() const { return maxMass <= 0.0; }
+
+        // State of particle i given the parent's; positions uniform in area over the ring
+        void sample(uint64_t i, const Body& parentBody, bool threeD,
+                    Vector3d& position, Vector3d& velocity, double& mass) const;
+    };
+
+    // A file the scenario was built from, as it was when read
+    struct Source {
+        std::string path;
+        uint64_t bytes = 0;
+        int64_t modified = 0;    // Filesystem clock ticks
+    };
+
+    std::vector<Body> bodies;
+    std::vector<Belt> belts;
+    bool threeD = false;
+    double epoch = 0.0;               // Julian date (TDB) of ephemeris states; 0 if none were used
+    std::vector<Source> sources;      // Scenario file first, then its ephemeris tables
+
+    // Bodies plus the particles of every belt with mass
+    size_t getBodyCount() const;
+    // Particles of the massless belts
+    size_t getParticleCount() const;
+
+    // Append a body on a circular orbit of parent at distance along +x; returns its index
+    uint32_t addOrbiting(const std::string& name, uint32_t parent, double mass, double radius,
+                         double distance, const Color& color, float visualRadius);
+
+    // The built-in Sun, planets and major moons
+    static Scenario solarSystem();
+
+    // Read a text or binary scenario file; false with error set on bad input.
+    // Text scenarios that use ephemeris tables go through the cache at cachePath(path).
+    static bool load(const std::string& path, Scenario& scenario, std::string& error, bool useCache = true);
+    // Relative ephemeris paths are resolved against directory
+    static bool parseText(const char* text, size_t size, Scenario& scenario, std::string& error,
+                          const std::string& directory = std::string());
+    static bool parseBinary(const uint8_t* data, size_t size, Scenario& scenario, std::string& error);
+
+    // Write the compact binary form; belts stay as their parameters
+    bool saveBinary(const std::string& path, std::string& error) const;
+
+    // Whether every source file still has the size and time it had when read
+    bool isCurrent() const;
+    static std::string cachePath(const std::string& path) { return path + ".gsb"; }
+
+    static constexpr uint32_t BINARY_VERSION = 2;
+};
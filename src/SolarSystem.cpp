@@ -1,77 +1,137 @@
 #include "SolarSystem.h"
 #include "Physics.h"
+#include "DirectSolver.h"
+#include "SymplecticIntegrators.h"
+#include "Profiler.h"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <numeric>
 
-SolarSystem::SolarSystem() : paused_(false), timeScale_(1.0), is3DMode_(false) {
+SolarSystem::SolarSystem()
+    : paused_(false), timeScale_(1.0), is3DMode_(false), solver_(std::make_unique<DirectSolver>()),
+      integrator_(std::make_unique<LeapfrogIntegrator>()), forceEvaluations_(0), stepCount_(0), revision_(0), verbose_(true),
+      simulationTime_(0.0), initialSimulationTime_(0.0) {
 }
 
 void SolarSystem::initialize() {
-    clear();
-
-    // Create the Sun at the center
-    createSun();
-
-    // Create planets with realistic orbital data
-    // Note: Using simplified circular orbits for stability
-    // Distances in AU, masses relative to Earth, radii in km
-
-    // Mercury
-    createPlanet("Mercury", 0.0553 * Physics::EARTH_MASS, 2439.7e3,
-                0.39 * Physics::AU, 47.87e3, sf::Color(169, 169, 169), 5.0f);
-
-    // Venus
-    createPlanet("Venus", 0.815 * Physics::EARTH_MASS, 6051.8e3,
-                0.72 * Physics::AU, 35.02e3, sf::Color(255, 198, 73), 4.0f);
-
-    // Earth
-    createPlanet("Earth", Physics::EARTH_MASS, 6371e3,
-                1.0 * Physics::AU, 29.78e3, sf::Color(100, 149, 237), 4.0f);
-
-    // Mars
-    createPlanet("Mars", 0.107 * Physics::EARTH_MASS, 3389.5e3,
-                1.52 * Physics::AU, 24.08e3, sf::Color(205, 92, 92), 3.0f);
-
-    // Jupiter
-    createPlanet("Jupiter", 317.8 * Physics::EARTH_MASS, 69911e3,
-                5.2 * Physics::AU, 13.07e3, sf::Color(255, 165, 0), 2.0f);
-
-    // Saturn
-    createPlanet("Saturn", 95.2 * Physics::EARTH_MASS, 58232e3,
-                9.5 * Physics::AU, 9.69e3, sf::Color(218, 165, 32), 1.8f);
+    load(Scenario::solarSystem());
 
-    // Uranus
-    createPlanet("Uranus", 14.5 * Physics::EARTH_MASS, 25362e3,
-                19.2 * Physics::AU, 6.81e3, sf::Color(64, 224, 208), 1.5f);
-
-    // Neptune
-    createPlanet("Neptune", 17.1 * Physics::EARTH_MASS, 24622e3,
-                30.1 * Physics::AU, 5.43e3, sf::Color(65, 105, 225), 1.5f);
+    if (verbose_) {
+        std::cout << "Solar system initialized with " << bodies_.size() << " celestial bodies." << std::endl;
+        std::cout << "Starting in 2D mode. Press M to toggle to 3D mode." << std::endl;
+    }
+}
 
-    // Add moons to planets
-    addMoonsToEarth();
-    addMoonsToMars();
-    addMoonsToJupiter();
-    addMoonsToSaturn();
-    // Uranus and Neptune moons are quite small, so we'll skip them for now
+void SolarSystem::load(const Scenario& scenario, uint64_t firstParticle, uint64_t lastParticle) {
+    clear();
+    is3DMode_ = scenario.threeD;
+
+    const size_t total = scenario.getBodyCount();
+    const uint64_t particleCount = scenario.getParticleCount();
+    lastParticle = std::min<uint64_t>(lastParticle, particleCount);
+    firstParticle = std::min(firstParticle, lastParticle);
+    store_.reserve(total);
+    bodies_.reserve(total);
+    particles_.reserve(lastParticle - firstParticle);
+    particleColors_.reserve(lastParticle - firstParticle);
+
+    // Scenarios are in SI units; the store holds simulation units
+    const double scale = Physics::DISTANCE_SCALE;
+    for (const Scenario::Body& b : scenario.bodies) {
+        auto body = std::make_unique<CelestialBody>(b.name, b.mass, b.radius, b.position * scale,
+                                                    b.velocity * scale, b.color);
+        body->setVisualRadius(b.visualRadius);
+        addBody(std::move(body), b.parent);
+    }
 
+    Vector3d position, velocity;
+    double mass = 0.0;
+    uint64_t particleOffset = 0;    // Scenario index of the belt's first test particle
+    for (const Scenario::Belt& belt : scenario.belts) {
+        const Scenario::Body& parent = scenario.bodies[belt.parent];
+        if (belt.isTestParticles()) {
+            // Samples are independent of each other, so a share starts anywhere in the belt
+            const uint64_t begin = std::clamp(firstParticle, particleOffset, particleOffset + belt.count);
+            const uint64_t end = std::clamp(lastParticle, particleOffset, particleOffset + belt.count);
+            for (uint64_t i = begin - particleOffset; i < end - particleOffset; ++i) {
+                belt.sample(i, parent, scenario.threeD, position, velocity, mass);
+                addTestParticle(position * scale, velocity * scale, belt.color, belt.parent);
+            }
+            particleOffset += belt.count;
+            continue;
+        }
+        for (uint64_t i = 0; i < belt.count; ++i) {
+            belt.sample(i, parent, scenario.threeD, position, velocity, mass);
+            // Belt particles go unnamed; there are too many to label
+            auto body = std::make_unique<CelestialBody>(std::string(), mass, 0.0, position * scale,
+                                                        velocity * scale, belt.color);
+            body->setVisualRadius(belt.visualRadius);
+            addBody(std::move(body), belt.parent);
+        }
+    }
     storeInitialConditions();
+}
 
-    std::cout << "Solar system initialized with " << bodies_.size() << " celestial bodies." << std::endl;
-    std::cout << "Starting in 2D mode. Press M to toggle to 3D mode." << std::endl;
-}void SolarSystem::update(double deltaTime) {
+void SolarSystem::update(double deltaTime) {
     if (!paused_) {
-        updatePhysics(deltaTime * timeScale_);
+        updatePhysics(getStepSize(deltaTime * timeScale_));
     }
 }
 
-void SolarSystem::addBody(std::unique_ptr<CelestialBody> body) {
+void SolarSystem::advance(double stepSize) {
+    if (stepSize > 0.0) {
+        updatePhysics(stepSize);
+    }
+}
+
+void SolarSystem::addBody(std::unique_ptr<CelestialBody> body, uint32_t parent) {
+    size_t index = store_.add(0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, parent);
+    body->attach(store_, index);
+    if (!body->getName().empty()) {
+        bodyIndexByName_.emplace(body->getName(), static_cast<uint32_t>(index));
+    }
     bodies_.push_back(std::move(body));
+    bodyIds_.push_back(nextBodyId_++);
+    live_.push_back(1);
+    integrator_->invalidate();
+    ++revision_;
+    ++layout_;
+}
+
+void SolarSystem::addTestParticle(const Vector3d& position, const Vector3d& velocity, const Color& color,
+                                  uint32_t parent) {
+    particles_.add(position.x, position.y, position.z, velocity.x, velocity.y, velocity.z, parent);
+    particleColors_.push_back(color);
+    ++revision_;
+}
+
+void SolarSystem::setTestParticles(TestParticles particles, std::vector<Color> colors) {
+    particles_ = std::move(particles);
+    particleColors_ = std::move(colors);
+    initialParticles_.clear();
+    particleAccelerationsValid_ = false;
 }
 
 void SolarSystem::clear() {
     bodies_.clear();
+    store_.clear();
+    particles_.clear();
+    particleColors_.clear();
+    initialParticles_.clear();
+    bodyIndexByName_.clear();
+    bodyIds_.clear();
+    nextBodyId_ = 0;
+    live_.clear();
+    pendingRemovals_ = 0;
     initialConditions_.clear();
+    absorbed_.clear();
+    integrator_->invalidate();
+    ++revision_;
+    ++layout_;
+    simulationTime_ = 0.0;
+    shortSteps_ = 0;
+    timeShortfall_ = 0.0;
 }
 
 CelestialBody* SolarSystem::getBody(size_t index) {
@@ -85,57 +145,78 @@ const CelestialBody* SolarSystem::getBody(size_t index) const {
 }
 
 CelestialBody* SolarSystem::findBody(const std::string& name) {
-    for (auto& body : bodies_) {
-        if (body->getName() == name) {
-            return body.get();
-        }
-    }
-    return nullptr;
+    auto it = bodyIndexByName_.find(name);
+    return it != bodyIndexByName_.end() ? bodies_[it->second].get() : nullptr;
 }
 
-std::vector<CelestialBody> SolarSystem::getRawBodies() const {
-    std::vector<CelestialBody> rawBodies;
-    rawBodies.reserve(bodies_.size());
-
-    for (const auto& body : bodies_) {
-        rawBodies.push_back(*body);
-    }
-
-    return rawBodies;
+const CelestialBody* SolarSystem::findBody(const std::string& name) const {
+    auto it = bodyIndexByName_.find(name);
+    return it != bodyIndexByName_.end() ? bodies_[it->second].get() : nullptr;
 }
 
 void SolarSystem::set3DMode(bool enable) {
     is3DMode_ = enable;  // Actually set the mode flag!
 
     if (enable) {
-        // Initialize 3D positions from 2D positions when switching to 3D
-        for (auto& body : bodies_) {
-            sf::Vector2f pos2D = body->getPosition();
-            body->setPosition3D(Vector3f(pos2D.x, pos2D.y, 0.0f));
-
-            sf::Vector2f vel2D = body->getVelocity();
-            body->setVelocity3D(Vector3f(vel2D.x, vel2D.y, 0.0f));
+        // Start 3D mode from the orbital plane of the 2D state
+        std::fill(store_.z.begin(), store_.z.end(), 0.0);
+        std::fill(store_.vz.begin(), store_.vz.end(), 0.0);
+        std::fill(particles_.z.begin(), particles_.z.end(), 0.0);
+        std::fill(particles_.vz.begin(), particles_.vz.end(), 0.0);
+    } else {
+        // 2D steps never touch z, vz or pz, but energy and angular momentum still read
+        // them: project onto the plane rather than keep the last 3D step's values
+        std::fill(store_.z.begin(), store_.z.end(), 0.0);
+        std::fill(store_.vz.begin(), store_.vz.end(), 0.0);
+        std::fill(store_.pz.begin(), store_.pz.end(), 0.0f);
+        std::fill(particles_.z.begin(), particles_.z.end(), 0.0);
+        std::fill(particles_.vz.begin(), particles_.vz.end(), 0.0);
+        std::fill(particles_.pz.begin(), particles_.pz.end(), 0.0f);
+    }
+    integrator_->invalidate();
+    ++revision_;
+}
 
-            // Set previous position for Verlet integration
-            body->setPreviousPosition3D(body->getPosition3D() - body->getVelocity3D() * 0.016f);
-        }
+void SolarSystem::captureSnapshot(StateSnapshot& snapshot) const {
+    const size_t n = store_.size();
+    snapshot.revision = revision_;
+    snapshot.step = stepCount_;
+    snapshot.simulationTime = simulationTime_;
+    snapshot.position.resize(n);
+    snapshot.velocity.resize(n);
+    snapshot.mass.assign(store_.mass.begin(), store_.mass.end());
+    snapshot.visualRadius.resize(n);
+    if (snapshot.layout != layout_ || snapshot.id.size() != n) {
+        snapshot.id = bodyIds_;
+        snapshot.layout = layout_;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        snapshot.position[i] = Vector3d(store_.x[i], store_.y[i], store_.z[i]);
+        snapshot.velocity[i] = Vector3d(store_.vx[i], store_.vy[i], store_.vz[i]);
+        snapshot.visualRadius[i] = bodies_[i]->getVisualRadius();
+    }
+    snapshot.particlePosition.resize(particles_.size());
+    for (size_t i = 0; i < particles_.size(); ++i) {
+        snapshot.particlePosition[i] = Vector3f(static_cast<float>(particles_.x[i]), static_cast<float>(particles_.y[i]),
+                                                static_cast<float>(particles_.z[i]));
     }
 }
 
 double SolarSystem::getTotalEnergy() const {
     double totalEnergy = 0.0;
 
-    // Calculate kinetic energy
+    // Calculate kinetic energy (velocities converted to m/s)
     for (const auto& body : bodies_) {
-        sf::Vector2f vel = body->getVelocity();
-        double kineticEnergy = 0.5 * body->getMass() * (vel.x * vel.x + vel.y * vel.y);
+        Vector3d vel = body->getPreciseVelocity() * (1.0 / Physics::DISTANCE_SCALE);
+        double kineticEnergy = 0.5 * body->getMass() * (vel.x * vel.x + vel.y * vel.y + vel.z * vel.z);
         totalEnergy += kineticEnergy;
     }
 
     // Calculate potential energy (avoid double counting)
     for (size_t i = 0; i < bodies_.size(); ++i) {
         for (size_t j = i + 1; j < bodies_.size(); ++j) {
-            double distance = bodies_[i]->distanceTo(*bodies_[j]);
+            Vector3d delta = bodies_[j]->getPrecisePosition() - bodies_[i]->getPrecisePosition();
+            double distance = delta.magnitude() / Physics::DISTANCE_SCALE;
             double potentialEnergy = -Physics::G * bodies_[i]->getMass() * bodies_[j]->getMass() / distance;
             totalEnergy += potentialEnergy;
         }
@@ -145,230 +226,543 @@ double SolarSystem::getTotalEnergy() const {
 }
 
 sf::Vector2f SolarSystem::getCenterOfMass() const {
-    sf::Vector2f centerOfMass(0.0f, 0.0f);
+    Vector3d centerOfMass;
     double totalMass = 0.0;
 
     for (const auto& body : bodies_) {
-        sf::Vector2f pos = body->getPosition();
         double mass = body->getMass();
-        centerOfMass += pos * static_cast<float>(mass);
+        centerOfMass += body->getPrecisePosition() * mass;
         totalMass += mass;
     }
 
     if (totalMass > 0.0) {
-        centerOfMass /= static_cast<float>(totalMass);
+        centerOfMass = centerOfMass * (1.0 / totalMass);
     }
 
-    return centerOfMass;
+    return centerOfMass.toFloat().to2D();
 }
 
 void SolarSystem::reset() {
     restoreInitialConditions();
 }
 
-void SolarSystem::updatePhysics(double deltaTime) {
-    if (is3DMode_) {
-        // 3D physics update
-        for (auto& body : bodies_) {
-            body->update3D(getRawBodies(), static_cast<float>(deltaTime));
-        }
-    } else {
-        // 2D physics update
-        // Calculate gravitational forces between all bodies
-        calculateGravitationalForces();
-
-        // Update all bodies
-        for (auto& body : bodies_) {
-            body->update(deltaTime);
-            body->resetForces();
+void SolarSystem::updatePhysics(double stepSize) {
+    GRAVITY_PROFILE_SCOPE("step");
+    GRAVITY_PROFILE_COUNTER("bodies", store_.size());
+    Integrator::Context context{
+        store_, is3DMode_,
+        [this]() { calculateGravitationalForces(); },
+        [this](const std::vector<uint32_t>& targets) { calculateGravitationalForces(targets); },
+        [this](const ThreadPool::RangeTask& task) { forEachBodyRange(task); }
+    };
+    // On diagnostics steps every full evaluation also accumulates the potential
+    const bool sample = diagnosticsInterval_ > 0 && (stepCount_ + 1) % diagnosticsInterval_ == 0;
+    if (sample) {
+        store_.potential.assign(store_.size(), 0.0f);
+        potentialCurrent_ = false;
+    }
+    openParticleStep(stepSize);
+    const double advanced = integrator_->step(context, stepSize);
+    if (advanced < stepSize) {
+        shortenParticleStep(stepSize, advanced);
+        if (verbose_ && shortSteps_ == 0) {
+            std::cout << integrator_->getName() << " covered " << advanced << " of a " << stepSize
+                      << " s step; the clock follows the bodies" << std::endl;
         }
+        ++shortSteps_;
+        timeShortfall_ += stepSize - advanced;
+    }
+    closeParticleStep(advanced);
+    simulationTime_ += advanced;
+    ++stepCount_;
+    if (sample) {
+        finishDiagnosticsStep();
+    }
+    if (collisions_) {
+        resolveCollisions(advanced);
     }
 }
 
-void SolarSystem::calculateGravitationalForces() {
-    // Calculate forces between all pairs of bodies
-    for (size_t i = 0; i < bodies_.size(); ++i) {
-        for (size_t j = i + 1; j < bodies_.size(); ++j) {
-            // Calculate gravitational force between body i and body j
-            sf::Vector2f force = CelestialBody::calculateGravitationalForce(*bodies_[i], *bodies_[j]);
+const SolarSystem::Diagnostics& SolarSystem::sampleDiagnostics() {
+    store_.potential.assign(store_.size(), 0.0f);
+    potentialCurrent_ = false;
+    finishDiagnosticsStep();
+    return diagnostics_;
+}
 
-            // Apply equal and opposite forces (Newton's third law)
-            bodies_[i]->addForce(force);
-            bodies_[j]->addForce(-force);
-        }
+void SolarSystem::finishDiagnosticsStep() {
+    GRAVITY_PROFILE_SCOPE("diagnostics");
+    // Symplectic and FSAL schemes end on a full evaluation at the final positions;
+    // Euler's was at the start, so it pays for one more
+    if (!potentialCurrent_ || !integrator_->hasValidAccelerations(store_)) {
+        calculateGravitationalForces();
     }
+    computeDiagnostics();
+    store_.potential.clear();
+    potentialCurrent_ = false;
 }
 
-void SolarSystem::createSun() {
-    sf::Vector2f sunPosition(0.0f, 0.0f);  // Center of the solar system
-    sf::Vector2f sunVelocity(0.0f, 0.0f);  // Stationary (approximately)
+void SolarSystem::computeDiagnostics() {
+    Diagnostics d;
+    d.step = stepCount_;
+    d.simulationTime = simulationTime_;
+    const size_t n = store_.size();
+    if (n == 0 || store_.potential.size() != n) {
+        diagnostics_ = d;
+        return;
+    }
 
-    auto sun = std::make_unique<CelestialBody>(
-        "Sun",
-        Physics::SUN_MASS,
-        696340e3, // Sun radius in meters
-        sunPosition,
-        sunVelocity,
-        sf::Color::Yellow
-    );
+    // Sums in simulation units, converted once at the end
+    double kinetic = 0.0, potential = 0.0, totalMass = 0.0;
+    Vector3d momentum, angularMomentum, moment;
+    for (size_t i = 0; i < n; ++i) {
+        const double m = store_.mass[i];
+        const double vx = store_.vx[i], vy = store_.vy[i], vz = store_.vz[i];
+        const double x = store_.x[i], y = store_.y[i], z = store_.z[i];
+        kinetic += m * (vx * vx + vy * vy + vz * vz);
+        potential += m * store_.potential[i];
+        momentum += Vector3d(vx, vy, vz) * m;
+        angularMomentum += Vector3d(y * vz - z * vy, z * vx - x * vz, x * vy - y * vx) * m;
+        moment += Vector3d(x, y, z) * m;
+        totalMass += m;
+    }
 
-    // Make the Sun visually larger for better visibility
-    sun->setVisualRadius(20.0f);
+    // Each pair's potential was added at both ends
+    const double metres = 1.0 / Physics::DISTANCE_SCALE;
+    d.valid = true;
+    d.kineticEnergy = 0.5 * kinetic * metres * metres;
+    d.potentialEnergy = 0.5 * potential * metres * metres;
+    d.momentum = momentum * metres;
+    d.angularMomentum = angularMomentum * (metres * metres);
+    d.centerOfMass = totalMass > 0.0 ? moment * (metres / totalMass) : Vector3d();
+
+    if (!diagnosticsBaseline_.valid || diagnosticsRevision_ != revision_) {
+        diagnosticsBaseline_ = d;
+        diagnosticsRevision_ = revision_;
+    }
+    const Diagnostics& base = diagnosticsBaseline_;
+    const double baseEnergy = std::abs(base.totalEnergy());
+    const double baseAngular = base.angularMomentum.magnitude();
+    d.energyDrift = baseEnergy > 0.0 ? (d.totalEnergy() - base.totalEnergy()) / baseEnergy : 0.0;
+    d.angularMomentumDrift = baseAngular > 0.0
+        ? (d.angularMomentum - base.angularMomentum).magnitude() / baseAngular : 0.0;
+    d.momentumDrift = (d.momentum - base.momentum).magnitude();
+    diagnostics_ = d;
+}
 
-    std::cout << "Created Sun at center with visual radius 20.0 pixels" << std::endl;
+void SolarSystem::resolveCollisions(double stepSize) {
+    GRAVITY_PROFILE_SCOPE("collisions");
+    const size_t n = store_.size();
+    collisionDetector_.detect(store_, live_, is3DMode_, stepSize, contacts_);
+    if (contacts_.empty()) {
+        return;
+    }
 
-    addBody(std::move(sun));
-}
+    // Group touching bodies (chains included) under the heaviest body of each group
+    mergeRoot_.resize(n);
+    std::iota(mergeRoot_.begin(), mergeRoot_.end(), 0u);
+    auto find = [this](uint32_t i) {
+        while (mergeRoot_[i] != i) {
+            mergeRoot_[i] = mergeRoot_[mergeRoot_[i]];
+            i = mergeRoot_[i];
+        }
+        return i;
+    };
+    auto heavier = [this](uint32_t a, uint32_t b) {
+        return store_.mass[a] > store_.mass[b] || (store_.mass[a] == store_.mass[b] && a < b);
+    };
+    mergeMembers_.clear();
+    for (const CollisionDetector::Contact& contact : contacts_) {
+        mergeMembers_.push_back(contact.a);
+        mergeMembers_.push_back(contact.b);
+        uint32_t a = find(contact.a), b = find(contact.b);
+        if (a == b) continue;
+        if (heavier(b, a)) std::swap(a, b);
+        mergeRoot_[b] = a;
+    }
+    std::sort(mergeMembers_.begin(), mergeMembers_.end());
+    mergeMembers_.erase(std::unique(mergeMembers_.begin(), mergeMembers_.end()), mergeMembers_.end());
+
+    // Each group becomes one body at its centre of mass with its total mass, momentum and volume;
+    // sorting by root lines up each group's members, in index order
+    mergeGroups_.clear();
+    for (const uint32_t i : mergeMembers_) {
+        mergeGroups_.emplace_back(find(i), i);
+    }
+    std::sort(mergeGroups_.begin(), mergeGroups_.end());
+    for (size_t first = 0; first < mergeGroups_.size();) {
+        const uint32_t rootIndex = mergeGroups_[first].first;
+        double mass = 0.0;
+        Vector3d momentum, moment;
+        double volume = 0.0;    // Sum of radius cubed
+        size_t last = first;
+        for (; last < mergeGroups_.size() && mergeGroups_[last].first == rootIndex; ++last) {
+            const uint32_t i = mergeGroups_[last].second;
+            const double m = store_.mass[i];
+            mass += m;
+            momentum += Vector3d(store_.vx[i], store_.vy[i], store_.vz[i]) * m;
+            moment += Vector3d(store_.x[i], store_.y[i], store_.z[i]) * m;
+            volume += store_.radius[i] * store_.radius[i] * store_.radius[i];
+        }
+        first = last;
 
-void SolarSystem::createPlanet(const std::string& name, double mass, double radius,
-                              double orbitDistance, double orbitVelocity,
-                              const sf::Color& color, float visualScale) {
-    // Convert orbital distance to simulation coordinates
-    float simDistance = Physics::metersToPixels(orbitDistance);
+        CelestialBody& root = *bodies_[rootIndex];
+        if (mass > 0.0) {
+            root.setPrecisePosition(moment * (1.0 / mass));
+            root.setPreciseVelocity(momentum * (1.0 / mass));
+        }
+        root.setMass(mass);
+        root.setRadius(std::cbrt(volume) / Physics::DISTANCE_SCALE);
+    }
 
-    // Place planet on positive X axis initially
-    sf::Vector2f planetPosition(simDistance, 0.0f);
+    // The others are absorbed: massless, riding along with their root until compacted away
+    for (const uint32_t i : mergeMembers_) {
+        const uint32_t root = find(i);
+        if (root == i) continue;
+        absorbed_.push_back({bodyIds_[i], *bodies_[i]});
+        bodies_[i]->setMass(0.0);
+        bodies_[i]->setRadius(0.0);
+        bodies_[i]->setPrecisePosition(bodies_[root]->getPrecisePosition());
+        bodies_[i]->setPreciseVelocity(bodies_[root]->getPreciseVelocity());
+        store_.parent[i] = BodyStore::NO_PARENT;
+        live_[i] = 0;
+        ++pendingRemovals_;
+        ++mergeCount_;
+    }
 
-    // Calculate orbital velocity for stable circular orbit
-    double orbitalSpeed = Physics::calculateOrbitalVelocity(Physics::SUN_MASS, orbitDistance);
+    // Bodies that orbited an absorbed body now orbit the one that took it in
+    for (size_t i = 0; i < n; ++i) {
+        const uint32_t parent = store_.parent[i];
+        if (parent != BodyStore::NO_PARENT && !live_[parent]) {
+            const uint32_t root = find(parent);
+            store_.parent[i] = root == i ? BodyStore::NO_PARENT : root;
+        }
+    }
+    for (uint32_t& parent : particles_.parent) {
+        if (parent != BodyStore::NO_PARENT && !live_[parent]) {
+            parent = find(parent);
+        }
+    }
 
-    // Set velocity tangent to orbit (in positive Y direction for clockwise orbit when viewed from above)
-    sf::Vector2f planetVelocity(0.0f, static_cast<float>(orbitalSpeed));
+    integrator_->invalidate();
+    particleAccelerationsValid_ = false;
+    if (!deferCompaction_) {
+        compactBodies();
+    }
+}
 
-    auto planet = std::make_unique<CelestialBody>(
-        name,
-        mass,
-        radius,
-        planetPosition,
-        planetVelocity,
-        color
-    );
+size_t SolarSystem::compactBodies() {
+    if (pendingRemovals_ == 0) {
+        return 0;
+    }
+    store_.compact(live_, compactionMap_);
+    particles_.remapParents(compactionMap_);
+    size_t kept = 0;
+    for (size_t i = 0; i < bodies_.size(); ++i) {
+        if (!live_[i]) continue;
+        bodies_[kept] = std::move(bodies_[i]);
+        bodies_[kept]->rebind(kept);
+        bodyIds_[kept] = bodyIds_[i];
+        ++kept;
+    }
+    bodies_.resize(kept);
+    bodyIds_.resize(kept);
 
-    // Scale visual radius for better visibility
-    float baseVisualRadius = Physics::metersToPixels(radius);
-    float finalVisualRadius = std::max(4.0f, baseVisualRadius * visualScale);
-    planet->setVisualRadius(finalVisualRadius);
+    bodyIndexByName_.clear();
+    for (size_t i = 0; i < kept; ++i) {
+        if (!bodies_[i]->getName().empty()) {
+            bodyIndexByName_.emplace(bodies_[i]->getName(), static_cast<uint32_t>(i));
+        }
+    }
 
-    // Debug output
-    std::cout << "Created planet " << name
-              << " at distance " << simDistance << " pixels"
-              << " with visual radius " << finalVisualRadius << " pixels" << std::endl;
+    const size_t removed = pendingRemovals_;
+    pendingRemovals_ = 0;
+    live_.assign(kept, 1);
+    integrator_->invalidate();
+    ++layout_;
+    return removed;
+}
 
-    addBody(std::move(planet));
+double SolarSystem::getStepSize(double deltaTime) const {
+    return deltaTime * Physics::TIME_SCALE;
 }
 
-void SolarSystem::storeInitialConditions() {
-    initialConditions_.clear();
-    for (const auto& body : bodies_) {
-        InitialCondition condition;
-        condition.position = body->getPosition();
-        condition.velocity = body->getVelocity();
-        initialConditions_.push_back(condition);
-    }
+void SolarSystem::setThreadCount(size_t threadCount) {
+    threadPool_.resize(threadCount);
 }
 
-void SolarSystem::restoreInitialConditions() {
-    if (initialConditions_.size() != bodies_.size()) return;
+void SolarSystem::forEachBodyRange(const ThreadPool::RangeTask& task) {
+    if (store_.size() < PARALLEL_THRESHOLD) {
+        task(0, store_.size());
+    } else {
+        threadPool_.parallelFor(store_.size(), task);
+    }
+}
 
-    for (size_t i = 0; i < bodies_.size(); ++i) {
-        bodies_[i]->setPosition(initialConditions_[i].position);
-        bodies_[i]->setVelocity(initialConditions_[i].velocity);
-        bodies_[i]->resetForces();
+void SolarSystem::forEachParticleRange(const ThreadPool::RangeTask& task) {
+    if (particles_.size() < PARALLEL_THRESHOLD) {
+        task(0, particles_.size());
+    } else {
+        threadPool_.parallelFor(particles_.size(), task);
     }
 }
 
-void SolarSystem::createMoon(const std::string& moonName, double mass, double radius,
-                            const std::string& parentPlanetName, double orbitDistance,
-                            double orbitVelocity, const sf::Color& color, float visualScale) {
-    // Find the parent planet
-    CelestialBody* parentPlanet = findBody(parentPlanetName);
-    if (!parentPlanet) {
-        std::cerr << "Warning: Could not find parent planet " << parentPlanetName
-                  << " for moon " << moonName << std::endl;
+void SolarSystem::openParticleStep(double stepSize) {
+    if (particles_.empty()) {
         return;
     }
+    // The closing kick's accelerations open the next step unless the state jumped since
+    if (!particleAccelerationsValid_ || particleRevision_ != revision_) {
+        calculateParticleAccelerations();
+    }
+    const bool threeD = is3DMode_;
+    forEachParticleRange([&](size_t begin, size_t end) {
+        particles_.kick(begin, end, 0.5 * stepSize, threeD);
+        particles_.drift(begin, end, stepSize, threeD);
+    });
+}
 
-    // Calculate moon's position relative to parent planet
-    sf::Vector2f parentPos = parentPlanet->getPosition();
-    sf::Vector2f parentVel = parentPlanet->getVelocity();
-
-    // Convert orbital distance to simulation coordinates
-    float simDistance = Physics::metersToPixels(orbitDistance);
+void SolarSystem::closeParticleStep(double stepSize) {
+    if (particles_.empty()) {
+        return;
+    }
+    calculateParticleAccelerations();
+    const bool threeD = is3DMode_;
+    forEachParticleRange([&](size_t begin, size_t end) {
+        particles_.kick(begin, end, 0.5 * stepSize, threeD);
+    });
+}
 
-    // Place moon initially to the right of the planet
-    sf::Vector2f moonPosition = parentPos + sf::Vector2f(simDistance, 0.0f);
+void SolarSystem::shortenParticleStep(double stepSize, double advanced) {
+    if (particles_.empty()) {
+        return;
+    }
+    // The opening accelerations are still in place: undo the drift, trim the opening
+    // kick to half the shorter step and drift again
+    const bool threeD = is3DMode_;
+    forEachParticleRange([&](size_t begin, size_t end) {
+        particles_.drift(begin, end, -stepSize, threeD);
+        particles_.kick(begin, end, -0.5 * (stepSize - advanced), threeD);
+        particles_.drift(begin, end, advanced, threeD);
+    });
+}
 
-    // Calculate orbital velocity around the parent planet
-    double planetMass = parentPlanet->getMass();
-    double moonOrbitalSpeed = Physics::calculateOrbitalVelocity(planetMass, orbitDistance);
+void SolarSystem::calculateParticleAccelerations() {
+    GRAVITY_PROFILE_SCOPE("particleForces");
+    // The bodies' last force evaluation may have been at a substep; refresh their copy
+    prepareForceEvaluation();
+    const float softening2 = getSoftening2();
+    const bool threeD = is3DMode_;
+    forEachParticleRange([&](size_t begin, size_t end) {
+        particles_.computeAccelerations(store_, begin, end, softening2, threeD);
+    });
+    particleAccelerationsValid_ = true;
+    particleRevision_ = revision_;
+}
 
-    // Add parent planet's velocity plus moon's orbital velocity (perpendicular)
-    sf::Vector2f moonVelocity = parentVel + sf::Vector2f(0.0f, static_cast<float>(moonOrbitalSpeed));
+void SolarSystem::setForceSolver(std::unique_ptr<ForceSolver> solver) {
+    if (solver) {
+        solver_ = std::move(solver);
+        integrator_->invalidate();
+    }
+}
 
-    auto moon = std::make_unique<CelestialBody>(
-        moonName,
-        mass,
-        radius,
-        moonPosition,
-        moonVelocity,
-        color
-    );
+void SolarSystem::setIntegrator(std::unique_ptr<Integrator> integrator) {
+    if (integrator) {
+        integrator_ = std::move(integrator);
+    }
+}
 
-    // Scale visual radius for better visibility (moons are usually very small)
-    float baseVisualRadius = Physics::metersToPixels(radius);
-    moon->setVisualRadius(std::max(2.0f, baseVisualRadius * visualScale));
+float SolarSystem::getSoftening2() {
+    const float softening = static_cast<float>(Physics::SOFTENING_LENGTH * Physics::DISTANCE_SCALE);
+    return softening * softening;
+}
 
-    addBody(std::move(moon));
+double SolarSystem::getSoftening2Precise() {
+    const double softening = Physics::SOFTENING_LENGTH * Physics::DISTANCE_SCALE;
+    return softening * softening;
 }
 
-void SolarSystem::addMoonsToEarth() {
-    // Luna (Earth's Moon)
-    createMoon("Luna", 7.342e22, 1737.4e3, "Earth", 384400e3, 1.022e3,
-               sf::Color::White, 8.0f);
+void SolarSystem::prepareForceEvaluation() {
+    // Centring the single-precision copy on the barycentre keeps its rounding
+    // error independent of where the system has drifted to
+    store_.recenterOrigin();
+    const bool threeD = is3DMode_;
+    forEachBodyRange([&](size_t begin, size_t end) {
+        store_.updateSinglePositions(begin, end, threeD);
+    });
 }
 
-void SolarSystem::addMoonsToMars() {
-    // Phobos
-    createMoon("Phobos", 1.0659e16, 11.1e3, "Mars", 9376e3, 2.138e3,
-               sf::Color(139, 139, 139), 15.0f);
+template <bool ThreeD>
+void SolarSystem::correctParentForces(const std::vector<uint8_t>* mask) {
+    // The solvers see positions rounded to float, which for a moon far from the
+    // origin misplaces it relative to its planet by a sizeable fraction of the
+    // orbit. That pair dominates the moon's acceleration, so subtract the float
+    // term the solver computed (same formula as the kernel) and add it back
+    // from the double positions. Serial: several children share each parent.
+    const float softening2 = getSoftening2();
+    const double softening2Precise = getSoftening2Precise();
+    for (size_t i = 0; i < store_.size(); ++i) {
+        const uint32_t p = store_.parent[i];
+        if (p == BodyStore::NO_PARENT || p >= store_.size()) continue;
+        const bool correctChild = !mask || (*mask)[i];
+        const bool correctParent = !mask || (*mask)[p];
+        if (!correctChild && !correctParent) continue;
+
+        const float fdx = store_.px[p] - store_.px[i];
+        const float fdy = store_.py[p] - store_.py[i];
+        const float fdz = ThreeD ? store_.pz[p] - store_.pz[i] : 0.0f;
+        const float fr2 = fdx * fdx + fdy * fdy + fdz * fdz + softening2;
+        const float fInvR = 1.0f / std::sqrt(fr2);
+        const float fInvR3 = fInvR * fInvR * fInvR;
+
+        const double dx = store_.x[p] - store_.x[i];
+        const double dy = store_.y[p] - store_.y[i];
+        const double dz = ThreeD ? store_.z[p] - store_.z[i] : 0.0;
+        const double r2 = dx * dx + dy * dy + dz * dz + softening2Precise;
+        const double invR3 = 1.0 / (r2 * std::sqrt(r2));
+
+        // Difference of the unit-mass pull, double minus float
+        const double cx = dx * invR3 - static_cast<double>(fdx * fInvR3);
+        const double cy = dy * invR3 - static_cast<double>(fdy * fInvR3);
+        const double cz = dz * invR3 - static_cast<double>(fdz * fInvR3);
+
+        if (correctChild) {
+            store_.ax[i] += static_cast<float>(store_.gm[p] * cx);
+            store_.ay[i] += static_cast<float>(store_.gm[p] * cy);
+            if (ThreeD) {
+                store_.az[i] += static_cast<float>(store_.gm[p] * cz);
+            }
+        }
+        if (correctParent) {
+            store_.ax[p] -= static_cast<float>(store_.gm[i] * cx);
+            store_.ay[p] -= static_cast<float>(store_.gm[i] * cy);
+            if (ThreeD) {
+                store_.az[p] -= static_cast<float>(store_.gm[i] * cz);
+            }
+        }
 
-    // Deimos
-    createMoon("Deimos", 1.4762e15, 6.2e3, "Mars", 23463e3, 1.351e3,
-               sf::Color(105, 105, 105), 18.0f);
+        // Subset evaluations leave the potential alone, so only full ones correct it
+        if (!mask && !store_.potential.empty()) {
+            const double cp = 1.0 / std::sqrt(r2) - static_cast<double>(fInvR);
+            store_.potential[i] -= static_cast<float>(store_.gm[p] * cp);
+            store_.potential[p] -= static_cast<float>(store_.gm[i] * cp);
+        }
+    }
 }
 
-void SolarSystem::addMoonsToJupiter() {
-    // Io
-    createMoon("Io", 8.9319e22, 1821.6e3, "Jupiter", 421700e3, 17.334e3,
-               sf::Color(255, 255, 0), 4.0f);
+void SolarSystem::correctParentForces(bool threeD, const std::vector<uint8_t>* mask) {
+    if (threeD) {
+        correctParentForces<true>(mask);
+    } else {
+        correctParentForces<false>(mask);
+    }
+}
 
-    // Europa
-    createMoon("Europa", 4.7998e22, 1560.8e3, "Jupiter", 671034e3, 13.740e3,
-               sf::Color(173, 216, 230), 4.5f);
+void SolarSystem::calculateGravitationalForces() {
+    GRAVITY_PROFILE_SCOPE("forces");
+    store_.resetForces();
+    prepareForceEvaluation();
+    solver_->computeAccelerations(store_, threadPool_, getSoftening2(), is3DMode_);
+    correctParentForces(is3DMode_);
+    potentialCurrent_ = !store_.potential.empty();
+    forceEvaluations_ += store_.size();
+}
 
-    // Ganymede
-    createMoon("Ganymede", 1.4819e23, 2634.1e3, "Jupiter", 1070412e3, 10.880e3,
-               sf::Color(139, 119, 101), 3.0f);
+void SolarSystem::calculateGravitationalForces(const std::vector<uint32_t>& targets) {
+    GRAVITY_PROFILE_SCOPE("forcesSubset");
+    targetMask_.assign(store_.size(), 0);
+    for (uint32_t i : targets) {
+        targetMask_[i] = 1;
+        store_.ax[i] = 0.0f;
+        store_.ay[i] = 0.0f;
+        store_.az[i] = 0.0f;
+    }
+    prepareForceEvaluation();
+    solver_->computeAccelerationsFor(store_, threadPool_, targets, getSoftening2(), is3DMode_);
+    correctParentForces(is3DMode_, &targetMask_);
+    // The other bodies have moved since the last full evaluation
+    potentialCurrent_ = false;
+    forceEvaluations_ += targets.size();
+}
 
-    // Callisto
-    createMoon("Callisto", 1.0759e23, 2410.3e3, "Jupiter", 1882709e3, 8.204e3,
-               sf::Color(64, 64, 64), 3.2f);
+void SolarSystem::storeInitialConditions() {
+    initialSimulationTime_ = simulationTime_;
+    initialConditions_.clear();
+    initialConditions_.reserve(store_.size());
+    for (size_t i = 0; i < store_.size(); ++i) {
+        InitialCondition condition;
+        condition.id = bodyIds_[i];
+        condition.position = Vector3d(store_.x[i], store_.y[i], store_.z[i]);
+        condition.velocity = Vector3d(store_.vx[i], store_.vy[i], store_.vz[i]);
+        condition.mass = store_.mass[i];
+        condition.radius = bodies_[i]->getRadius();
+        condition.parent = store_.parent[i];
+        initialConditions_.push_back(condition);
+    }
+    absorbed_.clear();
+    initialParticles_ = particles_;
 }
 
-void SolarSystem::addMoonsToSaturn() {
-    // Titan
-    createMoon("Titan", 1.3452e23, 2574e3, "Saturn", 1221830e3, 5.57e3,
-               sf::Color(255, 165, 0), 3.5f);
+void SolarSystem::restoreInitialConditions() {
+    bool sameBodies = initialConditions_.size() == bodies_.size();
+    for (size_t i = 0; sameBodies && i < bodies_.size(); ++i) {
+        sameBodies = initialConditions_[i].id == bodyIds_[i];
+    }
+    if (!sameBodies && !restoreAbsorbedBodies()) return;
 
-    // Enceladus (smaller but interesting)
-    createMoon("Enceladus", 1.08022e20, 252.1e3, "Saturn", 238020e3, 12.635e3,
-               sf::Color::White, 12.0f);
+    for (size_t i = 0; i < bodies_.size(); ++i) {
+        const InitialCondition& condition = initialConditions_[i];
+        bodies_[i]->setPrecisePosition(condition.position);
+        bodies_[i]->setPreciseVelocity(condition.velocity);
+        bodies_[i]->setMass(condition.mass);
+        bodies_[i]->setRadius(condition.radius);
+        store_.parent[i] = condition.parent;
+    }
+    live_.assign(bodies_.size(), 1);
+    pendingRemovals_ = 0;
+    absorbed_.clear();
+    if (initialParticles_.size() == particles_.size()) {
+        particles_ = initialParticles_;
+    }
+    store_.resetForces();
+    integrator_->invalidate();
+    ++revision_;
+    simulationTime_ = initialSimulationTime_;
 }
 
-void SolarSystem::addMoonsToUranus() {
-    // Add major moons if desired - currently empty
-}
+bool SolarSystem::restoreAbsorbedBodies() {
+    const size_t n = initialConditions_.size();
+    auto slotOf = [&](uint32_t id) {
+        // Ids grow with the index, so the initial conditions are sorted by them
+        auto it = std::lower_bound(initialConditions_.begin(), initialConditions_.end(), id,
+                                   [](const InitialCondition& c, uint32_t value) { return c.id < value; });
+        return it != initialConditions_.end() && it->id == id ? static_cast<size_t>(it - initialConditions_.begin()) : n;
+    };
+
+    std::vector<std::unique_ptr<CelestialBody>> restored(n);
+    for (size_t i = 0; i < bodies_.size(); ++i) {
+        const size_t slot = slotOf(bodyIds_[i]);
+        if (slot == n) return false;    // Added after the initial state; nothing to return to
+        if (live_[i]) restored[slot] = std::make_unique<CelestialBody>(*bodies_[i]);
+    }
+    for (const AbsorbedBody& absorbed : absorbed_) {
+        const size_t slot = slotOf(absorbed.id);
+        if (slot < n) restored[slot] = std::make_unique<CelestialBody>(absorbed.body);
+    }
+    for (const auto& body : restored) {
+        if (!body) return false;
+    }
 
-void SolarSystem::addMoonsToNeptune() {
-    // Add Triton if desired - currently empty
+    // Detached copies, re-added in their original order with fresh ids
+    bodies_.clear();
+    store_.clear();
+    bodyIndexByName_.clear();
+    bodyIds_.clear();
+    live_.clear();
+    for (size_t slot = 0; slot < n; ++slot) {
+        addBody(std::move(restored[slot]), initialConditions_[slot].parent);
+        initialConditions_[slot].id = bodyIds_.back();
+    }
+    return true;
 }
@@ -1,7 +1,18 @@
 #pragma once
 #include "CelestialBody.h"
+#include "BodyStore.h"
+#include "ThreadPool.h"
+#include "ForceSolver.h"
+#include "Integrator.h"
+#include "StateSnapshot.h"
+#include "Scenario.h"
+#include "CollisionDetector.h"
+#include "TestParticles.h"
+#include <cstdint>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 
 /**
  * Manages the solar system simulation including all celestial bodies
@@ -15,16 +26,41 @@ public:
     // Initialize the solar system with realistic data
     void initialize();
 
+    // Replace all bodies with the scenario's, generating its belts; becomes the reset state.
+    // Only test particles [firstParticle, lastParticle) of the scenario's are made, so the
+    // processes of a distributed run can each load their own share
+    void load(const Scenario& scenario, uint64_t firstParticle = 0, uint64_t lastParticle = UINT64_MAX);
+
     // Update physics for all bodies
     void update(double deltaTime);
 
+    // Advance by exactly stepSize simulated seconds, ignoring pause and time scale
+    void advance(double stepSize);
+
     // Get all bodies for rendering
     const std::vector<std::unique_ptr<CelestialBody>>& getBodies() const { return bodies_; }
 
-    // Add a new celestial body
-    void addBody(std::unique_ptr<CelestialBody> body);
+    // Packed physics state of all bodies, indexed like getBodies()
+    const BodyStore& getStore() const { return store_; }
+    BodyStore& getStore() { return store_; }
+
+    // Add a new celestial body; parent is the index of the body it orbits, if any
+    void addBody(std::unique_ptr<CelestialBody> body, uint32_t parent = BodyStore::NO_PARENT);
 
-    // Remove all bodies
+    // Add a massless test particle (simulation units); it feels the bodies but pulls on nothing
+    void addTestParticle(const Vector3d& position, const Vector3d& velocity, const Color& color,
+                         uint32_t parent = BodyStore::NO_PARENT);
+
+    // Test particles, stepped alongside the bodies; colours are indexed like them
+    const TestParticles& getTestParticles() const { return particles_; }
+    TestParticles& getTestParticles() { return particles_; }
+    const std::vector<Color>& getTestParticleColors() const { return particleColors_; }
+    size_t getTestParticleCount() const { return particles_.size(); }
+    // Replace the test particles and their colours, as when a distributed run moves some to
+    // another process; restoreInitialConditions() leaves these as they are
+    void setTestParticles(TestParticles particles, std::vector<Color> colors);
+
+    // Remove all bodies and test particles
     void clear();
 
     // Get body by index
@@ -34,8 +70,9 @@ public:
     // Get number of bodies
     size_t getBodyCount() const { return bodies_.size(); }
 
-    // Find body by name
+    // Find body by name (the first added, if several share it); a hash lookup
     CelestialBody* findBody(const std::string& name);
+    const CelestialBody* findBody(const std::string& name) const;
 
     // Get the central body (usually the Sun)
     CelestialBody* getCentralBody() { return bodies_.empty() ? nullptr : bodies_[0].get(); }
@@ -49,57 +86,239 @@ public:
     void setTimeScale(double timeScale) { timeScale_ = timeScale; }
     double getTimeScale() const { return timeScale_; }
 
+    // Integration timestep in simulated seconds for deltaTime seconds of (time-scaled) frame time
+    double getStepSize(double deltaTime) const;
+
+    // Squared Physics::SOFTENING_LENGTH in simulation units
+    static float getSoftening2();
+    static double getSoftening2Precise();
+
     // 3D simulation mode
     void set3DMode(bool enable3D);
     bool is3DMode() const { return is3DMode_; }
-    void toggle3DMode() { is3DMode_ = !is3DMode_; }
+    void toggle3DMode() { set3DMode(!is3DMode_); }
+
+    // Worker threads used for force evaluation (including the calling thread); 0 = all cores
+    void setThreadCount(size_t threadCount);
+    size_t getThreadCount() const { return threadPool_.size(); }
+
+    // Force evaluation strategy; the exact DirectSolver is the default
+    void setForceSolver(std::unique_ptr<ForceSolver> solver);
+    ForceSolver& getForceSolver() { return *solver_; }
+    const ForceSolver& getForceSolver() const { return *solver_; }
+
+    // Time integration scheme; kick-drift-kick leapfrog is the default
+    void setIntegrator(std::unique_ptr<Integrator> integrator);
+    Integrator& getIntegrator() { return *integrator_; }
+    const Integrator& getIntegrator() const { return *integrator_; }
+
+    // Merge bodies whose spheres touch during a step into the heaviest of them, conserving
+    // mass and momentum; off by default
+    void setCollisions(bool enable) { collisions_ = enable; }
+    bool getCollisions() const { return collisions_; }
+
+    // Bodies absorbed by merges since the system was created
+    size_t getMergeCount() const { return mergeCount_; }
 
-    // Get raw bodies vector for 3D physics calculations
-    std::vector<CelestialBody> getRawBodies() const;
+    // Absorbed bodies leave getBodies() right after the step that merged them unless compaction
+    // is deferred. Defer it when another thread reads getBodies() without the mutex, and call
+    // compactBodies() from that thread while holding it; until then absorbed bodies are massless
+    // and ride along with the body that took them in. Returns the number of bodies dropped.
+    void setDeferCompaction(bool defer) { deferCompaction_ = defer; }
+    size_t compactBodies();
+
+    // Stable id of each body, indexed like getBodies(); bumps of getLayoutRevision() mark changes
+    const std::vector<uint32_t>& getBodyIds() const { return bodyIds_; }
+    uint64_t getLayoutRevision() const { return layout_; }
+
+    // Call after editing body positions directly through the store
+    void invalidateAccelerations() { integrator_->invalidate(); ++revision_; }
+
+    // Bumped whenever the state jumps instead of evolving (bodies added, reset, mode change, edits)
+    uint64_t getRevision() const { return revision_; }
+
+    // Copy positions and velocities out for another thread; leaves snapshot.time alone
+    void captureSnapshot(StateSnapshot& snapshot) const;
+
+    // Body accelerations evaluated since the system was created; a full evaluation counts N
+    size_t getForceEvaluationCount() const { return forceEvaluations_; }
+
+    // Integrator steps taken since the system was created; paused frames take none
+    uint64_t getStepCount() const { return stepCount_; }
+    // Carry the count on across a checkpoint; diagnostics intervals are counted from it
+    void setStepCount(uint64_t steps) { stepCount_ = steps; }
+
+    // Progress messages on stdout while building the system; on by default
+    void setVerbose(bool verbose) { verbose_ = verbose; }
+    bool isVerbose() const { return verbose_; }
+
+    // Simulated seconds integrated since the system was built or reset
+    double getSimulationTime() const { return simulationTime_; }
+    // Steps the integrator gave up on part way, and the simulated seconds they left out
+    uint64_t getShortStepCount() const { return shortSteps_; }
+    double getTimeShortfall() const { return timeShortfall_; }
+    void setSimulationTime(double seconds) { simulationTime_ = seconds; }
+
+    // Remember the current state as the one reset() returns to
+    void storeInitialConditions();
 
     // Get simulation statistics
     double getTotalEnergy() const;
     sf::Vector2f getCenterOfMass() const;
 
+    /**
+     * Conserved quantities of the bodies, in SI units. The potential energy is read from
+     * the step's own force evaluation, so a sample costs O(N) on top of the step instead of
+     * the O(N^2) pass of getTotalEnergy(); it is softened and as approximate as the solver.
+     * Test particles are massless and add nothing. Merges are inelastic, so with collisions
+     * on the energy drift includes what they dissipated.
+     */
+    struct Diagnostics {
+        bool valid = false;            // False until the first sample
+        uint64_t step = 0;             // getStepCount() when sampled
+        double simulationTime = 0.0;
+        double kineticEnergy = 0.0;    // J
+        double potentialEnergy = 0.0;  // J
+        Vector3d momentum;             // kg m/s
+        Vector3d angularMomentum;      // kg m^2/s about the origin
+        Vector3d centerOfMass;         // m
+        // Change since the first sample after the last state jump (see getRevision())
+        double energyDrift = 0.0;           // (E - E0) / |E0|
+        double angularMomentumDrift = 0.0;  // |L - L0| / |L0|
+        double momentumDrift = 0.0;         // |P - P0| in kg m/s
+
+        double totalEnergy() const { return kineticEnergy + potentialEnergy; }
+    };
+
+    // Sample diagnostics at the end of every this many steps; 0 (the default) turns them off
+    void setDiagnosticsInterval(uint64_t steps) { diagnosticsInterval_ = steps; }
+    uint64_t getDiagnosticsInterval() const { return diagnosticsInterval_; }
+
+    // Most recent sample
+    const Diagnostics& getDiagnostics() const { return diagnostics_; }
+
+    // Sample now, at the cost of one full force evaluation
+    const Diagnostics& sampleDiagnostics();
+
     // Reset to initial conditions
     void reset();
 
 private:
     std::vector<std::unique_ptr<CelestialBody>> bodies_;
+    BodyStore store_;  // Hot state the physics loops run on; bodies_ are handles into it
+    std::unordered_map<std::string, uint32_t> bodyIndexByName_;  // Named bodies only
     bool paused_;
     double timeScale_; // Speed multiplier for simulation time
     bool is3DMode_;    // Whether to use 3D simulation mode
 
-    // Physics integration method
-    void updatePhysics(double deltaTime);
+    // Force evaluation
+    ThreadPool threadPool_;
+    std::unique_ptr<ForceSolver> solver_;
+    std::unique_ptr<Integrator> integrator_;
+    size_t forceEvaluations_;
+    uint64_t stepCount_;
+    uint64_t revision_;
+    bool verbose_;
+    double simulationTime_;
+    uint64_t shortSteps_ = 0;
+    double timeShortfall_ = 0.0;
+    std::vector<uint8_t> targetMask_;  // Scratch for subset evaluations
+
+    // Collisions
+    bool collisions_ = false;
+    bool deferCompaction_ = false;
+    size_t mergeCount_ = 0;
+    CollisionDetector collisionDetector_;
+    std::vector<CollisionDetector::Contact> contacts_;
+    std::vector<uint8_t> live_;          // 0 for bodies absorbed but not yet compacted away
+    size_t pendingRemovals_ = 0;
+    std::vector<uint32_t> mergeRoot_;    // Union-find scratch over merging bodies
+    std::vector<uint32_t> mergeMembers_;
+    std::vector<std::pair<uint32_t, uint32_t>> mergeGroups_;   // (root, member), sorted into groups
+    std::vector<uint32_t> compactionMap_;
+
+    std::vector<uint32_t> bodyIds_;
+    uint32_t nextBodyId_ = 0;
+    uint64_t layout_ = 0;
+
+    // Test particles
+    TestParticles particles_;
+    std::vector<Color> particleColors_;
+    TestParticles initialParticles_;
+    bool particleAccelerationsValid_ = false;
+    uint64_t particleRevision_ = 0;    // revision_ the particle accelerations belong to
+
+    // Diagnostics
+    uint64_t diagnosticsInterval_ = 0;
+    Diagnostics diagnostics_;
+    Diagnostics diagnosticsBaseline_;
+    uint64_t diagnosticsRevision_ = 0;  // revision_ the baseline belongs to
+    bool potentialCurrent_ = false;     // store_.potential holds the last full evaluation's
+
+    // Below this many bodies the pool's wake-up cost outweighs the work
+    static constexpr size_t PARALLEL_THRESHOLD = 256;
+
+    // Advance the integrator by stepSize simulated seconds
+    void updatePhysics(double stepSize);
 
-    // Calculate forces between all bodies
+    // Merge the bodies that touched during the step just taken
+    void resolveCollisions(double stepSize);
+
+    // Replace the store's accelerations with those at the current positions;
+    // reads positions only, so every body sees the same state
     void calculateGravitationalForces();
 
-    // Helper methods for initialization
-    void createSun();
-    void createPlanet(const std::string& name, double mass, double radius,
-                     double orbitDistance, double orbitVelocity,
-                     const sf::Color& color, float visualScale = 1.0f);
-
-    // Moon creation methods
-    void createMoon(const std::string& moonName, double mass, double radius,
-                   const std::string& parentPlanetName, double orbitDistance,
-                   double orbitVelocity, const sf::Color& color, float visualScale = 1.0f);
-    void addMoonsToEarth();
-    void addMoonsToMars();
-    void addMoonsToJupiter();
-    void addMoonsToSaturn();
-    void addMoonsToUranus();
-    void addMoonsToNeptune();
-
-    // Store initial conditions for reset functionality
-    void storeInitialConditions();
+    // Recompute the accelerations of the listed bodies only
+    void calculateGravitationalForces(const std::vector<uint32_t>& targets);
+
+    // Refresh the floating origin and the solvers' single-precision positions
+    void prepareForceEvaluation();
+
+    // Replace the single-precision pull between each body and its parent with a double one;
+    // with a mask, only bodies flagged in it are corrected
+    void correctParentForces(bool threeD, const std::vector<uint8_t>* mask = nullptr);
+    template <bool ThreeD>
+    void correctParentForces(const std::vector<uint8_t>* mask);
+
+    // Run task over [0, N) on the pool, or inline for small systems
+    void forEachBodyRange(const ThreadPool::RangeTask& task);
+    void forEachParticleRange(const ThreadPool::RangeTask& task);
+
+    // Test particles take a kick-drift-kick step in the field of the bodies before and
+    // after theirs: open before the bodies move, close once they have
+    void openParticleStep(double stepSize);
+    void closeParticleStep(double stepSize);
+    // Pull the particles back from a step of stepSize to the advanced seconds the bodies made
+    void shortenParticleStep(double stepSize, double advanced);
+    void calculateParticleAccelerations();
+
+    // Evaluate the potential at the current positions unless the step left it there
+    void finishDiagnosticsStep();
+    // Fill diagnostics_ from the store and its potential
+    void computeDiagnostics();
+
+    // Restore the state saved by storeInitialConditions()
     void restoreInitialConditions();
 
+    // Rebuild the initial body set from the survivors and absorbed_; false if some body is missing
+    bool restoreAbsorbedBodies();
+
+    // Mass, radius and parent change in merges, so they are kept along with the state
     struct InitialCondition {
-        sf::Vector2f position;
-        sf::Vector2f velocity;
+        uint32_t id;
+        Vector3d position;
+        Vector3d velocity;
+        double mass;
+        double radius;
+        uint32_t parent;
     };
     std::vector<InitialCondition> initialConditions_;
+    double initialSimulationTime_;
+
+    // Detached copies of the bodies merged away since the initial state, so reset() can bring them back
+    struct AbsorbedBody {
+        uint32_t id;
+        CelestialBody body;
+    };
+    std::vector<AbsorbedBody> absorbed_;
 };
@@ -0,0 +1,162 @@
+#include "SpatialTree.h"
+#include <algorithm>
+#include <numeric>
+
+void SpatialTree::build(const BodyStore& store, bool threeD, size_t leafSize) {
+    threeD_ = threeD;
+    leafSize_ = leafSize > 0 ? leafSize : 1;
+
+    const size_t n = store.size();
+    nodes_.clear();
+    leaves_.clear();
+    if (n == 0) {
+        return;
+    }
+
+    order_.resize(n);
+    std::iota(order_.begin(), order_.end(), 0u);
+    orderScratch_.resize(n);
+    childCode_.resize(n);
+
+    // Root cell: a cube around all bodies
+    float minX = store.px[0], maxX = store.px[0];
+    float minY = store.py[0], maxY = store.py[0];
+    float minZ = threeD ? store.pz[0] : 0.0f, maxZ = minZ;
+    for (size_t i = 1; i < n; ++i) {
+        minX = std::min(minX, store.px[i]);
+        maxX = std::max(maxX, store.px[i]);
+        minY = std::min(minY, store.py[i]);
+        maxY = std::max(maxY, store.py[i]);
+        if (threeD) {
+            minZ = std::min(minZ, store.pz[i]);
+            maxZ = std::max(maxZ, store.pz[i]);
+        }
+    }
+    float extent = std::max(maxX - minX, std::max(maxY - minY, maxZ - minZ));
+
+    Node root;
+    root.centerX = 0.5f * (minX + maxX);
+    root.centerY = 0.5f * (minY + maxY);
+    root.centerZ = 0.5f * (minZ + maxZ);
+    // Pad slightly so bodies on the max faces classify into the upper children
+    root.halfSize = 0.5f * extent * 1.0001f + 1e-6f;
+    root.comX = root.comY = root.comZ = 0.0f;
+    root.gm = 0.0f;
+    root.firstChild = 0;
+    root.begin = 0;
+    root.count = static_cast<uint32_t>(n);
+    nodes_.push_back(root);
+
+    buildNode(store, 0, 0);
+
+    // Copy the sources into tree order so leaves are contiguous ranges
+    sortedX_.resize(n);
+    sortedY_.resize(n);
+    sortedZ_.resize(n);
+    sortedGm_.resize(n);
+    for (size_t k = 0; k < n; ++k) {
+        uint32_t b = order_[k];
+        sortedX_[k] = store.px[b];
+        sortedY_[k] = store.py[b];
+        sortedZ_[k] = threeD ? store.pz[b] : 0.0f;
+        sortedGm_[k] = store.gm[b];
+    }
+}
+
+void SpatialTree::buildNode(const BodyStore& store, uint32_t nodeIndex, unsigned int depth) {
+    const bool threeD = threeD_;
+    // Copy: the pool may reallocate while children are appended
+    Node node = nodes_[nodeIndex];
+    const uint32_t end = node.begin + node.count;
+
+    if (node.count <= leafSize_ || depth >= MAX_DEPTH) {
+        double gm = 0.0, mx = 0.0, my = 0.0, mz = 0.0;
+        for (uint32_t k = node.begin; k < end; ++k) {
+            uint32_t b = order_[k];
+            double m = store.gm[b];
+            gm += m;
+            mx += m * store.px[b];
+            my += m * store.py[b];
+            if (threeD) {
+                mz += m * store.pz[b];
+            }
+        }
+
+        Node& leaf = nodes_[nodeIndex];
+        leaf.gm = static_cast<float>(gm);
+        leaf.comX = gm > 0.0 ? static_cast<float>(mx / gm) : node.centerX;
+        leaf.comY = gm > 0.0 ? static_cast<float>(my / gm) : node.centerY;
+        leaf.comZ = gm > 0.0 ? static_cast<float>(mz / gm) : node.centerZ;
+        leaf.firstChild = 0;
+        if (node.count > 0) {
+            leaves_.push_back(nodeIndex);
+        }
+        return;
+    }
+
+    // Partition the node's bodies by child cell with a counting sort
+    const unsigned int childCount = threeD ? 8 : 4;
+    uint32_t counts[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (uint32_t k = node.begin; k < end; ++k) {
+        uint32_t b = order_[k];
+        uint8_t code = static_cast<uint8_t>((store.px[b] >= node.centerX ? 1 : 0) |
+                                            (store.py[b] >= node.centerY ? 2 : 0));
+        if (threeD && store.pz[b] >= node.centerZ) {
+            code |= 4;
+        }
+        childCode_[k] = code;
+        ++counts[code];
+    }
+
+    uint32_t offsets[8];
+    uint32_t running = node.begin;
+    for (unsigned int c = 0; c < childCount; ++c) {
+        offsets[c] = running;
+        running += counts[c];
+    }
+    for (uint32_t k = node.begin; k < end; ++k) {
+        orderScratch_[offsets[childCode_[k]]++] = order_[k];
+    }
+    std::copy(orderScratch_.begin() + node.begin, orderScratch_.begin() + end, order_.begin() + node.begin);
+
+    const uint32_t firstChild = static_cast<uint32_t>(nodes_.size());
+    const float childHalf = 0.5f * node.halfSize;
+    running = node.begin;
+    for (unsigned int c = 0; c < childCount; ++c) {
+        Node child;
+        child.centerX = node.centerX + ((c & 1) ? childHalf : -childHalf);
+        child.centerY = node.centerY + ((c & 2) ? childHalf : -childHalf);
+        child.centerZ = threeD ? node.centerZ + ((c & 4) ? childHalf : -childHalf) : 0.0f;
+        child.halfSize = childHalf;
+        child.comX = child.centerX;
+        child.comY = child.centerY;
+        child.comZ = child.centerZ;
+        child.gm = 0.0f;
+        child.firstChild = 0;
+        child.begin = running;
+        child.count = counts[c];
+        running += counts[c];
+        nodes_.push_back(child);
+    }
+    nodes_[nodeIndex].firstChild = firstChild;
+
+    double gm = 0.0, mx = 0.0, my = 0.0, mz = 0.0;
+    for (unsigned int c = 0; c < childCount; ++c) {
+        if (counts[c] == 0) {
+            continue;
+        }
+        buildNode(store, firstChild + c, depth + 1);
+
+        const Node& child = nodes_[firstChild + c];
+        gm += child.gm;
+        mx += static_cast<double>(child.gm) * child.comX;
+        my += static_cast<double>(child.gm) * child.comY;
+        mz += static_cast<double>(child.gm) * child.comZ;
+    }
+
+    Node& parent = nodes_[nodeIndex];
+    parent.gm = static_cast<float>(gm);
+    parent.comX = gm > 0.0 ? static_cast<float>(mx / gm) : node.centerX;
+    parent.comY = gm > 0.0 ? static_cast<float>(my / gm) : node.centerY;
+    parent.comZ = gm > 0.0 ? static_cast<float>(mz / gm) : node.centerZ;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "BodyStore.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * Adaptive spatial tree over the body store: a quadtree in 2D mode and an
+ * octree in 3D mode, shared by the tree-based force solvers.
+ *
+ * The tree is rebuilt from scratch on every build() into node and index pools
+ * whose capacity is kept between calls, so steady-state rebuilds do not
+ * allocate. Bodies are reordered so every node covers a contiguous range, and
+ * positions and gm are copied into that order for the kernels.
+ */
+class SpatialTree {
+public:
+    struct Node {
+        float centerX, centerY, centerZ;  // Geometric center of the cell
+        float halfSize;                   // Half the cell's side length
+        float comX, comY, comZ;           // Center of mass
+        float gm;                         // Total gravitational parameter of the cell
+        uint32_t firstChild;              // Index of the first of 4 / 8 children, 0 for leaves
+        uint32_t begin;                   // First body of the cell in tree order
+        uint32_t count;                   // Number of bodies in the cell
+    };
+
+    /**
+     * Rebuild the tree for the current body positions
+     * @param leafSize Maximum number of bodies in a leaf before it is split
+     */
+    void build(const BodyStore& store, bool threeD, size_t leafSize);
+
+    bool empty() const { return nodes_.empty(); }
+    bool isThreeD() const { return threeD_; }
+    unsigned int getChildCount() const { return threeD_ ? 8 : 4; }
+
+    // Node pool, root at index 0; children always follow their parent
+    const std::vector<Node>& getNodes() const { return nodes_; }
+    // Indices of non-empty leaves in depth-first order
+    const std::vector<uint32_t>& getLeaves() const { return leaves_; }
+    // Body indices in tree order; node.begin / node.count index into this
+    const std::vector<uint32_t>& getOrder() const { return order_; }
+
+    // Positions (z = 0 in 2D mode) and gm in tree order
+    const std::vector<float>& getSortedX() const { return sortedX_; }
+    const std::vector<float>& getSortedY() const { return sortedY_; }
+    const std::vector<float>& getSortedZ() const { return sortedZ_; }
+    const std::vector<float>& getSortedGm() const { return sortedGm_; }
+
+private:
+    void buildNode(const BodyStore& store, uint32_t nodeIndex, unsigned int depth);
+
+    bool threeD_ = false;
+    size_t leafSize_ = 16;
+
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> leaves_;
+    std::vector<uint32_t> order_;
+    std::vector<uint32_t> orderScratch_;
+    std::vector<uint8_t> childCode_;
+    std::vector<float> sortedX_, sortedY_, sortedZ_, sortedGm_;
+
+    // Bodies that share a position cannot be separated; stop splitting past this depth
+    static constexpr unsigned int MAX_DEPTH = 32;
+};
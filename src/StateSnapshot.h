@@ -0,0 +1,63 @@
+#pragma once
+#include "CelestialBody.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Copy of the moving part of the body state at one instant, indexed like
+ * SolarSystem::getBodies(). The physics thread publishes these so the
+ * renderer never reads the store while it is being integrated.
+ */
+struct StateSnapshot {
+    double time = 0.0;        // Clock time in seconds the state belongs to
+    uint64_t revision = 0;    // SolarSystem::getRevision() when taken
+    uint64_t step = 0;        // SolarSystem::getStepCount() when taken
+    double simulationTime = 0.0;  // SolarSystem::getSimulationTime() when taken
+    uint64_t layout = 0;      // SolarSystem::getLayoutRevision() of id
+    std::vector<Vector3d> position;
+    std::vector<Vector3d> velocity;
+    std::vector<double> mass;          // Collisions change these on the physics thread
+    std::vector<float> visualRadius;
+    std::vector<uint32_t> id; // SolarSystem::getBodyIds(), only copied when the layout changes
+    std::vector<Vector3f> particlePosition;  // Test particles, rounded: there may be millions
+
+    size_t size() const { return position.size(); }
+
+    // Blend from a to b by alpha in [0, 1]; snapshots that are not continuous give b
+    void interpolate(const StateSnapshot& a, const StateSnapshot& b, double alpha) {
+        time = a.time + (b.time - a.time) * alpha;
+        revision = b.revision;
+        step = b.step;
+        if (layout != b.layout || id.size() != b.id.size()) {
+            id = b.id;
+            layout = b.layout;
+        }
+        position.resize(b.size());
+        velocity.resize(b.size());
+        mass = b.mass;
+        visualRadius = b.visualRadius;
+        const bool continuous = a.revision == b.revision && a.size() == b.size();
+        simulationTime = continuous ? a.simulationTime + (b.simulationTime - a.simulationTime) * alpha
+                                    : b.simulationTime;
+        for (size_t i = 0; i < b.size(); ++i) {
+            if (continuous) {
+                position[i] = a.position[i] + (b.position[i] - a.position[i]) * alpha;
+                velocity[i] = a.velocity[i] + (b.velocity[i] - a.velocity[i]) * alpha;
+            } else {
+                position[i] = b.position[i];
+                velocity[i] = b.velocity[i];
+            }
+        }
+        const size_t particles = b.particlePosition.size();
+        particlePosition.resize(particles);
+        if (continuous && a.particlePosition.size() == particles) {
+            const float t = static_cast<float>(alpha);
+            for (size_t i = 0; i < particles; ++i) {
+                particlePosition[i] = a.particlePosition[i] + (b.particlePosition[i] - a.particlePosition[i]) * t;
+            }
+        } else {
+            std::copy(b.particlePosition.begin(), b.particlePosition.end(), particlePosition.begin());
+        }
+    }
+};
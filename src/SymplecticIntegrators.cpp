@@ -0,0 +1,44 @@
+#include "SymplecticIntegrators.h"
+#include <cmath>
+#include <utility>
+
+double EulerIntegrator::step(Context& context, double dt) {
+    ensureAccelerations(context);
+    kick(context, dt);
+    drift(context, dt);
+    invalidate();
+    return dt;
+}
+
+LeapfrogIntegrator::LeapfrogIntegrator() : weights_{1.0} {
+}
+
+LeapfrogIntegrator::LeapfrogIntegrator(std::vector<double> weights) : weights_(std::move(weights)) {
+}
+
+double LeapfrogIntegrator::step(Context& context, double dt) {
+    ensureAccelerations(context);
+    for (double weight : weights_) {
+        const double h = weight * dt;
+        kick(context, 0.5 * h);
+        drift(context, h);
+        context.evaluate();
+        kick(context, 0.5 * h);
+    }
+    markAccelerationsValid(context);
+    return dt;
+}
+
+namespace {
+
+// w1 = 1 / (2 - 2^(1/3)), w0 = 1 - 2 w1
+std::vector<double> yoshidaWeights() {
+    const double w1 = 1.0 / (2.0 - std::cbrt(2.0));
+    const double w0 = 1.0 - 2.0 * w1;
+    return {w1, w0, w1};
+}
+
+} // namespace
+
+YoshidaIntegrator::YoshidaIntegrator() : LeapfrogIntegrator(yoshidaWeights()) {
+}
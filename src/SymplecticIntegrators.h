@@ -0,0 +1,47 @@
+#pragma once
+#include "Integrator.h"
+#include <vector>
+
+/**
+ * Semi-implicit (symplectic) Euler: kick with the current accelerations, then
+ * drift. First order, one force evaluation per step.
+ */
+class EulerIntegrator : public Integrator {
+public:
+    const char* getName() const override { return "Euler"; }
+
+    double step(Context& context, double dt) override;
+};
+
+/**
+ * Kick-drift-kick leapfrog. Second order, symplectic and time-reversible, so
+ * energy errors stay bounded instead of drifting; the closing kick's
+ * accelerations open the next step, so it costs one evaluation per step.
+ */
+class LeapfrogIntegrator : public Integrator {
+public:
+    LeapfrogIntegrator();
+
+    const char* getName() const override { return "Leapfrog"; }
+
+    double step(Context& context, double dt) override;
+
+protected:
+    // Composition of leapfrog substeps with the given fractions of dt
+    explicit LeapfrogIntegrator(std::vector<double> weights);
+
+private:
+    std::vector<double> weights_;
+};
+
+/**
+ * Fourth-order Yoshida (1990) triple-jump composition of leapfrog. Three
+ * evaluations per step, but its error falls as dt^4, so for the same accuracy
+ * it can take far larger steps than leapfrog.
+ */
+class YoshidaIntegrator : public LeapfrogIntegrator {
+public:
+    YoshidaIntegrator();
+
+    const char* getName() const override { return "Yoshida-4"; }
+};
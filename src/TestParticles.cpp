@@ -0,0 +1,155 @@
+#include "TestParticles.h"
+#include "GravityKernel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Ring particles sit close to their planet and far from the origin; as in
+// SolarSystem::correctParentForces the dominant pull is swapped for a double one
+template <bool ThreeD>
+void correctParentPull(TestParticles& particles, const BodyStore& sources, size_t begin, size_t end, float softening2) {
+    const double softening2Precise = softening2;
+    for (size_t i = begin; i < end; ++i) {
+        const uint32_t p = particles.parent[i];
+        if (p == TestParticles::NO_PARENT || p >= sources.size()) continue;
+
+        const float fdx = sources.px[p] - particles.px[i];
+        const float fdy = sources.py[p] - particles.py[i];
+        const float fdz = ThreeD ? sources.pz[p] - particles.pz[i] : 0.0f;
+        const float fr2 = fdx * fdx + fdy * fdy + fdz * fdz + softening2;
+        const float fInvR = 1.0f / std::sqrt(fr2);
+        const float fInvR3 = fInvR * fInvR * fInvR;
+
+        const double dx = sources.x[p] - particles.x[i];
+        const double dy = sources.y[p] - particles.y[i];
+        const double dz = ThreeD ? sources.z[p] - particles.z[i] : 0.0;
+        const double r2 = dx * dx + dy * dy + dz * dz + softening2Precise;
+        const double invR3 = 1.0 / (r2 * std::sqrt(r2));
+
+        const double gm = sources.gm[p];
+        particles.ax[i] += static_cast<float>(gm * (dx * invR3 - static_cast<double>(fdx * fInvR3)));
+        particles.ay[i] += static_cast<float>(gm * (dy * invR3 - static_cast<double>(fdy * fInvR3)));
+        if (ThreeD) {
+            particles.az[i] += static_cast<float>(gm * (dz * invR3 - static_cast<double>(fdz * fInvR3)));
+        }
+    }
+}
+
+} // namespace
+
+void TestParticles::reserve(size_t n) {
+    x.reserve(n);
+    y.reserve(n);
+    z.reserve(n);
+    vx.reserve(n);
+    vy.reserve(n);
+    vz.reserve(n);
+    px.reserve(n);
+    py.reserve(n);
+    pz.reserve(n);
+    ax.reserve(n);
+    ay.reserve(n);
+    az.reserve(n);
+    parent.reserve(n);
+}
+
+size_t TestParticles::add(double posX, double posY, double posZ, double velX, double velY, double velZ,
+                          uint32_t parentIndex) {
+    x.push_back(posX);
+    y.push_back(posY);
+    z.push_back(posZ);
+    vx.push_back(velX);
+    vy.push_back(velY);
+    vz.push_back(velZ);
+    px.push_back(0.0f);
+    py.push_back(0.0f);
+    pz.push_back(0.0f);
+    ax.push_back(0.0f);
+    ay.push_back(0.0f);
+    az.push_back(0.0f);
+    parent.push_back(parentIndex);
+    return x.size() - 1;
+}
+
+void TestParticles::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    vx.clear();
+    vy.clear();
+    vz.clear();
+    px.clear();
+    py.clear();
+    pz.clear();
+    ax.clear();
+    ay.clear();
+    az.clear();
+    parent.clear();
+}
+
+void TestParticles::computeAccelerations(const BodyStore& sources, size_t begin, size_t end,
+                                         float softening2, bool threeD) {
+    if (begin >= end) {
+        return;
+    }
+    for (size_t i = begin; i < end; ++i) {
+        px[i] = static_cast<float>(x[i] - sources.originX);
+        py[i] = static_cast<float>(y[i] - sources.originY);
+    }
+    std::fill(ax.begin() + begin, ax.begin() + end, 0.0f);
+    std::fill(ay.begin() + begin, ay.begin() + end, 0.0f);
+    if (threeD) {
+        for (size_t i = begin; i < end; ++i) {
+            pz[i] = static_cast<float>(z[i] - sources.originZ);
+        }
+        std::fill(az.begin() + begin, az.begin() + end, 0.0f);
+    }
+
+    const GravityKernel::Sources field = {
+        sources.px.data(), sources.py.data(), sources.pz.data(), sources.gm.data(), sources.size()
+    };
+    const GravityKernel::Targets targets = {
+        px.data() + begin, py.data() + begin, pz.data() + begin, end - begin
+    };
+    GravityKernel::accumulateField(field, targets, softening2,
+                                   ax.data() + begin, ay.data() + begin, az.data() + begin, threeD);
+
+    if (threeD) {
+        correctParentPull<true>(*this, sources, begin, end, softening2);
+    } else {
+        correctParentPull<false>(*this, sources, begin, end, softening2);
+    }
+}
+
+void TestParticles::kick(size_t begin, size_t end, double dt, bool threeD) {
+    for (size_t i = begin; i < end; ++i) {
+        vx[i] += ax[i] * dt;
+        vy[i] += ay[i] * dt;
+    }
+    if (threeD) {
+        for (size_t i = begin; i < end; ++i) {
+            vz[i] += az[i] * dt;
+        }
+    }
+}
+
+void TestParticles::drift(size_t begin, size_t end, double dt, bool threeD) {
+    for (size_t i = begin; i < end; ++i) {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+    }
+    if (threeD) {
+        for (size_t i = begin; i < end; ++i) {
+            z[i] += vz[i] * dt;
+        }
+    }
+}
+
+void TestParticles::remapParents(const std::vector<uint32_t>& newIndex) {
+    for (uint32_t& p : parent) {
+        if (p != NO_PARENT) {
+            p = p < newIndex.size() ? newIndex[p] : NO_PARENT;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "BodyStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Massless test particles, packed like BodyStore but kept out of it.
+ *
+ * Particles feel the bodies of a store and are never sources, so evaluating
+ * their accelerations costs O(bodies * particles) and each particle is
+ * independent of every other; a million ring particles around a handful of
+ * planets is a linear, trivially parallel pass instead of an N^2 one.
+ * SolarSystem steps them by kick-drift-kick leapfrog in the field of its
+ * bodies at the start and end of every step, whatever integrator the bodies
+ * use.
+ */
+struct TestParticles {
+    // Position (simulation units)
+    std::vector<double> x, y, z;
+    // Velocity (simulation units per second)
+    std::vector<double> vx, vy, vz;
+    // Position relative to the source store's floating origin, as read by the kernel; pz only in 3D
+    std::vector<float> px, py, pz;
+    // Acceleration from the bodies at the current positions
+    std::vector<float> ax, ay, az;
+    // Index of the body the particle orbits (NO_PARENT for none); its pull is corrected in double
+    std::vector<uint32_t> parent;
+
+    static constexpr uint32_t NO_PARENT = BodyStore::NO_PARENT;
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+
+    // Reserve room for n particles in every array
+    void reserve(size_t n);
+
+    // Append a particle and return its index
+    size_t add(double posX, double posY, double posZ, double velX, double velY, double velZ,
+               uint32_t parentIndex = NO_PARENT);
+
+    // Remove all particles
+    void clear();
+
+    /**
+     * Replace the accelerations of particles [begin, end) with the pull of every
+     * body in sources. The sources' single-precision positions must be current.
+     * @param softening2 Squared Plummer softening length in simulation units
+     * @param threeD When false z is ignored and pz and az are left untouched
+     */
+    void computeAccelerations(const BodyStore& sources, size_t begin, size_t end,
+                              float softening2, bool threeD);
+
+    // Velocity half of a leapfrog step for particles [begin, end): v += a * dt
+    void kick(size_t begin, size_t end, double dt, bool threeD);
+    // Position half: x += v * dt
+    void drift(size_t begin, size_t end, double dt, bool threeD);
+
+    // Follow the bodies through BodyStore::compact(); a dropped parent becomes NO_PARENT
+    void remapParents(const std::vector<uint32_t>& newIndex);
+};
@@ -0,0 +1,106 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount)
+    : task_(nullptr), generation_(0), pending_(0), stopping_(false) {
+    resize(threadCount);
+}
+
+ThreadPool::~ThreadPool() {
+    stopWorkers();
+}
+
+size_t ThreadPool::defaultThreadCount() {
+    unsigned int hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? hardware : 1;
+}
+
+void ThreadPool::resize(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = defaultThreadCount();
+    }
+    if (threadCount == size()) {
+        return;
+    }
+
+    stopWorkers();
+
+    stopping_ = false;
+    workers_.reserve(threadCount - 1);
+    for (size_t i = 1; i < threadCount; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this, i, generation_);
+    }
+}
+
+void ThreadPool::run(const Task& task) {
+    if (workers_.empty()) {
+        task(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        pending_ = workers_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    // The caller does its share instead of idling
+    task(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+}
+
+void ThreadPool::parallelFor(size_t count, const RangeTask& task) {
+    const size_t workers = std::min(size(), std::max<size_t>(count, 1));
+    if (workers <= 1) {
+        task(0, count);
+        return;
+    }
+
+    const size_t chunk = (count + workers - 1) / workers;
+    run([&](size_t worker) {
+        size_t begin = std::min(count, worker * chunk);
+        size_t end = std::min(count, begin + chunk);
+        if (begin < end) {
+            task(begin, end);
+        }
+    });
+}
+
+void ThreadPool::workerLoop(size_t index, uint64_t seenGeneration) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        wake_.wait(lock, [&] { return stopping_ || generation_ != seenGeneration; });
+        if (stopping_) {
+            return;
+        }
+        seenGeneration = generation_;
+        const Task* task = task_;
+
+        lock.unlock();
+        (*task)(index);
+        lock.lock();
+
+        if (--pending_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
+
+void ThreadPool::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "FunctionRef.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Persistent pool of worker threads for data-parallel physics work.
+ * The calling thread always takes part as worker 0, so a pool of size 1
+ * spawns no threads at all and run() degenerates to a plain call.
+ */
+class ThreadPool {
+public:
+    // Tasks are only referenced for the duration of run() / parallelFor(), so passing a lambda never allocates
+    using Task = FunctionRef<void(size_t worker)>;
+    using RangeTask = FunctionRef<void(size_t begin, size_t end)>;
+
+    // threadCount of 0 picks the hardware concurrency
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Change the number of threads (including the caller); 0 = hardware concurrency
+    void resize(size_t threadCount);
+
+    // Number of threads taking part in run(), including the caller
+    size_t size() const { return workers_.size() + 1; }
+
+    // Invoke task(worker) once for every worker index in [0, size()) and wait for all
+    void run(const Task& task);
+
+    // Split [0, count) into one contiguous chunk per worker and wait for all
+    void parallelFor(size_t count, const RangeTask& task);
+
+    static size_t defaultThreadCount();
+
+private:
+    void workerLoop(size_t index, uint64_t seenGeneration);
+    void stopWorkers();
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const Task* task_;
+    uint64_t generation_;
+    size_t pending_;
+    bool stopping_;
+};
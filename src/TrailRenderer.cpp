@@ -0,0 +1,204 @@
+#include "TrailRenderer.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// texCoords.x carries the segment's slot; its age behind the newest slot sets the fade.
+// texCoords.y carries z, which in 3D goes through the camera model of CameraProjection
+const char* const TRAIL_VERTEX_SHADER = R"(
+uniform float newest;
+uniform float length;
+uniform float threeD;
+uniform vec3 camera;     // View centre x, y and camera z
+uniform vec4 rotation;   // cos / sin of pitch, cos / sin of yaw
+void main() {
+    vec4 position = gl_Vertex;
+    if (threeD > 0.5) {
+        vec3 r = vec3(gl_Vertex.xy, gl_MultiTexCoord0.y) - camera;
+        float yRot = r.y * rotation.x - r.z * rotation.y;
+        float zPitch = r.y * rotation.y + r.z * rotation.x;
+        float xRot = r.x * rotation.z + zPitch * rotation.w;
+        float zRot = -r.x * rotation.w + zPitch * rotation.z;
+
+        const float perspective = 1000.0;
+        if (zRot < -perspective) zRot = -perspective + 1.0;
+        position.xy = vec2(xRot, yRot) * (perspective / (perspective + zRot)) + camera.xy;
+    }
+    gl_Position = gl_ModelViewProjectionMatrix * position;
+    float age = mod(newest - gl_MultiTexCoord0.x + length, length);
+    float t = (length - age) / length;
+    gl_FrontColor = vec4(gl_Color.rgb, gl_Color.a * t * t);
+}
+)";
+
+const char* const TRAIL_FRAGMENT_SHADER = R"(
+void main() {
+    gl_FragColor = gl_Color;
+}
+)";
+
+sf::Color toSfColor(const Color& color) {
+    return sf::Color(color.r, color.g, color.b, color.a);
+}
+
+} // namespace
+
+TrailRenderer::TrailRenderer()
+    : length_(1000), sampleInterval_(16), useBuffer_(sf::VertexBuffer::isAvailable()),
+      buffer_(sf::Lines, sf::VertexBuffer::Stream), array_(sf::Lines), useShader_(false) {
+    useShader_ = sf::Shader::isAvailable() &&
+                 fadeShader_.loadFromMemory(TRAIL_VERTEX_SHADER, TRAIL_FRAGMENT_SHADER);
+}
+
+void TrailRenderer::setLength(size_t length) {
+    length_ = std::max<size_t>(2, length);
+    columns_ = 0;
+    clear();
+}
+
+void TrailRenderer::clear() {
+    samples_ = 0;
+    newest_ = 0;
+    if (columns_ > 0) {
+        allocate(columns_);
+    }
+}
+
+void TrailRenderer::allocate(size_t columns) {
+    columns_ = columns;
+    lastPosition_.assign(columns, Vector3f());
+    staging_.assign(2 * columns, sf::Vertex(sf::Vector2f(), sf::Color::Transparent));
+
+    const size_t total = 2 * columns * length_;
+    if (useBuffer_) {
+        if (buffer_.getVertexCount() != total && !buffer_.create(total)) {
+            useBuffer_ = false;
+        } else {
+            // Slot by slot, so the fill needs no full-size copy on the CPU
+            for (size_t slot = 0; slot < length_; ++slot) {
+                upload(staging_.data(), staging_.size(), slot * staging_.size());
+            }
+        }
+    }
+    if (!useBuffer_) {
+        array_.resize(total);
+        for (size_t i = 0; i < total; ++i) {
+            array_[i] = sf::Vertex(sf::Vector2f(), sf::Color::Transparent);
+        }
+    }
+}
+
+void TrailRenderer::upload(const sf::Vertex* vertices, size_t count, size_t offset) {
+    if (useBuffer_) {
+        buffer_.update(vertices, count, static_cast<unsigned int>(offset));
+    } else {
+        std::copy(vertices, vertices + count, &array_[offset]);
+    }
+}
+
+void TrailRenderer::update(const SolarSystem& solarSystem, const StateSnapshot& state) {
+    const auto& bodies = solarSystem.getBodies();
+    const size_t count = std::min(bodies.size(), state.size());
+    bool restart = state.revision != revision_ || count == 0;
+    if (!restart && state.layout != layout_) {
+        restart = !remap(state, count);
+    } else if (!restart && count != liveCount_) {
+        restart = true;
+    }
+    if (restart) {
+        revision_ = state.revision;
+        layout_ = state.layout;
+        liveCount_ = count;
+        columnBody_.resize(count);
+        std::iota(columnBody_.begin(), columnBody_.end(), 0u);
+        columnId_ = state.id;
+        columns_ = count;
+        clear();
+        if (columns_ == 0) {
+            return;
+        }
+    } else if (samples_ > 0 && state.step < lastStep_ + sampleInterval_) {
+        return;
+    }
+
+    const size_t slot = samples_ == 0 ? 0 : (newest_ + 1) % length_;
+    const float slotCoord = static_cast<float>(slot);
+    const float toleranceSquared = tolerance_ * tolerance_;
+    for (size_t c = 0; c < columns_; ++c) {
+        const uint32_t i = columnBody_[c];
+        const Vector3f position = i != NO_BODY ? state.position[i].toFloat() : lastPosition_[c];
+        const Vector3f step = position - lastPosition_[c];
+        // The first sample has nothing to connect to, a short step waits for the next and a
+        // merged body's trail just fades
+        if (samples_ == 0 || i == NO_BODY ||
+            step.x * step.x + step.y * step.y + step.z * step.z < toleranceSquared) {
+            const Vector3f at = samples_ == 0 ? position : lastPosition_[c];
+            staging_[2 * c] = sf::Vertex(at.to2D(), sf::Color::Transparent, sf::Vector2f(slotCoord, at.z));
+            staging_[2 * c + 1] = staging_[2 * c];
+            if (samples_ == 0) {
+                lastPosition_[c] = position;
+            }
+            continue;
+        }
+        const sf::Color color = toSfColor(bodies[i]->getColor());
+        const Vector3f& last = lastPosition_[c];
+        staging_[2 * c] = sf::Vertex(last.to2D(), color, sf::Vector2f(slotCoord, last.z));
+        staging_[2 * c + 1] = sf::Vertex(position.to2D(), color, sf::Vector2f(slotCoord, position.z));
+        lastPosition_[c] = position;
+    }
+    upload(staging_.data(), staging_.size(), slot * staging_.size());
+
+    newest_ = slot;
+    samples_ = std::min(samples_ + 1, length_);
+    lastStep_ = state.step;
+}
+
+bool TrailRenderer::remap(const StateSnapshot& state, size_t count) {
+    if (state.id.size() != count || columnId_.size() != columns_) {
+        return false;
+    }
+    // A majority of dead columns is not worth drawing; start over instead
+    if (2 * count < columns_) {
+        return false;
+    }
+
+    // Bodies only leave between layouts and keep their order, so one pass pairs them with columns
+    std::fill(columnBody_.begin(), columnBody_.end(), NO_BODY);
+    size_t column = 0;
+    for (size_t i = 0; i < count; ++i) {
+        while (column < columns_ && columnId_[column] != state.id[i]) {
+            ++column;
+        }
+        if (column == columns_) {
+            return false;
+        }
+        columnBody_[column++] = static_cast<uint32_t>(i);
+    }
+    layout_ = state.layout;
+    liveCount_ = count;
+    return true;
+}
+
+void TrailRenderer::draw(sf::RenderTarget& target, const CameraProjection& projection, bool threeD) {
+    if (samples_ < 2) {
+        return;
+    }
+
+    sf::RenderStates states;
+    if (useShader_) {
+        fadeShader_.setUniform("newest", static_cast<float>(newest_));
+        fadeShader_.setUniform("length", static_cast<float>(length_));
+        fadeShader_.setUniform("threeD", threeD ? 1.0f : 0.0f);
+        fadeShader_.setUniform("camera", sf::Glsl::Vec3(projection.getCenter().x, projection.getCenter().y,
+                                                        projection.getCameraZ()));
+        fadeShader_.setUniform("rotation", sf::Glsl::Vec4(projection.getCosPitch(), projection.getSinPitch(),
+                                                          projection.getCosYaw(), projection.getSinYaw()));
+        states.shader = &fadeShader_;
+    }
+    if (useBuffer_) {
+        target.draw(buffer_, states);
+    } else {
+        target.draw(array_, states);
+    }
+}
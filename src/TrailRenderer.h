@@ -0,0 +1,89 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include "SolarSystem.h"
+#include "CameraProjection.h"
+#include "StateSnapshot.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * Orbital trails for every body, kept in one persistent vertex buffer.
+ *
+ * All bodies are sampled together, so the history is a single ring of
+ * length slots; slot s holds, for every body, the segment from its previous
+ * sample to the one taken at s. A sample overwrites the oldest slot with one
+ * contiguous upload of N segments, and the fade is computed by a shader from
+ * each segment's age relative to the newest slot, so nothing already stored
+ * is touched again. Samples are taken every few physics steps rather than
+ * every frame, so a trail spans the same stretch of simulation however fast
+ * the window renders.
+ *
+ * A body that has moved less than the tolerance since its last point gets
+ * an empty segment instead of a new point, so slow or distant bodies are
+ * drawn with fewer, longer segments while staying within the tolerance of
+ * their true path.
+ *
+ * Points keep their z, so in 3D the vertex shader projects the stored trails
+ * through the current camera instead of them being rebuilt when it moves.
+ *
+ * Each body owns a column of the ring, matched to it by the body's id, so
+ * when merges remove bodies the survivors keep their trails and the absorbed
+ * bodies' trails fade out; only once most columns are dead are the trails
+ * rebuilt for the bodies that remain.
+ */
+class TrailRenderer {
+public:
+    TrailRenderer();
+
+    // Points kept per body; changing it clears the trails
+    void setLength(size_t length);
+    size_t getLength() const { return length_; }
+
+    // Physics steps between samples
+    void setSampleInterval(uint64_t steps) { sampleInterval_ = steps > 0 ? steps : 1; }
+    uint64_t getSampleInterval() const { return sampleInterval_; }
+
+    // Smallest step that extends a trail, in world units (about a pixel at the current zoom)
+    void setTolerance(float tolerance) { tolerance_ = tolerance; }
+
+    void clear();
+
+    // Take a sample if enough steps have passed; a state that jumped (reset, new bodies) restarts the trails
+    void update(const SolarSystem& solarSystem, const StateSnapshot& state);
+
+    // In 3D the trails are projected by their shader; without shaders they stay flat
+    void draw(sf::RenderTarget& target, const CameraProjection& projection, bool threeD);
+
+private:
+    // Size the buffer for the given number of columns and fill it with invisible segments
+    void allocate(size_t columns);
+    // Point the columns at the bodies of a new layout; false if the trails must restart
+    bool remap(const StateSnapshot& state, size_t count);
+    void upload(const sf::Vertex* vertices, size_t count, size_t offset);
+
+    size_t length_;
+    uint64_t sampleInterval_;
+    float tolerance_ = 0.0f;
+    size_t columns_ = 0;
+    size_t liveCount_ = 0;        // Bodies currently mapped to columns
+    size_t newest_ = 0;           // Slot written last
+    size_t samples_ = 0;          // Slots written since the last clear, up to length_
+    uint64_t lastStep_ = 0;
+    uint64_t revision_ = 0;
+    uint64_t layout_ = 0;
+
+    static constexpr uint32_t NO_BODY = UINT32_MAX;
+    std::vector<uint32_t> columnBody_;  // Body drawn in each column, NO_BODY once it is gone
+    std::vector<uint32_t> columnId_;    // Id the column was assigned to
+
+    std::vector<Vector3f> lastPosition_;
+    std::vector<sf::Vertex> staging_;   // One slot's segments (2 vertices per column)
+
+    // GPU storage when vertex buffers are available, otherwise a CPU array of the same layout
+    bool useBuffer_;
+    sf::VertexBuffer buffer_;
+    sf::VertexArray array_;
+
+    bool useShader_;
+    sf::Shader fadeShader_;
+};
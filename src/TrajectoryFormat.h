@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * On-disk layout shared by TrajectoryWriter and TrajectoryReader.
+ *
+ * A file is a FileHeader followed by independent chunks. Each chunk is a
+ * ChunkHeader and a payload, zstd-compressed when built with zstd. A
+ * decompressed payload holds frameCount frames:
+ *   varint step, 8-byte double time, varint bodyCount,
+ *   then for x, y and z in turn one zigzag varint per body.
+ * Positions are quantised to multiples of FileHeader::quantum. The stored
+ * value is the residual against a prediction from the body's previous
+ * frames in the chunk: zero for the first, the last value for the second,
+ * linear extrapolation after that. Smooth orbits leave residuals of a
+ * few bits.
+ */
+namespace TrajectoryFormat {
+
+constexpr char MAGIC[8] = {'G', 'R', 'A', 'V', 'T', 'R', 'A', 'J'};
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t CHUNK_MAGIC = 0x4b4e4843;   // "CHNK"
+
+enum Codec : uint32_t {
+    CODEC_RAW = 0,
+    CODEC_ZSTD = 1,
+};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    double quantum;        // Position resolution in simulation units
+};
+
+struct ChunkHeader {
+    uint32_t magic;
+    uint32_t codec;
+    uint32_t frameCount;
+    uint32_t rawBytes;     // Payload size once decompressed
+    uint32_t storedBytes;  // Payload size in the file
+    uint32_t reserved;
+};
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// False on a truncated or overlong encoding
+inline bool getVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && in < end; shift += 7) {
+        const uint8_t byte = *in++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Prediction for a body's next quantised value from its last two in the chunk
+inline int64_t predict(size_t frameInChunk, int64_t last, int64_t beforeLast) {
+    if (frameInChunk == 0) return 0;
+    if (frameInChunk == 1) return last;
+    return 2 * last - beforeLast;
+}
+
+} // namespace TrajectoryFormat
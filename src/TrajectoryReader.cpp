@@ -0,0 +1,149 @@
+#include "TrajectoryReader.h"
+#include "TrajectoryFormat.h"
+#include <cstring>
+
+#ifdef GRAVITY_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+bool TrajectoryReader::open(const std::string& path, std::string& error) {
+    offset_ = 0;
+    framesLeft_ = 0;
+    if (!file_.open(path, error)) {
+        return false;
+    }
+
+    TrajectoryFormat::FileHeader header;
+    if (file_.size() < sizeof(header)) {
+        error = path + " is too short for a trajectory";
+        return false;
+    }
+    std::memcpy(&header, file_.data(), sizeof(header));
+    if (std::memcmp(header.magic, TrajectoryFormat::MAGIC, sizeof(header.magic)) != 0) {
+        error = path + " is not a trajectory file";
+        return false;
+    }
+    if (header.version != TrajectoryFormat::VERSION) {
+        error = path + " has unsupported trajectory version " + std::to_string(header.version);
+        return false;
+    }
+    if (!(header.quantum > 0.0)) {
+        error = path + " has an invalid quantum";
+        return false;
+    }
+
+    quantum_ = header.quantum;
+    offset_ = sizeof(header);
+    return true;
+}
+
+bool TrajectoryReader::nextChunk(std::string& error) {
+    TrajectoryFormat::ChunkHeader header;
+    if (file_.size() - offset_ < sizeof(header)) {
+        error = "truncated chunk header at byte " + std::to_string(offset_);
+        return false;
+    }
+    std::memcpy(&header, file_.data() + offset_, sizeof(header));
+    if (header.magic != TrajectoryFormat::CHUNK_MAGIC || header.frameCount == 0) {
+        error = "bad chunk header at byte " + std::to_string(offset_);
+        return false;
+    }
+    const uint8_t* stored = file_.data() + offset_ + sizeof(header);
+    if (file_.size() - offset_ - sizeof(header) < header.storedBytes) {
+        error = "truncated chunk at byte " + std::to_string(offset_);
+        return false;
+    }
+
+    if (header.codec == TrajectoryFormat::CODEC_RAW) {
+        if (header.rawBytes != header.storedBytes) {
+            error = "bad raw chunk at byte " + std::to_string(offset_);
+            return false;
+        }
+        chunk_.assign(stored, stored + header.storedBytes);
+    } else if (header.codec == TrajectoryFormat::CODEC_ZSTD) {
+#ifdef GRAVITY_HAVE_ZSTD
+        chunk_.resize(header.rawBytes);
+        const size_t unpacked = ZSTD_decompress(chunk_.data(), chunk_.size(), stored, header.storedBytes);
+        if (ZSTD_isError(unpacked) || unpacked != header.rawBytes) {
+            error = "corrupt compressed chunk at byte " + std::to_string(offset_);
+            return false;
+        }
+#else
+        error = "trajectory uses zstd compression, which this build does not include";
+        return false;
+#endif
+    } else {
+        error = "unknown chunk codec " + std::to_string(header.codec);
+        return false;
+    }
+
+    offset_ += sizeof(header) + header.storedBytes;
+    cursor_ = 0;
+    framesLeft_ = header.frameCount;
+    frameInChunk_ = 0;
+    return true;
+}
+
+bool TrajectoryReader::readFrame(Frame& frame, std::string& error) {
+    if (!file_.isOpen()) {
+        error = "no trajectory open";
+        return false;
+    }
+    if (framesLeft_ == 0) {
+        if (offset_ >= file_.size()) {
+            return false;
+        }
+        if (!nextChunk(error)) {
+            return false;
+        }
+    }
+
+    const uint8_t* in = chunk_.data() + cursor_;
+    const uint8_t* end = chunk_.data() + chunk_.size();
+    uint64_t step = 0;
+    uint64_t n = 0;
+    if (!TrajectoryFormat::getVarint(in, end, step) || end - in < static_cast<ptrdiff_t>(sizeof(double))) {
+        error = "truncated frame";
+        return false;
+    }
+    std::memcpy(&frame.time, in, sizeof(double));
+    in += sizeof(double);
+    // Every body takes at least one byte per component, which bounds n before allocating
+    if (!TrajectoryFormat::getVarint(in, end, n) || n > static_cast<uint64_t>(end - in) / 3) {
+        error = "truncated frame";
+        return false;
+    }
+    if (frameInChunk_ == 0) {
+        last_.assign(3 * n, 0);
+        beforeLast_.assign(3 * n, 0);
+    } else if (last_.size() != 3 * n) {
+        error = "body count changed inside a chunk";
+        return false;
+    }
+
+    frame.step = step;
+    std::vector<double>* components[3] = {&frame.x, &frame.y, &frame.z};
+    for (int c = 0; c < 3; ++c) {
+        std::vector<double>& values = *components[c];
+        values.resize(n);
+        int64_t* last = last_.data() + c * n;
+        int64_t* beforeLast = beforeLast_.data() + c * n;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t code = 0;
+            if (!TrajectoryFormat::getVarint(in, end, code)) {
+                error = "truncated frame";
+                return false;
+            }
+            const int64_t q = TrajectoryFormat::predict(frameInChunk_, last[i], beforeLast[i]) +
+                              TrajectoryFormat::unzigzag(code);
+            beforeLast[i] = last[i];
+            last[i] = q;
+            values[i] = static_cast<double>(q) * quantum_;
+        }
+    }
+
+    cursor_ = static_cast<size_t>(in - chunk_.data());
+    --framesLeft_;
+    ++frameInChunk_;
+    return true;
+}
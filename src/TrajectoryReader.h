@@ -0,0 +1,40 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Decodes trajectory files written by TrajectoryWriter, one frame at a time.
+ * The file is memory-mapped and each chunk is decompressed as the frames
+ * in it are reached, so memory stays at one chunk however long the run was.
+ */
+class TrajectoryReader {
+public:
+    struct Frame {
+        uint64_t step = 0;
+        double time = 0.0;                // Simulated seconds
+        std::vector<double> x, y, z;      // Simulation units, to within quantum / 2
+    };
+
+    // False with error set if the file is missing or not a trajectory
+    bool open(const std::string& path, std::string& error);
+
+    // Decode the next frame; false at the end of the file or, with error set, on corrupt data
+    bool readFrame(Frame& frame, std::string& error);
+
+    double getQuantum() const { return quantum_; }
+
+private:
+    bool nextChunk(std::string& error);
+
+    MappedFile file_;
+    size_t offset_ = 0;       // Next chunk header in the file
+    double quantum_ = 0.0;
+
+    std::vector<uint8_t> chunk_;    // Decompressed payload of the current chunk
+    size_t cursor_ = 0;
+    size_t framesLeft_ = 0;
+    size_t frameInChunk_ = 0;
+    std::vector<int64_t> last_, beforeLast_;
+};
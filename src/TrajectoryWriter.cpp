@@ -0,0 +1,239 @@
+#include "TrajectoryWriter.h"
+#include "TrajectoryFormat.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef GRAVITY_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// zstd's fastest level; the residuals are already small, so higher levels gain little
+constexpr int COMPRESSION_LEVEL = 1;
+
+} // namespace
+
+TrajectoryWriter::TrajectoryWriter(const std::string& path, const Options& options) : options_(options) {
+    options_.framesPerChunk = std::max<size_t>(1, options_.framesPerChunk);
+    options_.ringFrames = std::max<size_t>(1, options_.ringFrames);
+    if (!(options_.quantum > 0.0)) {
+        options_.quantum = Options().quantum;
+    }
+
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_) {
+        error_ = "cannot create " + path;
+        return;
+    }
+
+    TrajectoryFormat::FileHeader header{};
+    std::memcpy(header.magic, TrajectoryFormat::MAGIC, sizeof(header.magic));
+    header.version = TrajectoryFormat::VERSION;
+    header.quantum = options_.quantum;
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stats_.fileBytes = sizeof(header);
+
+    ring_.resize(options_.ringFrames);
+    open_ = true;
+    thread_ = std::thread(&TrajectoryWriter::run, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    close();
+}
+
+bool TrajectoryWriter::hasCompression() {
+#ifdef GRAVITY_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TrajectoryWriter::record(const SolarSystem& system, uint64_t step) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!open_ || closing_) {
+        return false;
+    }
+    if (count_ == ring_.size()) {
+        if (options_.backpressure == Backpressure::DropFrames) {
+            ++stats_.framesDropped;
+            return false;
+        }
+        notFull_.wait(lock, [this]() { return count_ < ring_.size() || closing_; });
+        if (closing_) {
+            return false;
+        }
+    }
+
+    // The I/O thread never touches a slot outside [tail, tail + count), so this one is ours
+    Slot& slot = ring_[head_];
+    lock.unlock();
+
+    const BodyStore& s = system.getStore();
+    slot.step = step;
+    slot.time = system.getSimulationTime();
+    const TestParticles& particles = system.getTestParticles();
+    slot.x.assign(s.x.begin(), s.x.end());
+    slot.y.assign(s.y.begin(), s.y.end());
+    slot.z.assign(s.z.begin(), s.z.end());
+    slot.x.insert(slot.x.end(), particles.x.begin(), particles.x.end());
+    slot.y.insert(slot.y.end(), particles.y.begin(), particles.y.end());
+    slot.z.insert(slot.z.end(), particles.z.begin(), particles.z.end());
+
+    lock.lock();
+    head_ = (head_ + 1) % ring_.size();
+    ++count_;
+    notEmpty_.notify_one();
+    return true;
+}
+
+void TrajectoryWriter::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!thread_.joinable()) {
+            return;
+        }
+        closing_ = true;
+    }
+    notEmpty_.notify_one();
+    notFull_.notify_all();
+    thread_.join();
+
+    file_.flush();
+    if (!file_) {
+        fail("failed writing trajectory");
+    }
+    file_.close();
+}
+
+TrajectoryWriter::Stats TrajectoryWriter::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+std::string TrajectoryWriter::getError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+void TrajectoryWriter::run() {
+    Profiler::setThreadName("trajectory");
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        notEmpty_.wait(lock, [this]() { return count_ > 0 || closing_; });
+        if (count_ == 0) {
+            break;
+        }
+
+        // record() only appends at head_, so the oldest slot is stable while unlocked
+        const size_t tail = (head_ + ring_.size() - count_) % ring_.size();
+        lock.unlock();
+        encode(ring_[tail]);
+        lock.lock();
+
+        --count_;
+        notFull_.notify_one();
+    }
+    lock.unlock();
+    flushChunk();
+}
+
+void TrajectoryWriter::encode(const Slot& frame) {
+    GRAVITY_PROFILE_SCOPE("encodeFrame");
+    const size_t n = frame.x.size();
+    // A changed body count cannot be predicted from the previous frames
+    if (chunkFrames_ > 0 && n != chunkBodies_) {
+        flushChunk();
+    }
+    if (chunkFrames_ == 0) {
+        chunk_.clear();
+        chunkBodies_ = n;
+        last_.assign(3 * n, 0);
+        beforeLast_.assign(3 * n, 0);
+    }
+
+    TrajectoryFormat::putVarint(chunk_, frame.step);
+    const size_t timeAt = chunk_.size();
+    chunk_.resize(timeAt + sizeof(double));
+    std::memcpy(chunk_.data() + timeAt, &frame.time, sizeof(double));
+    TrajectoryFormat::putVarint(chunk_, n);
+
+    const double scale = 1.0 / options_.quantum;
+    const std::vector<double>* components[3] = {&frame.x, &frame.y, &frame.z};
+    for (int c = 0; c < 3; ++c) {
+        const std::vector<double>& values = *components[c];
+        int64_t* last = last_.data() + c * n;
+        int64_t* beforeLast = beforeLast_.data() + c * n;
+        for (size_t i = 0; i < n; ++i) {
+            const int64_t q = std::llround(values[i] * scale);
+            const int64_t residual = q - TrajectoryFormat::predict(chunkFrames_, last[i], beforeLast[i]);
+            TrajectoryFormat::putVarint(chunk_, TrajectoryFormat::zigzag(residual));
+            beforeLast[i] = last[i];
+            last[i] = q;
+        }
+    }
+
+    ++chunkFrames_;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.framesWritten;
+        stats_.rawBytes += 3 * n * sizeof(double);
+    }
+    if (chunkFrames_ >= options_.framesPerChunk) {
+        flushChunk();
+    }
+}
+
+void TrajectoryWriter::flushChunk() {
+    if (chunkFrames_ == 0) {
+        return;
+    }
+
+    TrajectoryFormat::ChunkHeader header{};
+    header.magic = TrajectoryFormat::CHUNK_MAGIC;
+    header.codec = TrajectoryFormat::CODEC_RAW;
+    header.frameCount = static_cast<uint32_t>(chunkFrames_);
+    header.rawBytes = static_cast<uint32_t>(chunk_.size());
+    const uint8_t* payload = chunk_.data();
+    size_t payloadBytes = chunk_.size();
+
+#ifdef GRAVITY_HAVE_ZSTD
+    if (options_.compress) {
+        compressed_.resize(ZSTD_compressBound(chunk_.size()));
+        const size_t packed = ZSTD_compress(compressed_.data(), compressed_.size(), chunk_.data(), chunk_.size(),
+                                            COMPRESSION_LEVEL);
+        // Store raw when compression fails or does not help
+        if (!ZSTD_isError(packed) && packed < chunk_.size()) {
+            header.codec = TrajectoryFormat::CODEC_ZSTD;
+            payload = compressed_.data();
+            payloadBytes = packed;
+        }
+    }
+#else
+    (void)COMPRESSION_LEVEL;
+#endif
+
+    header.storedBytes = static_cast<uint32_t>(payloadBytes);
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_.write(reinterpret_cast<const char*>(payload), static_cast<std::streamsize>(payloadBytes));
+    if (!file_) {
+        fail("failed writing trajectory chunk");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.fileBytes += sizeof(header) + payloadBytes;
+    }
+    chunkFrames_ = 0;
+}
+
+void TrajectoryWriter::fail(const std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_.empty()) {
+        error_ = error;
+    }
+}
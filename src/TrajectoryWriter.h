@@ -0,0 +1,98 @@
+#pragma once
+#include "SolarSystem.h"
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Records body positions to a compact trajectory file (see TrajectoryFormat.h);
+ * a frame holds the bodies followed by the test particles.
+ *
+ * record() only copies the positions into a slot of a bounded ring; a
+ * dedicated I/O thread quantises them, predicts each frame from the
+ * previous ones, and compresses and writes whole chunks. When the ring is
+ * full the backpressure policy either blocks the caller until a slot frees
+ * up or drops the frame, so a slow disk can never grow memory without bound.
+ */
+class TrajectoryWriter {
+public:
+    enum class Backpressure {
+        Block,       // Wait for the I/O thread; every frame is kept
+        DropFrames,  // Skip frames while the ring is full; the step loop never waits
+    };
+
+    struct Options {
+        double quantum = 1e-6;            // Position resolution in simulation units (1 km)
+        size_t framesPerChunk = 64;       // Frames compressed together; chunks decode independently
+        size_t ringFrames = 8;            // Frames that can wait for the I/O thread
+        Backpressure backpressure = Backpressure::Block;
+        bool compress = true;             // zstd when built with it; raw chunks otherwise
+    };
+
+    TrajectoryWriter(const std::string& path, const Options& options);
+    ~TrajectoryWriter();
+
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    // False if the file could not be created; getError() says why
+    bool isOpen() const { return open_; }
+
+    // Queue the current positions as frame step; false if dropped or closed
+    bool record(const SolarSystem& system, uint64_t step);
+
+    // Write everything queued, finish the file and stop the I/O thread
+    void close();
+
+    // Whether this build can compress chunks
+    static bool hasCompression();
+
+    struct Stats {
+        size_t framesWritten = 0;
+        size_t framesDropped = 0;
+        uint64_t rawBytes = 0;      // Positions as doubles, for comparison
+        uint64_t fileBytes = 0;
+    };
+    Stats getStats() const;
+    std::string getError() const;
+
+private:
+    struct Slot {
+        uint64_t step = 0;
+        double time = 0.0;
+        std::vector<double> x, y, z;
+    };
+
+    void run();
+    void encode(const Slot& frame);
+    void flushChunk();
+    void fail(const std::string& error);
+
+    Options options_;
+    std::ofstream file_;
+    bool open_ = false;
+
+    // Ring of frames between record() and the I/O thread
+    std::vector<Slot> ring_;
+    size_t head_ = 0;    // Next slot to fill
+    size_t count_ = 0;   // Filled slots waiting
+    bool closing_ = false;
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::thread thread_;
+
+    // I/O thread only: the chunk being built and each body's last two quantised values
+    std::vector<uint8_t> chunk_;
+    std::vector<uint8_t> compressed_;
+    size_t chunkFrames_ = 0;
+    size_t chunkBodies_ = 0;
+    std::vector<int64_t> last_, beforeLast_;
+
+    Stats stats_;
+    std::string error_;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Lock-free single-producer / single-consumer triple buffer.
+ *
+ * The producer fills writeBuffer() and publish()es it; the consumer calls
+ * update() and reads readBuffer(). Neither side ever waits for the other:
+ * the three slots rotate through one atomic index, so the producer always
+ * has a free slot and the consumer always holds the newest complete one.
+ * Buffers are reused round-robin, so a T holding vectors stops allocating
+ * once their capacity has settled.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    // Producer side: the slot being filled
+    T& writeBuffer() { return buffers_[writeIndex_]; }
+
+    // Producer side: hand the filled slot over and take the spare one
+    void publish() {
+        writeIndex_ = middle_.exchange(static_cast<uint8_t>(writeIndex_ | FRESH), std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Consumer side: switch to the newest published slot; false if nothing new arrived
+    bool update() {
+        if ((middle_.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return false;
+        }
+        readIndex_ = middle_.exchange(readIndex_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    // Consumer side: the newest slot seen by update()
+    const T& readBuffer() const { return buffers_[readIndex_]; }
+
+private:
+    static constexpr uint8_t INDEX = 0x3;
+    static constexpr uint8_t FRESH = 0x4;  // Set while the middle slot has not been read
+
+    T buffers_[3];
+    uint8_t writeIndex_ = 0;
+    uint8_t readIndex_ = 1;
+    std::atomic<uint8_t> middle_{2};
+};
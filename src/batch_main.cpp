@@ -0,0 +1,22 @@
+#include "BatchRunner.h"
+#include "Communicator.h"
+#include <iostream>
+
+int main(int argc, char** argv) {
+    // Before the arguments are read, since MPI may remove its own; a plain launch is a job of one
+    Communicator communicator(argc, argv);
+
+    BatchRunner::Options options;
+    std::string message;
+    if (!BatchRunner::parseArguments(argc, argv, options, message)) {
+        const bool help = message.rfind("Usage:", 0) == 0;
+        if (communicator.isRoot()) {
+            (help ? std::cout : std::cerr) << message << std::endl;
+        }
+        return help ? 0 : 2;
+    }
+
+    BatchRunner runner(options);
+    runner.setCommunicator(&communicator);
+    return runner.run();
+}
@@ -5,16 +5,26 @@
 #include "SolarSystem.h"
 #include "Renderer.h"
 #include "InputHandler.h"
+#include "GravityKernel.h"
+#include "GpuBackend.h"
+#include "PhysicsThread.h"
+#include "Profiler.h"
 
-int main() {
+int main(int argc, char** argv) {
     std::cout << "Starting Solar System Gravity Simulator...\n" << std::endl;
+    Profiler::setThreadName("main");
 
     // Create window
     const unsigned int WINDOW_WIDTH = 1200;
     const unsigned int WINDOW_HEIGHT = 800;
+    // Ask for OpenGL 4.3 so the GPU compute backend can run; SFML falls back
+    // to whatever the driver offers and the backend then stays unavailable
+    sf::ContextSettings contextSettings;
+    contextSettings.majorVersion = 4;
+    contextSettings.minorVersion = 3;
     sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT),
                            "Solar System Gravity Simulator",
-                           sf::Style::Default);
+                           sf::Style::Default, contextSettings);
 
     // Enable VSync for smooth animation
     window.setVerticalSyncEnabled(true);
@@ -24,8 +34,31 @@ int main() {
     Renderer renderer(window);
     InputHandler inputHandler(window, solarSystem, renderer);
 
-    // Initialize the solar system
-    solarSystem.initialize();
+    // Optional GPU compute path; declared after the window so it is released while the context lives
+    GpuBackend gpu;
+    renderer.setGpuBackend(&gpu);
+    inputHandler.setGpuBackend(&gpu);
+    if (gpu.initialize()) {
+        std::cout << "GPU compute backend available (press U)" << std::endl;
+    } else {
+        std::cout << "GPU compute backend disabled: " << gpu.getError() << std::endl;
+    }
+
+    // Initialize the solar system, or the scenario file given on the command line
+    if (argc > 1) {
+        Scenario scenario;
+        std::string error;
+        if (!Scenario::load(argv[1], scenario, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        solarSystem.load(scenario);
+        std::cout << "Loaded " << solarSystem.getBodyCount() << " bodies from " << argv[1] << std::endl;
+    } else {
+        solarSystem.initialize();
+    }
+    std::cout << "Force kernel: " << GravityKernel::getIsaName(GravityKernel::getIsa())
+              << " on " << solarSystem.getThreadCount() << " thread(s)" << std::endl;
 
     // Set up initial camera view to show the entire solar system
     renderer.setZoom(0.5f);  // Zoom out to see more of the solar system
@@ -34,7 +67,18 @@ int main() {
     // Show help message
     inputHandler.showHelpMessage();
 
-    // Set up timing for physics updates
+    // Bodies removed by merges stay until this thread compacts them, since the renderer reads them unlocked
+    solarSystem.setDeferCompaction(true);
+
+    // Conservation diagnostics for the status panel, a few times a second at the physics rate
+    solarSystem.setDiagnosticsInterval(250);
+
+    // Physics runs at a fixed rate on its own thread; the loop below only renders
+    const double PHYSICS_RATE = 1000.0; // Steps per second of wall-clock time
+    PhysicsThread physics(solarSystem, PHYSICS_RATE);
+    physics.start();
+
+    // Set up timing for the camera and the GPU backend, which still step with the frame
     auto lastTime = std::chrono::high_resolution_clock::now();
     const double MAX_DELTA_TIME = 1.0 / 30.0; // Cap delta time to prevent instability
 
@@ -42,6 +86,8 @@ int main() {
 
     // Main simulation loop
     while (window.isOpen() && !inputHandler.shouldExit()) {
+        GRAVITY_PROFILE_FRAME();
+
         // Calculate delta time
         auto currentTime = std::chrono::high_resolution_clock::now();
         double deltaTime = std::chrono::duration<double>(currentTime - lastTime).count();
@@ -50,15 +96,35 @@ int main() {
         // Cap delta time to prevent physics instability during window resize or lag spikes
         deltaTime = std::min(deltaTime, MAX_DELTA_TIME);
 
-        // Handle input events
-        inputHandler.handleEvents();
-        inputHandler.update(deltaTime);
-
-        // Update physics simulation
-        solarSystem.update(deltaTime);
+        {
+            // Everything that touches the system directly waits for the current physics step
+            std::lock_guard<std::mutex> lock(physics.getMutex());
+
+            // Drop bodies absorbed by merges; the published states still index the old layout
+            if (solarSystem.compactBodies() > 0) {
+                physics.republish();
+            }
+
+            // Handle input events
+            {
+                GRAVITY_PROFILE_SCOPE("events");
+                inputHandler.handleEvents();
+                inputHandler.update(deltaTime);
+            }
+
+            // The GPU backend needs this thread's GL context, so it takes over from the physics thread
+            physics.setSuspended(gpu.isActive());
+            if (gpu.isActive()) {
+                GRAVITY_PROFILE_SCOPE("gpuStep");
+                gpu.step(solarSystem, deltaTime);
+            }
+
+            GRAVITY_PROFILE_SCOPE("status");
+            renderer.updateStatus(solarSystem, deltaTime);
+        }
 
-        // Render everything
-        renderer.render(solarSystem, deltaTime);
+        // Render everything from the interpolated snapshot, without holding up the physics thread
+        renderer.render(solarSystem, physics.sample(), deltaTime);
 
         // Check if window was closed
         if (!window.isOpen()) {
@@ -66,6 +132,7 @@ int main() {
         }
     }
 
+    physics.stop();
     std::cout << "\nThank you for using the Solar System Gravity Simulator!" << std::endl;
     return 0;
 }
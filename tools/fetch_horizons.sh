@@ -0,0 +1,74 @@
+#!/bin/sh
+# Fetch state vectors for the Sun, planets and major moons from JPL Horizons
+# and write a scenario that uses them:
+#
+#   tools/fetch_horizons.sh DIR [DATE]
+#
+# DIR receives one vector table per body and horizons.csv; DATE (TDB,
+# YYYY-MM-DD) defaults to 2025-01-01. States are barycentric (@0) in the
+# ecliptic frame, in km and km/s. Run the result with
+#   GravitySimulator DIR/horizons.csv
+#   GravityBatch --scenario DIR/horizons.csv --3d
+set -e
+
+dir=${1:?usage: $0 DIR [DATE]}
+date=${2:-2025-01-01}
+api=https://ssd.jpl.nasa.gov/api/horizons.api
+mkdir -p "$dir"
+
+# Day after DATE, as Horizons wants a stop time after the start
+stop=$(date -u -d "$date + 1 day" +%Y-%m-%d 2>/dev/null || date -u -j -v+1d -f %Y-%m-%d "$date" +%Y-%m-%d)
+
+scenario="$dir/horizons.csv"
+{
+    echo "# JPL Horizons state vectors at $date TDB, barycentric ecliptic frame"
+    echo "mode,3d"
+} > "$scenario"
+
+# NAME ID MASS_KG RADIUS_M COLOR VISUAL_RADIUS PARENT
+while read -r name id mass radius color visual parent; do
+    case $name in ''|\#*) continue ;; esac
+    file="$name.txt"
+    echo "Fetching $name ($id)" >&2
+    curl -sfG "$api" \
+        --data-urlencode "format=text" \
+        --data-urlencode "COMMAND='$id'" \
+        --data-urlencode "OBJ_DATA='NO'" \
+        --data-urlencode "MAKE_EPHEM='YES'" \
+        --data-urlencode "EPHEM_TYPE='VECTORS'" \
+        --data-urlencode "CENTER='500@0'" \
+        --data-urlencode "REF_PLANE='ECLIPTIC'" \
+        --data-urlencode "START_TIME='$date'" \
+        --data-urlencode "STOP_TIME='$stop'" \
+        --data-urlencode "STEP_SIZE='1 d'" \
+        --data-urlencode "VEC_TABLE='2'" \
+        --data-urlencode "OUT_UNITS='KM-S'" \
+        --data-urlencode "CSV_FORMAT='YES'" \
+        -o "$dir/$file"
+    if [ "$parent" = "-" ]; then
+        echo "horizons,$name,$file,$mass,$radius,$color,$visual" >> "$scenario"
+    else
+        echo "horizons,$name,$file,$mass,$radius,$color,$visual,$parent" >> "$scenario"
+    fi
+done <<'BODIES'
+Sun       10  1.989e30   696340e3  #ffff00 20 -
+Mercury   199 3.3011e23  2439.7e3  #a9a9a9 4  Sun
+Venus     299 4.8675e24  6051.8e3  #ffc649 4  Sun
+Earth     399 5.972e24   6371e3    #6495ed 4  Sun
+Luna      301 7.342e22   1737.4e3  #ffffff 2  Earth
+Mars      499 6.4171e23  3389.5e3  #cd5c5c 4  Sun
+Phobos    401 1.0659e16  11.1e3    #8b8b8b 2  Mars
+Deimos    402 1.4762e15  6.2e3     #696969 2  Mars
+Jupiter   599 1.8982e27  69911e3   #ffa500 4  Sun
+Io        501 8.9319e22  1821.6e3  #ffff00 2  Jupiter
+Europa    502 4.7998e22  1560.8e3  #add8e6 2  Jupiter
+Ganymede  503 1.4819e23  2634.1e3  #8b7765 2  Jupiter
+Callisto  504 1.0759e23  2410.3e3  #404040 2  Jupiter
+Saturn    699 5.6834e26  58232e3   #daa520 4  Sun
+Titan     606 1.3452e23  2574e3    #ffa500 2  Saturn
+Enceladus 602 1.08022e20 252.1e3   #ffffff 2  Saturn
+Uranus    799 8.6810e25  25362e3   #40e0d0 4  Sun
+Neptune   899 1.02413e26 24622e3   #4169e1 4  Sun
+BODIES
+
+echo "Wrote $scenario" >&2